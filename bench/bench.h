@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace span::bench {
+    /**
+     * Keep the compiler from discarding a value computed only for its cost.
+     */
+    template<typename T>
+    inline void doNotOptimize(const T& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    struct Result {
+        std::string name;
+        size_t iterations{0};
+        size_t itemsPerIteration{1};
+        double medianNs{0};
+        double minNs{0};
+        double maxNs{0};
+    };
+
+    /**
+     * Minimal calibrating benchmark runner.
+     *
+     * Each benchmark's iteration count is doubled until one sample takes at
+     * least the minimum sample time, then several samples are taken at that
+     * count and reported as nanoseconds per iteration.
+     */
+    class Runner {
+    public:
+        using Body = std::function<void(size_t iterations)>;
+        // Runs the iterations and returns only the time that should be counted
+        using TimedBody = std::function<std::chrono::nanoseconds(size_t iterations)>;
+
+        Runner(std::string filter, const std::chrono::milliseconds minSampleTime, const size_t samples)
+            : filter(std::move(filter)), minSampleTime(minSampleTime), samples(std::max<size_t>(samples, 1)) {}
+
+        /**
+         * Time a body as a whole.
+         * @param name Benchmark name, matched against the filter
+         * @param body Runs the given number of iterations
+         * @param itemsPerIteration Items processed per iteration, for throughput
+         */
+        void run(const std::string& name, const Body& body, const size_t itemsPerIteration = 1) {
+            runTimed(name, [&body](const size_t iterations) {
+                const auto start = std::chrono::steady_clock::now();
+                body(iterations);
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start
+                );
+            }, itemsPerIteration);
+        }
+
+        /**
+         * Time a body that excludes its own setup from the measurement.
+         */
+        void runTimed(const std::string& name, const TimedBody& body, const size_t itemsPerIteration = 1) {
+            if (!filter.empty() && name.find(filter) == std::string::npos) {
+                return;
+            }
+
+            size_t iterations = 1;
+            while (true) {
+                if (body(iterations) >= minSampleTime || iterations >= MAX_ITERATIONS) {
+                    break;
+                }
+                iterations *= 2;
+            }
+
+            std::vector<double> perIteration;
+            perIteration.reserve(samples);
+            for (size_t i = 0; i < samples; ++i) {
+                perIteration.push_back(static_cast<double>(body(iterations).count()) / static_cast<double>(iterations));
+            }
+            std::ranges::sort(perIteration);
+
+            Result result;
+            result.name = name;
+            result.iterations = iterations;
+            result.itemsPerIteration = itemsPerIteration;
+            result.medianNs = perIteration[perIteration.size() / 2];
+            result.minNs = perIteration.front();
+            result.maxNs = perIteration.back();
+
+            std::fprintf(
+                stderr, "%-48s %14.1f ns/op %12zu iterations\n",
+                result.name.c_str(), result.medianNs, result.iterations
+            );
+            results.push_back(std::move(result));
+        }
+
+        [[nodiscard]] const std::vector<Result>& getResults() const { return results; }
+
+        /**
+         * Write all results as one JSON document.
+         */
+        void writeJson(std::ostream& out, const std::string& context) const {
+            out << "{\n  \"context\": " << context << ",\n  \"benchmarks\": [";
+            for (size_t i = 0; i < results.size(); ++i) {
+                const Result& result = results[i];
+                const double itemsPerSecond = result.medianNs > 0
+                    ? static_cast<double>(result.itemsPerIteration) * 1e9 / result.medianNs
+                    : 0;
+                out << (i ? ",\n" : "\n")
+                    << "    {\"name\": \"" << result.name << "\""
+                    << ", \"iterations\": " << result.iterations
+                    << ", \"ns_per_op\": " << result.medianNs
+                    << ", \"min_ns_per_op\": " << result.minNs
+                    << ", \"max_ns_per_op\": " << result.maxNs
+                    << ", \"items_per_second\": " << itemsPerSecond << "}";
+            }
+            out << "\n  ]\n}\n";
+        }
+
+    private:
+        static constexpr size_t MAX_ITERATIONS = size_t{1} << 30;
+
+        std::string filter;
+        std::chrono::milliseconds minSampleTime;
+        size_t samples;
+        std::vector<Result> results;
+    };
+} // namespace span::bench
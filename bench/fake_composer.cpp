@@ -0,0 +1,100 @@
+// Deterministic stand-in for the composer executable, for end-to-end
+// benchmarks without network access. Put its directory first on PATH.
+//
+// Supports the one invocation span makes:
+//
+//   composer require --working-dir=<dir> <package>[:<version>]
+//
+// It sleeps for a simulated install latency, then writes the package into
+// <dir>/vendor/<package>. Latency, file count and file size are derived from
+// a hash of "<package>:<version>", so every run behaves identically.
+//
+// Environment:
+//   SPAN_FAKE_COMPOSER_LATENCY_MS  Base latency per install (default 50)
+//   SPAN_FAKE_COMPOSER_JITTER_MS   Extra latency, 0..jitter per package (default 0)
+//   SPAN_FAKE_COMPOSER_FILES       Maximum files per package (default 8)
+//   SPAN_FAKE_COMPOSER_FILE_SIZE   Maximum bytes per file (default 4096)
+//   SPAN_FAKE_COMPOSER_LOG         Append one line per invocation to this file
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+    uint64_t getEnv(const char* name, const uint64_t fallback) {
+        const char* value = std::getenv(name);
+        return value ? std::strtoull(value, nullptr, 10) : fallback;
+    }
+
+    // FNV-1a, stable across platforms and standard libraries
+    uint64_t hash(const std::string_view value) {
+        uint64_t result = 1469598103934665603ULL;
+        for (const char c : value) {
+            result ^= static_cast<unsigned char>(c);
+            result *= 1099511628211ULL;
+        }
+        return result;
+    }
+}
+
+int main(const int argc, char** argv) {
+    std::string workingDir = ".";
+    std::string requirement;
+    std::string_view command;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view argument = argv[i];
+        if (argument.starts_with("--working-dir=")) {
+            workingDir = argument.substr(std::string_view("--working-dir=").size());
+        } else if (argument.starts_with("-")) {
+            continue;
+        } else if (command.empty()) {
+            command = argument;
+        } else if (requirement.empty()) {
+            requirement = argument;
+        }
+    }
+
+    if (command != "require" || requirement.empty()) {
+        std::cerr << "fake composer: only 'require --working-dir=<dir> <package>[:<version>]' is supported" << std::endl;
+        return 1;
+    }
+
+    const auto separator = requirement.find(':');
+    const std::string package = requirement.substr(0, separator);
+    const uint64_t seed = hash(requirement);
+
+    const uint64_t jitter = getEnv("SPAN_FAKE_COMPOSER_JITTER_MS", 0);
+    const uint64_t latency = getEnv("SPAN_FAKE_COMPOSER_LATENCY_MS", 50) + (jitter ? seed % (jitter + 1) : 0);
+    const uint64_t files = 1 + (seed >> 8) % std::max<uint64_t>(getEnv("SPAN_FAKE_COMPOSER_FILES", 8), 1);
+    const uint64_t fileSize = 1 + (seed >> 24) % std::max<uint64_t>(getEnv("SPAN_FAKE_COMPOSER_FILE_SIZE", 4096), 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(latency));
+
+    const fs::path packageDir = fs::path(workingDir) / "vendor" / package;
+    std::error_code error;
+    fs::create_directories(packageDir, error);
+    if (error) {
+        std::cerr << "fake composer: cannot create " << packageDir << ": " << error.message() << std::endl;
+        return 1;
+    }
+
+    for (uint64_t f = 0; f < files; ++f) {
+        std::ofstream(packageDir / ("File" + std::to_string(f) + ".php")) << std::string(fileSize, 'x');
+    }
+
+    if (const char* log = std::getenv("SPAN_FAKE_COMPOSER_LOG")) {
+        std::ofstream(log, std::ios::app) << requirement << " " << workingDir << " " << latency << "ms\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include "cache.h"
+#include "cli.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using dev::packages::Cache;
+
+namespace {
+    struct Options {
+        std::string outputDir;
+        std::string cacheDir;
+        size_t projects{1};
+        size_t packages{100};
+        size_t poolSize{0};
+        size_t fanOut{3};
+        size_t directRequires{20};
+        double hitRatio{0.0};
+        double filesPerPackage{20};
+        double fileSizeMedian{4096};
+        double fileSizeSigma{1.0};
+        uint64_t seed{1};
+    };
+
+    struct Package {
+        std::string name;
+        std::string version;
+        std::vector<size_t> dependencies;
+    };
+
+    std::vector<Package> makePool(const Options& options, std::mt19937_64& random) {
+        const size_t size = std::max(options.poolSize, options.packages);
+        std::uniform_int_distribution<int> minor(0, 30);
+        std::uniform_int_distribution<int> patch(0, 15);
+
+        std::vector<Package> pool(size);
+        for (size_t i = 0; i < size; ++i) {
+            pool[i].name = "fixture" + std::to_string(i % 113) + "/package-" + std::to_string(i);
+            pool[i].version = std::to_string(1 + i % 4) + "." + std::to_string(minor(random)) + "." +
+                std::to_string(patch(random));
+        }
+
+        // Dependencies only point forward, so the graph is acyclic like most real ones
+        for (size_t i = 0; i < size; ++i) {
+            if (i + 1 >= size) {
+                break;
+            }
+            std::uniform_int_distribution<size_t> target(i + 1, size - 1);
+            for (size_t edge = 0; edge < options.fanOut; ++edge) {
+                pool[i].dependencies.push_back(target(random));
+            }
+            std::ranges::sort(pool[i].dependencies);
+            const auto duplicates = std::ranges::unique(pool[i].dependencies);
+            pool[i].dependencies.erase(duplicates.begin(), duplicates.end());
+        }
+        return pool;
+    }
+
+    std::string jsonRequires(const std::vector<Package>& pool, const std::vector<size_t>& dependencies) {
+        std::string json = "{\"php\": \">=8.1\"";
+        for (const size_t dependency : dependencies) {
+            json += ", \"" + pool[dependency].name + "\": \"^" + pool[dependency].version + "\"";
+        }
+        return json + "}";
+    }
+
+    void writeProject(
+        const fs::path& projectDir,
+        const std::vector<Package>& pool,
+        const std::vector<size_t>& selected,
+        const Options& options
+    ) {
+        fs::create_directories(projectDir);
+
+        std::ofstream lock(projectDir / "composer.lock");
+        std::vector<size_t> dependencies;
+        lock << "{\n    \"_readme\": [\"Generated by span_fixtures\"],\n    \"content-hash\": \"\",\n"
+             << "    \"packages\": [";
+        for (size_t i = 0; i < selected.size(); ++i) {
+            const Package& package = pool[selected[i]];
+            // A lock file holds everything its packages require, so only selected packages are required
+            dependencies.clear();
+            std::ranges::copy_if(package.dependencies, std::back_inserter(dependencies), [&](const size_t dependency) {
+                return std::ranges::binary_search(selected, dependency);
+            });
+            lock << (i ? "," : "") << "\n        {\"name\": \"" << package.name << "\", "
+                 << "\"version\": \"" << package.version << "\", "
+                 << "\"dist\": {\"type\": \"zip\", \"url\": \"https://fixtures.invalid/" << package.name
+                 << "/" << package.version << ".zip\", \"reference\": \"\", \"shasum\": \"\"}, "
+                 << "\"require\": " << jsonRequires(pool, dependencies) << ", "
+                 << "\"type\": \"library\"}";
+        }
+        lock << "\n    ],\n    \"packages-dev\": [],\n    \"platform\": {}\n}\n";
+
+        const std::vector direct(selected.begin(), selected.begin() + std::min(options.directRequires, selected.size()));
+        std::ofstream composerJson(projectDir / "composer.json");
+        composerJson << "{\n    \"name\": \"fixtures/" << projectDir.filename().string() << "\",\n"
+                     << "    \"require\": " << jsonRequires(pool, direct) << "\n}\n";
+    }
+
+    uintmax_t fillPackage(
+        const fs::path& packageDir,
+        const Options& options,
+        std::mt19937_64& random
+    ) {
+        std::poisson_distribution<size_t> fileCount(options.filesPerPackage);
+        std::lognormal_distribution<double> fileSize(std::log(options.fileSizeMedian), options.fileSizeSigma);
+
+        fs::create_directories(packageDir / "src");
+        const size_t files = std::max<size_t>(fileCount(random), 1);
+        uintmax_t bytes = 0;
+        for (size_t f = 0; f < files; ++f) {
+            const auto size = static_cast<size_t>(std::min(fileSize(random), 64.0 * 1024 * 1024));
+            std::ofstream(packageDir / "src" / ("File" + std::to_string(f) + ".php")) << std::string(size, 'x');
+            bytes += size;
+        }
+        return bytes;
+    }
+}
+
+int main(const int argc, char** argv) {
+    CLI::App app{"Generate synthetic composer projects and a pre-populated span cache"};
+
+    Options options;
+    app.add_option("-o,--output", options.outputDir, "Directory to write projects into")->required();
+    app.add_option("--cache", options.cacheDir, "Span cache directory to pre-populate");
+    app.add_option("--projects", options.projects, "Number of projects");
+    app.add_option("--packages", options.packages, "Packages per project");
+    app.add_option("--pool", options.poolSize, "Distinct packages shared by all projects (defaults to --packages)");
+    app.add_option("--fan-out", options.fanOut, "Dependencies required by each package of the pool; projects keep those they include");
+    app.add_option("--direct", options.directRequires, "Packages required directly by composer.json");
+    app.add_option("--hit-ratio", options.hitRatio, "Fraction of the pool to place in the cache, 0..1")
+        ->check(CLI::Range(0.0, 1.0));
+    app.add_option("--files", options.filesPerPackage, "Mean number of files per package (Poisson)");
+    app.add_option("--file-size", options.fileSizeMedian, "Median file size in bytes (log-normal)");
+    app.add_option("--file-size-sigma", options.fileSizeSigma, "Log-normal sigma of file sizes");
+    app.add_option("--seed", options.seed, "Random seed; equal seeds produce identical fixtures");
+
+    CLI11_PARSE(app, argc, argv);
+
+    std::mt19937_64 random(options.seed);
+    const auto pool = makePool(options, random);
+
+    std::vector<size_t> order(pool.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+
+    for (size_t project = 0; project < options.projects; ++project) {
+        // Each project takes a random subset of the shared pool, kept in pool order
+        std::ranges::shuffle(order, random);
+        std::vector selected(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(options.packages));
+        std::ranges::sort(selected);
+
+        writeProject(fs::path(options.outputDir) / ("project-" + std::to_string(project)), pool, selected, options);
+    }
+
+    size_t cached = 0;
+    uintmax_t cachedBytes = 0;
+    if (!options.cacheDir.empty() && options.hitRatio > 0) {
+        std::bernoulli_distribution hit(options.hitRatio);
+        for (const Package& package : pool) {
+            if (!hit(random)) {
+                continue;
+            }
+            const fs::path packageDir = fs::path(options.cacheDir) / "composer" /
+                Cache::escapePath(package.name) / Cache::escapePath(package.version);
+            cachedBytes += fillPackage(packageDir, options, random);
+            ++cached;
+        }
+    }
+
+    std::cout << "Wrote " << options.projects << " project(s) with " << options.packages
+              << " packages each from a pool of " << pool.size() << " to " << options.outputDir << std::endl;
+    if (!options.cacheDir.empty()) {
+        std::cout << "Cached " << cached << " package(s), " << cachedBytes << " bytes, in "
+                  << options.cacheDir << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,636 @@
+#include "bench.h"
+#include "cache.h"
+#include "cli.h"
+#include "packages/cargo.h"
+#include "packages/composer.h"
+#include "packages/composer_resolver.h"
+#include "packages/go.h"
+#include "packages/lock_file_cache.h"
+#include "packages/npm.h"
+#include "packages/pnpm.h"
+#include "packages/python.h"
+#include "packages/package_table.h"
+#include "thread_pool.h"
+#include "vfs.h"
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+using dev::packages::Cache;
+using dev::packages::Cargo;
+using dev::packages::Composer;
+using dev::packages::Go;
+using dev::packages::LockFileCache;
+using dev::packages::Npm;
+using dev::packages::Pnpm;
+using dev::packages::Python;
+using dev::packages::PackageTable;
+using span::bench::doNotOptimize;
+
+namespace {
+    std::string packageName(const size_t i) {
+        return "vendor" + std::to_string(i % 97) + "/package" + std::to_string(i);
+    }
+
+    std::string packageVersion(const size_t i) {
+        return "1." + std::to_string(i % 50) + "." + std::to_string(i % 7);
+    }
+
+    /**
+     * Write a composer.lock shaped like a real one, with dist, source and require entries.
+     */
+    void writeLockFile(const fs::path& path, const size_t packages) {
+        std::ofstream out(path);
+        out << "{\n    \"content-hash\": \"0123456789abcdef\",\n    \"packages\": [";
+        for (size_t i = 0; i < packages; ++i) {
+            const std::string name = packageName(i);
+            out << (i ? "," : "") << "\n        {"
+                << "\"name\": \"" << name << "\", \"version\": \"" << packageVersion(i) << "\", "
+                << "\"source\": {\"type\": \"git\", \"url\": \"https://example.com/" << name << ".git\", "
+                << "\"reference\": \"" << std::string(40, 'a') << "\"}, "
+                << "\"dist\": {\"type\": \"zip\", \"url\": \"https://example.com/" << name << ".zip\", "
+                << "\"reference\": \"" << std::string(40, 'b') << "\", \"shasum\": \"\"}, "
+                << "\"require\": {\"php\": \">=8.1\", \"" << packageName(i + 1) << "\": \"^1.0\"}, "
+                << "\"type\": \"library\", \"license\": [\"MIT\"], "
+                << "\"description\": \"Synthetic package used by span_bench\"}";
+        }
+        out << "\n    ],\n    \"packages-dev\": []\n}\n";
+    }
+
+    /**
+     * Write a package-lock.json (lockfileVersion 3) with a hoisted tree and some nested packages.
+     */
+    void writeNpmLockFile(const fs::path& path, const size_t packages) {
+        std::ofstream out(path);
+        out << "{\n  \"name\": \"bench\",\n  \"lockfileVersion\": 3,\n  \"requires\": true,\n  \"packages\": {\n"
+            << "    \"\": {\"name\": \"bench\", \"dependencies\": {\"package0\": \"^1.0.0\"}}";
+        for (size_t i = 0; i < packages; ++i) {
+            const std::string name = "package" + std::to_string(i);
+            // Every tenth package is nested under the one before it, as npm does on version conflicts
+            const std::string path = i % 10 == 9
+                ? "node_modules/package" + std::to_string(i - 1) + "/node_modules/" + name
+                : "node_modules/" + name;
+            out << ",\n    \"" << path << "\": {"
+                << "\"version\": \"" << packageVersion(i) << "\", "
+                << "\"resolved\": \"https://registry.npmjs.org/" << name << "/-/" << name << "-" << packageVersion(i) << ".tgz\", "
+                << "\"integrity\": \"sha512-" << std::string(86, 'A') << "==\", "
+                << "\"dev\": " << (i % 3 == 0 ? "true" : "false") << ", "
+                << "\"dependencies\": {\"package" << i + 1 << "\": \"^1.0.0\"}, "
+                << "\"engines\": {\"node\": \">=18\"}}";
+        }
+        out << "\n  }\n}\n";
+    }
+
+    /**
+     * Write a pnpm-lock.yaml (lockfileVersion 9) where every package depends on the next two,
+     * and every tenth has a peer dependency.
+     */
+    void writePnpmLockFile(const fs::path& path, const size_t packages) {
+        const auto depPath = [](const size_t i) {
+            std::string key = packageName(i) + "@" + packageVersion(i);
+            if (i % 10 == 0) {
+                key += "(peer@1.0.0)";
+            }
+            return key;
+        };
+
+        std::ofstream out(path);
+        out << "lockfileVersion: '9.0'\n\nsettings:\n  autoInstallPeers: true\n  excludeLinksFromLockfile: false\n\n"
+            << "importers:\n\n  .:\n    dependencies:\n";
+        for (size_t i = 0; i < packages; i += 10) {
+            out << "      " << packageName(i) << ":\n        specifier: ^1.0.0\n        version: "
+                << depPath(i).substr(packageName(i).size() + 1) << "\n";
+        }
+        out << "\npackages:\n";
+        for (size_t i = 0; i < packages; ++i) {
+            out << "\n  " << packageName(i) << "@" << packageVersion(i) << ":\n"
+                << "    resolution: {integrity: sha512-" << std::string(86, 'A') << "==}\n"
+                << "    engines: {node: '>=18'}\n";
+        }
+        out << "\nsnapshots:\n";
+        for (size_t i = 0; i < packages; ++i) {
+            out << "\n  " << depPath(i) << ":\n    dependencies:\n";
+            for (const size_t dependency : {i + 1, i + 2}) {
+                out << "      " << packageName(dependency % packages) << ": "
+                    << depPath(dependency % packages).substr(packageName(dependency % packages).size() + 1) << "\n";
+            }
+        }
+    }
+
+    /**
+     * Write a uv.lock where the project depends on every package, each with an sdist
+     * and wheels for three platforms, and every tenth only on Windows.
+     */
+    void writeUvLockFile(const fs::path& path, const size_t packages) {
+        const auto name = [](const size_t i) { return "package-" + std::to_string(i); };
+        const auto hash = "sha256:" + std::string(64, 'a');
+
+        std::ofstream out(path);
+        out << "version = 1\nrequires-python = \">=3.9\"\n\n[[package]]\nname = \"bench\"\nversion = \"0.1.0\"\n"
+            << "source = { virtual = \".\" }\ndependencies = [\n";
+        for (size_t i = 0; i < packages; ++i) {
+            out << "    { name = \"" << name(i) << "\"" << (i % 10 == 9 ? ", marker = \"sys_platform == 'win32'\"" : "") << " },\n";
+        }
+        out << "]\n";
+        for (size_t i = 0; i < packages; ++i) {
+            const std::string file = "package_" + std::to_string(i) + "-" + packageVersion(i);
+            out << "\n[[package]]\nname = \"" << name(i) << "\"\nversion = \"" << packageVersion(i) << "\"\n"
+                << "source = { registry = \"https://pypi.org/simple\" }\n"
+                << "dependencies = [\n    { name = \"" << name((i + 1) % packages) << "\" },\n]\n"
+                << "sdist = { url = \"https://files.example/" << file << ".tar.gz\", hash = \"" << hash << "\", size = 1024 }\n"
+                << "wheels = [\n";
+            for (const char* platform : {"macosx_11_0_arm64", "manylinux_2_17_x86_64.manylinux2014_x86_64", "win_amd64"}) {
+                out << "    { url = \"https://files.example/" << file << "-cp312-cp312-" << platform << ".whl\", hash = \""
+                    << hash << "\", size = 1024 },\n";
+            }
+            out << "]\n";
+        }
+    }
+
+    /**
+     * Write a Cargo.lock (version 4) where every crate depends on the next two.
+     */
+    void writeCargoLockFile(const fs::path& path, const size_t packages) {
+        const auto name = [](const size_t i) { return "crate-" + std::to_string(i); };
+
+        std::ofstream out(path);
+        out << "# This file is automatically @generated by Cargo.\n# It is not intended for manual editing.\nversion = 4\n";
+        for (size_t i = 0; i < packages; ++i) {
+            out << "\n[[package]]\nname = \"" << name(i) << "\"\nversion = \"" << packageVersion(i) << "\"\n"
+                << "source = \"registry+https://github.com/rust-lang/crates.io-index\"\n"
+                << "checksum = \"" << std::string(64, 'a') << "\"\ndependencies = [\n";
+            for (const size_t dependency : {i + 1, i + 2}) {
+                out << " \"" << name(dependency % packages) << "\",\n";
+            }
+            out << "]\n";
+        }
+    }
+
+    /**
+     * Write a go.mod requiring every module and the go.sum listing their hashes.
+     */
+    void writeGoModule(const fs::path& directory, const size_t packages) {
+        const auto path = [](const size_t i) { return "example.com/module-" + std::to_string(i); };
+        const std::string hash = "h1:" + std::string(43, 'a') + "=";
+
+        fs::create_directories(directory);
+        std::ofstream mod(directory / Go::DEPS_FILE_NAME);
+        std::ofstream sum(directory / Go::LOCK_FILE_NAME);
+        mod << "module example.com/app\n\ngo 1.21\n\nrequire (\n";
+        for (size_t i = 0; i < packages; ++i) {
+            const std::string version = "v" + packageVersion(i);
+            mod << "\t" << path(i) << " " << version << (i % 2 ? " // indirect\n" : "\n");
+            sum << path(i) << " " << version << " " << hash << "\n"
+                << path(i) << " " << version << "/go.mod " << hash << "\n";
+        }
+        mod << ")\n";
+    }
+
+    /**
+     * Write a Composer repository where every package has three majors of five
+     * versions and requires the next two packages at its own major or the one
+     * before. The last package only has major 1, so the tail has to backtrack.
+     */
+    void writeComposerRepository(const fs::path& directory, const size_t packages) {
+        for (size_t i = 0; i < packages; ++i) {
+            const std::string name = packageName(i);
+            fs::create_directories((directory / "p2" / name).parent_path());
+            std::ofstream out(directory / "p2" / (name + ".json"));
+            out << "{\"packages\": {\"" << name << "\": [";
+            const size_t majors = i + 1 == packages ? 1 : 3;
+            for (size_t major = majors; major >= 1; --major) {
+                for (size_t minor = 5; minor-- > 0;) {
+                    const std::string version = std::to_string(major) + "." + std::to_string(minor) + ".0";
+                    out << (major != majors || minor != 4 ? "," : "")
+                        << "{\"name\": \"" << name << "\", \"version\": \"" << version << "\", "
+                        << "\"dist\": {\"type\": \"zip\", \"url\": \"https://example.com/" << name << ".zip\", "
+                        << "\"reference\": \"" << std::string(40, 'b') << "\", \"shasum\": \"\"}, \"require\": {";
+                    for (size_t dependency = i + 1; dependency < std::min(i + 3, packages); ++dependency) {
+                        out << (dependency > i + 1 ? ", " : "") << "\"" << packageName(dependency) << "\": \"^"
+                            << major << ".0 || ^" << std::max<size_t>(major - 1, 1) << ".0\"";
+                    }
+                    out << "}}";
+                }
+            }
+            out << "]}}\n";
+        }
+    }
+
+    void populateCache(const fs::path& cacheDir, const size_t packages, const size_t filesPerPackage) {
+        for (size_t i = 0; i < packages; ++i) {
+            const fs::path packageDir = cacheDir / "composer" /
+                Cache::escapePath(packageName(i)) / Cache::escapePath(packageVersion(i));
+            fs::create_directories(packageDir);
+            for (size_t f = 0; f < filesPerPackage; ++f) {
+                std::ofstream(packageDir / ("file" + std::to_string(f) + ".php")) << std::string(256, 'x');
+            }
+        }
+    }
+
+    void populateCache(
+        span::vfs::MemoryFileSystem& fileSystem,
+        const fs::path& cacheDir,
+        const size_t packages,
+        const size_t filesPerPackage
+    ) {
+        for (size_t i = 0; i < packages; ++i) {
+            const fs::path packageDir = cacheDir / "composer" /
+                Cache::escapePath(packageName(i)) / Cache::escapePath(packageVersion(i));
+            fileSystem.createDirectories(packageDir);
+            for (size_t f = 0; f < filesPerPackage; ++f) {
+                fileSystem.createFile(packageDir / ("file" + std::to_string(f) + ".php"), 256);
+            }
+        }
+    }
+
+    std::shared_ptr<const PackageTable> parseLockFile(const fs::path& lockFile) {
+        return Composer::parseLockFile(lockFile);
+    }
+
+    std::string getContext() {
+        std::ostringstream context;
+        context << "{\"timestamp\": " << std::chrono::duration_cast<std::chrono::seconds>(
+                       std::chrono::system_clock::now().time_since_epoch()
+                   ).count()
+                << ", \"hardware_concurrency\": " << std::thread::hardware_concurrency()
+#ifdef NDEBUG
+                << ", \"build_type\": \"release\""
+#else
+                << ", \"build_type\": \"debug\""
+#endif
+#if defined(__clang__)
+                << ", \"compiler\": \"clang " << __clang_version__ << "\""
+#elif defined(__GNUC__)
+                << ", \"compiler\": \"gcc " << __VERSION__ << "\""
+#endif
+                << "}";
+        return context.str();
+    }
+}
+
+int main(const int argc, char** argv) {
+    CLI::App app{"span microbenchmarks"};
+
+    std::string filter;
+    std::string jsonFile;
+    size_t minSampleMs = 100;
+    size_t samples = 5;
+
+    app.add_option("-f,--filter", filter, "Only run benchmarks whose name contains this string");
+    app.add_option("-o,--json", jsonFile, "Write results as JSON to this file instead of stdout");
+    app.add_option("--min-sample-ms", minSampleMs, "Minimum duration of one sample");
+    app.add_option("--samples", samples, "Number of samples per benchmark");
+
+    CLI11_PARSE(app, argc, argv);
+
+    const fs::path workDir = fs::temp_directory_path() / ("span-bench-" + std::to_string(::getpid()));
+    fs::create_directories(workDir);
+
+    span::bench::Runner runner(filter, std::chrono::milliseconds(minSampleMs), samples);
+
+    // Lock file parsing and lookup
+    for (const size_t packages : {100, 1000, 10000}) {
+        const fs::path lockFile = workDir / ("composer-" + std::to_string(packages) + ".lock");
+        writeLockFile(lockFile, packages);
+
+        runner.run("composer/parse_lock/" + std::to_string(packages), [&lockFile](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(Composer::parseLockFile(lockFile));
+            }
+        }, packages);
+
+        const fs::path npmLockFile = workDir / ("package-lock-" + std::to_string(packages) + ".json");
+        writeNpmLockFile(npmLockFile, packages);
+
+        runner.run("npm/parse_lock/" + std::to_string(packages), [&npmLockFile](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(Npm::parseLockFile(npmLockFile));
+            }
+        }, packages);
+
+        const fs::path pnpmLockFile = workDir / ("pnpm-lock-" + std::to_string(packages) + ".yaml");
+        writePnpmLockFile(pnpmLockFile, packages);
+
+        runner.run("pnpm/parse_lock/" + std::to_string(packages), [&pnpmLockFile](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(Pnpm::parseLockFile(pnpmLockFile));
+            }
+        }, packages);
+
+        const fs::path uvLockFile = workDir / ("uv-" + std::to_string(packages) + ".lock");
+        writeUvLockFile(uvLockFile, packages);
+
+        runner.run("python/parse_lock/" + std::to_string(packages), [&uvLockFile](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(Python::parseLockFile(uvLockFile, {3, 12, 0}));
+            }
+        }, packages);
+
+        const fs::path cargoLockFile = workDir / ("Cargo-" + std::to_string(packages) + ".lock");
+        writeCargoLockFile(cargoLockFile, packages);
+
+        runner.run("cargo/parse_lock/" + std::to_string(packages), [&cargoLockFile](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(Cargo::parseLockFile(cargoLockFile));
+            }
+        }, packages);
+
+        const fs::path goModule = workDir / ("go-" + std::to_string(packages));
+        writeGoModule(goModule, packages);
+
+        runner.run("go/parse_lock/" + std::to_string(packages), [&goModule](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(Go::parseLockFile(goModule / Go::LOCK_FILE_NAME));
+            }
+        }, packages);
+
+        const auto table = Composer::parseLockFile(lockFile);
+        std::vector<std::string> names;
+        for (size_t i = 0; i < packages; ++i) {
+            names.push_back(packageName(i));
+        }
+
+        runner.run("package_table/find/" + std::to_string(packages), [&table, &names](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(table->find(names[i % names.size()]));
+            }
+        });
+    }
+
+    // Resolving a composer.json without a lock file, with the repository already read
+    for (const size_t packages : {100, 1000}) {
+        const fs::path repositoryDir = workDir / ("composer-repository-" + std::to_string(packages));
+        writeComposerRepository(repositoryDir, packages);
+        dev::packages::composer::Repository repository(repositoryDir);
+        dev::packages::composer::RootPackage root;
+        root.require.push_back({packageName(0), "*"});
+
+        runner.run("composer/resolve/" + std::to_string(packages), [&](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(dev::packages::composer::resolve(repository, root));
+            }
+        }, packages);
+
+        // Reading a package's versions from the metadata index instead of its JSON
+        repository.update();
+        const dev::packages::composer::MetadataIndex index(repositoryDir / dev::packages::composer::MetadataIndex::FILE_NAME);
+        std::vector<std::string> names;
+        for (size_t i = 0; i < packages; ++i) {
+            names.push_back(packageName(i));
+        }
+
+        runner.run("composer/index/get_versions/" + std::to_string(packages), [&index, &names](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(index.getVersions(names[i % names.size()]));
+            }
+        });
+    }
+
+    // Matching a constraint against a package's versions one at a time, and all at once
+    {
+        namespace composer = dev::packages::composer;
+        std::vector<composer::Version> versions;
+        for (size_t i = 0; i < 1000; ++i) {
+            versions.push_back(*composer::parseVersion(std::to_string(i % 5) + "." + std::to_string(i % 13) + "." + std::to_string(i % 7)));
+        }
+        composer::PackedVersionList list;
+        for (const auto& version : versions) {
+            list.add(&version);
+        }
+        const composer::Constraint constraint = composer::Constraint::parse("^1.2 || ~2.0.3 || >=3.1 <3.5");
+        const composer::CompiledConstraint compiled(constraint);
+        std::vector<uint64_t> matches((list.size() + 63) / 64);
+
+        runner.run("composer/constraint/match_each/1000", [&constraint, &versions](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                for (const auto& version : versions) {
+                    doNotOptimize(constraint.matches(version));
+                }
+            }
+        }, versions.size());
+
+        runner.run("composer/constraint/match_all/1000", [&compiled, &list, &matches](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                compiled.match(list, matches);
+                doNotOptimize(matches.front());
+            }
+        }, versions.size());
+    }
+
+    // Lock file cache: hits, and misses that evict the least recently used table
+    {
+        const fs::path lockFile = workDir / "composer-1000.lock";
+        LockFileCache lockFileCache;
+        lockFileCache.get(lockFile, &parseLockFile);
+
+        runner.run("lock_file_cache/hit", [&](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(lockFileCache.get(lockFile, &parseLockFile));
+            }
+        });
+
+        std::vector<fs::path> lockFiles;
+        for (size_t i = 0; i < 8; ++i) {
+            lockFiles.push_back(workDir / ("evict-" + std::to_string(i) + ".lock"));
+            writeLockFile(lockFiles.back(), 100);
+        }
+        // Budget for roughly one table per shard, so every miss evicts
+        LockFileCache evictingCache(32 * 1024, 1);
+
+        runner.run("lock_file_cache/miss_evict", [&](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(evictingCache.get(lockFiles[i % lockFiles.size()], &parseLockFile));
+            }
+        });
+    }
+
+    // Cache probes and links
+    {
+        const fs::path cacheDir = workDir / "cache";
+        constexpr size_t packages = 1000;
+        populateCache(cacheDir, packages, 4);
+        const Cache cache(cacheDir.string());
+
+        runner.run("cache/is_cached/hit", [&cache](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(cache.isCached("composer", packageName(i % packages), packageVersion(i % packages)));
+            }
+        });
+
+        runner.run("cache/is_cached/miss", [&cache](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(cache.isCached("composer", packageName(i % packages), "0.0.0-missing"));
+            }
+        });
+
+        const fs::path vendorDir = workDir / "project" / "vendor";
+        runner.run("cache/link_from_cache", [&](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                const size_t package = i % packages;
+                doNotOptimize(cache.linkFromCache(
+                    "composer",
+                    packageName(package),
+                    packageVersion(package),
+                    (vendorDir / packageName(package)).string()
+                ));
+            }
+        });
+
+        // Hard links per file, as npm packages are installed; the targets already exist after the first pass
+        const fs::path nodeModulesDir = workDir / "project" / "node_modules";
+        runner.run("cache/materialize_from_cache", [&](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                const size_t package = i % packages;
+                doNotOptimize(cache.materializeFromCache(
+                    "composer",
+                    packageName(package),
+                    packageVersion(package),
+                    (nodeModulesDir / packageName(package)).string()
+                ));
+            }
+        });
+
+        runner.run("cache/escape_path", [](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(Cache::escapePath("symfony/polyfill-mbstring"));
+            }
+        });
+    }
+
+    // Cache cleanup: a full scan that evicts nothing, and one that evicts half
+    {
+        const fs::path cacheDir = workDir / "cleanup-cache";
+        constexpr size_t packages = 500;
+        constexpr size_t filesPerPackage = 4;
+        populateCache(cacheDir, packages, filesPerPackage);
+        const Cache cache(cacheDir.string());
+
+        runner.run("cache/cleanup/scan_" + std::to_string(packages), [&cache](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(cache.cleanup());
+            }
+        });
+
+        const size_t halfSize = packages * filesPerPackage * 256 / 2;
+        runner.runTimed("cache/cleanup/evict_half_" + std::to_string(packages), [&](const size_t iterations) {
+            std::chrono::nanoseconds elapsed{0};
+            for (size_t i = 0; i < iterations; ++i) {
+                populateCache(cacheDir, packages, filesPerPackage);
+                const auto start = std::chrono::steady_clock::now();
+                doNotOptimize(cache.cleanup(halfSize));
+                elapsed += std::chrono::steady_clock::now() - start;
+            }
+            return elapsed;
+        });
+    }
+
+    // The same cache operations on an in-memory filesystem, at a scale no test disk
+    // holds, and behind added per-call latency to model a cache on NFS
+    {
+        const auto memory = std::make_shared<span::vfs::MemoryFileSystem>();
+        constexpr size_t packages = 100000;
+        constexpr size_t filesPerPackage = 2;
+        populateCache(*memory, "/cache", packages, filesPerPackage);
+        const Cache cache("/cache", memory);
+
+        runner.run("vfs/memory/is_cached/hit_" + std::to_string(packages), [&cache](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(cache.isCached("composer", packageName(i % packages), packageVersion(i % packages)));
+            }
+        });
+
+        runner.run("vfs/memory/link_from_cache", [&cache](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                const size_t package = i % packages;
+                doNotOptimize(cache.linkFromCache(
+                    "composer",
+                    packageName(package),
+                    packageVersion(package),
+                    "/project/vendor/" + packageName(package)
+                ));
+            }
+        });
+
+        runner.run("vfs/memory/cleanup/scan_" + std::to_string(packages), [&cache](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(cache.cleanup());
+            }
+        });
+
+        const size_t halfSize = packages * filesPerPackage * 256 / 2;
+        runner.runTimed("vfs/memory/cleanup/evict_half_" + std::to_string(packages), [&](const size_t iterations) {
+            std::chrono::nanoseconds elapsed{0};
+            for (size_t i = 0; i < iterations; ++i) {
+                populateCache(*memory, "/cache", packages, filesPerPackage);
+                const auto start = std::chrono::steady_clock::now();
+                doNotOptimize(cache.cleanup(halfSize));
+                elapsed += std::chrono::steady_clock::now() - start;
+            }
+            return elapsed;
+        });
+
+        const auto nfs = std::make_shared<span::vfs::LatencyFileSystem>(memory, std::chrono::microseconds(200));
+        populateCache(*memory, "/cache", packages, filesPerPackage);
+        const Cache nfsCache("/cache", nfs);
+
+        runner.run("vfs/latency_200us/is_cached/hit", [&nfsCache](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(nfsCache.isCached("composer", packageName(i % packages), packageVersion(i % packages)));
+            }
+        });
+
+        const fs::path lockFile = "/project/composer.lock";
+        memory->createDirectories(lockFile.parent_path());
+        memory->writeFile(lockFile, [&workDir] {
+            std::ifstream in(workDir / "composer-1000.lock");
+            return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }());
+        LockFileCache nfsLockFileCache(LockFileCache::DEFAULT_MAX_BYTES, LockFileCache::DEFAULT_SHARD_COUNT, nfs);
+        const auto parseFromNfs = [&nfs](const fs::path& path) {
+            return Composer::parseLockFile(path, *nfs);
+        };
+        nfsLockFileCache.get(lockFile, parseFromNfs);
+
+        runner.run("vfs/latency_200us/lock_file_cache/hit", [&](const size_t iterations) {
+            for (size_t i = 0; i < iterations; ++i) {
+                doNotOptimize(nfsLockFileCache.get(lockFile, parseFromNfs));
+            }
+        });
+    }
+
+    // Thread pool: enqueue and complete empty tasks
+    {
+        span::threads::ThreadPool pool(std::thread::hardware_concurrency());
+        constexpr size_t batch = 1000;
+
+        runner.run("thread_pool/enqueue_" + std::to_string(batch), [&pool](const size_t iterations) {
+            std::vector<std::future<void>> futures;
+            futures.reserve(batch);
+            for (size_t i = 0; i < iterations; ++i) {
+                futures.clear();
+                for (size_t task = 0; task < batch; ++task) {
+                    futures.push_back(pool.enqueue([] {}));
+                }
+                for (auto& future : futures) {
+                    future.get();
+                }
+            }
+        }, batch);
+    }
+
+    std::error_code error;
+    fs::remove_all(workDir, error);
+
+    if (jsonFile.empty()) {
+        runner.writeJson(std::cout, getContext());
+    } else {
+        std::ofstream out(jsonFile);
+        runner.writeJson(out, getContext());
+    }
+
+    return 0;
+}
@@ -43,17 +43,23 @@ def main(source_dir, target_file):
     if not os.path.exists(target_dir):
         os.makedirs(target_dir)
 
+    # Sorted so the registration order, and with it detection order, is stable
+    managers.sort(key=lambda manager: manager['manager_name'])
+
     with open(target_file, 'w') as f:
         f.write('// This file is generated by cmake/generate_registrar.py. DO NOT EDIT.\n\n')
         f.write('#include "packages/manager_factory.h"\n')
         for manager in managers:
             f.write(f'#include "packages/{manager["header"]}"\n')
 
-        f.write('\nnamespace {\n')
+        # A function rather than static registrar objects, which the linker
+        # drops when span is linked as a static library
+        f.write('\nnamespace dev::packages {\n')
+        f.write('    void registerBuiltinManagers(ManagerFactory& factory) {\n')
         for manager in managers:
-            f.write(f'    static dev::packages::ManagerRegistrar<dev::packages::{manager["class_name"]}> '
-                    f'{manager["manager_name"]}_registrar("{manager["manager_name"]}");\n')
-        f.write('} // namespace\n')
+            f.write(f'        factory.registerManager<{manager["class_name"]}>("{manager["manager_name"]}");\n')
+        f.write('    }\n')
+        f.write('} // namespace dev::packages\n')
 
 if __name__ == '__main__':
     import sys
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "vfs.h"
+#include <memory>
 #include <string>
+#include <string_view>
 #include <filesystem>
+#include <functional>
 #include <optional>
 #include <vector>
 
@@ -9,11 +13,16 @@ namespace dev::packages {
     class Cache {
     public:
         /**
-         * Initializes the cache directory, creating it if it doesn't exist.
+         * Set up a cache without touching the disk; the cache directory is
+         * created when the first package is linked into it.
          *
          * @param customCacheDir Optional custom cache directory. If not provided, defaults to ~/.dev-cache.
+         * @param fileSystem The filesystem holding the cache. If not provided, the real one.
          */
-        explicit Cache(const std::optional<std::string>& customCacheDir = std::nullopt);
+        explicit Cache(
+            const std::optional<std::string>& customCacheDir = std::nullopt,
+            std::shared_ptr<span::vfs::FileSystem> fileSystem = nullptr
+        );
 
         /**
          * Get the cache directory path.
@@ -22,6 +31,13 @@ namespace dev::packages {
          */
         [[nodiscard]] std::string getCacheDir() const;
 
+        /**
+         * Get the filesystem the cache and the projects linked to it live on.
+         *
+         * @return The filesystem.
+         */
+        [[nodiscard]] const std::shared_ptr<span::vfs::FileSystem>& getFileSystem() const;
+
         /**
          * Get the total size of the cache directory.
          *
@@ -38,9 +54,9 @@ namespace dev::packages {
          * @return True if the package is cached, false otherwise.
          */
         [[nodiscard]] bool isCached(
-            const std::string& language,
-            const std::string& package,
-            const std::string& version
+            std::string_view language,
+            std::string_view package,
+            std::string_view version
         ) const;
 
         /**
@@ -53,9 +69,9 @@ namespace dev::packages {
          * @return True if the link was created successfully, false otherwise.
          */
         [[nodiscard]] bool linkFromCache(
-            const std::string& language,
-            const std::string& package,
-            const std::string& version,
+            std::string_view language,
+            std::string_view package,
+            std::string_view version,
             const std::string& targetDir
         ) const;
 
@@ -69,12 +85,106 @@ namespace dev::packages {
          * @return True if the link was created successfully, false otherwise.
          */
         [[nodiscard]] bool linkToCache(
-            const std::string& language,
-            const std::string& package,
-            const std::string& version,
+            std::string_view language,
+            std::string_view package,
+            std::string_view version,
             const std::string& sourceDir
         ) const;
 
+        /**
+         * Recreate a cached package in the target directory with every file
+         * hard-linked, for tools that resolve symlinks to their real path, such
+         * as Node's module resolution. Files are copied where they cannot be
+         * linked. Files already in the target are replaced, other entries kept.
+         *
+         * @param language The programming language of the package (e.g., "PHP").
+         * @param package The name of the package.
+         * @param version The version of the package.
+         * @param targetDir The directory to recreate the package in.
+         * @return True if the package is cached and every file was linked, false otherwise.
+         */
+        [[nodiscard]] bool materializeFromCache(
+            std::string_view language,
+            std::string_view package,
+            std::string_view version,
+            const std::string& targetDir
+        ) const;
+
+        /**
+         * Add a package installed in a project to the cache, with every file
+         * hard-linked. Does nothing if the package is already cached.
+         *
+         * @param language The programming language of the package (e.g., "PHP").
+         * @param package The name of the package.
+         * @param version The version of the package.
+         * @param sourceDir The directory containing the package.
+         * @param exclude A directory of the package to leave out, e.g. "node_modules"; empty for none.
+         * @return True if the package is now cached, false otherwise.
+         */
+        [[nodiscard]] bool materializeToCache(
+            std::string_view language,
+            std::string_view package,
+            std::string_view version,
+            const std::string& sourceDir,
+            std::string_view exclude = {}
+        ) const;
+
+        /**
+         * Add a package to the cache by creating it under a temporary path,
+         * which only becomes the package's cache path once fill returns.
+         *
+         * @param language The programming language of the package (e.g., "PHP").
+         * @param package The name of the package.
+         * @param version The version of the package.
+         * @param fill Creates the package directory at the path it is given; may throw.
+         * @return True if the package is now cached, false otherwise.
+         */
+        [[nodiscard]] bool addToCache(
+            std::string_view language,
+            std::string_view package,
+            std::string_view version,
+            const std::function<void(const std::filesystem::path& directory)>& fill
+        ) const;
+
+        /**
+         * Extract an archive into a directory, which is created if missing,
+         * for a fill passed to addToCache.
+         *
+         * @param archive A zip file if it ends in ".zip", a gzipped tarball otherwise.
+         * @param directory The directory to extract into.
+         * @param package The package the archive holds, for tracing.
+         * @param stripComponents Leading path components to drop from each tarball entry; zip files keep theirs.
+         * @throws PackageManagerError if the archive cannot be extracted.
+         */
+        void extractArchive(
+            const std::filesystem::path& archive,
+            const std::filesystem::path& directory,
+            std::string_view package,
+            size_t stripComponents = 0
+        ) const;
+
+        /**
+         * Remove a scratch directory a failed fill leaves next to the cache
+         * path it was filling, without throwing.
+         *
+         * @param path The scratch directory.
+         */
+        void discard(const std::filesystem::path& path) const noexcept;
+
+        /**
+         * Get where a package is cached, whether or not it is.
+         *
+         * @param language The programming language of the package (e.g., "PHP").
+         * @param package The name of the package.
+         * @param version The version of the package.
+         * @return The path of the package's cache directory.
+         */
+        [[nodiscard]] std::filesystem::path getPackagePath(
+            std::string_view language,
+            std::string_view package,
+            std::string_view version
+        ) const;
+
         /**
          * Verify the integrity of a cached package.
          *
@@ -84,9 +194,9 @@ namespace dev::packages {
          * @return True if the package is valid, false otherwise.
          */
         [[nodiscard]] bool verifyPackageIntegrity(
-            const std::string& language,
-            const std::string& package,
-            const std::string& version
+            std::string_view language,
+            std::string_view package,
+            std::string_view version
         ) const;
 
         /**
@@ -98,9 +208,9 @@ namespace dev::packages {
          * @return True if the package was successfully cleaned, false otherwise.
          */
         [[nodiscard]] bool cleanPackage(
-            const std::string& language,
-            const std::string& package,
-            const std::string& version
+            std::string_view language,
+            std::string_view package,
+            std::string_view version
         ) const;
 
         /**
@@ -112,11 +222,38 @@ namespace dev::packages {
         [[nodiscard]]
         bool cleanup(size_t maxSizeBytes = 5ULL * 1024 * 1024 * 1024) const; // 5GB default
 
+        /**
+         * Get a path next to the given one that no other thread or process
+         * writes to, for creating a file or directory before renaming it into place.
+         *
+         * @param path The path to create.
+         * @return The path with a ".partial-<pid>-<thread>" suffix.
+         */
+        static std::filesystem::path getPartialPath(const std::filesystem::path& path);
+
+        /**
+         * Escape a name for use as a single cache path component.
+         *
+         * @param path The name to escape.
+         * @return The name with every character outside [A-Za-z0-9._-] replaced by '_'.
+         */
+        static std::string escapePath(std::string_view path);
+
     private:
         std::string cacheDir;
+        std::shared_ptr<span::vfs::FileSystem> fileSystem;
 
         static std::string getDefaultCacheDir();
-        static std::string escapePath(const std::string& path);
+
+        /**
+         * Same as isCached, without counting towards the hit and miss metrics.
+         */
+        bool lookup(
+            const std::filesystem::path& path,
+            std::string_view language,
+            std::string_view package,
+            std::string_view version
+        ) const;
 
         void createSymlink(
             const std::filesystem::path& target,
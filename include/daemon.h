@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "cache.h"
+#include "packages/manager.h"
+#include "packages/manager_factory.h"
+#include "thread_pool.h"
+
+namespace span::daemon {
+    /**
+     * Wire protocol, one request per connection:
+     *
+     *   request:  <command>\t<directory>\n
+     *   response: (ok|error)\t<message>\n
+     *
+     * Commands are "install", "link" and "status". The directory is ignored
+     * for "status".
+     */
+    struct Response {
+        bool ok{false};
+        std::string message;
+    };
+
+    /**
+     * Get the default socket path.
+     *
+     * @return $SPAN_DAEMON_SOCKET if set, otherwise span.sock in $XDG_RUNTIME_DIR,
+     *         falling back to a per-user path in /tmp.
+     */
+    std::string getDefaultSocketPath();
+
+    class Server {
+    public:
+        /**
+         * @param socketPath Path of the Unix domain socket to listen on
+         * @param cache The cache shared by all requests
+         * @param managers The managers shared by all requests, created as projects need them
+         * @param maxConcurrentInstalls Size of the install pool shared by all requests
+         */
+        Server(
+            std::string socketPath,
+            std::shared_ptr<dev::packages::Cache> cache,
+            std::shared_ptr<dev::packages::ManagerSet> managers,
+            size_t maxConcurrentInstalls
+        );
+
+        ~Server();
+
+        Server(const Server&) = delete;
+        Server& operator=(const Server&) = delete;
+
+        /**
+         * Bind the socket and serve requests until stop() is called or the
+         * process receives SIGINT or SIGTERM.
+         *
+         * @throws std::runtime_error if the socket cannot be bound, or another
+         *         daemon is already listening on it
+         */
+        void run();
+
+        /**
+         * Ask a running server to stop after the requests in flight.
+         */
+        void stop();
+
+    private:
+        struct ProjectLock {
+            std::mutex mutex;
+            // Requests holding or waiting for the mutex; the entry goes once none are
+            size_t requests{0};
+        };
+
+        std::string socketPath;
+        std::shared_ptr<dev::packages::Cache> cache;
+        std::shared_ptr<dev::packages::ManagerSet> managers;
+        std::shared_ptr<threads::ThreadPool> installPool;
+        std::unique_ptr<threads::ThreadPool> connectionPool;
+        std::chrono::steady_clock::time_point startedAt;
+        std::atomic<bool> stopping{false};
+        std::atomic<uint64_t> requestsServed{0};
+        std::atomic<uint64_t> requestsActive{0};
+        int listenFd{-1};
+
+        // By normalized project directory, so requests for one project run one at a time
+        std::mutex projectLocksMutex;
+        std::unordered_map<std::string, ProjectLock> projectLocks;
+
+        void bindSocket();
+        void handleConnection(int fd);
+        Response handleRequest(const std::string& command, const std::string& directory);
+    };
+
+    class Client {
+    public:
+        explicit Client(std::string socketPath);
+
+        /**
+         * Check whether a daemon is accepting connections on the socket.
+         *
+         * @return True if a connection could be established.
+         */
+        [[nodiscard]] bool isAvailable() const;
+
+        /**
+         * Send one request and wait for its response.
+         *
+         * @param command The command to run
+         * @param directory The absolute project directory
+         * @return The response, or std::nullopt if the daemon could not be reached
+         */
+        [[nodiscard]] std::optional<Response> request(
+            const std::string& command,
+            const std::string& directory = ""
+        ) const;
+
+    private:
+        std::string socketPath;
+
+        [[nodiscard]] int connectSocket() const;
+    };
+} // namespace span::daemon
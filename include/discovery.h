@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include "vfs.h"
+
+namespace span::discovery {
+    /**
+     * Directories never descended into: version control metadata, and where
+     * package managers install, which holds projects of their own.
+     */
+    inline constexpr std::array SKIPPED_DIRECTORIES{".git", ".hg", ".svn", ".venv", "node_modules", "vendor"};
+
+    struct Options {
+        // Patterns in .gitignore syntax, matched relative to each root; they win over .gitignore files
+        std::vector<std::string> excludes;
+        // Skip what the .gitignore files in the tree exclude
+        bool useGitignore{true};
+        // Directories listed at once; 0 for twice the hardware threads, at least 4
+        size_t concurrency{0};
+    };
+
+    /**
+     * Find every project at or below the given directories, for monorepos
+     * with many projects.
+     *
+     * A directory is a project if it holds a marker file of a registered
+     * package manager. Directories are listed in parallel, each once, and
+     * symlinks are not followed. The tree is searched below projects too, so
+     * a workspace root and the projects inside it are all found.
+     *
+     * @param fileSystem The filesystem the directories are on
+     * @param roots Directories to search
+     * @param options Exclusions and concurrency
+     * @return Absolute, normalized project directories, sorted
+     */
+    std::vector<std::string> findProjects(
+        const vfs::FileSystem& fileSystem,
+        const std::vector<std::string>& roots,
+        const Options& options = {}
+    );
+
+    /**
+     * Match a path against a pattern in .gitignore syntax: '*' and '?' stop at
+     * '/', "**" spans directories, and [...] matches a character class.
+     * @param pattern The pattern, without a leading '!', '/' or a trailing '/'
+     * @param path The '/'-separated path to match
+     */
+    [[nodiscard]] bool matchesGlob(std::string_view pattern, std::string_view path);
+} // namespace span::discovery
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace span::hash {
+    using Md5Digest = std::array<uint8_t, 16>;
+    using Sha1Digest = std::array<uint8_t, 20>;
+    using Sha256Digest = std::array<uint8_t, 32>;
+    using Sha512Digest = std::array<uint8_t, 64>;
+
+    // Not for integrity; only where a format records an MD5, as composer.lock's content-hash does
+    [[nodiscard]] Md5Digest md5(std::string_view data);
+    [[nodiscard]] Sha1Digest sha1(std::string_view data);
+    [[nodiscard]] Sha256Digest sha256(std::string_view data);
+    [[nodiscard]] Sha512Digest sha512(std::string_view data);
+
+    /**
+     * Encode bytes as standard, padded base64.
+     */
+    [[nodiscard]] std::string toBase64(std::span<const uint8_t> bytes);
+
+    /**
+     * Encode bytes as lowercase hex, as Cargo and most tools print digests.
+     */
+    [[nodiscard]] std::string toHex(std::span<const uint8_t> bytes);
+
+    /**
+     * Decode hex, in either case.
+     * @return nullopt if the text is not an even number of hex digits
+     */
+    [[nodiscard]] std::optional<std::vector<uint8_t>> fromHex(std::string_view text);
+
+    /**
+     * Check data against a Subresource Integrity string, as found in npm lock
+     * files, e.g. "sha512-<base64>". The string may list several hashes
+     * separated by whitespace. As in SRI, only those of the strongest
+     * supported algorithm listed count (sha512, then sha256, then sha1), and
+     * the data matches if any of them does. URL-safe base64 is accepted as well.
+     *
+     * @param integrity The integrity string
+     * @param data The data to check
+     * @return False if no hash of the strongest algorithm matches, or none uses a supported one
+     */
+    [[nodiscard]] bool matchesIntegrity(std::string_view integrity, std::string_view data);
+} // namespace span::hash
@@ -1,13 +1,86 @@
 #pragma once
 
-#include <iostream>
-#include <mutex>
-#include <string>
-#include <sstream>
+#include <array>
+#include <atomic>
+#include <charconv>
 #include <chrono>
-#include <iomanip>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Lowest level compiled into the binary: 0 debug, 1 info, 2 warning, 3 error.
+// Calls below it through the SPAN_LOG_* and SPAN_EVENT_* macros are removed,
+// arguments included.
+#ifndef SPAN_LOG_LEVEL
+#ifdef NDEBUG
+#define SPAN_LOG_LEVEL 1
+#else
+#define SPAN_LOG_LEVEL 0
+#endif
+#endif
+
+#define SPAN_LOG_AT(LEVEL, CALL) \
+    do { \
+        if constexpr ((LEVEL) >= ::dev::Logger::COMPILED_LEVEL) { \
+            if (::dev::Logger::isEnabled(LEVEL)) { \
+                CALL; \
+            } \
+        } \
+    } while (false)
+
+#define SPAN_LOG_DEBUG(...) SPAN_LOG_AT(::dev::Logger::Level::DEBUG, ::dev::Logger::debug(__VA_ARGS__))
+#define SPAN_LOG_INFO(...) SPAN_LOG_AT(::dev::Logger::Level::INFO, ::dev::Logger::info(__VA_ARGS__))
+#define SPAN_LOG_WARNING(...) SPAN_LOG_AT(::dev::Logger::Level::WARNING, ::dev::Logger::warning(__VA_ARGS__))
+#define SPAN_LOG_ERROR(...) SPAN_LOG_AT(::dev::Logger::Level::ERROR, ::dev::Logger::error(__VA_ARGS__))
+
+#define SPAN_EVENT_DEBUG(...) \
+    SPAN_LOG_AT(::dev::Logger::Level::DEBUG, ::dev::Logger::event(::dev::Logger::Level::DEBUG, __VA_ARGS__))
+#define SPAN_EVENT_INFO(...) \
+    SPAN_LOG_AT(::dev::Logger::Level::INFO, ::dev::Logger::event(::dev::Logger::Level::INFO, __VA_ARGS__))
+#define SPAN_EVENT_WARNING(...) \
+    SPAN_LOG_AT(::dev::Logger::Level::WARNING, ::dev::Logger::event(::dev::Logger::Level::WARNING, __VA_ARGS__))
+#define SPAN_EVENT_ERROR(...) \
+    SPAN_LOG_AT(::dev::Logger::Level::ERROR, ::dev::Logger::event(::dev::Logger::Level::ERROR, __VA_ARGS__))
 
 namespace dev {
+    /**
+     * A typed key/value pair of a structured log event. The key must be a
+     * string literal; string values are copied when the event is recorded.
+     */
+    template<typename T>
+    struct LogField {
+        const char* key;
+        T value;
+    };
+
+    template<typename T>
+    LogField<T> field(const char* key, const T& value) {
+        return {key, value};
+    }
+
+    inline LogField<std::string_view> field(const char* key, const std::string& value) {
+        return {key, value};
+    }
+
+    inline LogField<std::string_view> field(const char* key, const char* value) {
+        return {key, value};
+    }
+
+    /**
+     * Asynchronous logger.
+     *
+     * Callers format their message into a reused thread-local buffer and push
+     * it into their thread's lock-free ring; a background thread drains every
+     * ring and writes lines to stdout in batches. Errors are written before
+     * the call returns, so they are never lost or reordered with stderr.
+     *
+     * Structured events skip formatting on the calling thread entirely: their
+     * fields are encoded as raw values and rendered as text or JSON lines by
+     * the writer.
+     */
     class Logger {
     public:
         enum class Level {
@@ -17,23 +90,54 @@ namespace dev {
             ERROR
         };
 
+        enum class Format {
+            TEXT,
+            JSON
+        };
+
+        enum class FieldType : uint8_t {
+            STRING,
+            INT,
+            UINT,
+            DOUBLE,
+            BOOL,
+            DURATION
+        };
+
+        static constexpr auto COMPILED_LEVEL = static_cast<Level>(SPAN_LOG_LEVEL);
+
         static void setLogLevel(const Level level) {
-            getLogger().currentLevel = level;
+            currentLevel.store(level, std::memory_order_relaxed);
+        }
+
+        /**
+         * Set how the writer renders lines. Applies to messages not yet written.
+         */
+        static void setFormat(Format format);
+
+        [[nodiscard]] static bool isEnabled(const Level level) {
+            return level >= COMPILED_LEVEL && level >= currentLevel.load(std::memory_order_relaxed);
         }
 
         template<typename... Args>
         static void debug(Args&&... args) {
-            log(Level::DEBUG, std::forward<Args>(args)...);
+            if constexpr (Level::DEBUG >= COMPILED_LEVEL) {
+                log(Level::DEBUG, std::forward<Args>(args)...);
+            }
         }
 
         template<typename... Args>
         static void info(Args&&... args) {
-            log(Level::INFO, std::forward<Args>(args)...);
+            if constexpr (Level::INFO >= COMPILED_LEVEL) {
+                log(Level::INFO, std::forward<Args>(args)...);
+            }
         }
 
         template<typename... Args>
         static void warning(Args&&... args) {
-            log(Level::WARNING, std::forward<Args>(args)...);
+            if constexpr (Level::WARNING >= COMPILED_LEVEL) {
+                log(Level::WARNING, std::forward<Args>(args)...);
+            }
         }
 
         template<typename... Args>
@@ -41,46 +145,118 @@ namespace dev {
             log(Level::ERROR, std::forward<Args>(args)...);
         }
 
-    private:
-        static Logger& getLogger() {
-            static Logger instance;
-            return instance;
+        /**
+         * Record a structured event.
+         *
+         * @param level The event level
+         * @param message Static description, e.g. "package linked"
+         * @param fields Fields made with dev::field(), e.g. field("package", name)
+         */
+        template<typename... Fields>
+        static void event(const Level level, const char* message, const Fields&... fields) {
+            if (!isEnabled(level)) {
+                return;
+            }
+
+            thread_local EventBuffer buffer;
+            buffer.size = 0;
+            buffer.put(message);
+            (buffer.encode(fields), ...);
+
+            write(level, true, {buffer.data.data(), buffer.size});
         }
 
+        /**
+         * Write every message logged so far before returning. Call before
+         * printing to stdout directly, so output keeps its order.
+         */
+        static void flush();
+
+    private:
+        static std::atomic<Level> currentLevel;
+
+        // Fields that do not fit are dropped
+        struct EventBuffer {
+            std::array<char, 4096> data;
+            size_t size{0};
+
+            template<typename T>
+            bool put(const T& value) {
+                return putBytes(&value, sizeof(value));
+            }
+
+            bool putBytes(const void* bytes, const size_t length) {
+                if (size + length > data.size()) {
+                    return false;
+                }
+                std::memcpy(data.data() + size, bytes, length);
+                size += length;
+                return true;
+            }
+
+            template<typename T>
+            void encode(const LogField<T>& field) {
+                const size_t start = size;
+                bool fits = put(field.key);
+
+                if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+                    const std::string_view value = field.value;
+                    fits = fits && put(FieldType::STRING) && put(static_cast<uint32_t>(value.size())) &&
+                        putBytes(value.data(), value.size());
+                } else if constexpr (std::is_same_v<T, bool>) {
+                    fits = fits && put(FieldType::BOOL) && put(field.value);
+                } else if constexpr (std::is_floating_point_v<T>) {
+                    fits = fits && put(FieldType::DOUBLE) && put(static_cast<double>(field.value));
+                } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+                    fits = fits && put(FieldType::INT) && put(static_cast<int64_t>(field.value));
+                } else if constexpr (std::is_integral_v<T>) {
+                    fits = fits && put(FieldType::UINT) && put(static_cast<uint64_t>(field.value));
+                } else {
+                    const int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(field.value).count();
+                    fits = fits && put(FieldType::DURATION) && put(nanoseconds);
+                }
+
+                if (!fits) {
+                    size = start;
+                }
+            }
+        };
+
         template<typename... Args>
         static void log(const Level level, Args&&... args) {
-            if (level < getLogger().currentLevel) {
+            if (!isEnabled(level)) {
                 return;
             }
 
-            std::stringstream message;
-            (message << ... << std::forward<Args>(args));
-
-            std::lock_guard<std::mutex> lock(getLogger().mutex);
-            const auto now = std::chrono::system_clock::now();
-            const auto time = std::chrono::system_clock::to_time_t(now);
+            thread_local std::string message;
+            message.clear();
+            (append(message, args), ...);
 
-            std::cout << "["
-                     << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S")
-                     << "]["
-                     << getLevelString(level)
-                     << "] "
-                     << message.str()
-                     << std::endl;
+            write(level, false, message);
         }
 
-        static const char* getLevelString(const Level level) {
-            switch (level) {
-                case Level::DEBUG: return "DEBUG";
-                case Level::INFO: return "INFO";
-                case Level::WARNING: return "WARN";
-                case Level::ERROR: return "ERROR";
-                default: return "UNKNOWN";
+        template<typename T>
+        static void append(std::string& out, const T& value) {
+            if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+                out.append(std::string_view(value));
+            } else if constexpr (std::is_same_v<T, bool>) {
+                out.append(value ? "true" : "false");
+            } else if constexpr (std::is_same_v<T, char>) {
+                out.push_back(value);
+            } else if constexpr (std::is_arithmetic_v<T>) {
+                char buffer[32];
+                const auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+                out.append(buffer, end);
+            } else {
+                std::ostringstream stream;
+                stream << value;
+                out.append(stream.str());
             }
         }
 
-        Logger() : currentLevel(Level::INFO) {}
-        Level currentLevel;
-        std::mutex mutex;
+        /**
+         * Push a formatted message or an encoded event into the calling thread's ring.
+         */
+        static void write(Level level, bool structured, std::string_view payload);
     };
 }
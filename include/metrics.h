@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace span::metrics {
+    class Counter {
+    public:
+        void add(const uint64_t amount = 1) {
+            value.fetch_add(amount, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] uint64_t get() const {
+            return value.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<uint64_t> value{0};
+    };
+
+    /**
+     * A level that goes up and down, remembering the highest level reached.
+     */
+    class Gauge {
+    public:
+        void increment() {
+            const int64_t current = value.fetch_add(1, std::memory_order_relaxed) + 1;
+            int64_t highest = maximum.load(std::memory_order_relaxed);
+            while (current > highest && !maximum.compare_exchange_weak(highest, current, std::memory_order_relaxed)) {}
+        }
+
+        void decrement() {
+            value.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] int64_t get() const { return value.load(std::memory_order_relaxed); }
+        [[nodiscard]] int64_t getMaximum() const { return maximum.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<int64_t> value{0};
+        std::atomic<int64_t> maximum{0};
+    };
+
+    /**
+     * Lock-free latency histogram with HDR-style log-linear buckets.
+     *
+     * Every power of two is split into 2^SUB_BUCKET_BITS linear sub-buckets,
+     * so any recorded value is reported within 1/2^SUB_BUCKET_BITS (12.5%) of
+     * its true value across the full 64-bit range. Values are nanoseconds.
+     */
+    class Histogram {
+    public:
+        static constexpr unsigned SUB_BUCKET_BITS = 3;
+        static constexpr unsigned SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+        static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+        void record(uint64_t value);
+
+        void record(const std::chrono::steady_clock::duration duration) {
+            record(static_cast<uint64_t>(std::max<int64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), 0
+            )));
+        }
+
+        [[nodiscard]] uint64_t getCount() const { return count.load(std::memory_order_relaxed); }
+        [[nodiscard]] uint64_t getSum() const { return sum.load(std::memory_order_relaxed); }
+        [[nodiscard]] uint64_t getMax() const { return max.load(std::memory_order_relaxed); }
+
+        /**
+         * Get the value at a percentile.
+         * @param percentile Between 0 and 100
+         * @return The upper bound of the bucket holding the percentile, or 0 if empty
+         */
+        [[nodiscard]] uint64_t getPercentile(double percentile) const;
+
+        /**
+         * Get the number of values less than or equal to a bound, at bucket precision.
+         */
+        [[nodiscard]] uint64_t getCountAtOrBelow(uint64_t bound) const;
+
+        static size_t getBucketIndex(uint64_t value);
+        static uint64_t getBucketUpperBound(size_t index);
+
+    private:
+        std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets{};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+    };
+
+    /**
+     * Records the lifetime of a scope into a histogram.
+     */
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Histogram& histogram)
+            : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+
+        ~ScopedTimer() {
+            histogram.record(std::chrono::steady_clock::now() - start);
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        Histogram& histogram;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    /**
+     * Process-wide registry of named metrics.
+     *
+     * Metrics are created once, usually into a function-local or file-level
+     * static reference, and then updated without touching the registry.
+     * Names follow Prometheus conventions; labels are given preformatted,
+     * e.g. phase="link".
+     */
+    class Registry {
+    public:
+        static Registry& getInstance();
+
+        Counter& counter(std::string_view name, std::string_view help, std::string_view labels = {});
+        Gauge& gauge(std::string_view name, std::string_view help, std::string_view labels = {});
+        Histogram& histogram(std::string_view name, std::string_view help, std::string_view labels = {});
+
+        /**
+         * Read a counter by name without creating it.
+         * @return The counter's value, or 0 if no such counter exists
+         */
+        [[nodiscard]] uint64_t getCounterValue(std::string_view name, std::string_view labels = {}) const;
+
+        /**
+         * Enable measurements that cost extra I/O, such as byte counts that
+         * require walking a package tree. Off unless metrics are exported.
+         */
+        void setDetailed(const bool enabled) { detailed.store(enabled, std::memory_order_relaxed); }
+        [[nodiscard]] bool isDetailed() const { return detailed.load(std::memory_order_relaxed); }
+
+        /**
+         * Human-readable summary, one metric per line.
+         */
+        [[nodiscard]] std::string toSummary() const;
+
+        /**
+         * JSON document with every metric, histograms as count, sum and percentiles.
+         */
+        [[nodiscard]] std::string toJson() const;
+
+        /**
+         * Prometheus text exposition format, for the node_exporter textfile collector.
+         */
+        [[nodiscard]] std::string toPrometheus() const;
+
+    private:
+        enum class Type { COUNTER, GAUGE, HISTOGRAM };
+
+        struct Entry {
+            Type type;
+            std::string name;
+            std::string help;
+            std::string labels;
+            Counter counter;
+            Gauge gauge;
+            // Histograms are a few KiB each, so only histogram entries carry one
+            std::unique_ptr<Histogram> histogram;
+        };
+
+        Registry() = default;
+
+        mutable std::mutex mutex;
+        // A deque keeps references to entries stable as metrics are added
+        std::deque<Entry> entries;
+        std::atomic<bool> detailed{false};
+
+        Entry& getOrCreate(Type type, std::string_view name, std::string_view help, std::string_view labels);
+    };
+
+    /**
+     * Write the registry to a file, atomically replacing it so collectors never
+     * read a partial file.
+     *
+     * @param path The destination file
+     * @param contents The rendered metrics
+     * @return True if the file was written
+     */
+    bool writeFile(const std::string& path, const std::string& contents);
+} // namespace span::metrics
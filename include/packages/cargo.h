@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <memory>
+#include "packages/manager.h"
+#include "packages/lock_file_cache.h"
+#include "cache.h"
+
+namespace fs = std::filesystem;
+
+namespace dev::packages {
+    /**
+     * Vendors the registry crates of a Cargo.lock into vendor/, as
+     * `cargo vendor --versioned-dirs` would, without running cargo.
+     *
+     * Every crate gets a directory vendor/<name>-<version> with the
+     * .cargo-checksum.json that cargo checks directory sources against.
+     * Crates come from a local store of .crate files (see getCrateStore),
+     * are checked against the lock file's checksum and unpacked into the
+     * cache once; projects get a symlink to the cached directory.
+     */
+    class Cargo final : public Manager {
+    public:
+        static constexpr const char* DEPS_FILE_NAME = "Cargo.toml";
+        static constexpr const char* LOCK_FILE_NAME = "Cargo.lock";
+        static constexpr const char* CHECKSUM_FILE_NAME = ".cargo-checksum.json";
+        static constexpr std::array MARKER_FILES{LOCK_FILE_NAME};
+
+        explicit Cargo(std::shared_ptr<Cache> cache);
+
+        bool isProjectType(const std::string& directory) override;
+
+        std::shared_ptr<const PackageTable> getInstalledVersions(
+            const std::string& directory
+        ) override;
+
+        /**
+         * Parse a Cargo.lock file, bypassing the lock file cache
+         * @param lockFile The lock file path
+         * @param fileSystem The filesystem to read it from
+         * @return Table of every registry crate, keyed by its directory below vendor
+         * @throws PackageManagerError if the file cannot be read or parsed
+         */
+        static std::shared_ptr<const PackageTable> parseLockFile(
+            const fs::path& lockFile,
+            const span::vfs::FileSystem& fileSystem = *span::vfs::getDefault()
+        );
+
+        /**
+         * Get the directory .crate files are read from: $SPAN_CARGO_CRATES, or
+         * cargo-crates in the cache directory. Crates are stored flat as
+         * <name>-<version>.crate, as in a Cargo local registry or Cargo's own
+         * download cache, ~/.cargo/registry/cache/<registry>.
+         */
+        [[nodiscard]] static fs::path getCrateStore(const Cache& cache);
+
+    private:
+        bool fillCache(
+            const std::string& directory,
+            std::string_view package,
+            std::string_view version
+        ) override;
+
+        [[nodiscard]] std::string getManagerName() const override;
+        [[nodiscard]] std::string getInstallDirectory() const override;
+        [[nodiscard]] std::string getDependencyFileName() const override;
+        [[nodiscard]] std::vector<std::string> getDependencyFiles() const override;
+
+        [[nodiscard]] std::string_view getCacheName(std::string_view package) const override;
+        [[nodiscard]] bool isInstalled(std::string_view package, std::string_view version, const fs::path& installPath) const override;
+        bool linkToCache(std::string_view package, std::string_view version, const std::string& installPath) const override;
+
+        LockFileCache lockFileCache;
+    };
+} // namespace dev::packages
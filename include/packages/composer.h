@@ -1,12 +1,13 @@
 #pragma once
 
+#include <array>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
 #include <filesystem>
 #include <memory>
-#include <chrono>
 #include "packages/manager.h"
+#include "packages/lock_file_cache.h"
 #include "cache.h"
 
 namespace fs = std::filesystem;
@@ -16,34 +17,73 @@ namespace dev::packages {
     public:
         static constexpr const char* DEPS_FILE_NAME = "composer.json";
         static constexpr const char* LOCK_FILE_NAME = "composer.lock";
+        // Entries whose presence makes a directory a Composer project
+        static constexpr std::array MARKER_FILES{LOCK_FILE_NAME, DEPS_FILE_NAME};
 
         explicit Composer(std::shared_ptr<Cache> cache);
 
         bool isProjectType(const std::string& directory) override;
 
-        std::unordered_map<std::string, std::string> getInstalledVersions(
+        std::shared_ptr<const PackageTable> getInstalledVersions(
             const std::string& directory
         ) override;
 
+        /**
+         * Parse a composer.lock file, bypassing the lock file cache
+         * @param lockFile The lock file path
+         * @param fileSystem The filesystem to read it from
+         * @return Table of every package in "packages" and "packages-dev"
+         * @throws PackageManagerError if the file cannot be read or parsed
+         */
+        static std::shared_ptr<const PackageTable> parseLockFile(
+            const fs::path& lockFile,
+            const span::vfs::FileSystem& fileSystem = *span::vfs::getDefault()
+        );
+
+        /**
+         * Get the directory package metadata is resolved against when a
+         * project has no lock file: $SPAN_COMPOSER_REPOSITORY, or
+         * composer-repository in the cache directory. It is laid out as a
+         * Composer v2 repository, p2/<vendor>/<name>.json, as Packagist serves
+         * it and as a mirror such as Satis writes it.
+         */
+        [[nodiscard]] static fs::path getMetadataRepository(const Cache& cache);
+
+        /**
+         * Compute the content-hash of a composer.lock, which Composer compares
+         * to composer.json to tell whether the lock file is up to date
+         * @param composerJson The contents of composer.json
+         * @throws simdjson::simdjson_error if it is not valid JSON
+         */
+        [[nodiscard]] static std::string getContentHash(std::string_view composerJson);
+
     private:
+        void resolveLockFile(const std::string& directory) override;
+
         bool installDependency(
             const std::string& directory,
-            const std::string& package,
-            const std::string& version
+            std::string_view package,
+            std::string_view version
+        ) override;
+
+        bool fillCache(
+            const std::string& directory,
+            std::string_view package,
+            std::string_view version
         ) override;
 
         [[nodiscard]] std::string getManagerName() const override;
         [[nodiscard]] std::string getInstallDirectory() const override;
         [[nodiscard]] std::string getDependencyFileName() const override;
+        [[nodiscard]] std::vector<std::string> getDependencyFiles() const override;
 
-        struct LockFileCache {
-            std::unordered_map<std::string, std::string> versions;
-            std::chrono::system_clock::time_point lastRead;
-            fs::file_time_type fileTimestamp;
-        };
+        /**
+         * Resolve a project's composer.json against the metadata repository
+         * and write the result to composer.lock, as `composer update` would.
+         * @throws PackageManagerError if it cannot be resolved
+         */
+        void writeLockFile(const std::string& directory);
 
-        std::unordered_map<std::string, LockFileCache> lockFileCache;
-        bool isLockFileCacheValid(const fs::path& lockFile) const;
-        void updateLockFileCache(const fs::path& lockFile);
+        LockFileCache lockFileCache;
     };
 } // namespace dev::packages
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Composer's versions and version constraints, as its VersionParser and
+ * the composer/semver library read them.
+ */
+namespace dev::packages::composer {
+    /**
+     * How stable a version is, with the values Composer gives them, so more
+     * stable is lower and "minimum-stability" is an upper limit.
+     */
+    enum class Stability : uint8_t {
+        STABLE = 0,
+        RC = 5,
+        BETA = 10,
+        ALPHA = 15,
+        DEV = 20,
+    };
+
+    /**
+     * Read a stability name, in any case: "stable", "RC", "beta", "alpha" or "dev"
+     */
+    [[nodiscard]] std::optional<Stability> parseStability(std::string_view name);
+
+    [[nodiscard]] std::string_view toString(Stability stability);
+
+    /**
+     * A normalized version: four numbers and a stage, "1.2" being 1.2.0.0 and
+     * "2.0.0-beta2" 2.0.0.0-beta2, or a branch, "dev-main".
+     */
+    struct Version {
+        // The stages of a release, in the order PHP's version_compare puts them
+        enum class Stage : uint8_t {
+            DEV,
+            ALPHA,
+            BETA,
+            RC,
+            STABLE,
+            PATCH,
+        };
+
+        std::array<uint64_t, 4> numbers{};
+        Stage stage{Stage::STABLE};
+        uint64_t stageNumber{0};
+        // The name of a branch, "main" for "dev-main"; such versions are only equal to themselves
+        std::string branch;
+
+        [[nodiscard]] bool isBranch() const { return !branch.empty(); }
+        [[nodiscard]] Stability getStability() const;
+
+        /**
+         * Write the version as Composer normalizes it, e.g. "1.2.0.0-beta2" or "dev-main"
+         */
+        [[nodiscard]] std::string toString() const;
+
+        // Branches order before every numbered version, and by name among themselves
+        std::strong_ordering operator<=>(const Version& other) const;
+        bool operator==(const Version& other) const = default;
+    };
+
+    /**
+     * Normalize a version as Composer does: "v1.2", "1.2.0-RC1", "1.0.0-p2",
+     * "1.x-dev", "dev-main", "2024.01.15" and the like.
+     * @return nullopt if it is not a version Composer accepts
+     */
+    [[nodiscard]] std::optional<Version> parseVersion(std::string_view text);
+
+    class ConstraintError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+     * A version constraint: a union of disjoint version intervals, and the
+     * branches it names. Numbered ranges never match branches.
+     */
+    class Constraint {
+    public:
+        struct Bound {
+            Version version;
+            bool inclusive{true};
+        };
+
+        // Missing bounds are unbounded
+        struct Interval {
+            std::optional<Bound> lower;
+            std::optional<Bound> upper;
+
+            [[nodiscard]] bool contains(const Version& version) const;
+        };
+
+        /**
+         * Parse a constraint such as "^1.2 || ~2.0.3", ">=5.4 <7", "1.0 - 2.0",
+         * "2.*", "dev-main" or "^1.0@beta". Stability flags and "as" aliases are
+         * dropped; see getStabilityFlag.
+         * @throws ConstraintError if it cannot be parsed
+         */
+        static Constraint parse(std::string_view text);
+
+        // "*": every version, branches too
+        static Constraint any();
+
+        // The versions between two bounds
+        static Constraint between(std::optional<Bound> lower, std::optional<Bound> upper);
+
+        // One branch, "dev-<name>"
+        static Constraint branch(std::string name);
+
+        // A default constructed constraint matches nothing
+        Constraint() = default;
+
+        [[nodiscard]] bool matches(const Version& version) const;
+
+        // Whether some version satisfies both, as when a requirement meets what a package provides
+        [[nodiscard]] bool intersects(const Constraint& other) const;
+
+        [[nodiscard]] Constraint intersect(const Constraint& other) const;
+        [[nodiscard]] Constraint unite(const Constraint& other) const;
+
+        [[nodiscard]] const std::vector<Interval>& getIntervals() const { return intervals; }
+        [[nodiscard]] const std::vector<std::string>& getBranches() const { return branches; }
+
+    private:
+        // Sorted and disjoint
+        std::vector<Interval> intervals;
+        // Sorted
+        std::vector<std::string> branches;
+        bool anyBranch{false};
+
+        void normalize();
+    };
+
+    /**
+     * A numbered version packed into two integers that order as the versions
+     * do: the major, minor and patch numbers in the high word, and the fourth
+     * number, the stage and the stage number in the low one.
+     */
+    struct PackedVersion {
+        // major:32 minor:16 patch:16
+        uint64_t high{0};
+        // build:16 stage:8 stageNumber:40
+        uint64_t low{0};
+
+        static constexpr PackedVersion max() { return {UINT64_MAX, UINT64_MAX}; }
+
+        auto operator<=>(const PackedVersion& other) const = default;
+    };
+
+    /**
+     * Pack a version
+     * @return nullopt for branches, and numbers too wide for their field,
+     *         such as dates written as one number
+     */
+    [[nodiscard]] std::optional<PackedVersion> pack(const Version& version);
+
+    /**
+     * Versions laid out to be matched all at once: the halves of their packed
+     * forms in two arrays, and the few that do not pack set aside.
+     */
+    class PackedVersionList {
+    public:
+        /**
+         * Add a version, which must outlive the list
+         * @param version The version, or nullptr for an entry that matches nothing
+         */
+        void add(const Version* version);
+
+        [[nodiscard]] size_t size() const { return high.size(); }
+
+    private:
+        friend class CompiledConstraint;
+
+        std::vector<uint64_t> high;
+        std::vector<uint64_t> low;
+        // Entries that did not pack, which are matched one at a time; nullptr matches nothing
+        std::vector<std::pair<uint32_t, const Version*>> unpacked;
+    };
+
+    /**
+     * A constraint compiled to inclusive ranges of packed versions, for
+     * matching many versions with integer comparisons only. Versions and
+     * bounds that do not pack fall back to the constraint itself.
+     */
+    class CompiledConstraint {
+    public:
+        CompiledConstraint() = default;
+        explicit CompiledConstraint(Constraint constraint);
+
+        [[nodiscard]] bool matches(const Version& version) const;
+
+        /**
+         * Match every version of a list in one pass, 64 at a time, without
+         * branches, so the compiler can vectorize it
+         * @param versions The versions
+         * @param matches A bitset of at least versions.size() bits; bit i is
+         *        set if version i matches and cleared otherwise
+         */
+        void match(const PackedVersionList& versions, std::span<uint64_t> matches) const;
+
+        [[nodiscard]] const Constraint& getConstraint() const { return constraint; }
+
+    private:
+        struct Range {
+            PackedVersion first;
+            PackedVersion last;
+        };
+
+        Constraint constraint;
+        // Sorted and disjoint
+        std::vector<Range> ranges;
+        // Some bound did not pack, so every version is matched by the constraint
+        bool fallback{false};
+
+        // Match up to 64 packed versions against the ranges, bit i for version i
+        static uint64_t matchBlock(const uint64_t* high, const uint64_t* low, size_t block, std::span<const Range> ranges);
+    };
+
+    /**
+     * Get the stability a root requirement allows its package, as Composer
+     * reads it from the constraint: an explicit "@beta", or what the versions
+     * it names imply, as "dev-main" or "2.0.0-RC1" do.
+     * @return The least stable one named, or nullopt if it names none
+     */
+    [[nodiscard]] std::optional<Stability> getStabilityFlag(std::string_view constraint);
+} // namespace dev::packages::composer
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "vfs.h"
+
+namespace fs = std::filesystem;
+
+namespace dev::packages::composer {
+    struct PackageVersion;
+
+    /**
+     * The size and modification time of a metadata file, which tell whether
+     * what was indexed from it is still current.
+     */
+    struct FileStamp {
+        // The modification time in nanoseconds; MISSING when there is no file
+        int64_t modified{MISSING};
+        uint64_t size{0};
+
+        static constexpr int64_t MISSING = INT64_MIN;
+
+        [[nodiscard]] bool exists() const { return modified != MISSING; }
+        bool operator==(const FileStamp& other) const = default;
+
+        [[nodiscard]] static FileStamp of(const span::vfs::Status& status);
+    };
+
+    /**
+     * The stamps of a package's two metadata files, <name>.json and <name>~dev.json.
+     */
+    struct PackageStamps {
+        FileStamp tagged;
+        FileStamp dev;
+
+        [[nodiscard]] bool exists() const { return tagged.exists() || dev.exists(); }
+        bool operator==(const PackageStamps& other) const = default;
+    };
+
+    /**
+     * A binary index of the packages of a Composer repository, so they are
+     * read without parsing JSON.
+     *
+     * The file holds a header and flat arrays of fixed-size records: packages
+     * sorted by name, their versions, the links of each version, the fields
+     * of each version as minified JSON, and one pool of the strings they all
+     * refer to by offset. It is memory-mapped, so finding a package is a
+     * binary search over the mapping and only the pages of what is read are
+     * loaded. Each package records the stamps of the files it was read from;
+     * a package whose files changed is re-read and put back, and save()
+     * rewrites the index with what was put. Records are in the host's byte
+     * order, as the index is a cache rather than something to share.
+     *
+     * A file that is missing, from another format version or truncated reads
+     * as an empty index. Not thread-safe; saving replaces the file by
+     * renaming, so other processes keep reading the one they mapped.
+     */
+    class MetadataIndex {
+    public:
+        static constexpr const char* FILE_NAME = ".span-index";
+
+        /**
+         * Open an index, mapping it if it exists.
+         * @param file The index file
+         * @param fileSystem Where it lives; only PosixFileSystem files are
+         *        mapped, those of other filesystems are read into memory
+         */
+        explicit MetadataIndex(
+            fs::path file,
+            span::vfs::FileSystem& fileSystem = *span::vfs::getDefault()
+        );
+        ~MetadataIndex();
+
+        MetadataIndex(const MetadataIndex&) = delete;
+        MetadataIndex& operator=(const MetadataIndex&) = delete;
+
+        /**
+         * Get the stamps a package was indexed with
+         * @return nullopt if it is not in the index
+         * @throws std::runtime_error if the index is corrupt
+         */
+        [[nodiscard]] std::optional<PackageStamps> getStamps(std::string_view name) const;
+
+        /**
+         * Get the versions of an indexed package, in the repository's order
+         * @return Empty if it is not in the index
+         * @throws std::runtime_error if the index is corrupt
+         */
+        [[nodiscard]] std::vector<PackageVersion> getVersions(std::string_view name) const;
+
+        /**
+         * Get the names of every package in the index, sorted.
+         */
+        [[nodiscard]] std::vector<std::string> getNames() const;
+
+        /**
+         * Replace what the index holds for a package, until save(). A package
+         * whose files both do not exist is dropped.
+         */
+        void put(std::string name, PackageStamps stamps, std::vector<PackageVersion> versions);
+
+        /**
+         * Write the index with everything put since it was opened, if
+         * anything was, and map the new file.
+         * @return Whether it was written
+         * @throws std::filesystem::filesystem_error if it cannot be written
+         * @throws std::runtime_error if the current index is corrupt
+         */
+        bool save();
+
+        [[nodiscard]] const fs::path& getFile() const { return file; }
+
+    private:
+        struct Mapping;
+        struct Entry {
+            PackageStamps stamps;
+            std::vector<PackageVersion> versions;
+        };
+
+        fs::path file;
+        span::vfs::FileSystem& fileSystem;
+        std::unique_ptr<Mapping> mapping;
+        // What was put since the index was opened, by name
+        std::map<std::string, Entry, std::less<>> pending;
+
+        /**
+         * Map an index file, or read it when it is not on the real filesystem
+         * @return nullptr if there is no file, or it is not an index of this format
+         */
+        static std::unique_ptr<Mapping> map(const fs::path& file, const span::vfs::FileSystem& fileSystem);
+    };
+} // namespace dev::packages::composer
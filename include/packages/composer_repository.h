@@ -0,0 +1,101 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "packages/composer_constraint.h"
+#include "packages/composer_index.h"
+#include "vfs.h"
+
+namespace fs = std::filesystem;
+
+namespace dev::packages::composer {
+    /**
+     * A requirement, conflict, replacement or provision of a package.
+     */
+    struct Link {
+        // In lower case, as Composer compares names
+        std::string name;
+        std::string constraint;
+    };
+
+    /**
+     * One version of a package, as a Composer repository describes it.
+     */
+    struct PackageVersion {
+        std::string name;
+        // As published, e.g. "v6.4.1"; what composer.lock records
+        std::string version;
+        Version normalized;
+        std::vector<Link> require;
+        std::vector<Link> conflict;
+        std::vector<Link> replace;
+        std::vector<Link> provide;
+        // Every field of the entry as minified JSON, in the repository's order
+        std::vector<std::pair<std::string, std::string>> fields;
+    };
+
+    /**
+     * Package metadata from a local directory laid out as a Composer v2
+     * repository, as Packagist serves it: p2/<vendor>/<name>.json for tagged
+     * versions and p2/<vendor>/<name>~dev.json for branches. The minified
+     * format, where each entry only lists what changed since the one before,
+     * is expanded.
+     *
+     * Packages are read through a MetadataIndex kept in the directory, so JSON
+     * is only parsed for packages whose files changed since they were
+     * indexed; save() writes what was parsed back to the index. Each package
+     * is read once, on first use. Not thread-safe.
+     */
+    class Repository {
+    public:
+        explicit Repository(
+            fs::path directory,
+            span::vfs::FileSystem& fileSystem = *span::vfs::getDefault()
+        );
+
+        /**
+         * Get every version of a package
+         * @param name The package name, in lower case
+         * @return Empty if the repository does not have the package; the
+         *         versions stay valid as long as the repository does
+         * @throws std::runtime_error if its metadata cannot be parsed
+         */
+        const std::vector<PackageVersion>& getVersions(const std::string& name);
+
+        /**
+         * Bring the index up to date with every package in the directory,
+         * re-reading those whose files changed and dropping those removed,
+         * and save it.
+         * @return The number of packages that were re-read or dropped
+         * @throws std::runtime_error if metadata cannot be parsed
+         */
+        size_t update();
+
+        /**
+         * Write the packages parsed since the repository was opened to its
+         * index. An index that cannot be written is only logged, as the
+         * packages are then parsed again next time.
+         */
+        void save();
+
+        [[nodiscard]] const fs::path& getDirectory() const { return directory; }
+
+    private:
+        fs::path directory;
+        span::vfs::FileSystem& fileSystem;
+        MetadataIndex index;
+        std::unordered_map<std::string, std::vector<PackageVersion>> packages;
+
+        /**
+         * Re-read a package into the index if its metadata files changed since
+         * it was indexed
+         * @return Whether it was re-read, or dropped as its files are gone
+         */
+        bool refresh(const std::string& name);
+        void load(const fs::path& file, const std::string& name, std::vector<PackageVersion>& versions) const;
+    };
+} // namespace dev::packages::composer
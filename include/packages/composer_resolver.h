@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "packages/composer_constraint.h"
+#include "packages/composer_repository.h"
+
+namespace dev::packages::composer {
+    /**
+     * What a composer.json asks for, as far as resolution is concerned.
+     */
+    struct RootPackage {
+        std::string name{"__root__"};
+        std::vector<Link> require;
+        std::vector<Link> requireDev;
+        std::vector<Link> conflict;
+        std::vector<Link> replace;
+        std::vector<Link> provide;
+        Stability minimumStability{Stability::STABLE};
+        bool preferStable{false};
+        // Versions of platform packages from config.platform, e.g. {"php", "8.2.0"}
+        std::vector<std::pair<std::string, std::string>> platform;
+    };
+
+    /**
+     * The versions chosen for a root package, split as composer.lock splits them.
+     */
+    struct Resolution {
+        // What "require" needs, sorted by name
+        std::vector<const PackageVersion*> packages;
+        // What only "require-dev" needs, sorted by name
+        std::vector<const PackageVersion*> devPackages;
+        // The stabilities root requirements allow beyond minimum-stability, sorted by name
+        std::vector<std::pair<std::string, Stability>> stabilityFlags;
+    };
+
+    class ResolutionError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+     * Check whether a name is a platform package, such as "php", "ext-json"
+     * or "composer-plugin-api", which is part of the environment rather than
+     * installed.
+     */
+    [[nodiscard]] bool isPlatformPackage(std::string_view name);
+
+    /**
+     * Choose a version of every package the root package needs, as
+     * `composer update` would, with the PubGrub algorithm.
+     *
+     * The candidates for each package are numbered in order of preference,
+     * so the set of versions a term allows is a bitset, and choosing a version
+     * is finding its lowest bit. When a choice leads to a conflict, the solver
+     * learns an incompatibility that explains it and backjumps, so it never
+     * repeats the same mistake.
+     *
+     * Only packages the root package can reach through requirements are
+     * considered, as Composer only loads those; a package that replaces or
+     * provides a name stands in for it if it is among them. Platform
+     * requirements are only checked against config.platform. Branch aliases
+     * are not applied.
+     *
+     * @param repository Where package metadata comes from
+     * @param root What composer.json requires
+     * @return The chosen versions, which point into the repository
+     * @throws ResolutionError explaining why, if no set of versions satisfies the requirements
+     */
+    [[nodiscard]] Resolution resolve(Repository& repository, const RootPackage& root);
+} // namespace dev::packages::composer
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include "packages/manager.h"
+#include "packages/lock_file_cache.h"
+#include "cache.h"
+
+namespace fs = std::filesystem;
+
+namespace dev::packages {
+    /**
+     * Vendors the modules a go.mod requires into vendor/, with the
+     * vendor/modules.txt that `go build -mod=vendor` checks, as `go mod vendor`
+     * would, without running go.
+     *
+     * Packages are listed by module path, so every module gets the directory
+     * of its import path below vendor. Module zips come from a local store in
+     * GOPROXY layout (see getModuleStore), are checked against the h1: hash
+     * of go.sum and unpacked into the cache once; projects get hard links to
+     * the cached files, since modules nest inside the directories of others.
+     */
+    class Go final : public Manager {
+    public:
+        static constexpr const char* DEPS_FILE_NAME = "go.mod";
+        static constexpr const char* LOCK_FILE_NAME = "go.sum";
+        static constexpr const char* MODULES_FILE_NAME = "modules.txt";
+        static constexpr std::array MARKER_FILES{LOCK_FILE_NAME};
+
+        explicit Go(std::shared_ptr<Cache> cache);
+
+        bool isProjectType(const std::string& directory) override;
+
+        std::shared_ptr<const PackageTable> getInstalledVersions(
+            const std::string& directory
+        ) override;
+
+        /**
+         * Parse a go.sum file and the go.mod next to it, bypassing the lock file cache
+         * @param lockFile The go.sum path
+         * @param fileSystem The filesystem to read them from
+         * @return Table of every required module go.sum has a zip hash for, keyed by module path;
+         *         sources are "<module>@<version>" after replacements, with the h1: hash as integrity
+         * @throws PackageManagerError if either file cannot be read or parsed
+         */
+        static std::shared_ptr<const PackageTable> parseLockFile(
+            const fs::path& lockFile,
+            const span::vfs::FileSystem& fileSystem = *span::vfs::getDefault()
+        );
+
+        /**
+         * Get the directory module zips are read from: $SPAN_GOPROXY_DIR, or
+         * goproxy in the cache directory. Zips are stored as a GOPROXY serves
+         * them, <module>/@v/<version>.zip with upper case letters escaped, as
+         * in Go's own download cache, $GOMODCACHE/cache/download.
+         */
+        [[nodiscard]] static fs::path getModuleStore(const Cache& cache);
+
+        /**
+         * Compute the h1: hash go.sum records for a module: a SHA-256 over the
+         * sorted SHA-256 sums of its files, as golang.org/x/mod/sumdb/dirhash does
+         * @param fileSystem The filesystem the module is on
+         * @param directory The module's root directory
+         * @param prefix The "<module>@<version>" its files are named under in the zip
+         * @return The hash, "h1:<base64>"
+         */
+        [[nodiscard]] static std::string hashModule(
+            const span::vfs::FileSystem& fileSystem,
+            const fs::path& directory,
+            std::string_view prefix
+        );
+
+    private:
+        bool fillCache(
+            const std::string& directory,
+            std::string_view package,
+            std::string_view version
+        ) override;
+
+        [[nodiscard]] std::string getManagerName() const override;
+        [[nodiscard]] std::string getInstallDirectory() const override;
+        [[nodiscard]] std::string getDependencyFileName() const override;
+        [[nodiscard]] std::vector<std::string> getDependencyFiles() const override;
+
+        [[nodiscard]] bool isInstalled(std::string_view package, std::string_view version, const fs::path& installPath) const override;
+        bool linkFromCache(std::string_view package, std::string_view version, const std::string& installPath) const override;
+        bool linkToCache(std::string_view package, std::string_view version, const std::string& installPath) const override;
+        void removeInstalled(const fs::path& installPath) override;
+        bool completeInstall(const std::string& directory, const PackageTable& versions) override;
+
+        /**
+         * The modules a vendor/modules.txt lists, with the version each was
+         * vendored at: the version, or "<path>@<version>" of a replacement, as
+         * in the lock file table.
+         */
+        struct VendoredModules {
+            fs::file_time_type modified;
+            uintmax_t size{0};
+            std::unordered_map<std::string, std::string> versions;
+        };
+
+        /**
+         * Read a project's vendor/modules.txt, reusing what was read while it is unchanged
+         * @param vendor The vendor directory
+         * @return Empty if there is none
+         */
+        std::shared_ptr<const VendoredModules> getVendoredModules(const fs::path& vendor) const;
+
+        LockFileCache lockFileCache;
+
+        // The go.mod each cached go.sum was parsed with, as modification time and size
+        std::mutex modFilesMutex;
+        std::unordered_map<std::string, std::pair<fs::file_time_type, uintmax_t>> modFiles;
+
+        // The modules.txt last read from each vendor directory
+        mutable std::mutex vendoredMutex;
+        mutable std::unordered_map<std::string, std::shared_ptr<const VendoredModules>> vendoredModules;
+    };
+} // namespace dev::packages
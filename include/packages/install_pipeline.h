@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "pipeline.h"
+#include "packages/manager.h"
+#include "packages/package_table.h"
+
+namespace dev::packages {
+    /**
+     * Install pipeline spanning any number of projects and managers.
+     *
+     * Every package flows through stages that each have their own workers and
+     * bounded queue, and moves on as soon as the previous stage is done with it:
+     *
+     *   parse   reads a project's lock file and queues its packages
+     *   link    uses packages already in the project or in the cache
+     *   fetch   installs the rest with the package manager
+     *   follow  links packages another project was filling, once that fill is done
+     *
+     * Cache hits are therefore linked while other lock files are still being
+     * parsed, and slow fetches only hold fetch workers. As in InstallPlan,
+     * packages are grouped by (manager, package, version) so a package shared
+     * by several projects is filled once.
+     */
+    class InstallPipeline {
+    public:
+        struct Options {
+            // Workers per stage; 0 picks a default from the hardware concurrency
+            size_t parseConcurrency{0};
+            size_t linkConcurrency{0};
+            size_t fetchConcurrency{0};
+            // Items that may wait in each stage's queue
+            size_t capacity{256};
+        };
+
+        struct ProjectReport {
+            std::string directory;
+            size_t packages{0};
+            size_t failures{0};
+            // Set if the project could not be parsed
+            std::string error;
+        };
+
+        struct Report {
+            // True if every project was parsed and every package installed or linked
+            bool success{true};
+            size_t packages{0};
+            size_t uniquePackages{0};
+            // In the order the projects were added
+            std::vector<ProjectReport> projects;
+        };
+
+        explicit InstallPipeline(Options options);
+        ~InstallPipeline();
+
+        InstallPipeline(const InstallPipeline&) = delete;
+        InstallPipeline& operator=(const InstallPipeline&) = delete;
+
+        /**
+         * Queue a project for parsing. Waits only while the parse queue is full.
+         * @param manager The manager detected for the project
+         * @param directory The project directory
+         * @return The project's index in Report::projects
+         */
+        size_t addProject(std::shared_ptr<Manager> manager, std::string directory);
+
+        /**
+         * Wait for every queued project to be installed. Call once.
+         * @return The outcome per project
+         */
+        Report finish();
+
+    private:
+        struct Project {
+            std::shared_ptr<Manager> manager;
+            std::string directory;
+            std::shared_ptr<const PackageTable> versions;
+            std::string error;
+            std::atomic<size_t> failures{0};
+        };
+
+        struct Fill;
+
+        struct Package {
+            Project* project{nullptr};
+            const PackageTable::Entry* entry{nullptr};
+            // Set for the package that fills the cache for everyone needing it
+            Fill* fill{nullptr};
+            std::chrono::steady_clock::time_point queuedAt;
+        };
+
+        struct Fill {
+            bool done{false};
+            std::vector<Package> followers;
+        };
+
+        std::mutex projectsMutex;
+        std::deque<Project> projects;
+
+        std::mutex fillsMutex;
+        std::unordered_map<std::string, Fill> fills;
+        std::atomic<size_t> unversioned{0};
+
+        // Declared in reverse flow order, so each stage is joined before the ones it feeds
+        span::pipeline::Stage<Package> followStage;
+        span::pipeline::Stage<Package> fetchStage;
+        span::pipeline::Stage<Package> linkStage;
+        span::pipeline::Stage<Project*> parseStage;
+
+        bool finished{false};
+
+        void parse(Project& project);
+        void link(Package& package);
+        void fetch(Package& package);
+        void follow(Package& package);
+
+        /**
+         * Record a package's outcome and release the projects waiting on its fill.
+         */
+        void complete(const Package& package, bool success);
+
+        void shutdown();
+    };
+} // namespace dev::packages
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "packages/manager.h"
+#include "packages/package_table.h"
+
+namespace dev::packages {
+    /**
+     * Install plan spanning any number of projects and managers, for counting
+     * what an install would do without doing it.
+     *
+     * Packages are grouped by (manager, package, version), as InstallPipeline
+     * groups them: the first project that needs a given package fills the
+     * cache for it and every other project only links it.
+     */
+    class InstallPlan {
+    public:
+        /**
+         * Add every package of a project to the plan.
+         * @param manager The manager detected for the project
+         * @param directory The project directory
+         * @throws PackageManagerError if the project has no dependency file or cannot be parsed
+         */
+        void addProject(const std::shared_ptr<Manager>& manager, const std::string& directory);
+
+        /**
+         * Get the number of packages across all projects.
+         */
+        [[nodiscard]] size_t size() const { return items.size(); }
+
+        /**
+         * Get the number of distinct packages that may need a cache fill.
+         */
+        [[nodiscard]] size_t getUniqueCount() const { return leaders.size(); }
+
+        [[nodiscard]] size_t getProjectCount() const { return directories.size(); }
+
+    private:
+        struct Item {
+            Manager* manager;
+            const std::string* directory;
+            PackageTable::Entry entry;
+        };
+
+        // Owners of everything the items point into
+        std::vector<std::shared_ptr<Manager>> managers;
+        std::vector<std::shared_ptr<const PackageTable>> tables;
+        std::deque<std::string> directories;
+
+        std::vector<Item> items;
+        std::vector<size_t> leaders;
+        std::unordered_set<std::string> fillKeys;
+    };
+} // namespace dev::packages
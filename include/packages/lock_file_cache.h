@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "packages/package_table.h"
+#include "vfs.h"
+
+namespace dev::packages {
+    /**
+     * Thread-safe cache of parsed lock files, keyed by lock file path.
+     *
+     * Entries are spread across independently locked shards. Loading is
+     * single-flight: concurrent requests for the same lock file wait on one
+     * parse instead of each parsing it. Entries are revalidated against the
+     * file's modification time and size, and each shard evicts its least
+     * recently used tables once it exceeds its share of the memory budget.
+     */
+    class LockFileCache {
+    public:
+        using Loader = std::function<std::shared_ptr<const PackageTable>(const std::filesystem::path&)>;
+
+        static constexpr size_t DEFAULT_MAX_BYTES = 64ULL * 1024 * 1024;
+        static constexpr size_t DEFAULT_SHARD_COUNT = 16;
+
+        /**
+         * @param maxBytes Memory budget for all parsed tables
+         * @param shardCount Number of independently locked shards
+         * @param fileSystem Where lock files are checked for changes; the real filesystem if null
+         */
+        explicit LockFileCache(
+            size_t maxBytes = DEFAULT_MAX_BYTES,
+            size_t shardCount = DEFAULT_SHARD_COUNT,
+            std::shared_ptr<span::vfs::FileSystem> fileSystem = nullptr
+        );
+
+        LockFileCache(const LockFileCache&) = delete;
+        LockFileCache& operator=(const LockFileCache&) = delete;
+
+        /**
+         * Get the parsed table for a lock file, loading it if it is missing or stale.
+         * @param lockFile The lock file path
+         * @param loader Parses the lock file; only called by one thread per file
+         * @return The parsed table
+         * @throws Whatever the loader throws, to every waiting caller
+         */
+        std::shared_ptr<const PackageTable> get(
+            const std::filesystem::path& lockFile,
+            const Loader& loader
+        );
+
+        /**
+         * Drop the cached table for a lock file, if any.
+         * @param lockFile The lock file path
+         */
+        void invalidate(const std::filesystem::path& lockFile);
+
+        /**
+         * Drop all cached tables.
+         */
+        void clear();
+
+        [[nodiscard]] size_t size() const;
+        [[nodiscard]] size_t getMemoryUsage() const;
+
+    private:
+        struct Entry {
+            std::shared_future<std::shared_ptr<const PackageTable>> table;
+            std::filesystem::file_time_type fileTimestamp;
+            uintmax_t fileSize{0};
+            size_t bytes{0};
+            uint64_t generation{0};
+            bool ready{false};
+            std::list<std::string>::iterator lruPosition;
+        };
+
+        struct Shard {
+            mutable std::mutex mutex;
+            std::unordered_map<std::string, Entry> entries;
+            // Most recently used at the front
+            std::list<std::string> lru;
+            size_t bytes{0};
+            uint64_t nextGeneration{0};
+        };
+
+        size_t maxBytesPerShard;
+        size_t shardCount;
+        std::unique_ptr<Shard[]> shards;
+        std::shared_ptr<span::vfs::FileSystem> fileSystem;
+
+        Shard& getShard(const std::string& key) const;
+        static void erase(Shard& shard, std::unordered_map<std::string, Entry>::iterator it);
+        void evict(Shard& shard, const std::string& keep) const;
+    };
+} // namespace dev::packages
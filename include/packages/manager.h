@@ -2,13 +2,20 @@
 
 #include <vector>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <stdexcept>
 #include <functional>
 #include <chrono>
+#include <filesystem>
 #include <memory>
+#include <span>
 #include <thread>
 #include "cache.h"
+#include "packages/package_table.h"
+
+namespace span::threads {
+    class ThreadPool;
+}
 
 namespace dev::packages {
     class PackageManagerError final : public std::runtime_error {
@@ -19,7 +26,10 @@ namespace dev::packages {
 
     class Manager {
     public:
-        using ProgressCallback = std::function<void(const std::string& package, float progress)>;
+        using ProgressCallback = std::function<void(std::string_view package, float progress)>;
+
+        // A version of "link:<target>" installs the package as a symlink to target, relative to its directory
+        static constexpr std::string_view LINK_PREFIX = "link:";
 
         explicit Manager(std::shared_ptr<Cache> cache);
         virtual ~Manager() = default;
@@ -33,12 +43,12 @@ namespace dev::packages {
         virtual bool isProjectType(const std::string& directory) = 0;
 
         /**
-         * Get map of installed package versions
+         * Get the table of installed package versions, without writing to the project
          * @param directory The project directory
-         * @return Map of package names to versions
+         * @return Shared, immutable table of package names to versions
          * @throws PackageManagerError if version information cannot be retrieved
          */
-        virtual std::unordered_map<std::string, std::string> getInstalledVersions(
+        virtual std::shared_ptr<const PackageTable> getInstalledVersions(
             const std::string& directory
         ) = 0;
 
@@ -48,6 +58,12 @@ namespace dev::packages {
          */
         virtual std::string getDependencyFileName() const = 0;
 
+        /**
+         * Get every file whose changes can change the installed packages
+         * @return File names relative to the project directory (e.g., "composer.json", "composer.lock")
+         */
+        virtual std::vector<std::string> getDependencyFiles() const;
+
         /**
          * Install all dependencies for the project
          * @param directory The project directory
@@ -66,30 +82,178 @@ namespace dev::packages {
          */
         bool linkDependencies(const std::string& directory);
 
+        /**
+         * Apply only the packages that differ from a previously applied table
+         * @param directory The project directory
+         * @param previous The table the install directory currently reflects
+         * @param success Set to false if any package failed to apply
+         * @return The table the install directory reflects afterwards
+         * @throws PackageManagerError if version information cannot be retrieved
+         */
+        std::shared_ptr<const PackageTable> syncDependencies(
+            const std::string& directory,
+            const std::shared_ptr<const PackageTable>& previous,
+            bool& success
+        );
+
+        /**
+         * Check whether a package can be shared between projects through the cache
+         * @param version The package version from the lock file
+         * @return False for an empty version, or a link version, which only points elsewhere in the project
+         */
+        static bool isCacheable(std::string_view version);
+
+        /**
+         * Quote an argument for a command run through /bin/sh, such as with std::system
+         * @param argument The argument
+         * @return The argument in single quotes, with any single quote in it escaped
+         */
+        static std::string quoteArgument(std::string_view argument);
+
         void setProgressCallback(ProgressCallback callback);
         void setTimeout(std::chrono::seconds timeout);
         void setMaxConcurrentInstalls(size_t max);
 
+        /**
+         * Run installs on a shared, long-lived pool instead of a pool per call
+         * @param pool The pool to use, or nullptr to create one per call
+         */
+        void setThreadPool(std::shared_ptr<span::threads::ThreadPool> pool);
+
     protected:
         std::shared_ptr<Cache> cache;
         ProgressCallback progressCallback;
         std::chrono::seconds timeout{300};
         size_t maxConcurrentInstalls{std::thread::hardware_concurrency()};
+        std::shared_ptr<span::threads::ThreadPool> threadPool;
 
+        /**
+         * Write the project's lock file if it has none and the manager can resolve it itself.
+         * Only installs call it, before getInstalledVersions; does nothing by default.
+         * @param directory The project directory
+         * @throws PackageManagerError if the dependencies cannot be resolved
+         */
+        virtual void resolveLockFile(const std::string& directory);
+
+        /**
+         * Install a package in the project, by default by filling the cache and linking from it
+         * @param directory The project directory
+         * @return true if the package is installed
+         */
         virtual bool installDependency(
             const std::string& directory,
-            const std::string& package,
-            const std::string& version
+            std::string_view package,
+            std::string_view version
+        );
+
+        /**
+         * Add a package to the cache without installing it in the project, for prefetching
+         * @param directory The project whose lock file lists the package; left untouched
+         * @return true if the package is now cached
+         */
+        virtual bool fillCache(
+            const std::string& directory,
+            std::string_view package,
+            std::string_view version
         ) = 0;
 
         virtual std::string getManagerName() const = 0;
         virtual std::string getInstallDirectory() const = 0;
 
+        /**
+         * Get the name a package is cached under
+         * @param package The package as listed in the lock file
+         * @return The package itself, unless the lock file lists packages by install path
+         */
+        virtual std::string_view getCacheName(std::string_view package) const;
+
+        /**
+         * Check whether a package is installed at the given version
+         * @param installPath Where the package is installed in the project
+         * @return True if the path exists; managers that can tell which version is installed also compare it
+         */
+        virtual bool isInstalled(std::string_view package, std::string_view version, const std::filesystem::path& installPath) const;
+
+        /**
+         * Make a cached package available in the project
+         * @param installPath Where the package is installed in the project
+         * @return false if the package is not cached or cannot be linked
+         */
+        virtual bool linkFromCache(std::string_view package, std::string_view version, const std::string& installPath) const;
+
+        /**
+         * Make a package installed in the project available to other projects through the cache
+         * @param installPath Where the package is installed in the project
+         * @return false if the package cannot be linked
+         */
+        virtual bool linkToCache(std::string_view package, std::string_view version, const std::string& installPath) const;
+
+        /**
+         * Remove a package from the project, for packages dropped from or changed in the lock file
+         * @param installPath Where the package is installed in the project
+         * @throws std::filesystem::filesystem_error if it cannot be removed
+         */
+        virtual void removeInstalled(const std::filesystem::path& installPath);
+
+        /**
+         * Write whatever the project needs besides its packages, once all of them are installed
+         * @param directory The project directory
+         * @param versions The table that was installed
+         * @return false if it cannot be written
+         */
+        virtual bool completeInstall(const std::string& directory, const PackageTable& versions);
+
+        /**
+         * Get the filesystem projects and the cache live on
+         * @return The cache's filesystem
+         */
+        span::vfs::FileSystem& getFileSystem() const;
+
     private:
+        friend class InstallPlan;
+        friend class InstallPipeline;
+        friend class Prefetcher;
+
+        bool installPackages(
+            const std::string& directory,
+            std::span<const PackageTable::Entry> packages
+        );
+
         bool installSingleDependency(
             const std::string& directory,
-            const std::string& package,
-            const std::string& version
+            std::string_view package,
+            std::string_view version
+        );
+
+        /**
+         * Use the package if it is already in the project, or link it from the cache
+         * @return true if the package is now available; false if it has to be fetched
+         */
+        bool linkExisting(
+            const std::string& directory,
+            std::string_view package,
+            std::string_view version
+        );
+
+        /**
+         * Point the symlink of a link version at its target, unless it already does
+         * @return true
+         * @throws PackageManagerError if the link cannot be created
+         */
+        bool linkPackage(
+            const std::filesystem::path& installPath,
+            std::string_view package,
+            std::string_view version
+        );
+
+        /**
+         * Install the package with the package manager, then add it to the cache
+         * @return true if the package was installed
+         */
+        bool fetchPackage(
+            const std::string& directory,
+            std::string_view package,
+            std::string_view version
         );
     };
 }
\ No newline at end of file
@@ -1,10 +1,15 @@
 #pragma once
 
 #include "manager.h"
+#include "vfs.h"
+#include <array>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <functional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
 namespace dev::packages {
     class ManagerFactory {
@@ -13,25 +18,111 @@ namespace dev::packages {
 
         static ManagerFactory& getInstance();
 
-        void registerManager(const std::string& name, ManagerCreator creator);
+        /**
+         * Register a manager
+         * @param name The manager name
+         * @param markerFiles Entry names whose presence in a directory makes it a project of this manager
+         * @param creator Creates the manager
+         */
+        void registerManager(const std::string& name, std::vector<std::string> markerFiles, ManagerCreator creator);
+
+        /**
+         * Register a manager class by its MARKER_FILES and a constructor taking the cache
+         * @param name The manager name
+         */
+        template<typename T>
+        void registerManager(const std::string& name) {
+            registerManager(
+                name,
+                {std::begin(T::MARKER_FILES), std::end(T::MARKER_FILES)},
+                [](std::shared_ptr<Cache> cache) {
+                    return std::make_shared<T>(cache);
+                }
+            );
+        }
 
         std::vector<std::shared_ptr<Manager>> createManagers(std::shared_ptr<Cache> cache);
 
+        /**
+         * Create one registered manager
+         * @param index The manager's position in registration order
+         * @param cache The cache for the manager to use
+         */
+        [[nodiscard]] std::shared_ptr<Manager> createManager(size_t index, std::shared_ptr<Cache> cache) const;
+
+        /**
+         * Match a directory's entries against every manager's marker files
+         * @param entries The directory's entries
+         * @return Positions of the matching managers, in registration order
+         */
+        [[nodiscard]] std::vector<size_t> detect(const std::vector<span::vfs::DirectoryEntry>& entries) const;
+
         [[nodiscard]] std::vector<std::string> getRegisteredManagerNames() const;
 
     private:
         ManagerFactory() = default;
         std::vector<ManagerCreator> creators_;
         std::vector<std::string> names_;
+        // Marker file name to the positions of the managers it identifies
+        std::unordered_map<std::string, std::vector<size_t>> markers_;
     };
 
+    /**
+     * The managers of one process, created on first use and shared by every
+     * project they are detected in. Thread-safe.
+     */
+    class ManagerSet {
+    public:
+        /**
+         * @param cache The cache shared by every manager
+         */
+        explicit ManagerSet(std::shared_ptr<Cache> cache);
+
+        /**
+         * Get the managers of a project, creating them on first use
+         *
+         * Lists the directory once and matches the entries against every
+         * manager's marker files, instead of each manager probing for its own.
+         *
+         * @param directory The project directory
+         * @return The managers in registration order; empty if none match
+         */
+        std::vector<std::shared_ptr<Manager>> detect(const std::string& directory);
+
+        /**
+         * Run installs of current and future managers on a shared pool
+         * @param pool The pool to use
+         */
+        void setThreadPool(std::shared_ptr<span::threads::ThreadPool> pool);
+
+        /**
+         * Get the number of managers created so far
+         */
+        [[nodiscard]] size_t size() const;
+
+    private:
+        std::shared_ptr<Cache> cache;
+        mutable std::mutex mutex;
+        // Indexed by registration order; null until first detected
+        std::vector<std::shared_ptr<Manager>> managers;
+        std::shared_ptr<span::threads::ThreadPool> threadPool;
+    };
+
+    /**
+     * Register every manager in src/packages. Generated at build time by
+     * cmake/generate_registrar.py, and called once by ManagerFactory::getInstance().
+     */
+    void registerBuiltinManagers(ManagerFactory& factory);
+
+    /**
+     * Registers a manager defined outside span, e.g. by an application that
+     * embeds it, from a static object: ManagerRegistrar<MyManager> registrar("mine");
+     */
     template<typename T>
     class ManagerRegistrar {
     public:
         explicit ManagerRegistrar(const std::string& name) {
-            ManagerFactory::getInstance().registerManager(name, [](std::shared_ptr<Cache> cache) {
-                return std::make_shared<T>(cache);
-            });
+            ManagerFactory::getInstance().registerManager<T>(name);
         }
     };
 }
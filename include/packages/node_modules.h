@@ -0,0 +1,103 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include "cache.h"
+
+namespace fs = std::filesystem;
+
+/**
+ * What the npm and pnpm managers share: finding and unpacking registry
+ * tarballs, and naming packages installed at a path below node_modules.
+ */
+namespace dev::packages::node_modules {
+    inline constexpr std::string_view DIRECTORY = "node_modules";
+    inline constexpr std::string_view NESTED_PREFIX = "/node_modules/";
+
+#if defined(__linux__)
+    inline constexpr std::string_view CURRENT_OS = "linux";
+#elif defined(__APPLE__)
+    inline constexpr std::string_view CURRENT_OS = "darwin";
+#elif defined(_WIN32)
+    inline constexpr std::string_view CURRENT_OS = "win32";
+#elif defined(__FreeBSD__)
+    inline constexpr std::string_view CURRENT_OS = "freebsd";
+#else
+    inline constexpr std::string_view CURRENT_OS = "";
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+    inline constexpr std::string_view CURRENT_CPU = "x64";
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    inline constexpr std::string_view CURRENT_CPU = "arm64";
+#elif defined(__i386__) || defined(_M_IX86)
+    inline constexpr std::string_view CURRENT_CPU = "ia32";
+#elif defined(__arm__)
+    inline constexpr std::string_view CURRENT_CPU = "arm";
+#else
+    inline constexpr std::string_view CURRENT_CPU = "";
+#endif
+
+    /**
+     * Check a package's "os" or "cpu" list, such as ["linux", "darwin"] or ["!win32"]
+     * @param values The list
+     * @param current CURRENT_OS or CURRENT_CPU
+     * @return True if the package can be installed here
+     */
+    [[nodiscard]] bool matchesPlatform(std::span<const std::string_view> values, std::string_view current);
+
+    /**
+     * Get the name of the package installed at a path, e.g. "b" for "a/node_modules/b"
+     * @param installPath The path below node_modules
+     * @return The part after the last nested node_modules
+     */
+    [[nodiscard]] std::string_view getPackageName(std::string_view installPath);
+
+    /**
+     * Get the directory tarballs are installed from: $SPAN_NPM_TARBALLS,
+     * or npm-tarballs in the cache directory. Tarballs are stored by
+     * registry path, e.g. <store>/@scope/name/-/name-1.0.0.tgz.
+     */
+    [[nodiscard]] fs::path getTarballStore(const Cache& cache);
+
+    /**
+     * Find the tarball of a registry package in the store
+     * @return <store>/<name>/-/<name without scope>-<version>.tgz
+     */
+    [[nodiscard]] fs::path getRegistryTarball(const fs::path& store, std::string_view name, std::string_view version);
+
+    /**
+     * Find the tarball a resolved URL or path refers to
+     * @param store The tarball store
+     * @param directory The project directory, for file: tarballs
+     * @param resolved A registry URL or a file: path
+     * @return The tarball path, or nullopt if it is neither
+     */
+    [[nodiscard]] std::optional<fs::path> locateTarball(
+        const fs::path& store,
+        const std::string& directory,
+        std::string_view resolved
+    );
+
+    /**
+     * Verify a tarball and unpack it into the cache
+     * @param cache The cache
+     * @param language The cache language, i.e. the manager name
+     * @param name The package name
+     * @param version The package version
+     * @param tarball The tarball
+     * @param integrity The lock file's integrity string; empty to skip the check
+     * @return false if the tarball is missing, fails the integrity check or cannot be unpacked
+     */
+    bool unpackToCache(
+        Cache& cache,
+        std::string_view language,
+        std::string_view name,
+        std::string_view version,
+        const fs::path& tarball,
+        std::string_view integrity
+    );
+} // namespace dev::packages::node_modules
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <memory>
+#include "packages/manager.h"
+#include "packages/lock_file_cache.h"
+#include "cache.h"
+
+namespace fs = std::filesystem;
+
+namespace dev::packages {
+    /**
+     * Installs the exact node_modules tree of an npm lock file (lockfileVersion
+     * 2 or 3), as `npm ci` would, without running npm.
+     *
+     * Packages are listed by install path ("a/node_modules/b"), so hoisting is
+     * reproduced as written in the lock file. Their tarballs are taken from a
+     * local store (see node_modules::getTarballStore), checked against the lock
+     * file's integrity hash and unpacked into the cache once; projects get hard
+     * links to the cached files, since Node resolves a symlinked package's own
+     * dependencies from its real path.
+     */
+    class Npm final : public Manager {
+    public:
+        static constexpr const char* DEPS_FILE_NAME = "package.json";
+        static constexpr const char* LOCK_FILE_NAME = "package-lock.json";
+        // Only a lock file pins the tree; a bare package.json is left to npm
+        static constexpr std::array MARKER_FILES{LOCK_FILE_NAME};
+
+        explicit Npm(std::shared_ptr<Cache> cache);
+
+        bool isProjectType(const std::string& directory) override;
+
+        std::shared_ptr<const PackageTable> getInstalledVersions(
+            const std::string& directory
+        ) override;
+
+        /**
+         * Parse a package-lock.json file, bypassing the lock file cache
+         * @param lockFile The lock file path
+         * @param fileSystem The filesystem to read it from
+         * @return Table of every package under node_modules, keyed by its path below node_modules
+         * @throws PackageManagerError if the file cannot be read or parsed, or is lockfileVersion 1
+         */
+        static std::shared_ptr<const PackageTable> parseLockFile(
+            const fs::path& lockFile,
+            const span::vfs::FileSystem& fileSystem = *span::vfs::getDefault()
+        );
+
+    private:
+        bool fillCache(
+            const std::string& directory,
+            std::string_view package,
+            std::string_view version
+        ) override;
+
+        [[nodiscard]] std::string getManagerName() const override;
+        [[nodiscard]] std::string getInstallDirectory() const override;
+        [[nodiscard]] std::string getDependencyFileName() const override;
+        [[nodiscard]] std::vector<std::string> getDependencyFiles() const override;
+
+        [[nodiscard]] std::string_view getCacheName(std::string_view package) const override;
+        [[nodiscard]] bool isInstalled(std::string_view package, std::string_view version, const fs::path& installPath) const override;
+        bool linkFromCache(std::string_view package, std::string_view version, const std::string& installPath) const override;
+        bool linkToCache(std::string_view package, std::string_view version, const std::string& installPath) const override;
+        void removeInstalled(const fs::path& installPath) override;
+
+        LockFileCache lockFileCache;
+    };
+} // namespace dev::packages
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dev::packages {
+    /**
+     * Immutable, sorted table of package versions.
+     *
+     * All names and versions live in a single shared character buffer and the
+     * records are stored contiguously, sorted by package name, so lookups are a
+     * binary search and iteration touches one allocation. Tables are built once
+     * with a Builder and handed out through shared ownership, never copied.
+     */
+    class PackageTable {
+    public:
+        struct Entry {
+            std::string_view name;
+            std::string_view version;
+        };
+
+        /**
+         * Where a package is installed from, for managers that install the
+         * archives listed in their lock file rather than by name.
+         */
+        struct Source {
+            // URL or path of the package archive
+            std::string_view resolved;
+            // Subresource Integrity string of the archive, e.g. "sha512-..."
+            std::string_view integrity;
+        };
+
+        /**
+         * Differences between two tables. Entries of added and changed point
+         * into the current table, entries of removed into the previous one.
+         */
+        struct Changes {
+            std::vector<Entry> added;
+            std::vector<Entry> changed;
+            std::vector<Entry> removed;
+
+            [[nodiscard]] bool empty() const {
+                return added.empty() && changed.empty() && removed.empty();
+            }
+        };
+
+        class Builder {
+        public:
+            /**
+             * Reserve space for the expected number of packages and characters.
+             * @param packages Expected number of packages
+             * @param bytes Expected total length of all names and versions
+             */
+            void reserve(size_t packages, size_t bytes);
+
+            /**
+             * Add a package. If the name was already added, the first version wins.
+             * @param name The package name
+             * @param version The package version, may be empty when unknown
+             */
+            void add(std::string_view name, std::string_view version);
+
+            /**
+             * Add a package along with where it is installed from.
+             * @param name The package name
+             * @param version The package version
+             * @param resolved URL or path of the package archive
+             * @param integrity Integrity string of the archive, may be empty
+             */
+            void add(
+                std::string_view name,
+                std::string_view version,
+                std::string_view resolved,
+                std::string_view integrity
+            );
+
+            /**
+             * Finalize the table. The builder is left empty.
+             * @return The immutable table
+             */
+            [[nodiscard]] std::shared_ptr<const PackageTable> build();
+
+        private:
+            struct PendingEntry {
+                size_t nameOffset;
+                size_t nameLength;
+                size_t versionOffset;
+                size_t versionLength;
+                size_t resolvedOffset{0};
+                size_t resolvedLength{0};
+                size_t integrityOffset{0};
+                size_t integrityLength{0};
+            };
+
+            std::string buffer;
+            std::vector<PendingEntry> pending;
+            bool hasSources{false};
+        };
+
+        PackageTable(const PackageTable&) = delete;
+        PackageTable& operator=(const PackageTable&) = delete;
+
+        /**
+         * Find a package by name.
+         * @param name The package name
+         * @return The matching entry, or nullptr if the package is not in the table
+         */
+        [[nodiscard]] const Entry* find(std::string_view name) const;
+
+        /**
+         * Get the version of a package.
+         * @param name The package name
+         * @return The version, or std::nullopt if the package is not in the table
+         */
+        [[nodiscard]] std::optional<std::string_view> getVersion(std::string_view name) const;
+
+        /**
+         * Get where a package is installed from.
+         * @param entry An entry of this table
+         * @return The source, or nullptr if the table was built without sources
+         */
+        [[nodiscard]] const Source* getSource(const Entry& entry) const;
+
+        [[nodiscard]] std::span<const Entry> entries() const { return records; }
+        [[nodiscard]] size_t size() const { return records.size(); }
+        [[nodiscard]] bool empty() const { return records.empty(); }
+        [[nodiscard]] auto begin() const { return records.cbegin(); }
+        [[nodiscard]] auto end() const { return records.cend(); }
+
+        /**
+         * Compare two tables in a single merge pass over their sorted records.
+         * @param previous The older table
+         * @param current The newer table
+         * @return The packages added, changed or removed in current
+         */
+        static Changes diff(const PackageTable& previous, const PackageTable& current);
+
+        /**
+         * Get the approximate heap footprint of the table.
+         * @return The size in bytes
+         */
+        [[nodiscard]] size_t getMemoryUsage() const;
+
+        /**
+         * Get an empty table shared by all callers.
+         * @return The empty table
+         */
+        static std::shared_ptr<const PackageTable> emptyTable();
+
+    private:
+        PackageTable() = default;
+
+        std::string buffer;
+        std::vector<Entry> records;
+        // Parallel to records; empty unless the lock file lists sources
+        std::vector<Source> sources;
+    };
+} // namespace dev::packages
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <memory>
+#include "packages/manager.h"
+#include "packages/lock_file_cache.h"
+#include "cache.h"
+
+namespace fs = std::filesystem;
+
+namespace dev::packages {
+    /**
+     * Installs a pnpm lock file (lockfileVersion 6 or 9) as pnpm lays it out,
+     * without running pnpm.
+     *
+     * Every package version, per set of peer dependencies, gets one directory
+     * in the project's virtual store, node_modules/.pnpm/<name>@<version>/node_modules/<name>,
+     * next to symlinks to its own dependencies. The project's direct
+     * dependencies are symlinks into the store, so a package needed at many
+     * places in the tree is still written once. Package files are hard links
+     * to the cache, and tarballs come from the same store as npm's.
+     */
+    class Pnpm final : public Manager {
+    public:
+        static constexpr const char* DEPS_FILE_NAME = "package.json";
+        static constexpr const char* LOCK_FILE_NAME = "pnpm-lock.yaml";
+        static constexpr std::array MARKER_FILES{LOCK_FILE_NAME};
+
+        explicit Pnpm(std::shared_ptr<Cache> cache);
+
+        bool isProjectType(const std::string& directory) override;
+
+        std::shared_ptr<const PackageTable> getInstalledVersions(
+            const std::string& directory
+        ) override;
+
+        /**
+         * Parse a pnpm-lock.yaml file, bypassing the lock file cache
+         * @param lockFile The lock file path
+         * @param fileSystem The filesystem to read it from
+         * @return Table of every package and symlink below node_modules, keyed by its path there;
+         *         symlinks have a link version
+         * @throws PackageManagerError if the file cannot be read or parsed, or is older than lockfileVersion 6
+         */
+        static std::shared_ptr<const PackageTable> parseLockFile(
+            const fs::path& lockFile,
+            const span::vfs::FileSystem& fileSystem = *span::vfs::getDefault()
+        );
+
+        /**
+         * Get the virtual store directory of a package, as pnpm names it
+         * @param depPath The package as the lock file lists it, e.g. "react-dom@18.2.0(react@18.2.0)"
+         * @return The directory name below node_modules/.pnpm, e.g. "react-dom@18.2.0_react@18.2.0"
+         */
+        static std::string getStoreDirectory(std::string_view depPath);
+
+    private:
+        bool fillCache(
+            const std::string& directory,
+            std::string_view package,
+            std::string_view version
+        ) override;
+
+        [[nodiscard]] std::string getManagerName() const override;
+        [[nodiscard]] std::string getInstallDirectory() const override;
+        [[nodiscard]] std::string getDependencyFileName() const override;
+        [[nodiscard]] std::vector<std::string> getDependencyFiles() const override;
+
+        [[nodiscard]] std::string_view getCacheName(std::string_view package) const override;
+        [[nodiscard]] bool isInstalled(std::string_view package, std::string_view version, const fs::path& installPath) const override;
+        bool linkFromCache(std::string_view package, std::string_view version, const std::string& installPath) const override;
+        bool linkToCache(std::string_view package, std::string_view version, const std::string& installPath) const override;
+
+        LockFileCache lockFileCache;
+    };
+} // namespace dev::packages
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "packages/manager.h"
+#include "packages/package_table.h"
+
+namespace dev::packages {
+    /**
+     * Fills the cache with the packages of any number of projects ahead of
+     * their installs, so that those only link. Projects are read but never
+     * changed.
+     *
+     * Packages are grouped by (manager, package, version) as in InstallPlan,
+     * and those already cached are skipped. Fills run on workers of their own,
+     * at the lowest CPU and I/O priority, paced by two token buckets: one on
+     * packages started per second, and one on the time spent filling, which
+     * holds a prefetch to a share of a core and a disk however large its
+     * packages are. That way it can run next to latency-sensitive services.
+     */
+    class Prefetcher {
+    public:
+        struct Options {
+            // Packages filled at once
+            size_t concurrency{1};
+            // Packages started per second; 0 for no limit
+            double packagesPerSecond{0};
+            // Share of wall time spent filling, summed over workers, e.g. 0.25; 0 for no limit
+            double busyShare{0};
+            // Lower the workers, and the commands they run, to the lowest CPU and I/O priority
+            bool lowPriority{true};
+        };
+
+        struct Report {
+            // Distinct packages that can be cached
+            size_t packages{0};
+            size_t cached{0};
+            size_t filled{0};
+            size_t failures{0};
+            // Time workers waited for the budget, summed over workers
+            std::chrono::steady_clock::duration throttled{};
+        };
+
+        explicit Prefetcher(Options options);
+
+        /**
+         * Add every package the project locks. A project with nothing locked is logged and skipped.
+         * @param manager The manager detected for the project
+         * @param directory The project directory
+         * @throws PackageManagerError if the project has no dependency file or cannot be parsed
+         */
+        void addProject(const std::shared_ptr<Manager>& manager, const std::string& directory);
+
+        /**
+         * Get the number of distinct packages added.
+         */
+        [[nodiscard]] size_t size() const { return items.size(); }
+
+        /**
+         * Fill the cache with every package added that it lacks. Call once.
+         * @return What was filled
+         */
+        Report run();
+
+    private:
+        struct Item {
+            Manager* manager;
+            const std::string* directory;
+            PackageTable::Entry entry;
+        };
+
+        Options options;
+
+        // Owners of everything the items point into
+        std::vector<std::shared_ptr<Manager>> managers;
+        std::vector<std::shared_ptr<const PackageTable>> tables;
+        std::deque<std::string> directories;
+
+        std::vector<Item> items;
+        std::unordered_set<std::string> fillKeys;
+    };
+} // namespace dev::packages
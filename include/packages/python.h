@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <memory>
+#include "packages/manager.h"
+#include "packages/lock_file_cache.h"
+#include "packages/wheel.h"
+#include "cache.h"
+
+namespace fs = std::filesystem;
+
+namespace dev::packages {
+    /**
+     * Installs the pinned wheels of a uv.lock, poetry.lock or requirements.txt
+     * into a project's virtual environment, .venv, without running pip.
+     *
+     * Packages are listed by their metadata directory in site-packages
+     * ("python3.12/site-packages/numpy-1.26.4.dist-info"), so the environment's
+     * Python version is part of every cache entry. Wheels come from a local
+     * wheelhouse (see wheel::getWheelhouse), are checked against the lock
+     * file's hashes and their own RECORD, and are unpacked and precompiled into
+     * the cache once; environments get hard links to the cached files.
+     */
+    class Python final : public Manager {
+    public:
+        static constexpr const char* DEPS_FILE_NAME = "pyproject.toml";
+        static constexpr const char* UV_LOCK_FILE_NAME = "uv.lock";
+        static constexpr const char* POETRY_LOCK_FILE_NAME = "poetry.lock";
+        static constexpr const char* REQUIREMENTS_FILE_NAME = "requirements.txt";
+        // In the order they are preferred when a project has several
+        static constexpr std::array MARKER_FILES{UV_LOCK_FILE_NAME, POETRY_LOCK_FILE_NAME, REQUIREMENTS_FILE_NAME};
+
+        explicit Python(std::shared_ptr<Cache> cache);
+
+        bool isProjectType(const std::string& directory) override;
+
+        /**
+         * @throws PackageManagerError if the project has no virtual environment, or its lock file cannot be parsed
+         */
+        std::shared_ptr<const PackageTable> getInstalledVersions(
+            const std::string& directory
+        ) override;
+
+        /**
+         * Parse a uv.lock, poetry.lock or requirements.txt file, bypassing the lock file cache
+         * @param lockFile The lock file path; its name picks the format
+         * @param interpreter The environment's Python version, which markers and wheel tags are matched to
+         * @param fileSystem The filesystem to read it from
+         * @return Table of every package that applies to the environment, keyed by its metadata
+         *         directory below lib; sources list candidate wheel file names, separated by spaces
+         * @throws PackageManagerError if the file cannot be read or parsed, or pins no version for a package
+         */
+        static std::shared_ptr<const PackageTable> parseLockFile(
+            const fs::path& lockFile,
+            const wheel::Interpreter& interpreter,
+            const span::vfs::FileSystem& fileSystem = *span::vfs::getDefault()
+        );
+
+    private:
+        bool fillCache(
+            const std::string& directory,
+            std::string_view package,
+            std::string_view version
+        ) override;
+
+        [[nodiscard]] std::string getManagerName() const override;
+        [[nodiscard]] std::string getInstallDirectory() const override;
+        [[nodiscard]] std::string getDependencyFileName() const override;
+        [[nodiscard]] std::vector<std::string> getDependencyFiles() const override;
+
+        [[nodiscard]] bool isInstalled(std::string_view package, std::string_view version, const fs::path& installPath) const override;
+        bool linkFromCache(std::string_view package, std::string_view version, const std::string& installPath) const override;
+        bool linkToCache(std::string_view package, std::string_view version, const std::string& installPath) const override;
+        void removeInstalled(const fs::path& installPath) override;
+
+        LockFileCache lockFileCache;
+    };
+} // namespace dev::packages
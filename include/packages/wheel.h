@@ -0,0 +1,154 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "cache.h"
+#include "vfs.h"
+
+namespace fs = std::filesystem;
+
+/**
+ * Wheels, Python's binary packages, for the python manager: matching a
+ * wheel's tags and a requirement's environment markers to a virtual
+ * environment, and verifying and unpacking wheels into the cache.
+ */
+namespace dev::packages::wheel {
+    // The virtual environment of a project, where uv and Poetry create it
+    inline constexpr std::string_view VIRTUAL_ENV = ".venv";
+
+    /**
+     * The CPython version of a virtual environment. Other implementations are not supported.
+     */
+    struct Interpreter {
+        unsigned major{0};
+        unsigned minor{0};
+        unsigned patch{0};
+    };
+
+    /**
+     * Read the Python version a virtual environment was created with, from its pyvenv.cfg
+     * @param fileSystem The filesystem the environment is on
+     * @param virtualEnv The environment directory
+     * @return nullopt if there is no environment or its version is not recorded
+     */
+    [[nodiscard]] std::optional<Interpreter> readInterpreter(
+        const span::vfs::FileSystem& fileSystem,
+        const fs::path& virtualEnv
+    );
+
+    /**
+     * Get the directory packages are installed into, relative to the environment's lib directory
+     * @return E.g. "python3.12/site-packages"
+     */
+    [[nodiscard]] std::string getSitePackages(const Interpreter& interpreter);
+
+    /**
+     * Normalize a project name as PEP 503 does, e.g. "Typing.Extensions" to "typing-extensions"
+     */
+    [[nodiscard]] std::string normalizeName(std::string_view name);
+
+    /**
+     * Get the name of the metadata directory of an installed project, in its normalized form
+     * @return E.g. "typing_extensions-4.12.2.dist-info"
+     */
+    [[nodiscard]] std::string getDistInfoName(std::string_view name, std::string_view version);
+
+    /**
+     * The parts of a wheel file name, <distribution>-<version>(-<build>)?-<python>-<abi>-<platform>.whl.
+     * Each tag may be a set of alternatives separated by dots, e.g. "py2.py3".
+     */
+    struct FileName {
+        std::string_view distribution;
+        std::string_view version;
+        std::string_view pythonTags;
+        std::string_view abiTags;
+        std::string_view platformTags;
+    };
+
+    /**
+     * Split a wheel file name into its parts
+     * @return nullopt if it is not a wheel file name
+     */
+    [[nodiscard]] std::optional<FileName> parseFileName(std::string_view fileName);
+
+    /**
+     * Rank how well a wheel suits an interpreter on this platform
+     * @return 0 if it cannot be installed; higher for more specific builds, as pip prefers them
+     */
+    [[nodiscard]] int getCompatibility(const FileName& wheel, const Interpreter& interpreter);
+
+    /**
+     * Evaluate PEP 508 environment markers, e.g. `sys_platform == "win32" and python_version < "3.11"`,
+     * for an interpreter on this platform. No extras are requested.
+     * @return True if the requirement applies; also for markers this cannot evaluate
+     */
+    [[nodiscard]] bool evaluateMarker(std::string_view marker, const Interpreter& interpreter);
+
+    /**
+     * Convert a hash as Python lock files write it, "sha256:<hex>", to a Subresource
+     * Integrity string for span::hash::matchesIntegrity, appended after a space
+     * @return False if the hash is malformed
+     */
+    bool appendIntegrity(std::string& integrity, std::string_view hash);
+
+    /**
+     * Get the directory wheels are installed from: $SPAN_WHEELHOUSE, or wheelhouse
+     * in the cache directory. Wheels are stored flat by file name, as pip download
+     * and pip wheel write them.
+     */
+    [[nodiscard]] fs::path getWheelhouse(const Cache& cache);
+
+    /**
+     * An entry of a RECORD file, which lists every file of an installed project.
+     */
+    struct RecordEntry {
+        // Relative to site-packages
+        std::string path;
+        // "sha256=<urlsafe base64>", or empty
+        std::string hash;
+        std::string size;
+    };
+
+    /**
+     * Parse the CSV of a RECORD file
+     */
+    [[nodiscard]] std::vector<RecordEntry> parseRecord(std::string_view record);
+
+    /**
+     * Check that a RECORD path stays inside site-packages, which rules out the
+     * scripts pip installs to ../../../bin
+     */
+    [[nodiscard]] bool isInsideSitePackages(std::string_view path);
+
+    /**
+     * Verify a wheel, unpack it into the cache and precompile its modules
+     *
+     * Every file is checked against the wheel's RECORD. Files a wheel installs
+     * into purelib or platlib are moved to the top, its .dist-info directory is
+     * renamed to distInfoName, and the compiled .pyc files are added to its
+     * RECORD, so the cached directory can be linked into site-packages as is.
+     *
+     * @param cache The cache
+     * @param language The cache language, i.e. the manager name
+     * @param name The name to cache the wheel under
+     * @param version The project version
+     * @param wheel The wheel file
+     * @param integrity The lock file's hashes of the wheel as an integrity string; empty to skip the check
+     * @param distInfoName The metadata directory name the lock file expects, see getDistInfoName
+     * @param python The interpreter to unpack and precompile with, e.g. .venv/bin/python
+     * @return false if the wheel is missing, fails a check or cannot be unpacked
+     */
+    bool unpackToCache(
+        Cache& cache,
+        std::string_view language,
+        std::string_view name,
+        std::string_view version,
+        const fs::path& wheel,
+        std::string_view integrity,
+        std::string_view distInfoName,
+        const fs::path& python
+    );
+} // namespace dev::packages::wheel
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "metrics.h"
+#include "trace.h"
+
+namespace span::pipeline {
+    /**
+     * One stage of a pipeline: a bounded queue drained by its own workers.
+     *
+     * push() blocks while the queue is full, so a fast stage cannot run
+     * arbitrarily far ahead of a slow one, and each stage's concurrency is
+     * sized to its kind of work independently of the others. Handlers may
+     * push into later stages; pushing into the same or an earlier stage can
+     * deadlock once queues fill up.
+     */
+    template<typename T>
+    class Stage {
+    public:
+        using Handler = std::function<void(T&)>;
+
+        /**
+         * @param name Stage name, used for worker thread names and metric labels
+         * @param concurrency Number of workers
+         * @param capacity Items that may wait in the queue before push() blocks
+         * @param handler Processes one item; exceptions are caught and dropped
+         */
+        Stage(std::string name, const size_t concurrency, const size_t capacity, Handler handler)
+            : name(std::move(name)),
+              capacity(std::max<size_t>(capacity, 1)),
+              handler(std::move(handler)),
+              queueWait(metrics::Registry::getInstance().histogram(
+                  "span_pipeline_queue_wait_seconds", "Time items waited in a pipeline stage's queue", getLabels()
+              )),
+              queued(metrics::Registry::getInstance().gauge(
+                  "span_pipeline_queued", "Items waiting in a pipeline stage's queue", getLabels()
+              )) {
+            for (size_t i = 0; i < std::max<size_t>(concurrency, 1); ++i) {
+                workers.emplace_back([this, i] {
+                    if (trace::Tracer::isEnabled()) {
+                        trace::Tracer::setThreadName(this->name + "-" + std::to_string(i));
+                    }
+                    work();
+                });
+            }
+        }
+
+        ~Stage() {
+            close();
+            join();
+        }
+
+        Stage(const Stage&) = delete;
+        Stage& operator=(const Stage&) = delete;
+
+        /**
+         * Queue an item, waiting while the queue is full.
+         * @throws std::runtime_error if the stage has been closed
+         */
+        void push(T item) {
+            {
+                std::unique_lock lock(mutex);
+                notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+                if (closed) {
+                    throw std::runtime_error("Pipeline stage " + name + " has been closed.");
+                }
+                items.push_back({std::move(item), std::chrono::steady_clock::now()});
+            }
+            queued.increment();
+            notEmpty.notify_one();
+        }
+
+        /**
+         * Accept no more items. Workers finish what is queued, then exit.
+         */
+        void close() {
+            {
+                std::lock_guard lock(mutex);
+                closed = true;
+            }
+            notEmpty.notify_all();
+            notFull.notify_all();
+        }
+
+        /**
+         * Wait for the workers to exit. Call after close().
+         */
+        void join() {
+            for (std::thread& worker : workers) {
+                if (worker.joinable()) {
+                    worker.join();
+                }
+            }
+        }
+
+    private:
+        struct Queued {
+            T item;
+            std::chrono::steady_clock::time_point queuedAt;
+        };
+
+        std::string name;
+        size_t capacity;
+        Handler handler;
+        metrics::Histogram& queueWait;
+        metrics::Gauge& queued;
+
+        std::mutex mutex;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+        std::deque<Queued> items;
+        bool closed{false};
+        std::vector<std::thread> workers;
+
+        [[nodiscard]] std::string getLabels() const {
+            return "stage=\"" + name + "\"";
+        }
+
+        void work() {
+            while (true) {
+                Queued next;
+                {
+                    std::unique_lock lock(mutex);
+                    notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+                    if (items.empty()) {
+                        return;
+                    }
+                    next = std::move(items.front());
+                    items.pop_front();
+                }
+                queued.decrement();
+                notFull.notify_one();
+
+                const auto started = std::chrono::steady_clock::now();
+                queueWait.record(started - next.queuedAt);
+                if (trace::Tracer::isEnabled()) {
+                    trace::Tracer::record("queue_wait", "pipeline", name, next.queuedAt, started);
+                }
+
+                try {
+                    handler(next.item);
+                } catch (...) {
+                    // Handlers report their own failures
+                }
+            }
+        }
+    };
+} // namespace span::pipeline
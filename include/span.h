@@ -0,0 +1,163 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "cache.h"
+#include "vfs.h"
+
+namespace dev::packages {
+    class InstallPlan;
+    class ManagerSet;
+}
+
+namespace span::threads {
+    class ThreadPool;
+}
+
+/**
+ * Programmatic API for embedding span, e.g. in a deploy orchestrator:
+ *
+ *   span::Session session({.concurrency = 16});
+ *   const auto result = session.install({"/srv/apps/billing", "/srv/apps/shop"});
+ *   if (!result.success) { ... result.projects[i].error ... }
+ *
+ * Link against the span_lib CMake target (libspan). Log output goes through
+ * dev::Logger, whose level and format are process-wide.
+ */
+namespace span {
+    struct SessionOptions {
+        // Cache directory; $DEV_PACKAGE_CACHE or ~/.dev/cache if not set
+        std::optional<std::string> cacheDir;
+        // Concurrent package fetches per install, and concurrent project links
+        // shared by every call; 0 for one per hardware thread
+        size_t concurrency{0};
+        // Filesystem holding the cache and the projects; the real one if null
+        std::shared_ptr<vfs::FileSystem> fileSystem;
+    };
+
+    struct ProjectResult {
+        // Absolute, normalized project directory
+        std::string directory;
+        // Number of packages the project depends on
+        size_t packages{0};
+        // False if the project could not be planned, installed or linked; see error
+        bool success{true};
+        std::string error;
+    };
+
+    struct Result {
+        // True if every project was planned and every package installed or linked
+        bool success{true};
+        // Packages across all projects, and how many of them are distinct
+        size_t packages{0};
+        size_t uniquePackages{0};
+        std::chrono::steady_clock::duration elapsed{};
+        std::vector<ProjectResult> projects;
+    };
+
+    /**
+     * Counters accumulated since a session was created. Metrics are
+     * process-wide, so concurrent sessions count towards each other's stats.
+     */
+    struct Stats {
+        uint64_t fromVendor{0};
+        uint64_t fromCache{0};
+        uint64_t fetched{0};
+        uint64_t symlinked{0};
+        uint64_t failures{0};
+        uint64_t cacheHits{0};
+        uint64_t cacheMisses{0};
+        uint64_t lockFileCacheHits{0};
+        uint64_t lockFileCacheMisses{0};
+    };
+
+    /**
+     * A warm cache, set of package managers, parsed lock files and link pool,
+     * reused across calls. Thread-safe: every install runs its own pipeline,
+     * so a package needed by concurrent installs may be fetched by each of them.
+     */
+    class Session {
+    public:
+        explicit Session(SessionOptions options = {});
+        ~Session();
+
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+
+        /**
+         * Find every project at or below the given directories, for monorepos.
+         * Skips vendor and node_modules, and what .gitignore files exclude.
+         * @param roots Directories to search
+         * @param excludes Further patterns in .gitignore syntax, relative to each root
+         * @return Absolute project directories, sorted, to pass to plan(), install() or link()
+         */
+        std::vector<std::string> discover(
+            const std::vector<std::string>& roots,
+            const std::vector<std::string>& excludes = {}
+        ) const;
+
+        /**
+         * Detect and parse projects without installing anything.
+         * @param directories Project directories
+         * @return Package counts, and the projects that could not be planned
+         */
+        Result plan(const std::vector<std::string>& directories);
+
+        /**
+         * Install every project's dependencies through one pipeline, so a
+         * package shared by several projects is fetched once. Projects that
+         * cannot be parsed are reported and skipped; the rest are still installed.
+         *
+         * @param directories Project directories
+         * @return The outcome per project
+         */
+        Result install(const std::vector<std::string>& directories);
+
+        /**
+         * Link every project's dependencies from the cache, without installing
+         * missing ones.
+         *
+         * @param directories Project directories
+         * @return The outcome per project
+         */
+        Result link(const std::vector<std::string>& directories);
+
+        /**
+         * Evict least recently used packages until the cache fits a size.
+         * @param maxSizeBytes The size to fit in
+         * @return True if the cache now fits
+         */
+        bool cleanup(size_t maxSizeBytes);
+
+        [[nodiscard]] Stats getStats() const;
+
+        /**
+         * Get every metric of the process as JSON, as written by --stats-json.
+         */
+        [[nodiscard]] std::string getMetricsJson() const;
+
+        [[nodiscard]] dev::packages::Cache& getCache() const;
+
+    private:
+        std::shared_ptr<dev::packages::Cache> cache;
+        std::shared_ptr<dev::packages::ManagerSet> managers;
+        std::shared_ptr<threads::ThreadPool> pool;
+        size_t concurrency;
+        Stats baseline;
+
+        /**
+         * Add every project to a plan, recording the ones that cannot be added.
+         */
+        void addProjects(
+            dev::packages::InstallPlan& plan,
+            const std::vector<std::string>& directories,
+            Result& result
+        );
+
+        static Stats readStats();
+    };
+} // namespace span
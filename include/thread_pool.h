@@ -8,13 +8,19 @@
 #include <stdexcept>
 #include <thread>
 #include <vector>
+#include "metrics.h"
+#include "trace.h"
 
 namespace span::threads {
     class ThreadPool {
     public:
         explicit ThreadPool(const size_t numThreads) {
             for (size_t i = 0; i < numThreads; ++i) {
-                workers.emplace_back([this] {
+                workers.emplace_back([this, i] {
+                    if (trace::Tracer::isEnabled()) {
+                        trace::Tracer::setThreadName("pool-worker-" + std::to_string(i));
+                    }
+
                     while (true) {
                         std::function<void()> task;
                         {
@@ -33,6 +39,8 @@ namespace span::threads {
                         }
 
                         try {
+                            trace::Span taskSpan("task", "pool");
+                            metrics::ScopedTimer timer(getRunTime());
                             task();
                         } catch (const std::exception &e) {
                             // Log the exception?
@@ -78,7 +86,15 @@ namespace span::threads {
                     throw std::runtime_error("Thread pool has been stopped.");
                 }
 
-                tasks.emplace([task] { (*task)(); });
+                // Record how long the task waited for a free worker
+                tasks.emplace([task, queued = std::chrono::steady_clock::now()] {
+                    const auto started = std::chrono::steady_clock::now();
+                    getQueueWait().record(started - queued);
+                    if (trace::Tracer::isEnabled()) {
+                        trace::Tracer::record("queue_wait", "pool", {}, queued, started);
+                    }
+                    (*task)();
+                });
             }
 
             condition.notify_one();
@@ -91,5 +107,19 @@ namespace span::threads {
         std::mutex queueMutex;
         std::condition_variable condition;
         std::atomic<bool> stop{false};
+
+        static metrics::Histogram& getQueueWait() {
+            static auto& histogram = metrics::Registry::getInstance().histogram(
+                "span_pool_queue_wait_seconds", "Time tasks waited for a free worker"
+            );
+            return histogram;
+        }
+
+        static metrics::Histogram& getRunTime() {
+            static auto& histogram = metrics::Registry::getInstance().histogram(
+                "span_pool_task_seconds", "Time workers spent running tasks"
+            );
+            return histogram;
+        }
     };
 } // namespace span::threads
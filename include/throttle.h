@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+
+namespace span::throttle {
+    /**
+     * Token bucket pacing work to a rate: tokens accrue at the rate, up to a
+     * burst, and work takes the tokens it costs before it starts.
+     *
+     * take() reserves tokens even when there are too few and then sleeps
+     * until they would have accrued, so concurrent callers queue up in the
+     * order they asked. charge() does the same without sleeping, for costs
+     * only known once the work is done, such as how long it ran; the debt
+     * delays whoever takes next.
+     */
+    class TokenBucket {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * @param rate Tokens per second; 0 or less for no limit
+         * @param burst Tokens that may accrue while nothing is taken; the bucket starts full
+         */
+        TokenBucket(double rate, double burst);
+
+        TokenBucket(const TokenBucket&) = delete;
+        TokenBucket& operator=(const TokenBucket&) = delete;
+
+        /**
+         * Take tokens, waiting until they are available
+         * @return How long it waited
+         */
+        Clock::duration take(double tokens);
+
+        /**
+         * Take tokens without waiting, going into debt if there are too few
+         */
+        void charge(double tokens);
+
+        [[nodiscard]] bool isLimited() const { return rate > 0; }
+
+    private:
+        std::mutex mutex;
+        const double rate;
+        const double burst;
+        double tokens;
+        Clock::time_point updated;
+
+        /**
+         * Take tokens, accruing what was earned since the last call
+         * @return How long until the balance is no longer negative
+         */
+        Clock::duration reserve(double tokens);
+    };
+
+    /**
+     * Lower the CPU and I/O priority of the calling thread to the lowest the
+     * system has: nice 19, and the idle I/O class on Linux, which only gets
+     * disk time no other process wants. Threads and processes started by the
+     * thread afterwards inherit both, so package manager commands it runs
+     * are throttled too. Other threads of the process are not affected.
+     *
+     * @return False if either could not be lowered, e.g. on other systems
+     */
+    bool lowerPriority();
+} // namespace span::throttle
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * A parser for the TOML that lock files are written in, such as uv.lock and
+ * poetry.lock: tables, arrays of tables, dotted keys, inline tables, arrays,
+ * and basic, literal and multi-line strings.
+ *
+ * Like span::yaml, the input is parsed into one flat array of nodes whose
+ * strings point into the input. Values other than strings are untyped:
+ * `true`, `1.0` and dates are returned as written. Redefining a table or
+ * extending an inline table is not detected; duplicate keys are.
+ */
+namespace span::toml {
+    class ParseError final : public std::runtime_error {
+    public:
+        ParseError(const std::string& message, size_t line);
+
+        /**
+         * Get the line the error was found on, starting at 1.
+         */
+        [[nodiscard]] size_t getLine() const { return line; }
+
+    private:
+        size_t line;
+    };
+
+    enum class NodeType : uint8_t {
+        NONE,
+        VALUE,
+        TABLE,
+        ARRAY
+    };
+
+    class Document;
+
+    /**
+     * A node of a Document, valid as long as the document is. Looking up a
+     * key that does not exist gives a node of type NONE, which is empty and
+     * can be looked into further.
+     */
+    class Node {
+    public:
+        class Iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Node;
+            using difference_type = std::ptrdiff_t;
+
+            Iterator() = default;
+
+            Node operator*() const { return {document, index}; }
+            Iterator& operator++();
+            Iterator operator++(int) {
+                Iterator previous = *this;
+                ++*this;
+                return previous;
+            }
+            bool operator==(const Iterator& other) const { return index == other.index; }
+
+        private:
+            friend class Node;
+            Iterator(const Document* document, uint32_t index) : document(document), index(index) {}
+
+            const Document* document{nullptr};
+            uint32_t index{0};
+        };
+
+        Node() = default;
+
+        [[nodiscard]] NodeType getType() const;
+        [[nodiscard]] bool isValue() const { return getType() == NodeType::VALUE; }
+        [[nodiscard]] bool isTable() const { return getType() == NodeType::TABLE; }
+        [[nodiscard]] bool isArray() const { return getType() == NodeType::ARRAY; }
+        explicit operator bool() const { return getType() != NodeType::NONE; }
+
+        /**
+         * Get a value: the contents of a string, unescaped, or anything else as written. Empty for other nodes.
+         */
+        [[nodiscard]] std::string_view getString() const;
+
+        /**
+         * Get the key of a table entry. Empty for other nodes.
+         */
+        [[nodiscard]] std::string_view getKey() const;
+
+        /**
+         * Get the number of entries of a table or array.
+         */
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * Look up a key of a table, by linear search. Iterate to read large tables.
+         */
+        [[nodiscard]] Node operator[](std::string_view key) const;
+
+        /**
+         * Iterate the entries of a table, in the order they were defined, or the items of an array.
+         */
+        [[nodiscard]] Iterator begin() const;
+        [[nodiscard]] Iterator end() const { return {document, 0}; }
+
+    private:
+        friend class Document;
+        Node(const Document* document, const uint32_t index) : document(document), index(index) {}
+
+        const Document* document{nullptr};
+        uint32_t index{0};
+    };
+
+    class Document {
+    public:
+        Document(const Document&) = delete;
+        Document& operator=(const Document&) = delete;
+        Document(Document&&) noexcept = default;
+        Document& operator=(Document&&) noexcept = default;
+
+        /**
+         * Parse a TOML document.
+         * @param text The input, which the document keeps
+         * @return The parsed document
+         * @throws ParseError if the input is malformed
+         */
+        [[nodiscard]] static Document parse(std::string text);
+
+        /**
+         * Get the root table.
+         */
+        [[nodiscard]] Node getRoot() const { return {this, 1}; }
+
+    private:
+        friend class Node;
+        friend class Parser;
+
+        struct Entry {
+            NodeType type;
+            std::string_view key;
+            std::string_view value;
+            // Indexes into nodes; 0 ends a list, since node 0 is never a child
+            uint32_t first{0};
+            uint32_t next{0};
+            uint32_t size{0};
+        };
+
+        Document() = default;
+
+        // Heap-allocated so views into it survive moving the document
+        std::unique_ptr<const std::string> text;
+        // Strings with escapes or line continuations, which cannot point into the input
+        std::deque<std::string> unescaped;
+        std::vector<Entry> nodes;
+    };
+} // namespace span::toml
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace span::trace {
+    /**
+     * Process-wide recorder of timed spans, exported as Chrome trace-event JSON
+     * (loadable in chrome://tracing, Perfetto and speedscope).
+     *
+     * Every thread appends to its own buffer, so recording never contends with
+     * other threads. While tracing is disabled a span costs one relaxed load.
+     */
+    class Tracer {
+    public:
+        /**
+         * Start recording.
+         *
+         * @param outputFile Where flush() writes the trace
+         */
+        static void enable(const std::string& outputFile);
+
+        [[nodiscard]] static bool isEnabled() {
+            return enabled.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Name the calling thread in the exported timeline.
+         *
+         * @param name The thread name, e.g. "pool-worker-3"
+         */
+        static void setThreadName(std::string_view name);
+
+        /**
+         * Record a completed span on the calling thread.
+         *
+         * @param name Static span name, e.g. "link"
+         * @param category Static category, e.g. "install"
+         * @param detail Optional detail shown with the span, e.g. the package
+         * @param start Start time
+         * @param end End time
+         */
+        static void record(
+            const char* name,
+            const char* category,
+            std::string_view detail,
+            std::chrono::steady_clock::time_point start,
+            std::chrono::steady_clock::time_point end
+        );
+
+        /**
+         * Write everything recorded so far to the output file. Safe to register with std::atexit.
+         */
+        static void flush();
+
+    private:
+        static std::atomic<bool> enabled;
+    };
+
+    /**
+     * Records the enclosing scope as a span if tracing is enabled.
+     * The name and category must be string literals, and the detail must
+     * outlive the span.
+     */
+    class Span {
+    public:
+        Span(const char* name, const char* category, const std::string_view detail = {})
+            : name(name), category(category), detail(detail) {
+            if (Tracer::isEnabled()) {
+                start = std::chrono::steady_clock::now();
+                active = true;
+            }
+        }
+
+        ~Span() {
+            if (active) {
+                Tracer::record(name, category, detail, start, std::chrono::steady_clock::now());
+            }
+        }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        const char* name;
+        const char* category;
+        std::string_view detail;
+        std::chrono::steady_clock::time_point start;
+        bool active{false};
+    };
+} // namespace span::trace
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace span::vfs {
+    enum class FileType {
+        NONE,
+        FILE,
+        DIRECTORY,
+        SYMLINK
+    };
+
+    struct Status {
+        FileType type{FileType::NONE};
+        uintmax_t size{0};
+        std::filesystem::file_time_type modified{};
+        std::filesystem::file_time_type accessed{};
+
+        [[nodiscard]] bool exists() const { return type != FileType::NONE; }
+        [[nodiscard]] bool isDirectory() const { return type == FileType::DIRECTORY; }
+        [[nodiscard]] bool isFile() const { return type == FileType::FILE; }
+    };
+
+    struct DirectoryEntry {
+        std::string name;
+        FileType type;
+    };
+
+    /**
+     * The filesystem operations used by Cache and the package managers.
+     *
+     * Queries never throw: a missing or unreadable path has type NONE.
+     * Mutations throw std::filesystem::filesystem_error, like std::filesystem.
+     */
+    class FileSystem {
+    public:
+        using Visitor = std::function<void(const std::filesystem::path& path, const Status& status, size_t depth)>;
+
+        virtual ~FileSystem() = default;
+
+        /**
+         * Get the status of a path, following symlinks.
+         */
+        [[nodiscard]] virtual Status status(const std::filesystem::path& path) const = 0;
+
+        /**
+         * Get the status of a path without following a symlink at the end of it.
+         */
+        [[nodiscard]] virtual Status symlinkStatus(const std::filesystem::path& path) const = 0;
+
+        /**
+         * Get what a symlink points to, as stored in the link. Empty if the path is not a symlink.
+         */
+        [[nodiscard]] virtual std::filesystem::path readSymlink(const std::filesystem::path& path) const = 0;
+
+        [[nodiscard]] bool exists(const std::filesystem::path& path) const {
+            return status(path).exists();
+        }
+
+        [[nodiscard]] bool isDirectory(const std::filesystem::path& path) const {
+            return status(path).isDirectory();
+        }
+
+        /**
+         * Check whether a directory has no entries. False if it is not a directory.
+         */
+        [[nodiscard]] virtual bool isEmptyDirectory(const std::filesystem::path& path) const = 0;
+
+        /**
+         * List the entries of a directory, in no particular order. Empty if it is not a directory.
+         */
+        [[nodiscard]] virtual std::vector<DirectoryEntry> list(const std::filesystem::path& directory) const = 0;
+
+        /**
+         * Visit everything below a directory, each directory before its
+         * contents. Symlinks below the root are reported but not followed.
+         * Depth 0 is the root's children.
+         */
+        virtual void walk(const std::filesystem::path& root, const Visitor& visitor) const;
+
+        virtual void createDirectories(const std::filesystem::path& path) = 0;
+
+        /**
+         * @param target What the link points to
+         * @param link The link to create; must not exist
+         */
+        virtual void createSymlink(const std::filesystem::path& target, const std::filesystem::path& link) = 0;
+
+        /**
+         * @param target An existing file
+         * @param link The new name for it; must not exist
+         */
+        virtual void createHardLink(const std::filesystem::path& target, const std::filesystem::path& link) = 0;
+
+        /**
+         * Remove a path and everything below it, without following symlinks.
+         * @return The number of entries removed, 0 if the path did not exist
+         */
+        virtual uintmax_t removeAll(const std::filesystem::path& path) = 0;
+
+        virtual void rename(const std::filesystem::path& from, const std::filesystem::path& to) = 0;
+
+        /**
+         * Read a whole file.
+         * @param path The file
+         * @param padding Extra capacity to reserve past the end, e.g. for simdjson
+         */
+        [[nodiscard]] virtual std::string readFile(const std::filesystem::path& path, size_t padding = 0) const = 0;
+
+        virtual void writeFile(const std::filesystem::path& path, std::string_view contents) = 0;
+    };
+
+    /**
+     * The real filesystem. Stateless; share the instance from getDefault().
+     */
+    class PosixFileSystem final : public FileSystem {
+    public:
+        [[nodiscard]] Status status(const std::filesystem::path& path) const override;
+        [[nodiscard]] Status symlinkStatus(const std::filesystem::path& path) const override;
+        [[nodiscard]] std::filesystem::path readSymlink(const std::filesystem::path& path) const override;
+        [[nodiscard]] bool isEmptyDirectory(const std::filesystem::path& path) const override;
+        [[nodiscard]] std::vector<DirectoryEntry> list(const std::filesystem::path& directory) const override;
+        void createDirectories(const std::filesystem::path& path) override;
+        void createSymlink(const std::filesystem::path& target, const std::filesystem::path& link) override;
+        void createHardLink(const std::filesystem::path& target, const std::filesystem::path& link) override;
+        uintmax_t removeAll(const std::filesystem::path& path) override;
+        void rename(const std::filesystem::path& from, const std::filesystem::path& to) override;
+        [[nodiscard]] std::string readFile(const std::filesystem::path& path, size_t padding = 0) const override;
+        void writeFile(const std::filesystem::path& path, std::string_view contents) override;
+    };
+
+    /**
+     * A filesystem held entirely in memory, for benchmarking and exercising
+     * orchestration, index and eviction logic at scales no test disk holds.
+     *
+     * Entries live in one ordered map keyed by absolute path, so a directory's
+     * subtree is a contiguous key range: removal, walks and emptiness checks
+     * cost a range scan rather than a tree traversal. Paths are normalized and
+     * treated as absolute; relative symlink targets resolve against the link's
+     * directory. Thread-safe.
+     */
+    class MemoryFileSystem final : public FileSystem {
+    public:
+        MemoryFileSystem();
+
+        [[nodiscard]] Status status(const std::filesystem::path& path) const override;
+        [[nodiscard]] Status symlinkStatus(const std::filesystem::path& path) const override;
+        [[nodiscard]] std::filesystem::path readSymlink(const std::filesystem::path& path) const override;
+        [[nodiscard]] bool isEmptyDirectory(const std::filesystem::path& path) const override;
+        [[nodiscard]] std::vector<DirectoryEntry> list(const std::filesystem::path& directory) const override;
+        void walk(const std::filesystem::path& root, const Visitor& visitor) const override;
+        void createDirectories(const std::filesystem::path& path) override;
+        void createSymlink(const std::filesystem::path& target, const std::filesystem::path& link) override;
+        void createHardLink(const std::filesystem::path& target, const std::filesystem::path& link) override;
+        uintmax_t removeAll(const std::filesystem::path& path) override;
+        void rename(const std::filesystem::path& from, const std::filesystem::path& to) override;
+        [[nodiscard]] std::string readFile(const std::filesystem::path& path, size_t padding = 0) const override;
+        void writeFile(const std::filesystem::path& path, std::string_view contents) override;
+
+        /**
+         * Create a file of a given size without storing its contents, which
+         * read back as zero bytes. Lets a test cache hold millions of packages.
+         *
+         * @param path The file, whose parent must exist
+         * @param size The reported size
+         * @param time The modification and access time
+         */
+        void createFile(
+            const std::filesystem::path& path,
+            uintmax_t size,
+            std::filesystem::file_time_type time = std::filesystem::file_time_type::clock::now()
+        );
+
+        /**
+         * Get the number of entries, directories included.
+         */
+        [[nodiscard]] size_t size() const;
+
+    private:
+        struct Node {
+            FileType type;
+            uintmax_t size{0};
+            std::filesystem::file_time_type modified{};
+            std::filesystem::file_time_type accessed{};
+            // File contents, or the target of a symlink
+            std::string data;
+            // Set by createFile; the file reads back as `size` zero bytes
+            bool sparse{false};
+        };
+
+        using Nodes = std::map<std::string, Node, std::less<>>;
+
+        mutable std::shared_mutex mutex;
+        Nodes nodes;
+
+        static std::string normalize(const std::filesystem::path& path);
+
+        /**
+         * Resolve the symlinks in a normalized path.
+         * @param key The normalized path
+         * @param followLast Whether to resolve a symlink in the final component
+         * @return The resolved path, or nullopt if a parent is missing or links loop
+         */
+        [[nodiscard]] std::optional<std::string> resolve(std::string_view key, bool followLast) const;
+
+        /**
+         * Resolve the parent of a path and append its final component, for creating entries.
+         * @throws std::filesystem::filesystem_error If the parent is not an existing directory
+         */
+        [[nodiscard]] std::string resolveForCreate(const std::filesystem::path& path, const char* operation) const;
+
+        [[nodiscard]] static Status toStatus(const Node& node);
+        [[nodiscard]] Nodes::const_iterator findResolved(const std::filesystem::path& path, bool followLast) const;
+    };
+
+    /**
+     * Adds a fixed delay to every call of another filesystem, and optionally
+     * limits read throughput, to model network filesystems such as NFS.
+     */
+    class LatencyFileSystem final : public FileSystem {
+    public:
+        /**
+         * @param inner The filesystem to delegate to
+         * @param latency Delay added to every call
+         * @param bytesPerSecond Read throughput limit, 0 for none
+         */
+        LatencyFileSystem(
+            std::shared_ptr<FileSystem> inner,
+            std::chrono::microseconds latency,
+            uintmax_t bytesPerSecond = 0
+        );
+
+        [[nodiscard]] Status status(const std::filesystem::path& path) const override;
+        [[nodiscard]] Status symlinkStatus(const std::filesystem::path& path) const override;
+        [[nodiscard]] std::filesystem::path readSymlink(const std::filesystem::path& path) const override;
+        [[nodiscard]] bool isEmptyDirectory(const std::filesystem::path& path) const override;
+        [[nodiscard]] std::vector<DirectoryEntry> list(const std::filesystem::path& directory) const override;
+        void createDirectories(const std::filesystem::path& path) override;
+        void createSymlink(const std::filesystem::path& target, const std::filesystem::path& link) override;
+        void createHardLink(const std::filesystem::path& target, const std::filesystem::path& link) override;
+        uintmax_t removeAll(const std::filesystem::path& path) override;
+        void rename(const std::filesystem::path& from, const std::filesystem::path& to) override;
+        [[nodiscard]] std::string readFile(const std::filesystem::path& path, size_t padding = 0) const override;
+        void writeFile(const std::filesystem::path& path, std::string_view contents) override;
+
+    private:
+        std::shared_ptr<FileSystem> inner;
+        std::chrono::microseconds latency;
+        uintmax_t bytesPerSecond;
+
+        void delay(uintmax_t bytes = 0) const;
+    };
+
+    /**
+     * Get the shared real filesystem.
+     */
+    std::shared_ptr<FileSystem> getDefault();
+} // namespace span::vfs
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace span::watch {
+    /**
+     * Watches the dependency files of one or more project directories and
+     * reports each project once its files have stopped changing.
+     *
+     * Directories are watched rather than the files themselves, so files
+     * replaced by rename (as git and most editors do) keep being tracked.
+     */
+    class Watcher {
+    public:
+        using Callback = std::function<void(const std::string& directory)>;
+
+        /**
+         * @param debounce How long a project's files must stay unchanged before it is reported
+         */
+        explicit Watcher(std::chrono::milliseconds debounce = std::chrono::milliseconds(250));
+        ~Watcher();
+
+        Watcher(const Watcher&) = delete;
+        Watcher& operator=(const Watcher&) = delete;
+
+        /**
+         * Start watching a project directory.
+         *
+         * @param directory The project directory
+         * @param fileNames Names of the files inside the directory to react to
+         * @throws std::runtime_error if the directory cannot be watched
+         */
+        void addProject(const std::string& directory, const std::vector<std::string>& fileNames);
+
+        /**
+         * Wait for changes and invoke the callback for every settled project,
+         * until stop() is called or the process receives SIGINT or SIGTERM.
+         *
+         * @param onChange Called with the project directory after its files settle
+         */
+        void run(const Callback& onChange);
+
+        /**
+         * Ask a running watcher to return.
+         */
+        void stop();
+
+    private:
+        struct Project {
+            std::string directory;
+            std::unordered_set<std::string> fileNames;
+        };
+
+        std::chrono::milliseconds debounce;
+        int inotifyFd{-1};
+        std::unordered_map<int, Project> projects;
+        std::atomic<bool> stopping{false};
+
+        /**
+         * Read pending events and push back the deadline of every affected project.
+         */
+        void readEvents(
+            std::unordered_map<int, std::chrono::steady_clock::time_point>& deadlines
+        ) const;
+    };
+} // namespace span::watch
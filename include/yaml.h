@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * A parser for the subset of YAML that lock files are written in, such as
+ * pnpm-lock.yaml: block mappings and sequences, flow mappings and sequences,
+ * plain and quoted scalars, comments and document markers.
+ *
+ * The whole input is parsed into one flat array of nodes whose strings point
+ * into the input, so parsing allocates little beyond that array: only quoted
+ * strings with escapes are copied. Scalars are untyped: `true`, `1.0` and `~`
+ * are returned as written. Anchors, aliases, tags, block scalars (| and >) and
+ * multi-line plain scalars are rejected.
+ */
+namespace span::yaml {
+    class ParseError final : public std::runtime_error {
+    public:
+        ParseError(const std::string& message, size_t line);
+
+        /**
+         * Get the line the error was found on, starting at 1.
+         */
+        [[nodiscard]] size_t getLine() const { return line; }
+
+    private:
+        size_t line;
+    };
+
+    enum class NodeType : uint8_t {
+        NONE,
+        SCALAR,
+        MAPPING,
+        SEQUENCE
+    };
+
+    class Document;
+
+    /**
+     * A node of a Document, valid as long as the document is. Looking up a
+     * key or index that does not exist gives a node of type NONE, which is
+     * empty and can be looked into further.
+     */
+    class Node {
+    public:
+        class Iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Node;
+            using difference_type = std::ptrdiff_t;
+
+            Iterator() = default;
+
+            Node operator*() const { return {document, index}; }
+            Iterator& operator++();
+            Iterator operator++(int) {
+                Iterator previous = *this;
+                ++*this;
+                return previous;
+            }
+            bool operator==(const Iterator& other) const { return index == other.index; }
+
+        private:
+            friend class Node;
+            Iterator(const Document* document, uint32_t index) : document(document), index(index) {}
+
+            const Document* document{nullptr};
+            uint32_t index{0};
+        };
+
+        Node() = default;
+
+        [[nodiscard]] NodeType getType() const;
+        [[nodiscard]] bool isScalar() const { return getType() == NodeType::SCALAR; }
+        [[nodiscard]] bool isMapping() const { return getType() == NodeType::MAPPING; }
+        [[nodiscard]] bool isSequence() const { return getType() == NodeType::SEQUENCE; }
+        explicit operator bool() const { return getType() != NodeType::NONE; }
+
+        /**
+         * Get the value of a scalar, unquoted and unescaped. Empty for other nodes and for null.
+         */
+        [[nodiscard]] std::string_view getString() const;
+
+        /**
+         * Get the key of a mapping entry. Empty for other nodes.
+         */
+        [[nodiscard]] std::string_view getKey() const;
+
+        /**
+         * Get the number of entries of a mapping or sequence.
+         */
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * Look up a key of a mapping, by linear search. Iterate to read large mappings.
+         */
+        [[nodiscard]] Node operator[](std::string_view key) const;
+
+        /**
+         * Iterate the entries of a mapping, in order, or the items of a sequence.
+         */
+        [[nodiscard]] Iterator begin() const;
+        [[nodiscard]] Iterator end() const { return {document, 0}; }
+
+    private:
+        friend class Document;
+        Node(const Document* document, const uint32_t index) : document(document), index(index) {}
+
+        const Document* document{nullptr};
+        uint32_t index{0};
+    };
+
+    class Document {
+    public:
+        Document(const Document&) = delete;
+        Document& operator=(const Document&) = delete;
+        Document(Document&&) noexcept = default;
+        Document& operator=(Document&&) noexcept = default;
+
+        /**
+         * Parse every document of a YAML stream.
+         * @param text The input, which the document keeps
+         * @return The parsed stream
+         * @throws ParseError if the input is malformed or uses unsupported syntax
+         */
+        [[nodiscard]] static Document parse(std::string text);
+
+        /**
+         * Get the number of documents, separated by --- lines.
+         */
+        [[nodiscard]] size_t getDocumentCount() const { return roots.size(); }
+
+        /**
+         * Get the root node of a document.
+         * @param document The document index
+         * @return The root, or a node of type NONE if there is no such document or it is empty
+         */
+        [[nodiscard]] Node getRoot(size_t document = 0) const;
+
+    private:
+        friend class Node;
+        friend class Parser;
+
+        struct Entry {
+            NodeType type;
+            std::string_view key;
+            std::string_view value;
+            // Indexes into nodes; 0 ends a list, since node 0 is never a child
+            uint32_t first{0};
+            uint32_t next{0};
+            uint32_t size{0};
+        };
+
+        Document() = default;
+
+        // Heap-allocated so views into it survive moving the document
+        std::unique_ptr<const std::string> text;
+        // Quoted strings with escapes, which cannot point into the input
+        std::deque<std::string> unescaped;
+        std::vector<Entry> nodes;
+        std::vector<uint32_t> roots;
+    };
+} // namespace span::yaml
@@ -1,40 +1,276 @@
 #include "cli.h"
 #include "packages/manager_factory.h"
+#include "packages/install_pipeline.h"
+#include "packages/prefetcher.h"
 #include "cache.h"
+#include "daemon.h"
+#include "discovery.h"
+#include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+#include "vfs.h"
+#include "watcher.h"
 #include <vector>
 #include <future>
+#include <fstream>
 #include <memory>
+#include <unordered_set>
 
 namespace fs = std::filesystem;
 
 int main(const int argc, char **argv) {
     CLI::App app{"Universal Package Manager CLI"};
 
-    std::string projectDir = fs::current_path().string();
+    std::vector<std::string> projectDirs;
+    std::string manifestFile;
+    bool recursive = false;
+    std::vector<std::string> excludes;
+    std::string socketPath = span::daemon::getDefaultSocketPath();
+    bool useDaemon = std::getenv("SPAN_DAEMON_SOCKET") != nullptr;
 
     app.add_option(
         "-d,--directory",
-        projectDir,
-        "Project directory (defaults to current directory)"
+        projectDirs,
+        "Project directories, repeatable (defaults to current directory)"
     );
 
-    const auto cache = std::make_shared<dev::packages::Cache>();
-    const auto managers = dev::packages::ManagerFactory::getInstance().createManagers(cache);
+    app.add_option(
+        "-m,--manifest",
+        manifestFile,
+        "File listing one project directory per line; blank lines and # comments are ignored"
+    );
+
+    app.add_flag(
+        "-r,--recursive",
+        recursive,
+        "Install every project found below the given directories, skipping vendor, node_modules and what .gitignore files exclude"
+    );
+
+    app.add_option(
+        "--exclude",
+        excludes,
+        "Pattern in .gitignore syntax for directories --recursive skips, repeatable"
+    );
+
+    app.add_option_function<std::string>(
+        "--trace",
+        [](const std::string &traceFile) {
+            span::trace::Tracer::enable(traceFile);
+            // Also covers the exit() calls on failure paths
+            std::atexit(&span::trace::Tracer::flush);
+        },
+        "Record a Chrome trace-event timeline of the run into this file"
+    );
+
+    app.add_option_function<std::string>(
+        "--log-level",
+        [](const std::string &level) {
+            using Level = dev::Logger::Level;
+            dev::Logger::setLogLevel(
+                level == "debug" ? Level::DEBUG
+                : level == "warning" ? Level::WARNING
+                : level == "error" ? Level::ERROR
+                : Level::INFO
+            );
+        },
+        "Lowest level to log; debug messages are only available in debug builds"
+    )->check(CLI::IsMember({"debug", "info", "warning", "error"}));
+
+    app.add_option_function<std::string>(
+        "--log-format",
+        [](const std::string &format) {
+            dev::Logger::setFormat(format == "json" ? dev::Logger::Format::JSON : dev::Logger::Format::TEXT);
+        },
+        "Render log lines as text or as JSON objects, one per line"
+    )->check(CLI::IsMember({"text", "json"}));
+
+    // Stats are written at exit, which also covers the exit() calls on failure paths
+    static bool printStats = false;
+    static std::string statsJsonFile;
+    static std::string statsPrometheusFile;
+    const auto enableStats = [] {
+        static bool registered = false;
+        if (registered) {
+            return;
+        }
+        registered = true;
+        span::metrics::Registry::getInstance().setDetailed(true);
+        std::atexit([] {
+            const auto &registry = span::metrics::Registry::getInstance();
+            if (printStats) {
+                std::cerr << registry.toSummary();
+            }
+            if (!statsJsonFile.empty() && !span::metrics::writeFile(statsJsonFile, registry.toJson())) {
+                std::cerr << "Error: Cannot write stats to " << statsJsonFile << std::endl;
+            }
+            if (!statsPrometheusFile.empty() &&
+                !span::metrics::writeFile(statsPrometheusFile, registry.toPrometheus())) {
+                std::cerr << "Error: Cannot write stats to " << statsPrometheusFile << std::endl;
+            }
+        });
+    };
+
+    app.add_flag_callback(
+        "--stats",
+        [enableStats] {
+            printStats = true;
+            enableStats();
+        },
+        "Print cache, install and process metrics to stderr when done"
+    );
+
+    app.add_option_function<std::string>(
+        "--stats-json",
+        [enableStats](const std::string &file) {
+            statsJsonFile = file;
+            enableStats();
+        },
+        "Write metrics as JSON into this file when done"
+    );
+
+    app.add_option_function<std::string>(
+        "--stats-prometheus",
+        [enableStats](const std::string &file) {
+            statsPrometheusFile = file;
+            enableStats();
+        },
+        "Write metrics in Prometheus text format into this file when done, e.g. for the node_exporter textfile collector"
+    );
+
+    const auto socketOption = app.add_option(
+        "-s,--socket",
+        socketPath,
+        "Daemon socket; install, link and status are sent to the daemon when set"
+    );
+
+    // Built on first use so that requests served by the daemon skip this setup;
+    // managers are only created for the projects they are detected in
+    std::shared_ptr<dev::packages::Cache> cache;
+    std::shared_ptr<dev::packages::ManagerSet> managers;
+    auto initialize = [&] {
+        if (!cache) {
+            cache = std::make_shared<dev::packages::Cache>();
+            managers = std::make_shared<dev::packages::ManagerSet>(cache);
+        }
+    };
+
+    // Every project named by --directory and --manifest, or found below them with --recursive,
+    // absolute and without duplicates
+    auto getProjectDirs = [&]() -> std::vector<std::string> {
+        std::vector<std::string> directories = projectDirs;
+
+        if (!manifestFile.empty()) {
+            std::ifstream manifest(manifestFile);
+            if (!manifest) {
+                std::cerr << "Error: Cannot read manifest " << manifestFile << std::endl;
+                exit(1);
+            }
+
+            const fs::path manifestDir = fs::absolute(manifestFile).parent_path();
+            std::string line;
+            while (std::getline(manifest, line)) {
+                line.erase(0, line.find_first_not_of(" \t"));
+                line.erase(line.find_last_not_of(" \t\r") + 1);
+                if (!line.empty() && line.front() != '#') {
+                    directories.push_back((manifestDir / line).string());
+                }
+            }
+        }
+
+        if (directories.empty()) {
+            directories.push_back(fs::current_path().string());
+        }
+
+        if (recursive) {
+            const auto roots = std::move(directories);
+            directories = span::discovery::findProjects(*span::vfs::getDefault(), roots, {.excludes = excludes});
+            if (directories.empty()) {
+                std::cerr << "Error: No projects found below " << roots.front() << std::endl;
+                exit(1);
+            }
+        }
+
+        std::vector<std::string> unique;
+        std::unordered_set<std::string> seen;
+        for (const auto &directory: directories) {
+            auto absolute = fs::absolute(directory).lexically_normal().string();
+            if (seen.insert(absolute).second) {
+                unique.push_back(std::move(absolute));
+            }
+        }
+        return unique;
+    };
 
     auto detectPackageManagers = [&](
         const std::string &directory
     ) -> std::vector<std::shared_ptr<dev::packages::Manager>> {
-        std::vector<std::shared_ptr<dev::packages::Manager>> detected;
+        initialize();
+        return managers->detect(directory);
+    };
+
+    // Returns true if the daemon handled the request for every project
+    auto sendToDaemon = [&](const std::string &command) -> bool {
+        if (!useDaemon && socketOption->count() == 0) {
+            return false;
+        }
+
+        const span::daemon::Client client(socketPath);
+        if (!client.isAvailable()) {
+            std::cerr << "Warning: daemon not reachable at " << socketPath << ", running in-process" << std::endl;
+            return false;
+        }
 
-        for (auto &manager: managers) {
-            if (manager->isProjectType(directory)) {
-                detected.push_back(manager);
+        bool allSucceeded = true;
+        for (const auto &directory: getProjectDirs()) {
+            const auto response = client.request(command, directory);
+            if (!response || !response->ok) {
+                std::cerr << "Error: " << (response ? response->message : "daemon went away") << std::endl;
+                allSucceeded = false;
+                continue;
             }
+            std::cout << response->message << std::endl;
         }
 
+        if (!allSucceeded) {
+            exit(1);
+        }
+        return true;
+    };
+
+    // Detects the managers of every project, exiting if a project has none
+    auto detectAllProjects = [&]() {
+        std::vector<std::pair<std::string, std::shared_ptr<dev::packages::Manager> > > detected;
+        for (const auto &directory: getProjectDirs()) {
+            const auto detectedManagers = detectPackageManagers(directory);
+            if (detectedManagers.empty()) {
+                std::cerr << "Error: No known package manager detected in " << directory << std::endl;
+                exit(1);
+            }
+            for (const auto &manager: detectedManagers) {
+                detected.emplace_back(directory, manager);
+            }
+        }
         return detected;
     };
 
+    auto runForAllManagers = [&](
+        const std::function<bool(const std::shared_ptr<dev::packages::Manager> &, const std::string &)> &operation
+    ) -> bool {
+        const auto detected = detectAllProjects();
+
+        std::vector<std::future<bool> > futures;
+        futures.reserve(detected.size());
+        for (const auto &[directory, manager]: detected) {
+            futures.push_back(std::async(std::launch::async, operation, manager, directory));
+        }
+
+        bool allSucceeded = true;
+        for (auto &future: futures) {
+            allSucceeded &= future.get();
+        }
+        return allSucceeded;
+    };
+
     app.require_subcommand();
 
     const auto installCmd = app.add_subcommand(
@@ -42,27 +278,45 @@ int main(const int argc, char **argv) {
         "Link dependencies from cache, then install missing ones"
     );
 
+    size_t installConcurrency = std::thread::hardware_concurrency();
+    size_t linkConcurrency = 0;
+
+    installCmd->add_option(
+        "-j,--jobs",
+        installConcurrency,
+        "Number of concurrent package fetches across all projects"
+    );
+
+    installCmd->add_option(
+        "--link-jobs",
+        linkConcurrency,
+        "Number of concurrent links of packages already in a project or the cache (default: twice the CPU count)"
+    );
+
     installCmd->callback([&]() {
-        const auto detectedManagers = detectPackageManagers(projectDir);
-        if (detectedManagers.empty()) {
-            std::cerr << "Error: No known package manager detected in " << projectDir << std::endl;
-            exit(1);
+        if (sendToDaemon("install")) {
+            return;
         }
 
-        std::vector<std::future<bool> > installFutures;
-        installFutures.reserve(detectedManagers.size());
-        for (const std::shared_ptr<dev::packages::Manager> &manager: detectedManagers) {
-            installFutures.push_back(std::async(std::launch::async, [manager, &projectDir]() {
-                return manager->installDependencies(projectDir);
-            }));
+        // One pipeline for every project so shared packages are filled once
+        dev::packages::InstallPipeline pipeline({
+            .linkConcurrency = linkConcurrency,
+            .fetchConcurrency = installConcurrency
+        });
+        for (const auto &[directory, manager]: detectAllProjects()) {
+            pipeline.addProject(manager, directory);
         }
 
-        bool allInstalled = true;
-        for (auto &future: installFutures) {
-            allInstalled &= future.get();
+        const auto report = pipeline.finish();
+        dev::Logger::flush();
+
+        for (const auto &project: report.projects) {
+            if (!project.error.empty()) {
+                std::cerr << "Error: " << project.error << std::endl;
+            }
         }
 
-        if (allInstalled) {
+        if (report.success) {
             std::cout << "Dependencies installed successfully for all detected package managers." << std::endl;
         } else {
             std::cerr << "One or more dependency installations failed." << std::endl;
@@ -70,6 +324,252 @@ int main(const int argc, char **argv) {
         }
     });
 
+    const auto linkCmd = app.add_subcommand(
+        "link",
+        "Link dependencies from cache without installing missing ones"
+    );
+
+    linkCmd->callback([&]() {
+        if (sendToDaemon("link")) {
+            return;
+        }
+
+        const bool allLinked = runForAllManagers([](const auto &manager, const std::string &directory) {
+            return manager->linkDependencies(directory);
+        });
+        dev::Logger::flush();
+
+        if (allLinked) {
+            std::cout << "Dependencies linked successfully for all detected package managers." << std::endl;
+        } else {
+            std::cerr << "One or more dependencies could not be linked." << std::endl;
+            exit(1);
+        }
+    });
+
+    std::vector<std::string> prefetchPaths;
+    dev::packages::Prefetcher::Options prefetchOptions{.busyShare = 0.25};
+    bool prefetchNormalPriority = false;
+    size_t prefetchInterval = 0;
+
+    const auto prefetchCmd = app.add_subcommand(
+        "prefetch",
+        "Fill the cache with the packages of lock files at low priority, without changing the projects"
+    );
+
+    prefetchCmd->add_option(
+        "paths",
+        prefetchPaths,
+        "Lock files or project directories (defaults to --directory and --manifest)"
+    );
+
+    prefetchCmd->add_option(
+        "-j,--jobs",
+        prefetchOptions.concurrency,
+        "Number of packages filled at once"
+    );
+
+    prefetchCmd->add_option(
+        "--rate",
+        prefetchOptions.packagesPerSecond,
+        "Packages started per second; 0 for no limit"
+    );
+
+    prefetchCmd->add_option(
+        "--busy",
+        prefetchOptions.busyShare,
+        "Share of wall time spent filling, summed over jobs; the default 0.25 is a quarter of one core and disk, 0 is no limit"
+    )->check(CLI::Range(0.0, 1024.0));
+
+    prefetchCmd->add_flag(
+        "--normal-priority",
+        prefetchNormalPriority,
+        "Keep the normal CPU and I/O priority instead of nice 19 and the idle I/O class"
+    );
+
+    prefetchCmd->add_option(
+        "--interval",
+        prefetchInterval,
+        "Seconds between passes, re-reading the lock files each time; 0 for a single pass"
+    );
+
+    prefetchCmd->callback([&]() {
+        initialize();
+        prefetchOptions.lowPriority = !prefetchNormalPriority;
+
+        // A lock file stands for its project, as far as the managers that read it are concerned
+        std::vector<std::pair<std::string, std::string>> targets;
+        if (prefetchPaths.empty()) {
+            for (auto &directory: getProjectDirs()) {
+                targets.emplace_back(std::move(directory), "");
+            }
+        }
+        for (const auto &path: prefetchPaths) {
+            const fs::path absolute = fs::absolute(path).lexically_normal();
+            if (fs::is_directory(absolute)) {
+                targets.emplace_back(absolute.string(), "");
+            } else {
+                targets.emplace_back(absolute.parent_path().string(), absolute.filename().string());
+            }
+        }
+
+        while (true) {
+            dev::packages::Prefetcher prefetcher(prefetchOptions);
+            bool allAdded = true;
+            for (const auto &[directory, lockFile]: targets) {
+                size_t matched = 0;
+                for (const auto &manager: detectPackageManagers(directory)) {
+                    const auto files = manager->getDependencyFiles();
+                    if (!lockFile.empty() && std::ranges::find(files, lockFile) == files.end()) {
+                        continue;
+                    }
+                    ++matched;
+                    try {
+                        prefetcher.addProject(manager, directory);
+                    } catch (const std::exception &e) {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                        allAdded = false;
+                    }
+                }
+                if (matched == 0) {
+                    std::cerr << "Error: No known package manager reads "
+                        << (lockFile.empty() ? directory : (fs::path(directory) / lockFile).string()) << std::endl;
+                    allAdded = false;
+                }
+            }
+
+            const auto report = prefetcher.run();
+            dev::Logger::flush();
+            std::cout << "Prefetched " << report.filled << " of " << report.packages << " packages ("
+                << report.cached << " already cached, " << report.failures << " failed, throttled for "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(report.throttled).count() << "ms)."
+                << std::endl;
+
+            if (prefetchInterval == 0) {
+                if (!allAdded || report.failures) {
+                    exit(1);
+                }
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::seconds(prefetchInterval));
+        }
+    });
+
+    const auto statusCmd = app.add_subcommand(
+        "status",
+        "Show the status of the daemon"
+    );
+
+    statusCmd->callback([&]() {
+        const auto response = span::daemon::Client(socketPath).request("status");
+        if (!response) {
+            std::cerr << "No daemon running at " << socketPath << std::endl;
+            exit(1);
+        }
+        std::cout << response->message << std::endl;
+    });
+
+    std::vector<std::string> watchDirs;
+    size_t debounceMs = 250;
+
+    const auto watchCmd = app.add_subcommand(
+        "watch",
+        "Watch lock and dependency files and apply only the changed packages"
+    );
+
+    watchCmd->add_option(
+        "directories",
+        watchDirs,
+        "Project directories to watch (defaults to --directory and --manifest)"
+    );
+
+    watchCmd->add_option(
+        "--debounce",
+        debounceMs,
+        "Milliseconds a project's files must stay unchanged before it is synced"
+    );
+
+    watchCmd->callback([&]() {
+        if (watchDirs.empty()) {
+            watchDirs = getProjectDirs();
+        }
+
+        struct WatchedProject {
+            std::vector<std::shared_ptr<dev::packages::Manager>> managers;
+            std::vector<std::shared_ptr<const dev::packages::PackageTable>> applied;
+        };
+        std::unordered_map<std::string, WatchedProject> watched;
+
+        // Applies each manager's changes since its last applied table
+        auto sync = [&](const std::string &directory) {
+            auto &project = watched.at(directory);
+            for (size_t i = 0; i < project.managers.size(); ++i) {
+                try {
+                    bool success;
+                    project.applied[i] = project.managers[i]->syncDependencies(directory, project.applied[i], success);
+                    if (!success) {
+                        SPAN_LOG_ERROR("Some packages could not be applied in ", directory);
+                    }
+                } catch (const std::exception &e) {
+                    SPAN_LOG_ERROR("Failed to sync ", directory, ": ", e.what());
+                }
+            }
+        };
+
+        try {
+            span::watch::Watcher watcher{std::chrono::milliseconds(debounceMs)};
+
+            for (const auto &directory: watchDirs) {
+                const std::string absolute = fs::absolute(directory).lexically_normal().string();
+                auto detectedManagers = detectPackageManagers(absolute);
+                if (detectedManagers.empty()) {
+                    std::cerr << "Error: No known package manager detected in " << absolute << std::endl;
+                    exit(1);
+                }
+
+                for (const auto &manager: detectedManagers) {
+                    watcher.addProject(absolute, manager->getDependencyFiles());
+                }
+
+                watched[absolute] = {
+                    detectedManagers,
+                    std::vector(detectedManagers.size(), dev::packages::PackageTable::emptyTable())
+                };
+                sync(absolute);
+            }
+
+            SPAN_LOG_INFO("Watching ", watched.size(), " project(s) for dependency changes");
+            watcher.run(sync);
+        } catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            exit(1);
+        }
+    });
+
+    size_t daemonConcurrency = std::thread::hardware_concurrency();
+
+    const auto daemonCmd = app.add_subcommand(
+        "daemon",
+        "Keep the cache, parsed lock files and thread pool warm and serve requests over a Unix socket"
+    );
+
+    daemonCmd->add_option(
+        "-j,--jobs",
+        daemonConcurrency,
+        "Number of concurrent package installs shared by all requests"
+    );
+
+    daemonCmd->callback([&]() {
+        initialize();
+        try {
+            span::daemon::Server server(socketPath, cache, managers, daemonConcurrency);
+            server.run();
+        } catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            exit(1);
+        }
+    });
+
     CLI11_PARSE(app, argc, argv);
 
     return 0;
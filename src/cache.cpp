@@ -1,23 +1,110 @@
 #include "cache.h"
+#include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+#include "packages/manager.h"
 #include <filesystem>
-#include <iostream>
 #include <cstdlib>
-#include <fstream>
 #include <chrono>
 #include <algorithm>
 #include <array>
 #include <cstring>
+#include <thread>
 #include <unordered_map>
-#include <sys/stat.h>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 
 namespace dev::packages {
-    Cache::Cache(const std::optional<std::string>& customCacheDir)
-        : cacheDir(customCacheDir.value_or(getDefaultCacheDir())) {
-        fs::create_directories(cacheDir);
+    namespace {
+        auto& registry = span::metrics::Registry::getInstance();
+        auto& hits = registry.counter("span_cache_hits_total", "Cache lookups that found the package");
+        auto& misses = registry.counter("span_cache_misses_total", "Cache lookups that did not find the package");
+        auto& integrityFailures = registry.counter(
+            "span_cache_integrity_failures_total", "Cached packages present on disk but failing verification"
+        );
+        auto& linksFromCache = registry.counter("span_cache_links_total", "Packages linked between projects and the cache", "direction=\"from_cache\"");
+        auto& linksToCache = registry.counter("span_cache_links_total", "Packages linked between projects and the cache", "direction=\"to_cache\"");
+        auto& bytesLinked = registry.counter(
+            "span_cache_bytes_linked_total", "Bytes of package files made available to projects by linking"
+        );
+        auto& filesLinked = registry.counter(
+            "span_cache_files_linked_total", "Files hard-linked or copied between projects and the cache"
+        );
+        auto& evictions = registry.counter("span_cache_evictions_total", "Packages evicted by cleanup");
+        auto& bytesEvicted = registry.counter("span_cache_evicted_bytes_total", "Bytes freed by cleanup");
+
+        uintmax_t getTreeSize(const span::vfs::FileSystem& fileSystem, const fs::path& path) {
+            uintmax_t total = 0;
+            fileSystem.walk(path, [&](const fs::path&, const span::vfs::Status& status, size_t) {
+                if (status.isFile()) {
+                    total += status.size;
+                }
+            });
+            return total;
+        }
+
+        /**
+         * Recreate a tree of directories and files with every file hard-linked,
+         * or copied where it cannot be, e.g. across devices. Symlinks are left out.
+         *
+         * @return The number of bytes linked or copied
+         * @throws fs::filesystem_error if a directory or file cannot be created
+         */
+        uintmax_t linkTree(
+            span::vfs::FileSystem& fileSystem,
+            const fs::path& from,
+            const fs::path& to,
+            const std::string_view exclude
+        ) {
+            // Into a new directory nothing can be in the way, which saves a stat per file
+            const bool replace = fileSystem.symlinkStatus(to).exists();
+            fileSystem.createDirectories(to);
+
+            const std::string_view root = from.native();
+            const size_t prefix = root.size() + (root.ends_with('/') ? 0 : 1);
+            uintmax_t bytes = 0;
+            uint64_t files = 0;
+
+            fileSystem.walk(from, [&](const fs::path& path, const span::vfs::Status& status, size_t) {
+                const std::string_view relative = std::string_view(path.native()).substr(prefix);
+                if (!exclude.empty() && relative.starts_with(exclude)
+                    && (relative.size() == exclude.size() || relative[exclude.size()] == '/')) {
+                    return;
+                }
+
+                const fs::path destination = to / relative;
+                if (status.isDirectory()) {
+                    fileSystem.createDirectories(destination);
+                    return;
+                }
+                if (!status.isFile()) {
+                    return;
+                }
+
+                if (replace && fileSystem.symlinkStatus(destination).exists()) {
+                    fileSystem.removeAll(destination);
+                }
+                try {
+                    fileSystem.createHardLink(path, destination);
+                } catch (const fs::filesystem_error&) {
+                    fileSystem.writeFile(destination, fileSystem.readFile(path));
+                }
+                bytes += status.size;
+                ++files;
+            });
+
+            filesLinked.add(files);
+            return bytes;
+        }
     }
 
+    Cache::Cache(
+        const std::optional<std::string>& customCacheDir,
+        std::shared_ptr<span::vfs::FileSystem> fileSystem
+    ) : cacheDir(customCacheDir.value_or(getDefaultCacheDir())),
+        fileSystem(fileSystem ? std::move(fileSystem) : span::vfs::getDefault()) {}
+
     std::string Cache::getDefaultCacheDir() {
         if (const char* envCacheDir = std::getenv("DEV_PACKAGE_CACHE")) {
             return fs::path(envCacheDir).make_preferred().string();
@@ -40,87 +127,242 @@ namespace dev::packages {
         return cacheDir;
     }
 
+    const std::shared_ptr<span::vfs::FileSystem>& Cache::getFileSystem() const {
+        return fileSystem;
+    }
+
     bool Cache::isCached(
-        const std::string& language,
-        const std::string& package,
-        const std::string& version
+        std::string_view language,
+        std::string_view package,
+        std::string_view version
     ) const {
-        const auto path = (
-            fs::path(cacheDir) /
-            escapePath(language) /
-            escapePath(package) /
-            escapePath(version)
-        ).make_preferred();
+        const auto path = getPackagePath(language, package, version);
+
+        const bool exists = fileSystem->exists(path);
+        if (exists && verifyPackageIntegrity(language, package, version)) {
+            hits.add();
+            return true;
+        }
+
+        if (exists) {
+            integrityFailures.add();
+        }
+        misses.add();
+        return false;
+    }
 
-        return fs::exists(path) && verifyPackageIntegrity(language, package, version);
+    bool Cache::lookup(
+        const fs::path& path,
+        std::string_view language,
+        std::string_view package,
+        std::string_view version
+    ) const {
+        return fileSystem->exists(path) && verifyPackageIntegrity(language, package, version);
     }
 
     bool Cache::linkFromCache(
-        const std::string& language,
-        const std::string& package,
-        const std::string& version,
+        std::string_view language,
+        std::string_view package,
+        std::string_view version,
         const std::string& targetDir
     ) const {
-        const auto cachedPath = (
-            fs::path(cacheDir) /
-            escapePath(language) /
-            escapePath(package) /
-            escapePath(version)
-        ).make_preferred();
+        const auto cachedPath = getPackagePath(language, package, version);
 
         const auto targetPath = fs::path(targetDir);
 
-        if (!isCached(language, package, version)) {
+        if (!lookup(cachedPath, language, package, version)) {
             return false;
         }
 
         try {
-            if (fs::exists(targetPath)) {
-                fs::remove_all(targetPath);
+            if (fileSystem->symlinkStatus(targetPath).exists()) {
+                fileSystem->removeAll(targetPath);
             }
+            fileSystem->createDirectories(targetPath.parent_path());
             createSymlink(cachedPath, targetPath);
+
+            linksFromCache.add();
+            if (span::metrics::Registry::getInstance().isDetailed()) {
+                bytesLinked.add(getTreeSize(*fileSystem, cachedPath));
+            }
             return true;
         } catch (const fs::filesystem_error& e) {
-            std::cerr << "Filesystem error: " << e.what() << std::endl;
+            SPAN_LOG_ERROR("Filesystem error: ", e.what());
             return false;
         }
     }
 
     bool Cache::linkToCache(
-        const std::string& language,
-        const std::string& package,
-        const std::string& version,
+        std::string_view language,
+        std::string_view package,
+        std::string_view version,
         const std::string& sourceDir
     ) const {
-        const auto cachedPath = (
-            fs::path(cacheDir) /
-            escapePath(language) /
-            escapePath(package) /
-            escapePath(version)
-        ).make_preferred();
+        const auto cachedPath = getPackagePath(language, package, version);
 
         const auto sourcePath = fs::path(sourceDir);
 
-        if (!fs::exists(sourcePath)) {
+        if (!fileSystem->exists(sourcePath)) {
             return false;
         }
 
+        // A project linked from the cache points at the entry already; pointing the entry back would make a loop
+        if (fileSystem->symlinkStatus(sourcePath).type == span::vfs::FileType::SYMLINK
+            && fileSystem->readSymlink(sourcePath) == cachedPath) {
+            return true;
+        }
+
         try {
             // Create the parent directories in cache
-            fs::create_directories(cachedPath.parent_path());
+            fileSystem->createDirectories(cachedPath.parent_path());
 
             // If cache directory already exists, remove it first
-            if (fs::exists(cachedPath)) {
-                fs::remove_all(cachedPath);
+            if (fileSystem->exists(cachedPath)) {
+                fileSystem->removeAll(cachedPath);
             }
 
             // Create symlink from cache to source
             createSymlink(sourcePath, cachedPath);
+            linksToCache.add();
             return true;
         } catch (const fs::filesystem_error& e) {
-            std::cerr << "Filesystem error: " << e.what() << std::endl;
+            SPAN_LOG_ERROR("Filesystem error: ", e.what());
+            return false;
+        }
+    }
+
+    bool Cache::materializeFromCache(
+        std::string_view language,
+        std::string_view package,
+        std::string_view version,
+        const std::string& targetDir
+    ) const {
+        const auto cachedPath = getPackagePath(language, package, version);
+        const auto targetPath = fs::path(targetDir);
+
+        if (!lookup(cachedPath, language, package, version)) {
+            return false;
+        }
+
+        try {
+            // A symlink from an earlier link would have the files written through it into the cache
+            if (const auto existing = fileSystem->symlinkStatus(targetPath); existing.exists() && !existing.isDirectory()) {
+                fileSystem->removeAll(targetPath);
+            }
+
+            bytesLinked.add(linkTree(*fileSystem, cachedPath, targetPath, {}));
+            linksFromCache.add();
+            return true;
+        } catch (const fs::filesystem_error& e) {
+            SPAN_LOG_ERROR("Filesystem error: ", e.what());
+            return false;
+        }
+    }
+
+    bool Cache::materializeToCache(
+        std::string_view language,
+        std::string_view package,
+        std::string_view version,
+        const std::string& sourceDir,
+        const std::string_view exclude
+    ) const {
+        const auto cachedPath = getPackagePath(language, package, version);
+        if (lookup(cachedPath, language, package, version)) {
+            return true;
+        }
+
+        const auto sourcePath = fs::path(sourceDir);
+        if (!fileSystem->isDirectory(sourcePath)) {
             return false;
         }
+
+        const bool added = addToCache(language, package, version, [&](const fs::path& directory) {
+            linkTree(*fileSystem, sourcePath, directory, exclude);
+        });
+        if (added) {
+            linksToCache.add();
+        }
+        return added;
+    }
+
+    bool Cache::addToCache(
+        std::string_view language,
+        std::string_view package,
+        std::string_view version,
+        const std::function<void(const fs::path& directory)>& fill
+    ) const {
+        const auto cachedPath = getPackagePath(language, package, version);
+
+        // Filled under a name of its own, so a half-written package is never visible
+        const fs::path partialPath = getPartialPath(cachedPath);
+
+        try {
+            fileSystem->removeAll(partialPath);
+            fileSystem->createDirectories(partialPath.parent_path());
+            fill(partialPath);
+
+            if (fileSystem->exists(cachedPath)) {
+                // Filled concurrently by another project, or left behind broken
+                if (lookup(cachedPath, language, package, version)) {
+                    fileSystem->removeAll(partialPath);
+                    return true;
+                }
+                fileSystem->removeAll(cachedPath);
+            }
+            fileSystem->rename(partialPath, cachedPath);
+            return true;
+        } catch (const std::exception& e) {
+            SPAN_LOG_ERROR("Failed to add ", package, " ", version, " to the cache: ", e.what());
+            discard(partialPath);
+            return lookup(cachedPath, language, package, version);
+        }
+    }
+
+    void Cache::extractArchive(
+        const fs::path& archive,
+        const fs::path& directory,
+        const std::string_view package,
+        const size_t stripComponents
+    ) const {
+        span::trace::Span extract("extract", "install", package);
+        // tar and unzip run on the real filesystem, like every package manager command
+        std::string command;
+        if (archive.extension() == ".zip") {
+            command = "unzip -qq -o " + Manager::quoteArgument(archive.string())
+                + " -d " + Manager::quoteArgument(directory.string());
+        } else {
+            fileSystem->createDirectories(directory);
+            command = "tar -xzf " + Manager::quoteArgument(archive.string())
+                + " -C " + Manager::quoteArgument(directory.string()) + " --no-same-owner";
+            if (stripComponents > 0) {
+                command += " --strip-components=" + std::to_string(stripComponents);
+            }
+        }
+        SPAN_LOG_DEBUG("Running command: ", command);
+        if (std::system(command.c_str()) != 0) {
+            throw PackageManagerError("Failed to extract " + archive.string());
+        }
+    }
+
+    void Cache::discard(const fs::path& path) const noexcept {
+        try {
+            fileSystem->removeAll(path);
+        } catch (const fs::filesystem_error&) {
+            // Scratch directories sit next to version directories, so cleanup evicts what is left
+        }
+    }
+
+    fs::path Cache::getPackagePath(
+        std::string_view language,
+        std::string_view package,
+        std::string_view version
+    ) const {
+        return (
+            fs::path(cacheDir) /
+            escapePath(language) /
+            escapePath(package) /
+            escapePath(version)
+        ).make_preferred();
     }
 
     void Cache::createSymlink(const fs::path& target, const fs::path& link) const {
@@ -136,11 +378,19 @@ namespace dev::packages {
 
         return _pclose(pipe) == 0;
 #else
-        return fs::create_symlink(target, link);
+        fileSystem->createSymlink(target, link);
 #endif
     }
 
-    std::string Cache::escapePath(const std::string& path) {
+    fs::path Cache::getPartialPath(const fs::path& path) {
+        // Thread ids repeat across processes, e.g. two installs sharing a cache
+        fs::path partialPath = path;
+        partialPath += ".partial-" + std::to_string(::getpid()) + "-"
+            + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        return partialPath;
+    }
+
+    std::string Cache::escapePath(const std::string_view path) {
         std::string result;
         result.reserve(path.size());
 
@@ -156,56 +406,38 @@ namespace dev::packages {
     }
 
     bool Cache::cleanPackage(
-        const std::string& language,
-        const std::string& package,
-        const std::string& version
+        std::string_view language,
+        std::string_view package,
+        std::string_view version
     ) const {
-        const auto path = (
-            fs::path(cacheDir) /
-            escapePath(language) /
-            escapePath(package) /
-            escapePath(version)
-        ).make_preferred();
+        const auto path = getPackagePath(language, package, version);
 
         try {
-            return fs::remove_all(path) > 0;
+            return fileSystem->removeAll(path) > 0;
         } catch (const fs::filesystem_error&) {
             return false;
         }
     }
 
     bool Cache::verifyPackageIntegrity(
-        const std::string& language,
-        const std::string& package,
-        const std::string& version
+        std::string_view language,
+        std::string_view package,
+        std::string_view version
     ) const {
-        const auto path = (
-            fs::path(cacheDir) /
-            escapePath(language) /
-            escapePath(package) /
-            escapePath(version)
-        ).make_preferred();
-
-        if (!fs::exists(path)) {
-            return false;
-        }
+        const auto path = getPackagePath(language, package, version);
 
-        try {
-            // TODO: Implement checksum verification when checksums are available
-            // Basic integrity check - ensure directory is readable and not empty
-            return fs::is_directory(path) && !fs::is_empty(path);
-        } catch (const fs::filesystem_error&) {
-            return false;
-        }
+        // TODO: Implement checksum verification when checksums are available
+        // Basic integrity check - ensure directory is readable and not empty
+        return fileSystem->isDirectory(path) && !fileSystem->isEmptyDirectory(path);
     }
 
     size_t Cache::getCacheSize() const {
         size_t total = 0;
-        for (const auto& entry : fs::recursive_directory_iterator(cacheDir)) {
-            if (fs::is_regular_file(entry)) {
-                total += fs::file_size(entry);
+        fileSystem->walk(cacheDir, [&](const fs::path&, const span::vfs::Status& status, size_t) {
+            if (status.isFile()) {
+                total += status.size;
             }
-        }
+        });
         return total;
     }
 
@@ -221,44 +453,26 @@ namespace dev::packages {
             std::unordered_map<fs::path, uintmax_t> sizeMap;
             std::unordered_map<fs::path, fs::file_time_type> accessMap;
 
-            for (
-                auto it = fs::recursive_directory_iterator(cacheDir);
-                 it != fs::recursive_directory_iterator();
-                 ++it
-            ) {
-                if (!fs::is_regular_file(it->path()) || it.depth() < 4) {
-                    continue;
+            // Files are <language>/<package>/<version>/..., so a file at depth
+            // 3 or deeper belongs to the version directory at depth 2
+            fileSystem->walk(cacheDir, [&](const fs::path& path, const span::vfs::Status& status, size_t depth) {
+                if (!status.isFile() || depth < 3) {
+                    return;
                 }
 
-                // Find the version directory at depth 3
-                fs::path versionDir = it->path();
-                int d = it.depth();
-                while (d-- > 3) {
+                fs::path versionDir = path;
+                while (depth-- > 2) {
                     versionDir = versionDir.parent_path();
                 }
 
-                uintmax_t fileSize = fs::file_size(it->path());
-                sizeMap[versionDir] += fileSize;
+                sizeMap[versionDir] += status.size;
 
-                // Get file access time (LRU eviction key)
-                fs::file_time_type accessTime;
-#ifdef _WIN32
-                // TODO: Implement Windows-specific access time retrieval
-                atime = fs::last_write_time(it->path());
-#else
-                struct stat sb{};
-                if (stat(it->path().c_str(), &sb) == 0) {
-                    auto sysTime = std::chrono::system_clock::from_time_t(sb.st_atime);
-                    accessTime = fs::file_time_type::clock::from_sys(sysTime);
-                } else {
-                    accessTime = fs::last_write_time(it->path());
-                }
-#endif
+                // Access time is the LRU eviction key
                 auto current = accessMap.find(versionDir);
-                if (current == accessMap.end() || accessTime > current->second) {
-                    accessMap[versionDir] = accessTime;
+                if (current == accessMap.end() || status.accessed > current->second) {
+                    accessMap[versionDir] = status.accessed;
                 }
-            }
+            });
 
             // Build cache entries
             std::vector<CacheEntry> entries;
@@ -287,8 +501,10 @@ namespace dev::packages {
                 if (currentSize <= maxSizeBytes) {
                     break;
                 }
-                if (fs::remove_all(entry.path) > 0) {
+                if (fileSystem->removeAll(entry.path) > 0) {
                     currentSize -= entry.size;
+                    evictions.add();
+                    bytesEvicted.add(entry.size);
                 }
             }
 
@@ -0,0 +1,322 @@
+#include "daemon.h"
+#include "logger.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace span::daemon {
+    namespace {
+        constexpr size_t MAX_REQUEST_BYTES = 64 * 1024;
+        constexpr size_t CONNECTION_THREADS = 8;
+        constexpr int ACCEPT_POLL_MS = 250;
+
+        std::atomic<bool> signalled{false};
+
+        void onSignal(int) {
+            signalled.store(true, std::memory_order_relaxed);
+        }
+
+        sockaddr_un makeAddress(const std::string& socketPath) {
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            if (socketPath.size() >= sizeof(address.sun_path)) {
+                throw std::runtime_error("Socket path is too long: " + socketPath);
+            }
+            std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+            return address;
+        }
+
+        bool writeAll(const int fd, const std::string& data) {
+            size_t written = 0;
+            while (written < data.size()) {
+                const ssize_t n = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return false;
+                }
+                written += static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        std::optional<std::string> readLine(const int fd) {
+            std::string line;
+            char buffer[4096];
+            while (line.size() < MAX_REQUEST_BYTES) {
+                const ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    return std::nullopt;
+                }
+                line.append(buffer, static_cast<size_t>(n));
+                if (const auto end = line.find('\n'); end != std::string::npos) {
+                    line.resize(end);
+                    return line;
+                }
+            }
+            return std::nullopt;
+        }
+
+        std::string encodeResponse(const Response& response) {
+            std::string message = response.message;
+            for (char& c : message) {
+                if (c == '\n') {
+                    c = ' ';
+                }
+            }
+            return (response.ok ? "ok\t" : "error\t") + message + "\n";
+        }
+    }
+
+    std::string getDefaultSocketPath() {
+        if (const char* socketPath = std::getenv("SPAN_DAEMON_SOCKET")) {
+            return socketPath;
+        }
+        if (const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR")) {
+            return (fs::path(runtimeDir) / "span.sock").string();
+        }
+        return "/tmp/span-" + std::to_string(::getuid()) + ".sock";
+    }
+
+    Server::Server(
+        std::string socketPath,
+        std::shared_ptr<dev::packages::Cache> cache,
+        std::shared_ptr<dev::packages::ManagerSet> managers,
+        const size_t maxConcurrentInstalls
+    ) : socketPath(std::move(socketPath)),
+        cache(std::move(cache)),
+        managers(std::move(managers)),
+        installPool(std::make_shared<threads::ThreadPool>(
+            maxConcurrentInstalls ? maxConcurrentInstalls : std::thread::hardware_concurrency()
+        )),
+        startedAt(std::chrono::steady_clock::now()) {
+        this->managers->setThreadPool(installPool);
+    }
+
+    Server::~Server() {
+        // Drain requests in flight before closing the socket they reply on
+        connectionPool.reset();
+
+        if (listenFd >= 0) {
+            ::close(listenFd);
+            ::unlink(socketPath.c_str());
+        }
+    }
+
+    void Server::bindSocket() {
+        const sockaddr_un address = makeAddress(socketPath);
+
+        if (fs::exists(fs::symlink_status(socketPath))) {
+            if (Client(socketPath).isAvailable()) {
+                throw std::runtime_error("A daemon is already listening on " + socketPath);
+            }
+            // Stale socket left behind by a daemon that did not shut down cleanly
+            ::unlink(socketPath.c_str());
+        }
+
+        listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) {
+            throw std::runtime_error("Failed to create socket: " + std::string(std::strerror(errno)));
+        }
+
+        // Only the owning user may talk to the daemon
+        const mode_t previousMask = ::umask(0177);
+        const int bound = ::bind(listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+        ::umask(previousMask);
+
+        if (bound < 0 || ::listen(listenFd, SOMAXCONN) < 0) {
+            const std::string reason = std::strerror(errno);
+            ::close(listenFd);
+            listenFd = -1;
+            throw std::runtime_error("Failed to listen on " + socketPath + ": " + reason);
+        }
+    }
+
+    void Server::run() {
+        bindSocket();
+        connectionPool = std::make_unique<threads::ThreadPool>(CONNECTION_THREADS);
+
+        struct sigaction action{};
+        action.sa_handler = onSignal;
+        sigemptyset(&action.sa_mask);
+        ::sigaction(SIGINT, &action, nullptr);
+        ::sigaction(SIGTERM, &action, nullptr);
+
+        SPAN_LOG_INFO("Daemon listening on ", socketPath);
+
+        while (!stopping.load(std::memory_order_acquire) && !signalled.load(std::memory_order_relaxed)) {
+            pollfd listener{listenFd, POLLIN, 0};
+            const int ready = ::poll(&listener, 1, ACCEPT_POLL_MS);
+            if (ready <= 0) {
+                continue;
+            }
+
+            const int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                continue;
+            }
+
+            connectionPool->enqueue([this, fd] {
+                handleConnection(fd);
+                ::close(fd);
+            });
+        }
+
+        SPAN_LOG_INFO("Daemon shutting down");
+        connectionPool.reset();
+    }
+
+    void Server::stop() {
+        stopping.store(true, std::memory_order_release);
+    }
+
+    void Server::handleConnection(const int fd) {
+        const auto line = readLine(fd);
+        if (!line) {
+            return;
+        }
+
+        const auto separator = line->find('\t');
+        const std::string command = line->substr(0, separator);
+        const std::string directory = separator == std::string::npos ? "" : line->substr(separator + 1);
+
+        ++requestsActive;
+        Response response;
+        try {
+            response = handleRequest(command, directory);
+        } catch (const std::exception& e) {
+            response = {false, e.what()};
+        }
+        --requestsActive;
+        ++requestsServed;
+
+        writeAll(fd, encodeResponse(response));
+    }
+
+    Response Server::handleRequest(const std::string& command, const std::string& directory) {
+        if (command == "status") {
+            const auto uptime = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now() - startedAt
+            );
+            return {
+                true,
+                "pid=" + std::to_string(::getpid()) +
+                " uptime=" + std::to_string(uptime.count()) + "s" +
+                " served=" + std::to_string(requestsServed.load()) +
+                " active=" + std::to_string(requestsActive.load() - 1) +
+                " managers=" + std::to_string(managers->size()) +
+                " cache=" + cache->getCacheDir()
+            };
+        }
+
+        if (command != "install" && command != "link") {
+            return {false, "Unknown command: " + command};
+        }
+        if (directory.empty() || !fs::path(directory).is_absolute()) {
+            return {false, "Expected an absolute project directory"};
+        }
+
+        // Two requests for a project would install over each other, e.g. one removing what the other links
+        std::error_code error;
+        fs::path normalized = fs::weakly_canonical(directory, error);
+        if (error) {
+            normalized = fs::path(directory).lexically_normal();
+        }
+        if (!normalized.has_filename() && normalized.has_parent_path()) {
+            normalized = normalized.parent_path();
+        }
+        const std::string project = normalized.string();
+
+        ProjectLock* projectLock;
+        {
+            std::lock_guard lock(projectLocksMutex);
+            projectLock = &projectLocks[project];
+            ++projectLock->requests;
+        }
+        const auto release = [this, &project](ProjectLock* held) {
+            held->mutex.unlock();
+            std::lock_guard lock(projectLocksMutex);
+            if (--held->requests == 0) {
+                projectLocks.erase(project);
+            }
+        };
+        projectLock->mutex.lock();
+        const std::unique_ptr<ProjectLock, decltype(release)> held(projectLock, release);
+
+        const auto detected = managers->detect(directory);
+        if (detected.empty()) {
+            return {false, "No known package manager detected in " + directory};
+        }
+
+        bool success = true;
+        for (const auto& manager : detected) {
+            success &= command == "install"
+                ? manager->installDependencies(directory)
+                : manager->linkDependencies(directory);
+        }
+
+        if (!success) {
+            return {false, "One or more dependencies failed to " + command + " in " + directory};
+        }
+        return {true, (command == "install" ? "Dependencies installed for " : "Dependencies linked for ") + directory};
+    }
+
+    Client::Client(std::string socketPath) : socketPath(std::move(socketPath)) {}
+
+    int Client::connectSocket() const {
+        const sockaddr_un address = makeAddress(socketPath);
+
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    bool Client::isAvailable() const {
+        const int fd = connectSocket();
+        if (fd < 0) {
+            return false;
+        }
+        ::close(fd);
+        return true;
+    }
+
+    std::optional<Response> Client::request(const std::string& command, const std::string& directory) const {
+        const int fd = connectSocket();
+        if (fd < 0) {
+            return std::nullopt;
+        }
+
+        std::optional<Response> response;
+        if (writeAll(fd, command + "\t" + directory + "\n")) {
+            if (const auto line = readLine(fd)) {
+                const auto separator = line->find('\t');
+                response = Response{
+                    line->substr(0, separator) == "ok",
+                    separator == std::string::npos ? "" : line->substr(separator + 1)
+                };
+            }
+        }
+
+        ::close(fd);
+        return response;
+    }
+} // namespace span::daemon
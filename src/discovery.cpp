@@ -0,0 +1,302 @@
+#include "discovery.h"
+#include "logger.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "packages/manager_factory.h"
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace fs = std::filesystem;
+
+namespace span::discovery {
+    namespace {
+        struct Rule {
+            std::string pattern;
+            bool negated{false};
+            // Holds a '/', so it is matched against the path below its .gitignore instead of the name
+            bool anchored{false};
+        };
+
+        /**
+         * The rules of one .gitignore, chained to those of the directories above it.
+         */
+        struct RuleSet {
+            std::shared_ptr<const RuleSet> parent;
+            // Directory of the .gitignore relative to the root; empty for the root itself
+            std::string base;
+            std::vector<Rule> rules;
+        };
+
+        std::optional<Rule> parseRule(std::string_view line) {
+            if (line.ends_with('\r')) {
+                line.remove_suffix(1);
+            }
+            while (line.ends_with(' ') && !line.ends_with("\\ ")) {
+                line.remove_suffix(1);
+            }
+            if (line.empty() || line.starts_with('#')) {
+                return std::nullopt;
+            }
+
+            Rule rule;
+            if (line.starts_with('!')) {
+                rule.negated = true;
+                line.remove_prefix(1);
+            }
+            // Only directories are matched, so a pattern for directories only is like any other
+            if (line.ends_with('/')) {
+                line.remove_suffix(1);
+            }
+            rule.anchored = line.find('/') != std::string_view::npos;
+            if (line.starts_with('/')) {
+                line.remove_prefix(1);
+            }
+            if (line.empty()) {
+                return std::nullopt;
+            }
+            rule.pattern = line;
+            return rule;
+        }
+
+        std::vector<Rule> parseRules(const std::string_view contents) {
+            std::vector<Rule> rules;
+            for (size_t start = 0; start < contents.size();) {
+                const size_t end = std::min(contents.find('\n', start), contents.size());
+                if (auto rule = parseRule(contents.substr(start, end - start))) {
+                    rules.push_back(std::move(*rule));
+                }
+                start = end + 1;
+            }
+            return rules;
+        }
+
+        /**
+         * Apply one file's rules to a directory; the last rule that matches decides.
+         * @return Whether the directory is excluded, or nothing if no rule matches
+         */
+        std::optional<bool> evaluate(const std::vector<Rule>& rules, const std::string_view path, const std::string_view name) {
+            for (auto rule = rules.rbegin(); rule != rules.rend(); ++rule) {
+                if (matchesGlob(rule->pattern, rule->anchored ? path : name)) {
+                    return !rule->negated;
+                }
+            }
+            return std::nullopt;
+        }
+
+        bool isIgnored(const RuleSet* rules, const std::string_view path, const std::string_view name) {
+            // A deeper .gitignore takes precedence over the ones above it
+            for (; rules; rules = rules->parent.get()) {
+                const std::string_view relative = rules->base.empty() ? path : path.substr(rules->base.size() + 1);
+                if (const auto excluded = evaluate(rules->rules, relative, name)) {
+                    return *excluded;
+                }
+            }
+            return false;
+        }
+
+        size_t getConcurrency(const size_t configured) {
+            return configured ? configured : std::max<size_t>(4, 2 * std::max(std::thread::hardware_concurrency(), 1U));
+        }
+
+        /**
+         * A parallel walk: every directory is listed by a task of its own,
+         * which queues a task for each subdirectory it does not skip.
+         */
+        class Search {
+        public:
+            Search(const vfs::FileSystem& fileSystem, const Options& options)
+                : fileSystem(fileSystem),
+                  useGitignore(options.useGitignore),
+                  pool(getConcurrency(options.concurrency)) {
+                for (const auto& exclude : options.excludes) {
+                    if (auto rule = parseRule(exclude)) {
+                        excludes.push_back(std::move(*rule));
+                    }
+                }
+            }
+
+            void addRoot(const fs::path& root) {
+                queue(root, "", nullptr);
+            }
+
+            std::vector<std::string> wait() {
+                std::unique_lock lock(mutex);
+                idle.wait(lock, [this] { return pending == 0; });
+                return std::move(projects);
+            }
+
+        private:
+            const vfs::FileSystem& fileSystem;
+            const bool useGitignore;
+            std::vector<Rule> excludes;
+
+            std::mutex mutex;
+            std::condition_variable idle;
+            size_t pending{0};
+            std::vector<std::string> projects;
+
+            // Declared last, so its workers are joined before the state they use is destroyed
+            threads::ThreadPool pool;
+
+            void queue(const fs::path& root, std::string path, std::shared_ptr<const RuleSet> rules) {
+                {
+                    std::lock_guard lock(mutex);
+                    ++pending;
+                }
+                pool.enqueue([this, &root, path = std::move(path), rules = std::move(rules)]() mutable {
+                    try {
+                        visit(root, path, std::move(rules));
+                    } catch (const std::exception& e) {
+                        SPAN_LOG_WARNING("Cannot search ", (root / path).string(), ": ", e.what());
+                    }
+
+                    std::lock_guard lock(mutex);
+                    if (--pending == 0) {
+                        idle.notify_all();
+                    }
+                });
+            }
+
+            void visit(const fs::path& root, const std::string& path, std::shared_ptr<const RuleSet> rules) {
+                const fs::path directory = path.empty() ? root : root / path;
+                const auto entries = fileSystem.list(directory);
+
+                if (!dev::packages::ManagerFactory::getInstance().detect(entries).empty()) {
+                    std::lock_guard lock(mutex);
+                    projects.push_back(directory.string());
+                }
+
+                const auto gitignore = std::ranges::find(entries, ".gitignore", &vfs::DirectoryEntry::name);
+                if (useGitignore && gitignore != entries.end() && gitignore->type == vfs::FileType::FILE) {
+                    auto parsed = parseRules(fileSystem.readFile(directory / gitignore->name));
+                    if (!parsed.empty()) {
+                        rules = std::make_shared<const RuleSet>(RuleSet{std::move(rules), path, std::move(parsed)});
+                    }
+                }
+
+                for (const auto& entry : entries) {
+                    if (entry.type != vfs::FileType::DIRECTORY
+                        || std::ranges::find(SKIPPED_DIRECTORIES, entry.name) != SKIPPED_DIRECTORIES.end()) {
+                        continue;
+                    }
+                    std::string child = path.empty() ? entry.name : path + "/" + entry.name;
+                    const auto excluded = evaluate(excludes, child, entry.name);
+                    if (excluded ? *excluded : isIgnored(rules.get(), child, entry.name)) {
+                        continue;
+                    }
+                    queue(root, std::move(child), rules);
+                }
+            }
+        };
+    }
+
+    std::vector<std::string> findProjects(
+        const vfs::FileSystem& fileSystem,
+        const std::vector<std::string>& roots,
+        const Options& options
+    ) {
+        trace::Span search("find_projects", "discovery");
+
+        // Outlive the search, whose tasks refer to them
+        std::vector<fs::path> absoluteRoots;
+        absoluteRoots.reserve(roots.size());
+        for (const auto& root : roots) {
+            fs::path absolute = fs::absolute(root).lexically_normal();
+            if (!absolute.has_filename() && absolute.has_relative_path()) {
+                absolute = absolute.parent_path();
+            }
+            absoluteRoots.push_back(std::move(absolute));
+        }
+
+        std::vector<std::string> projects;
+        {
+            Search walk(fileSystem, options);
+            for (const auto& root : absoluteRoots) {
+                walk.addRoot(root);
+            }
+            projects = walk.wait();
+        }
+
+        // Nested roots find the same projects twice
+        std::ranges::sort(projects);
+        const auto [first, last] = std::ranges::unique(projects);
+        projects.erase(first, last);
+
+        SPAN_LOG_INFO("Found ", projects.size(), " projects below ", roots.size(), " directories");
+        return projects;
+    }
+
+    bool matchesGlob(std::string_view pattern, std::string_view path) {
+        while (!pattern.empty()) {
+            if (pattern.starts_with("**/")) {
+                // Zero or more whole directories
+                pattern.remove_prefix(3);
+                for (size_t slash = 0; slash != std::string_view::npos; slash = path.find('/', slash + 1)) {
+                    if (matchesGlob(pattern, slash == 0 ? path : path.substr(slash + 1))) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+            if (pattern == "**") {
+                return true;
+            }
+            if (pattern.front() == '*') {
+                // Any run of characters within one path element
+                pattern.remove_prefix(pattern.starts_with("**") ? 2 : 1);
+                for (size_t length = 0;; ++length) {
+                    if (matchesGlob(pattern, path.substr(length))) {
+                        return true;
+                    }
+                    if (length == path.size() || path[length] == '/') {
+                        return false;
+                    }
+                }
+            }
+            if (path.empty()) {
+                return false;
+            }
+
+            const char c = path.front();
+            if (pattern.front() == '?') {
+                if (c == '/') {
+                    return false;
+                }
+                pattern.remove_prefix(1);
+            } else if (const size_t close = pattern.find(']', 2); pattern.front() == '[' && close != std::string_view::npos) {
+                std::string_view characters = pattern.substr(1, close - 1);
+                const bool negated = characters.starts_with('!') || characters.starts_with('^');
+                if (negated) {
+                    characters.remove_prefix(1);
+                }
+                bool matched = false;
+                for (size_t i = 0; i < characters.size(); ++i) {
+                    if (i + 2 < characters.size() && characters[i + 1] == '-') {
+                        matched |= c >= characters[i] && c <= characters[i + 2];
+                        i += 2;
+                    } else {
+                        matched |= c == characters[i];
+                    }
+                }
+                if (matched == negated || c == '/') {
+                    return false;
+                }
+                pattern.remove_prefix(close + 1);
+            } else {
+                if (pattern.front() == '\\' && pattern.size() > 1) {
+                    pattern.remove_prefix(1);
+                }
+                if (pattern.front() != c) {
+                    return false;
+                }
+                pattern.remove_prefix(1);
+            }
+            path.remove_prefix(1);
+        }
+        return path.empty();
+    }
+} // namespace span::discovery
@@ -0,0 +1,489 @@
+#include "hash.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <optional>
+
+namespace span::hash {
+    namespace {
+        constexpr std::array<uint32_t, 64> SHA256_ROUND_CONSTANTS = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+
+        constexpr std::array<uint64_t, 80> SHA512_ROUND_CONSTANTS = {
+            0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc,
+            0x3956c25bf348b538, 0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118,
+            0xd807aa98a3030242, 0x12835b0145706fbe, 0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2,
+            0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235, 0xc19bf174cf692694,
+            0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+            0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5,
+            0x983e5152ee66dfab, 0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4,
+            0xc6e00bf33da88fc2, 0xd5a79147930aa725, 0x06ca6351e003826f, 0x142929670a0e6e70,
+            0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed, 0x53380d139d95b3df,
+            0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+            0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30,
+            0xd192e819d6ef5218, 0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8,
+            0x19a4c116b8d2d0c8, 0x1e376c085141ab53, 0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8,
+            0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373, 0x682e6ff3d6b2b8a3,
+            0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+            0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b,
+            0xca273eceea26619c, 0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178,
+            0x06f067aa72176fba, 0x0a637dc5a2c898a6, 0x113f9804bef90dae, 0x1b710b35131c471b,
+            0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc, 0x431d67c49c100d4c,
+            0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817
+        };
+
+        constexpr std::array<uint32_t, 64> MD5_ROUND_CONSTANTS = {
+            0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+            0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+            0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+            0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+            0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+            0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+            0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+            0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+        };
+
+        constexpr std::array<int, 16> MD5_SHIFTS = {7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21};
+
+        constexpr std::string_view BASE64_ALPHABET =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        template<typename Word>
+        Word loadBigEndian(const uint8_t* bytes) {
+            Word word = 0;
+            for (size_t i = 0; i < sizeof(Word); ++i) {
+                word = (word << 8) | bytes[i];
+            }
+            return word;
+        }
+
+        template<typename Word>
+        Word loadLittleEndian(const uint8_t* bytes) {
+            Word word = 0;
+            for (size_t i = sizeof(Word); i-- > 0;) {
+                word = (word << 8) | bytes[i];
+            }
+            return word;
+        }
+
+        template<typename Word>
+        void storeLittleEndian(Word word, uint8_t* bytes) {
+            for (size_t i = 0; i < sizeof(Word); ++i) {
+                bytes[i] = static_cast<uint8_t>(word);
+                word >>= 8;
+            }
+        }
+
+        template<typename Word>
+        void storeBigEndian(Word word, uint8_t* bytes) {
+            for (size_t i = sizeof(Word); i-- > 0;) {
+                bytes[i] = static_cast<uint8_t>(word);
+                word >>= 8;
+            }
+        }
+
+        /**
+         * Feed data through a Merkle–Damgård compression function with the
+         * padding MD5, SHA-1 and SHA-2 share: a 1 bit, zeros, then the bit
+         * length, which MD5 alone stores little-endian.
+         */
+        template<size_t BlockSize, std::endian LengthOrder = std::endian::big, typename Compress>
+        void digestBlocks(const std::string_view data, Compress&& compress) {
+            const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+            const size_t fullBlocks = data.size() / BlockSize;
+            for (size_t block = 0; block < fullBlocks; ++block) {
+                compress(bytes + block * BlockSize);
+            }
+
+            // The length field is 8 bytes for SHA-1 and SHA-256, and 16 for SHA-512; the upper 8 stay zero
+            constexpr size_t lengthBytes = BlockSize == 128 ? 16 : 8;
+            std::array<uint8_t, BlockSize * 2> tail{};
+            const size_t remaining = data.size() - fullBlocks * BlockSize;
+            std::memcpy(tail.data(), bytes + fullBlocks * BlockSize, remaining);
+            tail[remaining] = 0x80;
+
+            const size_t tailSize = remaining + 1 + lengthBytes <= BlockSize ? BlockSize : BlockSize * 2;
+            const uint64_t bitLength = static_cast<uint64_t>(data.size()) * 8;
+            if constexpr (LengthOrder == std::endian::little) {
+                storeLittleEndian(bitLength, tail.data() + tailSize - 8);
+            } else {
+                storeBigEndian(bitLength, tail.data() + tailSize - 8);
+            }
+            for (size_t offset = 0; offset < tailSize; offset += BlockSize) {
+                compress(tail.data() + offset);
+            }
+        }
+
+        /**
+         * Decode standard or URL-safe base64, ignoring padding.
+         * @return False if the input holds anything else
+         */
+        bool fromBase64(const std::string_view text, std::string& bytes) {
+            uint32_t buffer = 0;
+            int bits = 0;
+            for (const char c : text) {
+                uint32_t value;
+                if (c >= 'A' && c <= 'Z') {
+                    value = c - 'A';
+                } else if (c >= 'a' && c <= 'z') {
+                    value = c - 'a' + 26;
+                } else if (c >= '0' && c <= '9') {
+                    value = c - '0' + 52;
+                } else if (c == '+' || c == '-') {
+                    value = 62;
+                } else if (c == '/' || c == '_') {
+                    value = 63;
+                } else if (c == '=') {
+                    break;
+                } else {
+                    return false;
+                }
+
+                buffer = (buffer << 6) | value;
+                bits += 6;
+                if (bits >= 8) {
+                    bits -= 8;
+                    bytes.push_back(static_cast<char>((buffer >> bits) & 0xff));
+                }
+            }
+            return true;
+        }
+
+        template<size_t Size>
+        bool equals(const std::array<uint8_t, Size>& digest, const std::string_view expected) {
+            return expected.size() == Size && std::memcmp(digest.data(), expected.data(), Size) == 0;
+        }
+    }
+
+    Md5Digest md5(const std::string_view data) {
+        std::array<uint32_t, 4> state = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+        digestBlocks<64, std::endian::little>(data, [&state](const uint8_t* block) {
+            std::array<uint32_t, 16> m;
+            for (size_t i = 0; i < 16; ++i) {
+                m[i] = loadLittleEndian<uint32_t>(block + i * 4);
+            }
+
+            auto [a, b, c, d] = state;
+            for (size_t i = 0; i < 64; ++i) {
+                uint32_t f;
+                size_t g;
+                if (i < 16) {
+                    f = (b & c) | (~b & d);
+                    g = i;
+                } else if (i < 32) {
+                    f = (d & b) | (~d & c);
+                    g = (5 * i + 1) % 16;
+                } else if (i < 48) {
+                    f = b ^ c ^ d;
+                    g = (3 * i + 5) % 16;
+                } else {
+                    f = c ^ (b | ~d);
+                    g = (7 * i) % 16;
+                }
+
+                const uint32_t next = b + std::rotl(a + f + MD5_ROUND_CONSTANTS[i] + m[g], MD5_SHIFTS[i / 16 * 4 + i % 4]);
+                a = d;
+                d = c;
+                c = b;
+                b = next;
+            }
+
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+        });
+
+        Md5Digest digest;
+        for (size_t i = 0; i < state.size(); ++i) {
+            storeLittleEndian(state[i], digest.data() + i * 4);
+        }
+        return digest;
+    }
+
+    Sha1Digest sha1(const std::string_view data) {
+        std::array<uint32_t, 5> state = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+        digestBlocks<64>(data, [&state](const uint8_t* block) {
+            std::array<uint32_t, 80> w;
+            for (size_t i = 0; i < 16; ++i) {
+                w[i] = loadBigEndian<uint32_t>(block + i * 4);
+            }
+            for (size_t i = 16; i < 80; ++i) {
+                w[i] = std::rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+            }
+
+            auto [a, b, c, d, e] = state;
+            for (size_t i = 0; i < 80; ++i) {
+                uint32_t f;
+                uint32_t k;
+                if (i < 20) {
+                    f = (b & c) | (~b & d);
+                    k = 0x5a827999;
+                } else if (i < 40) {
+                    f = b ^ c ^ d;
+                    k = 0x6ed9eba1;
+                } else if (i < 60) {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8f1bbcdc;
+                } else {
+                    f = b ^ c ^ d;
+                    k = 0xca62c1d6;
+                }
+
+                const uint32_t next = std::rotl(a, 5) + f + e + k + w[i];
+                e = d;
+                d = c;
+                c = std::rotl(b, 30);
+                b = a;
+                a = next;
+            }
+
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+        });
+
+        Sha1Digest digest;
+        for (size_t i = 0; i < state.size(); ++i) {
+            storeBigEndian(state[i], digest.data() + i * 4);
+        }
+        return digest;
+    }
+
+    Sha256Digest sha256(const std::string_view data) {
+        std::array<uint32_t, 8> state = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+
+        digestBlocks<64>(data, [&state](const uint8_t* block) {
+            std::array<uint32_t, 64> w;
+            for (size_t i = 0; i < 16; ++i) {
+                w[i] = loadBigEndian<uint32_t>(block + i * 4);
+            }
+            for (size_t i = 16; i < 64; ++i) {
+                const uint32_t s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                const uint32_t s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            auto [a, b, c, d, e, f, g, h] = state;
+            for (size_t i = 0; i < 64; ++i) {
+                const uint32_t s1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+                const uint32_t choose = (e & f) ^ (~e & g);
+                const uint32_t t1 = h + s1 + choose + SHA256_ROUND_CONSTANTS[i] + w[i];
+                const uint32_t s0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+                const uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+                const uint32_t t2 = s0 + majority;
+
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+        });
+
+        Sha256Digest digest;
+        for (size_t i = 0; i < state.size(); ++i) {
+            storeBigEndian(state[i], digest.data() + i * 4);
+        }
+        return digest;
+    }
+
+    Sha512Digest sha512(const std::string_view data) {
+        std::array<uint64_t, 8> state = {
+            0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+            0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
+        };
+
+        digestBlocks<128>(data, [&state](const uint8_t* block) {
+            std::array<uint64_t, 80> w;
+            for (size_t i = 0; i < 16; ++i) {
+                w[i] = loadBigEndian<uint64_t>(block + i * 8);
+            }
+            for (size_t i = 16; i < 80; ++i) {
+                const uint64_t s0 = std::rotr(w[i - 15], 1) ^ std::rotr(w[i - 15], 8) ^ (w[i - 15] >> 7);
+                const uint64_t s1 = std::rotr(w[i - 2], 19) ^ std::rotr(w[i - 2], 61) ^ (w[i - 2] >> 6);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            auto [a, b, c, d, e, f, g, h] = state;
+            for (size_t i = 0; i < 80; ++i) {
+                const uint64_t s1 = std::rotr(e, 14) ^ std::rotr(e, 18) ^ std::rotr(e, 41);
+                const uint64_t choose = (e & f) ^ (~e & g);
+                const uint64_t t1 = h + s1 + choose + SHA512_ROUND_CONSTANTS[i] + w[i];
+                const uint64_t s0 = std::rotr(a, 28) ^ std::rotr(a, 34) ^ std::rotr(a, 39);
+                const uint64_t majority = (a & b) ^ (a & c) ^ (b & c);
+                const uint64_t t2 = s0 + majority;
+
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+        });
+
+        Sha512Digest digest;
+        for (size_t i = 0; i < state.size(); ++i) {
+            storeBigEndian(state[i], digest.data() + i * 8);
+        }
+        return digest;
+    }
+
+    std::string toBase64(const std::span<const uint8_t> bytes) {
+        std::string text;
+        text.reserve((bytes.size() + 2) / 3 * 4);
+
+        size_t i = 0;
+        for (; i + 3 <= bytes.size(); i += 3) {
+            const uint32_t group = (bytes[i] << 16) | (bytes[i + 1] << 8) | bytes[i + 2];
+            text.push_back(BASE64_ALPHABET[(group >> 18) & 0x3f]);
+            text.push_back(BASE64_ALPHABET[(group >> 12) & 0x3f]);
+            text.push_back(BASE64_ALPHABET[(group >> 6) & 0x3f]);
+            text.push_back(BASE64_ALPHABET[group & 0x3f]);
+        }
+
+        if (const size_t remaining = bytes.size() - i) {
+            const uint32_t group = (bytes[i] << 16) | (remaining == 2 ? bytes[i + 1] << 8 : 0);
+            text.push_back(BASE64_ALPHABET[(group >> 18) & 0x3f]);
+            text.push_back(BASE64_ALPHABET[(group >> 12) & 0x3f]);
+            text.push_back(remaining == 2 ? BASE64_ALPHABET[(group >> 6) & 0x3f] : '=');
+            text.push_back('=');
+        }
+
+        return text;
+    }
+
+    std::string toHex(const std::span<const uint8_t> bytes) {
+        static constexpr char DIGITS[] = "0123456789abcdef";
+        std::string text;
+        text.reserve(bytes.size() * 2);
+        for (const uint8_t byte : bytes) {
+            text.push_back(DIGITS[byte >> 4]);
+            text.push_back(DIGITS[byte & 0xf]);
+        }
+        return text;
+    }
+
+    std::optional<std::vector<uint8_t>> fromHex(const std::string_view text) {
+        if (text.size() % 2 != 0) {
+            return std::nullopt;
+        }
+        const auto digit = [](const char c) -> int {
+            if (c >= '0' && c <= '9') {
+                return c - '0';
+            }
+            if (c >= 'a' && c <= 'f') {
+                return c - 'a' + 10;
+            }
+            if (c >= 'A' && c <= 'F') {
+                return c - 'A' + 10;
+            }
+            return -1;
+        };
+
+        std::vector<uint8_t> bytes;
+        bytes.reserve(text.size() / 2);
+        for (size_t i = 0; i < text.size(); i += 2) {
+            const int high = digit(text[i]);
+            const int low = digit(text[i + 1]);
+            if (high < 0 || low < 0) {
+                return std::nullopt;
+            }
+            bytes.push_back(static_cast<uint8_t>(high << 4 | low));
+        }
+        return bytes;
+    }
+
+    bool matchesIntegrity(const std::string_view integrity, const std::string_view data) {
+        // Supported algorithms, weakest first
+        static constexpr std::array<std::string_view, 3> ALGORITHMS{"sha1", "sha256", "sha512"};
+
+        struct Hash {
+            size_t algorithm;
+            std::string expected;
+        };
+        std::vector<Hash> hashes;
+        size_t strongest = 0;
+
+        size_t position = 0;
+        while (position < integrity.size()) {
+            const size_t end = std::min(integrity.find_first_of(" \t\n", position), integrity.size());
+            const std::string_view token = integrity.substr(position, end - position);
+            position = end + 1;
+
+            const size_t dash = token.find('-');
+            if (dash == std::string_view::npos) {
+                continue;
+            }
+            const auto algorithm = std::ranges::find(ALGORITHMS, token.substr(0, dash));
+            if (algorithm == ALGORITHMS.end()) {
+                continue;
+            }
+
+            // Options after '?' are reserved and ignored
+            std::string_view encoded = token.substr(dash + 1);
+            encoded = encoded.substr(0, encoded.find('?'));
+
+            Hash hash{static_cast<size_t>(algorithm - ALGORITHMS.begin()), {}};
+            if (!fromBase64(encoded, hash.expected)) {
+                continue;
+            }
+            strongest = std::max(strongest, hash.algorithm);
+            hashes.push_back(std::move(hash));
+        }
+
+        if (hashes.empty()) {
+            return false;
+        }
+
+        // Only the strongest algorithm listed counts, so a weak hash cannot vouch for data a strong one rejects
+        const auto matches = [&](const auto& digest) {
+            return std::ranges::any_of(hashes, [&](const Hash& hash) {
+                return hash.algorithm == strongest && equals(digest, hash.expected);
+            });
+        };
+        switch (strongest) {
+            case 2: return matches(sha512(data));
+            case 1: return matches(sha256(data));
+            default: return matches(sha1(data));
+        }
+    }
+} // namespace span::hash
@@ -0,0 +1,448 @@
+#include "logger.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace dev {
+    std::atomic<Logger::Level> Logger::currentLevel{Logger::Level::INFO};
+
+    namespace {
+        std::atomic<Logger::Format> currentFormat{Logger::Format::TEXT};
+    }
+
+    namespace {
+        /**
+         * Single-producer single-consumer byte ring. The owning thread appends
+         * records; the writer, holding the drain lock, consumes them.
+         */
+        struct Ring {
+            static constexpr size_t CAPACITY = 64 * 1024;
+
+            struct Header {
+                int64_t timestampNs;
+                uint32_t length;
+                Logger::Level level;
+                bool structured;
+            };
+
+            std::unique_ptr<char[]> data = std::make_unique<char[]>(CAPACITY);
+            alignas(64) std::atomic<uint64_t> head{0};
+            alignas(64) std::atomic<uint64_t> tail{0};
+            // Set when the owning thread exits; the ring is dropped once drained
+            std::atomic<bool> orphaned{false};
+
+            void copyIn(const uint64_t position, const void* source, const size_t size) {
+                const size_t offset = position % CAPACITY;
+                const size_t first = std::min(size, CAPACITY - offset);
+                std::memcpy(data.get() + offset, source, first);
+                std::memcpy(data.get(), static_cast<const char*>(source) + first, size - first);
+            }
+
+            void copyOut(const uint64_t position, void* target, const size_t size) const {
+                const size_t offset = position % CAPACITY;
+                const size_t first = std::min(size, CAPACITY - offset);
+                std::memcpy(target, data.get() + offset, first);
+                std::memcpy(static_cast<char*>(target) + first, data.get(), size - first);
+            }
+        };
+
+        struct Pending {
+            int64_t timestampNs;
+            Logger::Level level;
+            bool structured;
+            size_t offset;
+            size_t length;
+        };
+
+        const char* getLevelString(const Logger::Level level) {
+            switch (level) {
+                case Logger::Level::DEBUG: return "DEBUG";
+                case Logger::Level::INFO: return "INFO";
+                case Logger::Level::WARNING: return "WARN";
+                case Logger::Level::ERROR: return "ERROR";
+                default: return "UNKNOWN";
+            }
+        }
+
+        class Writer {
+        public:
+            static Writer& getInstance() {
+                // Never destroyed, so threads still logging during exit stay safe
+                static Writer* instance = [] {
+                    auto* created = new Writer();
+                    std::atexit([] { getInstance().drain(); });
+                    return created;
+                }();
+                return *instance;
+            }
+
+            std::shared_ptr<Ring> createRing() {
+                auto ring = std::make_shared<Ring>();
+                std::lock_guard lock(ringsMutex);
+                rings.push_back(ring);
+                return ring;
+            }
+
+            void wake() {
+                condition.notify_one();
+            }
+
+            /**
+             * Write everything in every ring, ordered by timestamp.
+             */
+            void drain() {
+                std::lock_guard drainLock(drainMutex);
+
+                std::vector<std::shared_ptr<Ring>> snapshot;
+                {
+                    std::lock_guard lock(ringsMutex);
+                    std::erase_if(rings, [](const auto& ring) {
+                        return ring->orphaned.load(std::memory_order_acquire) &&
+                            ring->head.load(std::memory_order_acquire) == ring->tail.load(std::memory_order_relaxed);
+                    });
+                    snapshot = rings;
+                }
+
+                pending.clear();
+                text.clear();
+                for (const auto& ring : snapshot) {
+                    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+                    const uint64_t head = ring->head.load(std::memory_order_acquire);
+                    while (tail < head) {
+                        Ring::Header header{};
+                        ring->copyOut(tail, &header, sizeof(header));
+                        tail += sizeof(header);
+
+                        const size_t offset = text.size();
+                        text.resize(offset + header.length);
+                        ring->copyOut(tail, text.data() + offset, header.length);
+                        tail += header.length;
+
+                        pending.push_back({header.timestampNs, header.level, header.structured, offset, header.length});
+                    }
+                    ring->tail.store(tail, std::memory_order_release);
+                }
+
+                if (pending.empty()) {
+                    return;
+                }
+
+                // Rings are drained one after another; merge them back into time order
+                std::ranges::stable_sort(pending, {}, &Pending::timestampNs);
+
+                output.clear();
+                const bool json = currentFormat.load(std::memory_order_relaxed) == Logger::Format::JSON;
+                for (const auto& record : pending) {
+                    const std::string_view payload(text.data() + record.offset, record.length);
+                    if (json) {
+                        renderJson(record, payload);
+                    } else {
+                        renderText(record, payload);
+                    }
+                }
+
+                const char* remaining = output.data();
+                size_t size = output.size();
+                while (size > 0) {
+                    const ssize_t written = ::write(STDOUT_FILENO, remaining, size);
+                    if (written < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (written <= 0) {
+                        break;
+                    }
+                    remaining += written;
+                    size -= static_cast<size_t>(written);
+                }
+            }
+
+        private:
+            std::mutex ringsMutex;
+            std::vector<std::shared_ptr<Ring>> rings;
+
+            // Held by whichever thread is draining; everything below belongs to it
+            std::mutex drainMutex;
+            std::vector<Pending> pending;
+            std::string text;
+            std::string output;
+            int64_t cachedSecond{-1};
+            char cachedTimestamp[32]{};
+            size_t cachedTimestampLength{0};
+
+            std::mutex sleepMutex;
+            std::condition_variable condition;
+
+            Writer() {
+                std::thread([this] {
+                    while (true) {
+                        {
+                            std::unique_lock lock(sleepMutex);
+                            condition.wait_for(lock, std::chrono::milliseconds(20));
+                        }
+                        drain();
+                    }
+                }).detach();
+            }
+
+            // localtime_r takes a lock and reads the timezone, so only do it once a second
+            void updateTimestamp(const int64_t timestampNs) {
+                const int64_t second = timestampNs / 1000000000;
+                if (second == cachedSecond) {
+                    return;
+                }
+                const auto time = static_cast<std::time_t>(second);
+                std::tm local{};
+                localtime_r(&time, &local);
+                cachedTimestampLength = std::strftime(
+                    cachedTimestamp, sizeof(cachedTimestamp), "%Y-%m-%d %H:%M:%S", &local
+                );
+                cachedSecond = second;
+            }
+
+            void appendNumber(const auto value) {
+                char buffer[32];
+                const auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+                output.append(buffer, end);
+            }
+
+            void appendDuration(const int64_t nanoseconds) {
+                char buffer[32];
+                const auto [end, error] = std::to_chars(
+                    buffer, buffer + sizeof(buffer), static_cast<double>(nanoseconds) / 1e6,
+                    std::chars_format::fixed, 3
+                );
+                output.append(buffer, end);
+            }
+
+            void appendJsonString(const std::string_view value) {
+                output.push_back('"');
+                for (const char c : value) {
+                    switch (c) {
+                        case '"': output.append("\\\""); break;
+                        case '\\': output.append("\\\\"); break;
+                        case '\n': output.append("\\n"); break;
+                        case '\r': output.append("\\r"); break;
+                        case '\t': output.append("\\t"); break;
+                        default:
+                            if (static_cast<unsigned char>(c) < 0x20) {
+                                char escaped[8];
+                                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                                output.append(escaped);
+                            } else {
+                                output.push_back(c);
+                            }
+                    }
+                }
+                output.push_back('"');
+            }
+
+            /**
+             * Decode a structured event: its message, then visit(key, type, string, integer, real)
+             * for every field.
+             */
+            template<typename Visitor>
+            static void decodeEvent(std::string_view payload, const char*& message, Visitor&& visit) {
+                const auto take = [&payload]<typename T>(T& value) {
+                    std::memcpy(&value, payload.data(), sizeof(T));
+                    payload.remove_prefix(sizeof(T));
+                };
+
+                take(message);
+                while (!payload.empty()) {
+                    const char* key;
+                    Logger::FieldType type;
+                    take(key);
+                    take(type);
+
+                    switch (type) {
+                        case Logger::FieldType::STRING: {
+                            uint32_t length;
+                            take(length);
+                            visit(key, type, payload.substr(0, length), 0, 0.0);
+                            payload.remove_prefix(length);
+                            break;
+                        }
+                        case Logger::FieldType::BOOL: {
+                            bool value;
+                            take(value);
+                            visit(key, type, std::string_view(value ? "true" : "false"), 0, 0.0);
+                            break;
+                        }
+                        case Logger::FieldType::DOUBLE: {
+                            double value;
+                            take(value);
+                            visit(key, type, std::string_view(), 0, value);
+                            break;
+                        }
+                        default: {
+                            // INT, UINT and DURATION are all eight bytes
+                            int64_t value;
+                            take(value);
+                            visit(key, type, std::string_view(), value, 0.0);
+                            break;
+                        }
+                    }
+                }
+            }
+
+            void appendValue(const Logger::FieldType type, const std::string_view string, const int64_t integer, const double real) {
+                switch (type) {
+                    case Logger::FieldType::STRING: appendJsonString(string); break;
+                    case Logger::FieldType::BOOL: output.append(string); break;
+                    case Logger::FieldType::DOUBLE: appendNumber(real); break;
+                    case Logger::FieldType::UINT: appendNumber(static_cast<uint64_t>(integer)); break;
+                    case Logger::FieldType::DURATION: appendDuration(integer); break;
+                    default: appendNumber(integer); break;
+                }
+            }
+
+            void renderText(const Pending& record, const std::string_view payload) {
+                updateTimestamp(record.timestampNs);
+                output.push_back('[');
+                output.append(cachedTimestamp, cachedTimestampLength);
+                output.append("][");
+                output.append(getLevelString(record.level));
+                output.append("] ");
+
+                if (!record.structured) {
+                    output.append(payload);
+                    output.push_back('\n');
+                    return;
+                }
+
+                // The message pointer is read first, so fields can be appended as they decode
+                const char* message;
+                std::memcpy(&message, payload.data(), sizeof(message));
+                output.append(message);
+
+                decodeEvent(payload, message, [this](
+                    const char* key,
+                    const Logger::FieldType type,
+                    const std::string_view string,
+                    const int64_t integer,
+                    const double real
+                ) {
+                    output.push_back(' ');
+                    output.append(key);
+                    output.push_back('=');
+                    // Only quote strings that would otherwise be ambiguous
+                    if (type == Logger::FieldType::STRING &&
+                        !string.empty() && string.find_first_of(" \"=") == std::string_view::npos) {
+                        output.append(string);
+                    } else {
+                        appendValue(type, string, integer, real);
+                    }
+                    if (type == Logger::FieldType::DURATION) {
+                        output.append("ms");
+                    }
+                });
+                output.push_back('\n');
+            }
+
+            void renderJson(const Pending& record, const std::string_view payload) {
+                updateTimestamp(record.timestampNs);
+                output.append("{\"time\":\"");
+                output.append(cachedTimestamp, cachedTimestampLength);
+                char millis[8];
+                std::snprintf(millis, sizeof(millis), ".%03d", static_cast<int>(record.timestampNs / 1000000 % 1000));
+                output.append(millis);
+                output.append("\",\"level\":\"");
+                output.append(getLevelString(record.level));
+                output.append("\",\"message\":");
+
+                if (!record.structured) {
+                    appendJsonString(payload);
+                    output.append("}\n");
+                    return;
+                }
+
+                const char* message;
+                std::memcpy(&message, payload.data(), sizeof(message));
+                appendJsonString(message);
+
+                decodeEvent(payload, message, [this](
+                    const char* key,
+                    const Logger::FieldType type,
+                    const std::string_view string,
+                    const int64_t integer,
+                    const double real
+                ) {
+                    output.append(",\"");
+                    output.append(key);
+                    output.append(type == Logger::FieldType::DURATION ? "_ms\":" : "\":");
+                    // JSON has no NaN or infinity, which the text format writes as nan and inf
+                    if (type == Logger::FieldType::DOUBLE && !std::isfinite(real)) {
+                        output.append("null");
+                    } else {
+                        appendValue(type, string, integer, real);
+                    }
+                });
+                output.append("}\n");
+            }
+        };
+
+        struct ThreadRing {
+            std::shared_ptr<Ring> ring = Writer::getInstance().createRing();
+
+            ~ThreadRing() {
+                ring->orphaned.store(true, std::memory_order_release);
+            }
+        };
+    }
+
+    void Logger::setFormat(const Format format) {
+        currentFormat.store(format, std::memory_order_relaxed);
+    }
+
+    void Logger::write(const Level level, const bool structured, std::string_view message) {
+        thread_local ThreadRing threadRing;
+        Ring& ring = *threadRing.ring;
+
+        // Leave room for other records; a single line longer than this is cut
+        constexpr size_t maxLength = Ring::CAPACITY / 4;
+        if (message.size() > maxLength) {
+            message = message.substr(0, maxLength);
+        }
+
+        const Ring::Header header{
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()
+            ).count(),
+            static_cast<uint32_t>(message.size()),
+            level,
+            structured
+        };
+        const size_t size = sizeof(header) + message.size();
+
+        auto& writer = Writer::getInstance();
+        const uint64_t head = ring.head.load(std::memory_order_relaxed);
+        while (head + size - ring.tail.load(std::memory_order_acquire) > Ring::CAPACITY) {
+            // Full: wait for the writer rather than drop the message
+            writer.wake();
+            std::this_thread::yield();
+        }
+
+        ring.copyIn(head, &header, sizeof(header));
+        ring.copyIn(head + sizeof(header), message.data(), message.size());
+        ring.head.store(head + size, std::memory_order_release);
+
+        if (level == Level::ERROR) {
+            writer.drain();
+        }
+    }
+
+    void Logger::flush() {
+        Writer::getInstance().drain();
+    }
+}
@@ -0,0 +1,377 @@
+#include "metrics.h"
+#include <bit>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+#include <sys/resource.h>
+
+namespace fs = std::filesystem;
+
+namespace span::metrics {
+    namespace {
+        // Prometheus bucket bounds, in seconds. Counts are at bucket precision.
+        constexpr std::array PROMETHEUS_BOUNDS = {
+            0.000001, 0.000005, 0.00001, 0.00005, 0.0001, 0.0005, 0.001, 0.005,
+            0.01, 0.05, 0.1, 0.5, 1.0, 5.0, 10.0, 50.0, 100.0
+        };
+
+        struct ProcessSample {
+            const char* name;
+            const char* help;
+            double value;
+        };
+
+        // Process-wide resource usage, read when the metrics are exported
+        std::vector<ProcessSample> sampleProcess() {
+            rusage usage{};
+            if (getrusage(RUSAGE_SELF, &usage) != 0) {
+                return {};
+            }
+
+            const auto seconds = [](const timeval& time) {
+                return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) / 1e6;
+            };
+
+            return {
+                {"span_process_cpu_user_seconds", "CPU time spent in user mode", seconds(usage.ru_utime)},
+                {"span_process_cpu_system_seconds", "CPU time spent in the kernel, mostly syscalls", seconds(usage.ru_stime)},
+                {"span_process_voluntary_context_switches", "Context switches from blocking syscalls", static_cast<double>(usage.ru_nvcsw)},
+                {"span_process_involuntary_context_switches", "Context switches from preemption", static_cast<double>(usage.ru_nivcsw)},
+                {"span_process_block_input_operations", "Filesystem block reads", static_cast<double>(usage.ru_inblock)},
+                {"span_process_block_output_operations", "Filesystem block writes", static_cast<double>(usage.ru_oublock)},
+                {"span_process_max_rss_kilobytes", "Peak resident set size", static_cast<double>(usage.ru_maxrss)},
+            };
+        }
+
+        std::string withLabels(const std::string& name, const std::string& labels, const std::string_view extra = {}) {
+            if (labels.empty() && extra.empty()) {
+                return name;
+            }
+            std::string result = name + "{" + labels;
+            if (!labels.empty() && !extra.empty()) {
+                result += ",";
+            }
+            result.append(extra);
+            return result + "}";
+        }
+
+        std::string formatDuration(const uint64_t nanoseconds) {
+            std::ostringstream out;
+            out << std::fixed << std::setprecision(2);
+            if (nanoseconds < 1000) {
+                out << nanoseconds << "ns";
+            } else if (nanoseconds < 1000000) {
+                out << static_cast<double>(nanoseconds) / 1e3 << "us";
+            } else if (nanoseconds < 1000000000) {
+                out << static_cast<double>(nanoseconds) / 1e6 << "ms";
+            } else {
+                out << static_cast<double>(nanoseconds) / 1e9 << "s";
+            }
+            return out.str();
+        }
+
+        double toSeconds(const uint64_t nanoseconds) {
+            return static_cast<double>(nanoseconds) / 1e9;
+        }
+
+        void writeEscaped(std::ostream& out, const std::string_view value) {
+            for (const char c : value) {
+                if (c == '"' || c == '\\') {
+                    out << '\\';
+                }
+                out << c;
+            }
+        }
+    }
+
+    size_t Histogram::getBucketIndex(const uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return value;
+        }
+        const unsigned shift = std::bit_width(value) - 1 - SUB_BUCKET_BITS;
+        const size_t sub = (value >> shift) & (SUB_BUCKETS - 1);
+        return (shift + 1) * SUB_BUCKETS + sub;
+    }
+
+    uint64_t Histogram::getBucketUpperBound(const size_t index) {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+        const size_t shift = index / SUB_BUCKETS - 1;
+        const uint64_t lower = (SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+        const uint64_t width = uint64_t{1} << shift;
+        // The last bucket ends at the top of the range
+        return lower > UINT64_MAX - width ? UINT64_MAX : lower + width - 1;
+    }
+
+    void Histogram::record(const uint64_t value) {
+        buckets[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t highest = max.load(std::memory_order_relaxed);
+        while (value > highest && !max.compare_exchange_weak(highest, value, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t Histogram::getPercentile(const double percentile) const {
+        const uint64_t total = getCount();
+        if (total == 0) {
+            return 0;
+        }
+
+        const auto rank = std::max<uint64_t>(
+            static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(total))), 1
+        );
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return std::min(getBucketUpperBound(i), getMax());
+            }
+        }
+        return getMax();
+    }
+
+    uint64_t Histogram::getCountAtOrBelow(const uint64_t bound) const {
+        uint64_t total = 0;
+        for (size_t i = 0; i < BUCKET_COUNT && getBucketUpperBound(i) <= bound; ++i) {
+            total += buckets[i].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    Registry& Registry::getInstance() {
+        static Registry registry;
+        return registry;
+    }
+
+    Registry::Entry& Registry::getOrCreate(
+        const Type type,
+        const std::string_view name,
+        const std::string_view help,
+        const std::string_view labels
+    ) {
+        std::lock_guard lock(mutex);
+        for (Entry& entry : entries) {
+            if (entry.type == type && entry.name == name && entry.labels == labels) {
+                return entry;
+            }
+        }
+
+        Entry& entry = entries.emplace_back();
+        entry.type = type;
+        entry.name = name;
+        entry.help = help;
+        entry.labels = labels;
+        if (type == Type::HISTOGRAM) {
+            entry.histogram = std::make_unique<Histogram>();
+        }
+        return entry;
+    }
+
+    Counter& Registry::counter(const std::string_view name, const std::string_view help, const std::string_view labels) {
+        return getOrCreate(Type::COUNTER, name, help, labels).counter;
+    }
+
+    Gauge& Registry::gauge(const std::string_view name, const std::string_view help, const std::string_view labels) {
+        return getOrCreate(Type::GAUGE, name, help, labels).gauge;
+    }
+
+    Histogram& Registry::histogram(const std::string_view name, const std::string_view help, const std::string_view labels) {
+        return *getOrCreate(Type::HISTOGRAM, name, help, labels).histogram;
+    }
+
+    uint64_t Registry::getCounterValue(const std::string_view name, const std::string_view labels) const {
+        std::lock_guard lock(mutex);
+        for (const Entry& entry : entries) {
+            if (entry.type == Type::COUNTER && entry.name == name && entry.labels == labels) {
+                return entry.counter.get();
+            }
+        }
+        return 0;
+    }
+
+    std::string Registry::toSummary() const {
+        std::lock_guard lock(mutex);
+        std::ostringstream out;
+        std::map<std::string, std::pair<uint64_t, uint64_t>> hitRatios;
+
+        for (const Entry& entry : entries) {
+            const std::string name = withLabels(entry.name, entry.labels);
+            out << std::left << std::setw(56) << name << ' ';
+
+            switch (entry.type) {
+                case Type::COUNTER:
+                    out << entry.counter.get();
+                    // Every cache-like pair of hit and miss counters gets a ratio line
+                    if (entry.name.ends_with("_hits_total")) {
+                        hitRatios[entry.name.substr(0, entry.name.size() - 11)].first += entry.counter.get();
+                    } else if (entry.name.ends_with("_misses_total")) {
+                        hitRatios[entry.name.substr(0, entry.name.size() - 13)].second += entry.counter.get();
+                    }
+                    break;
+                case Type::GAUGE:
+                    out << entry.gauge.get() << " (max " << entry.gauge.getMaximum() << ")";
+                    break;
+                case Type::HISTOGRAM: {
+                    const Histogram& histogram = *entry.histogram;
+                    out << "count=" << histogram.getCount();
+                    if (histogram.getCount() > 0) {
+                        out << " p50=" << formatDuration(histogram.getPercentile(50))
+                            << " p90=" << formatDuration(histogram.getPercentile(90))
+                            << " p99=" << formatDuration(histogram.getPercentile(99))
+                            << " max=" << formatDuration(histogram.getMax())
+                            << " total=" << formatDuration(histogram.getSum());
+                    }
+                    break;
+                }
+            }
+            out << '\n';
+        }
+
+        for (const auto& [prefix, counts] : hitRatios) {
+            const auto& [hits, misses] = counts;
+            if (hits + misses == 0) {
+                continue;
+            }
+            out << std::left << std::setw(56) << (prefix + "_hit_ratio") << ' '
+                << std::fixed << std::setprecision(1)
+                << 100.0 * static_cast<double>(hits) / static_cast<double>(hits + misses) << "%\n";
+        }
+
+        for (const auto& [name, help, value] : sampleProcess()) {
+            out << std::left << std::setw(56) << name << ' ' << std::defaultfloat << std::setprecision(6) << value << '\n';
+        }
+
+        return out.str();
+    }
+
+    std::string Registry::toJson() const {
+        std::lock_guard lock(mutex);
+        std::ostringstream out;
+        out << std::setprecision(9) << "{\n  \"metrics\": [";
+
+        bool first = true;
+        for (const Entry& entry : entries) {
+            out << (first ? "\n" : ",\n") << "    {\"name\": \"" << entry.name << "\", \"labels\": \"";
+            writeEscaped(out, entry.labels);
+            out << "\", ";
+            first = false;
+
+            switch (entry.type) {
+                case Type::COUNTER:
+                    out << "\"type\": \"counter\", \"value\": " << entry.counter.get();
+                    break;
+                case Type::GAUGE:
+                    out << "\"type\": \"gauge\", \"value\": " << entry.gauge.get()
+                        << ", \"max\": " << entry.gauge.getMaximum();
+                    break;
+                case Type::HISTOGRAM: {
+                    const Histogram& histogram = *entry.histogram;
+                    out << "\"type\": \"histogram\", \"count\": " << histogram.getCount()
+                        << ", \"sum_seconds\": " << toSeconds(histogram.getSum())
+                        << ", \"p50_seconds\": " << toSeconds(histogram.getPercentile(50))
+                        << ", \"p90_seconds\": " << toSeconds(histogram.getPercentile(90))
+                        << ", \"p99_seconds\": " << toSeconds(histogram.getPercentile(99))
+                        << ", \"max_seconds\": " << toSeconds(histogram.getMax());
+                    break;
+                }
+            }
+            out << "}";
+        }
+
+        out << "\n  ],\n  \"process\": {";
+        first = true;
+        for (const auto& [name, help, value] : sampleProcess()) {
+            out << (first ? "\n" : ",\n") << "    \"" << name << "\": " << value;
+            first = false;
+        }
+        out << "\n  }\n}\n";
+        return out.str();
+    }
+
+    std::string Registry::toPrometheus() const {
+        std::lock_guard lock(mutex);
+
+        // Samples of one metric must be grouped under a single HELP and TYPE
+        std::vector<const Entry*> sorted;
+        sorted.reserve(entries.size());
+        for (const Entry& entry : entries) {
+            sorted.push_back(&entry);
+        }
+        std::ranges::stable_sort(sorted, {}, &Entry::name);
+
+        std::ostringstream out;
+        out << std::setprecision(9);
+        const std::string* previousName = nullptr;
+
+        for (const Entry* entry : sorted) {
+            if (!previousName || *previousName != entry->name) {
+                const char* type = entry->type == Type::COUNTER ? "counter"
+                    : entry->type == Type::GAUGE ? "gauge"
+                    : "histogram";
+                out << "# HELP " << entry->name << ' ' << entry->help << '\n'
+                    << "# TYPE " << entry->name << ' ' << type << '\n';
+                previousName = &entry->name;
+            }
+
+            switch (entry->type) {
+                case Type::COUNTER:
+                    out << withLabels(entry->name, entry->labels) << ' ' << entry->counter.get() << '\n';
+                    break;
+                case Type::GAUGE:
+                    out << withLabels(entry->name, entry->labels) << ' ' << entry->gauge.get() << '\n';
+                    break;
+                case Type::HISTOGRAM: {
+                    const Histogram& histogram = *entry->histogram;
+                    for (const double bound : PROMETHEUS_BOUNDS) {
+                        std::ostringstream le;
+                        le << "le=\"" << bound << "\"";
+                        out << withLabels(entry->name + "_bucket", entry->labels, le.str()) << ' '
+                            << histogram.getCountAtOrBelow(static_cast<uint64_t>(bound * 1e9)) << '\n';
+                    }
+                    out << withLabels(entry->name + "_bucket", entry->labels, "le=\"+Inf\"") << ' '
+                        << histogram.getCount() << '\n'
+                        << withLabels(entry->name + "_sum", entry->labels) << ' '
+                        << toSeconds(histogram.getSum()) << '\n'
+                        << withLabels(entry->name + "_count", entry->labels) << ' '
+                        << histogram.getCount() << '\n';
+                    break;
+                }
+            }
+        }
+
+        for (const auto& [name, help, value] : sampleProcess()) {
+            out << "# HELP " << name << ' ' << help << '\n'
+                << "# TYPE " << name << " gauge\n"
+                << name << ' ' << value << '\n';
+        }
+
+        return out.str();
+    }
+
+    bool writeFile(const std::string& path, const std::string& contents) {
+        const std::string temporary = path + ".tmp." + std::to_string(::getpid());
+        {
+            std::ofstream out(temporary, std::ios::trunc);
+            if (!out || !(out << contents) || !out.flush()) {
+                std::error_code error;
+                fs::remove(temporary, error);
+                return false;
+            }
+        }
+
+        std::error_code error;
+        fs::rename(temporary, path, error);
+        if (error) {
+            fs::remove(temporary, error);
+            return false;
+        }
+        return true;
+    }
+} // namespace span::metrics
@@ -0,0 +1,257 @@
+#include "packages/cargo.h"
+#include "cache.h"
+#include "hash.h"
+#include "logger.h"
+#include "metrics.h"
+#include "toml.h"
+#include "trace.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace dev::packages {
+    namespace {
+        /**
+         * Find where the version starts in a vendor directory name, "<name>-<version>".
+         * Crate names have no dots, so it is the first dash followed by "<digits>.".
+         */
+        size_t findVersion(const std::string_view directory) {
+            for (size_t dash = directory.find('-'); dash != std::string_view::npos; dash = directory.find('-', dash + 1)) {
+                size_t end = dash + 1;
+                while (end < directory.size() && std::isdigit(static_cast<unsigned char>(directory[end]))) {
+                    ++end;
+                }
+                if (end > dash + 1 && end < directory.size() && directory[end] == '.') {
+                    return dash;
+                }
+            }
+            return std::string_view::npos;
+        }
+
+        void appendJsonString(std::string& json, const std::string_view text) {
+            json += '"';
+            for (const char c : text) {
+                if (c == '"' || c == '\\') {
+                    json += '\\';
+                }
+                json += c;
+            }
+            json += '"';
+        }
+
+        /**
+         * Write the checksums cargo verifies a vendored crate against: the
+         * sha256 of every file, and of the .crate file it came from.
+         */
+        void writeChecksums(span::vfs::FileSystem& fileSystem, const fs::path& directory, const std::string_view package) {
+            std::vector<std::string> files;
+            fileSystem.walk(directory, [&](const fs::path& path, const span::vfs::Status& status, size_t) {
+                if (status.isFile()) {
+                    files.push_back(path.lexically_relative(directory).generic_string());
+                }
+            });
+            // In the order cargo vendor writes them
+            std::ranges::sort(files);
+
+            std::string json = "{\"files\":{";
+            for (const auto& path : files) {
+                if (json.back() != '{') {
+                    json += ',';
+                }
+                appendJsonString(json, path);
+                json += ':';
+                appendJsonString(json, span::hash::toHex(span::hash::sha256(fileSystem.readFile(directory / path))));
+            }
+            json += "},\"package\":";
+            appendJsonString(json, package);
+            json += '}';
+            fileSystem.writeFile(directory / Cargo::CHECKSUM_FILE_NAME, json);
+        }
+    }
+
+    Cargo::Cargo(std::shared_ptr<Cache> cache)
+        : Manager(std::move(cache)),
+          lockFileCache(LockFileCache::DEFAULT_MAX_BYTES, LockFileCache::DEFAULT_SHARD_COUNT, this->cache->getFileSystem()) {}
+
+    bool Cargo::isProjectType(const std::string& directory) {
+        return getFileSystem().exists(fs::path(directory) / LOCK_FILE_NAME);
+    }
+
+    std::shared_ptr<const PackageTable> Cargo::getInstalledVersions(
+        const std::string& directory
+    ) {
+        const auto& fileSystem = getFileSystem();
+        const fs::path lockFile = fs::path(directory) / LOCK_FILE_NAME;
+        if (!fileSystem.exists(lockFile)) {
+            return PackageTable::emptyTable();
+        }
+
+        return lockFileCache.get(lockFile, [&fileSystem](const fs::path& path) {
+            return parseLockFile(path, fileSystem);
+        });
+    }
+
+    std::shared_ptr<const PackageTable> Cargo::parseLockFile(
+        const fs::path& lockFile,
+        const span::vfs::FileSystem& fileSystem
+    ) {
+        const std::string lockFileName = lockFile.string();
+        span::trace::Span parse("parse", "lock", lockFileName);
+        static auto& parseLatency = span::metrics::Registry::getInstance().histogram(
+            "span_lock_parse_seconds", "Time to parse a lock file"
+        );
+        span::metrics::ScopedTimer timer(parseLatency);
+
+        try {
+            const auto document = span::toml::Document::parse(fileSystem.readFile(lockFile));
+            const auto root = document.getRoot();
+            const auto packages = root["package"];
+
+            // Lock files before version 2 list checksums separately, as "checksum <name> <version> (<source>)"
+            std::unordered_map<std::string_view, std::string_view> metadataChecksums;
+            for (const auto entry : root["metadata"]) {
+                if (entry.getKey().starts_with("checksum ")) {
+                    metadataChecksums.emplace(entry.getKey().substr(9), entry.getString());
+                }
+            }
+
+            PackageTable::Builder versions;
+            versions.reserve(packages.size(), packages.size() * 64);
+            std::string directory;
+            std::string crateFile;
+            std::string metadataKey;
+            std::string integrity;
+
+            for (const auto package : packages) {
+                const std::string_view name = package["name"].getString();
+                const std::string_view version = package["version"].getString();
+                const std::string_view source = package["source"].getString();
+
+                // Workspace members and path dependencies have no source and are built in place
+                if (source.empty()) {
+                    continue;
+                }
+                if (!source.starts_with("registry+") && !source.starts_with("sparse+")) {
+                    SPAN_LOG_WARNING("Not vendoring ", name, " ", version, " from ", source, "; only registry crates are");
+                    continue;
+                }
+
+                std::string_view checksum = package["checksum"].getString();
+                if (checksum.empty()) {
+                    metadataKey.assign(name).append(1, ' ').append(version).append(" (").append(source).append(1, ')');
+                    if (const auto found = metadataChecksums.find(metadataKey); found != metadataChecksums.end()) {
+                        checksum = found->second;
+                    }
+                }
+                integrity.clear();
+                if (!checksum.empty()) {
+                    if (const auto digest = span::hash::fromHex(checksum)) {
+                        integrity.assign("sha256-").append(span::hash::toBase64(*digest));
+                    } else {
+                        SPAN_LOG_WARNING("Ignoring malformed checksum of ", name, " ", version, " in ", lockFileName);
+                    }
+                }
+
+                directory.assign(name).append(1, '-').append(version);
+                crateFile.assign(directory).append(".crate");
+                versions.add(directory, version, crateFile, integrity);
+            }
+
+            return versions.build();
+        } catch (const span::toml::ParseError& e) {
+            throw PackageManagerError("Failed to parse lock file: " + std::string(e.what()));
+        } catch (const PackageManagerError&) {
+            throw;
+        } catch (const std::exception& e) {
+            throw PackageManagerError("Error reading lock file: " + std::string(e.what()));
+        }
+    }
+
+    fs::path Cargo::getCrateStore(const Cache& cache) {
+        if (const char* store = std::getenv("SPAN_CARGO_CRATES")) {
+            return store;
+        }
+        return fs::path(cache.getCacheDir()) / "cargo-crates";
+    }
+
+    bool Cargo::fillCache(
+        const std::string& directory,
+        const std::string_view package,
+        const std::string_view version
+    ) {
+        const auto versions = getInstalledVersions(directory);
+        const PackageTable::Entry* entry = versions->find(package);
+        const PackageTable::Source* source = entry ? versions->getSource(*entry) : nullptr;
+        if (!source) {
+            SPAN_LOG_ERROR("No entry for ", package, " in ", LOCK_FILE_NAME);
+            return false;
+        }
+
+        auto& fileSystem = getFileSystem();
+        const fs::path crate = getCrateStore(*cache) / source->resolved;
+        if (!fileSystem.exists(crate)) {
+            SPAN_LOG_ERROR("Crate ", package, " not found: ", crate.string());
+            return false;
+        }
+
+        const std::string contents = fileSystem.readFile(crate);
+        if (source->integrity.empty()) {
+            SPAN_LOG_WARNING("No checksum for ", package, "; vendoring it unverified");
+        } else {
+            span::trace::Span verify("verify", "install", package);
+            if (!span::hash::matchesIntegrity(source->integrity, contents)) {
+                SPAN_LOG_ERROR("Checksum mismatch for ", package, ": ", crate.string());
+                return false;
+            }
+        }
+        const std::string checksum = span::hash::toHex(span::hash::sha256(contents));
+
+        // Every file in a crate is below "<name>-<version>/"
+        const std::string_view name = getCacheName(package);
+        return cache->addToCache(getManagerName(), name, version, [&](const fs::path& cacheDir) {
+            cache->extractArchive(crate, cacheDir, package, 1);
+            writeChecksums(fileSystem, cacheDir, checksum);
+        });
+    }
+
+    std::string_view Cargo::getCacheName(const std::string_view package) const {
+        return package.substr(0, findVersion(package));
+    }
+
+    bool Cargo::isInstalled(std::string_view, std::string_view, const fs::path& installPath) const {
+        // cargo rejects a vendored crate without its checksums
+        return getFileSystem().exists(installPath / CHECKSUM_FILE_NAME);
+    }
+
+    bool Cargo::linkToCache(
+        const std::string_view package,
+        const std::string_view version,
+        const std::string& installPath
+    ) const {
+        if (!isCacheable(version)) {
+            return true;
+        }
+        // Crates vendored by cargo itself are shared through the cache from then on
+        return cache->materializeToCache(getManagerName(), getCacheName(package), version, installPath);
+    }
+
+    std::string Cargo::getManagerName() const {
+        return "cargo";
+    }
+
+    std::string Cargo::getInstallDirectory() const {
+        return "vendor";
+    }
+
+    std::string Cargo::getDependencyFileName() const {
+        return DEPS_FILE_NAME;
+    }
+
+    std::vector<std::string> Cargo::getDependencyFiles() const {
+        return {DEPS_FILE_NAME, LOCK_FILE_NAME};
+    }
+} // namespace dev::packages
@@ -1,46 +1,359 @@
 #include "packages/composer.h"
 #include "cache.h"
+#include "hash.h"
 #include "logger.h"
+#include "metrics.h"
+#include "packages/composer_resolver.h"
+#include "trace.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <filesystem>
-#include <fstream>
 #include <simdjson.h>
 
 namespace fs = std::filesystem;
 
 namespace dev::packages {
-    Composer::Composer(std::shared_ptr<Cache> cache) : Manager(std::move(cache)) {}
+    namespace {
+        // What `composer update` writes at the top of every lock file
+        constexpr std::string_view LOCK_FILE_README =
+            R"(["This file locks the dependencies of your project to a known state",)"
+            R"("Read more about it at https://getcomposer.org/doc/01-basic-usage.md#installing-dependencies",)"
+            R"("This file is @generated automatically"])";
+        // The Composer plugin API the lock file claims, that of Composer 2.6 and later
+        constexpr std::string_view PLUGIN_API_VERSION = "2.6.0";
+
+        std::string toLower(std::string_view text) {
+            std::string lower(text);
+            std::ranges::transform(lower, lower.begin(), [](const unsigned char c) {
+                return static_cast<char>(std::tolower(c));
+            });
+            return lower;
+        }
+
+        void appendJsonString(std::string& json, const std::string_view text) {
+            json += '"';
+            for (const char c : text) {
+                if (c == '"' || c == '\\') {
+                    json += '\\';
+                }
+                json += c;
+            }
+            json += '"';
+        }
+
+        std::vector<composer::Link> readLinks(const simdjson::dom::element document, const char* key) {
+            std::vector<composer::Link> links;
+            simdjson::dom::object object;
+            if (document[key].get_object().get(object) != simdjson::SUCCESS) {
+                return links;
+            }
+            for (const auto field : object) {
+                std::string_view constraint;
+                if (field.value.get_string().get(constraint) != simdjson::SUCCESS) {
+                    throw PackageManagerError("Invalid constraint for " + std::string(field.key) + " in " + key);
+                }
+                links.push_back({toLower(field.key), std::string(constraint)});
+            }
+            return links;
+        }
+
+        composer::RootPackage readRootPackage(const simdjson::dom::element document) {
+            composer::RootPackage root;
+            if (std::string_view name; document["name"].get_string().get(name) == simdjson::SUCCESS) {
+                root.name = toLower(name);
+            }
+            root.require = readLinks(document, "require");
+            root.requireDev = readLinks(document, "require-dev");
+            root.conflict = readLinks(document, "conflict");
+            root.replace = readLinks(document, "replace");
+            root.provide = readLinks(document, "provide");
+
+            if (std::string_view stability; document["minimum-stability"].get_string().get(stability) == simdjson::SUCCESS) {
+                const auto parsed = composer::parseStability(stability);
+                if (!parsed) {
+                    throw PackageManagerError("Invalid minimum-stability: " + std::string(stability));
+                }
+                root.minimumStability = *parsed;
+            }
+            if (bool preferStable; document["prefer-stable"].get_bool().get(preferStable) == simdjson::SUCCESS) {
+                root.preferStable = preferStable;
+            }
+
+            // A platform package set to false is left out, as if it were not there
+            if (simdjson::dom::object platform; document["config"]["platform"].get_object().get(platform) == simdjson::SUCCESS) {
+                for (const auto field : platform) {
+                    if (std::string_view version; field.value.get_string().get(version) == simdjson::SUCCESS) {
+                        root.platform.emplace_back(toLower(field.key), std::string(version));
+                    }
+                }
+            }
+            return root;
+        }
+
+        /**
+         * Encode a string as PHP's json_encode does by default, which is what
+         * the content hash is taken over: slashes escaped, and everything
+         * beyond ASCII as lower case \u escapes of its UTF-16 code units.
+         */
+        void appendPhpJsonString(std::string& json, const std::string_view text) {
+            constexpr std::string_view HEX = "0123456789abcdef";
+            const auto appendUnit = [&json, HEX](const uint32_t unit) {
+                json += "\\u";
+                for (int shift = 12; shift >= 0; shift -= 4) {
+                    json += HEX[(unit >> shift) & 0xF];
+                }
+            };
+
+            json += '"';
+            for (size_t i = 0; i < text.size(); ++i) {
+                const auto c = static_cast<unsigned char>(text[i]);
+                switch (c) {
+                    case '"': json += "\\\""; continue;
+                    case '\\': json += "\\\\"; continue;
+                    case '/': json += "\\/"; continue;
+                    case '\b': json += "\\b"; continue;
+                    case '\f': json += "\\f"; continue;
+                    case '\n': json += "\\n"; continue;
+                    case '\r': json += "\\r"; continue;
+                    case '\t': json += "\\t"; continue;
+                    default: break;
+                }
+                if (c < 0x20) {
+                    appendUnit(c);
+                } else if (c < 0x80) {
+                    json += static_cast<char>(c);
+                } else {
+                    // simdjson has validated the UTF-8, so the sequence is complete
+                    const size_t length = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+                    uint32_t codePoint = c & (0x7F >> length);
+                    for (size_t j = 1; j < length; ++j) {
+                        codePoint = codePoint << 6 | (static_cast<unsigned char>(text[i + j]) & 0x3F);
+                    }
+                    i += length - 1;
+                    if (codePoint >= 0x10000) {
+                        codePoint -= 0x10000;
+                        appendUnit(0xD800 + (codePoint >> 10));
+                        appendUnit(0xDC00 + (codePoint & 0x3FF));
+                    } else {
+                        appendUnit(codePoint);
+                    }
+                }
+            }
+            json += '"';
+        }
+
+        void appendPhpJson(std::string& json, const simdjson::dom::element value) {
+            switch (value.type()) {
+                case simdjson::dom::element_type::OBJECT: {
+                    const simdjson::dom::object object = value.get_object();
+                    // PHP decodes {} to an empty array, which it encodes as []
+                    if (object.size() == 0) {
+                        json += "[]";
+                        break;
+                    }
+                    json += '{';
+                    for (bool first = true; const auto field : object) {
+                        if (!std::exchange(first, false)) {
+                            json += ',';
+                        }
+                        appendPhpJsonString(json, field.key);
+                        json += ':';
+                        appendPhpJson(json, field.value);
+                    }
+                    json += '}';
+                    break;
+                }
+                case simdjson::dom::element_type::ARRAY: {
+                    json += '[';
+                    for (bool first = true; const auto item : value.get_array()) {
+                        if (!std::exchange(first, false)) {
+                            json += ',';
+                        }
+                        appendPhpJson(json, item);
+                    }
+                    json += ']';
+                    break;
+                }
+                case simdjson::dom::element_type::STRING:
+                    appendPhpJsonString(json, value.get_string());
+                    break;
+                default:
+                    json += simdjson::minify(value);
+                    break;
+            }
+        }
+
+        /**
+         * Indent minified JSON as Composer writes its lock file: four spaces,
+         * a space after each colon and empty arrays and objects on one line.
+         */
+        std::string prettyPrint(const std::string_view json) {
+            std::string pretty;
+            pretty.reserve(json.size() * 2);
+            size_t depth = 0;
+            const auto newLine = [&pretty, &depth] {
+                pretty += '\n';
+                pretty.append(depth * 4, ' ');
+            };
+
+            for (size_t i = 0; i < json.size(); ++i) {
+                const char c = json[i];
+                switch (c) {
+                    case '"': {
+                        const size_t start = i;
+                        for (++i; json[i] != '"'; ++i) {
+                            if (json[i] == '\\') {
+                                ++i;
+                            }
+                        }
+                        pretty.append(json.substr(start, i - start + 1));
+                        break;
+                    }
+                    case '{':
+                    case '[':
+                        if (i + 1 < json.size() && (json[i + 1] == '}' || json[i + 1] == ']')) {
+                            pretty.append(json.substr(i, 2));
+                            ++i;
+                            break;
+                        }
+                        pretty += c;
+                        ++depth;
+                        newLine();
+                        break;
+                    case '}':
+                    case ']':
+                        --depth;
+                        newLine();
+                        pretty += c;
+                        break;
+                    case ',':
+                        pretty += c;
+                        newLine();
+                        break;
+                    case ':':
+                        pretty += ": ";
+                        break;
+                    default:
+                        pretty += c;
+                        break;
+                }
+            }
+            pretty += '\n';
+            return pretty;
+        }
+
+        void appendPackages(std::string& json, const std::vector<const composer::PackageVersion*>& packages) {
+            json += '[';
+            for (bool first = true; const auto* package : packages) {
+                if (!std::exchange(first, false)) {
+                    json += ',';
+                }
+                // Name and version first, as Composer writes them, then the rest as the repository has it
+                json += "{\"name\":";
+                appendJsonString(json, package->name);
+                json += ",\"version\":";
+                appendJsonString(json, package->version);
+                for (const auto& [key, value] : package->fields) {
+                    if (key == "name" || key == "version" || key == "version_normalized") {
+                        continue;
+                    }
+                    json += ',';
+                    appendJsonString(json, key);
+                    json += ':';
+                    json += value;
+                }
+                json += '}';
+            }
+            json += ']';
+        }
+
+        void appendPlatform(std::string& json, const std::vector<composer::Link>& links) {
+            std::string platform;
+            for (const auto& link : links) {
+                if (composer::isPlatformPackage(link.name)) {
+                    platform += platform.empty() ? '{' : ',';
+                    appendJsonString(platform, link.name);
+                    platform += ':';
+                    appendJsonString(platform, link.constraint);
+                }
+            }
+            // An empty PHP array, as Composer writes it
+            json += platform.empty() ? "[]" : platform + '}';
+        }
+
+        std::string formatLockFile(
+            const composer::RootPackage& root,
+            const composer::Resolution& resolution,
+            const std::string_view contentHash
+        ) {
+            std::string json = "{\"_readme\":";
+            json += LOCK_FILE_README;
+            json += ",\"content-hash\":";
+            appendJsonString(json, contentHash);
+            json += ",\"packages\":";
+            appendPackages(json, resolution.packages);
+            json += ",\"packages-dev\":";
+            appendPackages(json, resolution.devPackages);
+            json += ",\"aliases\":[],\"minimum-stability\":";
+            appendJsonString(json, composer::toString(root.minimumStability));
+            json += ",\"stability-flags\":";
+            if (resolution.stabilityFlags.empty()) {
+                json += "[]";
+            } else {
+                for (bool first = true; const auto& [name, stability] : resolution.stabilityFlags) {
+                    json += std::exchange(first, false) ? '{' : ',';
+                    appendJsonString(json, name);
+                    json += ':' + std::to_string(static_cast<int>(stability));
+                }
+                json += '}';
+            }
+            json += ",\"prefer-stable\":";
+            json += root.preferStable ? "true" : "false";
+            json += ",\"prefer-lowest\":false,\"platform\":";
+            appendPlatform(json, root.require);
+            json += ",\"platform-dev\":";
+            appendPlatform(json, root.requireDev);
+            json += ",\"plugin-api-version\":";
+            appendJsonString(json, PLUGIN_API_VERSION);
+            json += '}';
+            return prettyPrint(json);
+        }
+    }
+
+    Composer::Composer(std::shared_ptr<Cache> cache)
+        : Manager(std::move(cache)),
+          lockFileCache(LockFileCache::DEFAULT_MAX_BYTES, LockFileCache::DEFAULT_SHARD_COUNT, this->cache->getFileSystem()) {}
 
     bool Composer::isProjectType(const std::string& directory) {
-        return fs::exists(fs::path(directory) / LOCK_FILE_NAME) ||
-               fs::exists(fs::path(directory) / DEPS_FILE_NAME);
+        const auto& fileSystem = getFileSystem();
+        return fileSystem.exists(fs::path(directory) / LOCK_FILE_NAME) ||
+               fileSystem.exists(fs::path(directory) / DEPS_FILE_NAME);
     }
 
-    std::unordered_map<std::string, std::string> Composer::getInstalledVersions(
+    std::shared_ptr<const PackageTable> Composer::getInstalledVersions(
         const std::string& directory
     ) {
+        const auto& fileSystem = getFileSystem();
         const fs::path lockFile = fs::path(directory) / LOCK_FILE_NAME;
-        if (fs::exists(lockFile)) {
-            // Check cache first
-            if (isLockFileCacheValid(lockFile)) {
-                return lockFileCache.at(lockFile.string()).versions;
-            }
-
-            updateLockFileCache(lockFile);
-            return lockFileCache.at(lockFile.string()).versions;
+        if (fileSystem.exists(lockFile)) {
+            return lockFileCache.get(lockFile, [&fileSystem](const fs::path& path) {
+                return parseLockFile(path, fileSystem);
+            });
         }
 
         // If lock file doesn't exist, parse composer.json
         const fs::path composerJsonFile = fs::path(directory) / DEPS_FILE_NAME;
-        if (!fs::exists(composerJsonFile)) {
-            return {};
+        if (!fileSystem.exists(composerJsonFile)) {
+            return PackageTable::emptyTable();
         }
 
         try {
             simdjson::ondemand::parser parser;
-            const simdjson::padded_string json = simdjson::padded_string::load(composerJsonFile.string());
-            simdjson::ondemand::document doc = parser.iterate(json);
+            const std::string contents = fileSystem.readFile(composerJsonFile, simdjson::SIMDJSON_PADDING);
+            simdjson::ondemand::document doc = parser.iterate(simdjson::padded_string_view(contents));
 
-            std::unordered_map<std::string, std::string> versions;
+            PackageTable::Builder versions;
 
             auto processPackages = [&versions](simdjson::ondemand::object packages) {
                 for (auto field : packages) {
@@ -49,10 +362,10 @@ namespace dev::packages {
                         std::string_view keyView{key.raw()};
                         // Skip PHP version requirement for performance
                         if (keyView != "php") {
-                            versions.emplace(keyView, "");
+                            versions.add(keyView, "");
                         }
                     } catch (const simdjson::simdjson_error& e) {
-                        Logger::error("Error parsing package requirement: ", e.what());
+                        SPAN_LOG_ERROR("Error parsing package requirement: ", e.what());
                     }
                 }
             };
@@ -66,7 +379,7 @@ namespace dev::packages {
                 processPackages(require_dev.get_object());
             }
 
-            return versions;
+            return versions.build();
         } catch (const simdjson::simdjson_error& e) {
             throw PackageManagerError("Failed to parse composer.json: " + std::string(e.what()));
         } catch (const std::exception& e) {
@@ -74,33 +387,164 @@ namespace dev::packages {
         }
     }
 
+    void Composer::resolveLockFile(const std::string& directory) {
+        // With package metadata at hand, resolve composer.json to a lock file of our own
+        const auto& fileSystem = getFileSystem();
+        if (!fileSystem.exists(fs::path(directory) / LOCK_FILE_NAME)
+            && fileSystem.exists(fs::path(directory) / DEPS_FILE_NAME)
+            && fileSystem.exists(getMetadataRepository(*cache))) {
+            writeLockFile(directory);
+        }
+    }
+
+    void Composer::writeLockFile(const std::string& directory) {
+        auto& fileSystem = getFileSystem();
+        const fs::path lockFile = fs::path(directory) / LOCK_FILE_NAME;
+        span::trace::Span resolving("resolve", "lock", lockFile.string());
+        static auto& resolveLatency = span::metrics::Registry::getInstance().histogram(
+            "span_composer_resolve_seconds", "Time to resolve a composer.json without a lock file"
+        );
+        span::metrics::ScopedTimer timer(resolveLatency);
+
+        try {
+            const std::string contents = fileSystem.readFile(fs::path(directory) / DEPS_FILE_NAME, simdjson::SIMDJSON_PADDING);
+            simdjson::dom::parser parser;
+            const simdjson::dom::element document = parser.parse(contents.data(), contents.size(), false);
+            const composer::RootPackage root = readRootPackage(document);
+
+            // Whatever metadata was parsed is indexed for next time, whether or not it resolves
+            composer::Repository repository(getMetadataRepository(*cache), fileSystem);
+            composer::Resolution resolution;
+            try {
+                resolution = composer::resolve(repository, root);
+            } catch (...) {
+                repository.save();
+                throw;
+            }
+            repository.save();
+            const std::string lock = formatLockFile(root, resolution, getContentHash(contents));
+
+            // Written under a name of its own, so a half-written lock file is never read
+            const fs::path partialPath = Cache::getPartialPath(lockFile);
+            fileSystem.writeFile(partialPath, lock);
+            fileSystem.rename(partialPath, lockFile);
+            SPAN_LOG_INFO("Resolved ", resolution.packages.size() + resolution.devPackages.size(),
+                          " packages into ", lockFile.string());
+        } catch (const simdjson::simdjson_error& e) {
+            throw PackageManagerError("Failed to parse composer.json: " + std::string(e.what()));
+        } catch (const PackageManagerError&) {
+            throw;
+        } catch (const std::exception& e) {
+            throw PackageManagerError("Failed to resolve composer.json: " + std::string(e.what()));
+        }
+    }
+
+    fs::path Composer::getMetadataRepository(const Cache& cache) {
+        if (const char* repository = std::getenv("SPAN_COMPOSER_REPOSITORY")) {
+            return repository;
+        }
+        return fs::path(cache.getCacheDir()) / "composer-repository";
+    }
+
+    std::string Composer::getContentHash(const std::string_view composerJson) {
+        // The keys `composer update` hashes, in the order ksort() leaves them
+        static constexpr std::array RELEVANT_KEYS{
+            "conflict", "extra", "minimum-stability", "name", "prefer-stable", "provide",
+            "replace", "repositories", "require", "require-dev", "version"
+        };
+
+        simdjson::dom::parser parser;
+        const simdjson::dom::element document = parser.parse(composerJson.data(), composerJson.size());
+
+        std::string json = "{";
+        const auto appendKey = [&json](const std::string_view key) {
+            if (json.size() > 1) {
+                json += ',';
+            }
+            appendPhpJsonString(json, key);
+            json += ':';
+        };
+        for (const char* key : RELEVANT_KEYS) {
+            // Only config.platform is hashed, and "config" sorts just before "conflict"
+            if (std::string_view(key) == "conflict") {
+                if (simdjson::dom::element platform; document["config"]["platform"].get(platform) == simdjson::SUCCESS) {
+                    appendKey("config");
+                    json += "{\"platform\":";
+                    appendPhpJson(json, platform);
+                    json += '}';
+                }
+            }
+            if (simdjson::dom::element value; document[key].get(value) == simdjson::SUCCESS) {
+                appendKey(key);
+                appendPhpJson(json, value);
+            }
+        }
+        // An empty PHP array encodes as a list
+        json = json.size() > 1 ? json + '}' : "[]";
+        return span::hash::toHex(span::hash::md5(json));
+    }
+
     bool Composer::installDependency(
         const std::string& directory,
-        const std::string& package,
-        const std::string& version
+        const std::string_view package,
+        const std::string_view version
     ) {
         // For composer, we don't need to check the cache. `composer require` will handle everything.
         // It will either download the package or use its own cache. It will also update
         // composer.lock, which is what we want.
 
-        std::string command = "composer require --working-dir=" + directory + " " + package;
+        std::string requirement(package);
         if (!version.empty()) {
-            command += ":" + version;
+            requirement.append(":").append(version);
         }
+        const std::string command = "composer require --working-dir=" + quoteArgument(directory) + " "
+            + quoteArgument(requirement);
 
-        Logger::info("Running command: ", command);
+        SPAN_LOG_INFO("Running command: ", command);
 
         // TODO: A better way to execute commands and handle output.
+        span::trace::Span spawn("spawn", "install", package);
         int result = std::system(command.c_str());
 
         if (result != 0) {
-            Logger::error("Failed to install package: ", package);
+            SPAN_LOG_ERROR("Failed to install package: ", package);
             return false;
         }
 
         return true;
     }
 
+    bool Composer::fillCache(
+        const std::string&,
+        const std::string_view package,
+        const std::string_view version
+    ) {
+        auto& fileSystem = getFileSystem();
+        return cache->addToCache(getManagerName(), package, version, [&](const fs::path& cacheDir) {
+            // composer only installs into a project, so the package is required into a scratch one
+            const fs::path project = fs::path(cacheDir).concat(".project");
+            fileSystem.removeAll(project);
+            try {
+                fileSystem.createDirectories(project);
+                const std::string command = "composer require --no-interaction --no-scripts --working-dir="
+                    + quoteArgument(project.string()) + " "
+                    + quoteArgument(std::string(package) + ":" + std::string(version));
+                SPAN_LOG_DEBUG("Running command: ", command);
+                {
+                    span::trace::Span spawn("spawn", "install", package);
+                    if (std::system(command.c_str()) != 0) {
+                        throw PackageManagerError("Failed to require " + std::string(package) + " " + std::string(version));
+                    }
+                }
+                fileSystem.rename(project / getInstallDirectory() / package, cacheDir);
+                fileSystem.removeAll(project);
+            } catch (...) {
+                cache->discard(project);
+                throw;
+            }
+        });
+    }
+
     std::string Composer::getManagerName() const {
         return "composer";
     }
@@ -113,36 +557,40 @@ namespace dev::packages {
         return DEPS_FILE_NAME;
     }
 
-    bool Composer::isLockFileCacheValid(const fs::path& lockFile) const {
-        const auto it = lockFileCache.find(lockFile.string());
-
-        if (it == lockFileCache.end()) {
-            return false;
-        }
-
-        const auto currentTimestamp = fs::last_write_time(lockFile);
-
-        return it->second.fileTimestamp == currentTimestamp;
+    std::vector<std::string> Composer::getDependencyFiles() const {
+        return {DEPS_FILE_NAME, LOCK_FILE_NAME};
     }
 
-    void Composer::updateLockFileCache(const fs::path& lockFile) {
+    std::shared_ptr<const PackageTable> Composer::parseLockFile(
+        const fs::path& lockFile,
+        const span::vfs::FileSystem& fileSystem
+    ) {
+        const std::string lockFileName = lockFile.string();
+        span::trace::Span parse("parse", "lock", lockFileName);
+        static auto& parseLatency = span::metrics::Registry::getInstance().histogram(
+            "span_lock_parse_seconds", "Time to parse a lock file"
+        );
+        span::metrics::ScopedTimer timer(parseLatency);
+
         try {
             simdjson::ondemand::parser parser;
-            const simdjson::padded_string json = simdjson::padded_string::load(lockFile.string());
-            simdjson::ondemand::document doc = parser.iterate(json);
+            // Read with spare capacity so simdjson can parse in place, without a padded copy
+            const std::string json = fileSystem.readFile(lockFile, simdjson::SIMDJSON_PADDING);
+            simdjson::ondemand::document doc = parser.iterate(simdjson::padded_string_view(json));
 
-            LockFileCache cacheEntry;
-            cacheEntry.lastRead = std::chrono::system_clock::now();
-            cacheEntry.fileTimestamp = fs::last_write_time(lockFile);
+            // Names and versions are a small fraction of the lock file; reserving
+            // an estimate up front avoids regrowing the buffer while parsing
+            PackageTable::Builder versions;
+            versions.reserve(0, json.size() / 8);
 
-            auto processPackages = [&cacheEntry](simdjson::ondemand::array packages) {
+            auto processPackages = [&versions](simdjson::ondemand::array packages) {
                 for (auto package : packages) {
                     try {
                         std::string_view name = package["name"].get_string();
                         std::string_view version = package["version"].get_string();
-                        cacheEntry.versions.emplace(name, version);
+                        versions.add(name, version);
                     } catch (const simdjson::simdjson_error& e) {
-                        Logger::error("Error parsing package: ", e.what());
+                        SPAN_LOG_ERROR("Error parsing package: ", e.what());
                     }
                 }
             };
@@ -155,7 +603,7 @@ namespace dev::packages {
                 processPackages(packages_dev.get_array());
             }
 
-            lockFileCache[lockFile.string()] = std::move(cacheEntry);
+            return versions.build();
         } catch (const simdjson::simdjson_error& e) {
             throw PackageManagerError("Failed to parse lock file: " + std::string(e.what()));
         } catch (const std::exception& e) {
@@ -0,0 +1,886 @@
+#include "packages/composer_constraint.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+namespace dev::packages::composer {
+    namespace {
+        // What Composer puts in place of the "x" of a branch such as "1.x-dev"
+        constexpr uint64_t BRANCH_NUMBER = 9999999;
+
+        constexpr std::string_view WHITESPACE = " \t\r\n";
+
+        std::string_view trim(std::string_view text) {
+            const size_t start = text.find_first_not_of(WHITESPACE);
+            if (start == std::string_view::npos) {
+                return {};
+            }
+            return text.substr(start, text.find_last_not_of(WHITESPACE) - start + 1);
+        }
+
+        bool startsWithIgnoringCase(const std::string_view text, const std::string_view prefix) {
+            return text.size() >= prefix.size() && std::ranges::equal(text.substr(0, prefix.size()), prefix, [](const char a, const char b) {
+                return std::tolower(static_cast<unsigned char>(a)) == b;
+            });
+        }
+
+        bool isDigit(const char c) {
+            return c >= '0' && c <= '9';
+        }
+
+        bool readNumber(std::string_view& text, uint64_t& number) {
+            const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+            if (error != std::errc() || end == text.data()) {
+                return false;
+            }
+            text.remove_prefix(end - text.data());
+            return true;
+        }
+
+        /**
+         * A version as written, before it is padded to four numbers.
+         */
+        struct Scanned {
+            std::array<uint64_t, 4> numbers{};
+            // How many numbers were given
+            size_t count{0};
+            Version::Stage stage{Version::Stage::STABLE};
+            uint64_t stageNumber{0};
+            // A stage or "stable" is named
+            bool hasModifier{false};
+            // Ends with "-dev"
+            bool dev{false};
+        };
+
+        /**
+         * Read Composer's stage modifier, [._-]?(stable|beta|b|RC|alpha|a|patch|pl|p)((?:[.-]?\d+)*+)?
+         */
+        bool scanModifier(std::string_view& text, Scanned& scanned) {
+            std::string_view rest = text;
+            if (!rest.empty() && (rest.front() == '.' || rest.front() == '_' || rest.front() == '-')) {
+                rest.remove_prefix(1);
+            }
+
+            // Longer words first, so "beta" is not read as "b"
+            static constexpr std::pair<std::string_view, Version::Stage> WORDS[] = {
+                {"stable", Version::Stage::STABLE},
+                {"alpha", Version::Stage::ALPHA},
+                {"patch", Version::Stage::PATCH},
+                {"beta", Version::Stage::BETA},
+                {"rc", Version::Stage::RC},
+                {"pl", Version::Stage::PATCH},
+                {"a", Version::Stage::ALPHA},
+                {"b", Version::Stage::BETA},
+                {"p", Version::Stage::PATCH},
+            };
+            const auto word = std::ranges::find_if(WORDS, [rest](const auto& candidate) {
+                return startsWithIgnoringCase(rest, candidate.first);
+            });
+            if (word == std::end(WORDS)) {
+                return false;
+            }
+            rest.remove_prefix(word->first.size());
+            scanned.stage = word->second;
+            scanned.hasModifier = true;
+
+            // "beta2", "beta.2" and "RC-1"; later numbers, as in "beta2.1", are dropped as Composer's
+            // comparison ignores them in practice
+            bool first = true;
+            while (!rest.empty()) {
+                std::string_view number = rest;
+                if (number.front() == '.' || number.front() == '-') {
+                    number.remove_prefix(1);
+                }
+                uint64_t value;
+                if (number.empty() || !isDigit(number.front()) || !readNumber(number, value)) {
+                    break;
+                }
+                if (first) {
+                    scanned.stageNumber = value;
+                    first = false;
+                }
+                rest = number;
+            }
+            text = rest;
+            return true;
+        }
+
+        /**
+         * Read v?N(.N){0,3} and a modifier, which must make up the whole text.
+         */
+        std::optional<Scanned> scanNumbered(std::string_view text) {
+            if (!text.empty() && (text.front() == 'v' || text.front() == 'V')) {
+                text.remove_prefix(1);
+            }
+            Scanned scanned;
+            if (text.empty() || !isDigit(text.front()) || !readNumber(text, scanned.numbers[0])) {
+                return std::nullopt;
+            }
+            scanned.count = 1;
+            while (scanned.count < 4 && text.size() > 1 && text.front() == '.' && isDigit(text[1])) {
+                text.remove_prefix(1);
+                if (!readNumber(text, scanned.numbers[scanned.count])) {
+                    return std::nullopt;
+                }
+                ++scanned.count;
+            }
+
+            std::string_view rest = text;
+            if (!scanModifier(rest, scanned)) {
+                rest = text;
+            }
+            if (!rest.empty() && (rest.front() == '.' || rest.front() == '-') && startsWithIgnoringCase(rest.substr(1), "dev")) {
+                rest.remove_prefix(1);
+            }
+            if (startsWithIgnoringCase(rest, "dev")) {
+                rest.remove_prefix(3);
+                scanned.dev = true;
+            }
+            if (!rest.empty()) {
+                return std::nullopt;
+            }
+            return scanned;
+        }
+
+        Version toVersion(const Scanned& scanned) {
+            Version version;
+            version.numbers = scanned.numbers;
+            if (scanned.dev) {
+                version.stage = Version::Stage::DEV;
+            } else {
+                version.stage = scanned.stage;
+                version.stageNumber = scanned.stageNumber;
+            }
+            return version;
+        }
+
+        /**
+         * Read a numbered branch, "1.x" or "1.2.*", the part of "1.x-dev" before the suffix
+         */
+        std::optional<Version> scanBranch(std::string_view text) {
+            if (!text.empty() && (text.front() == 'v' || text.front() == 'V')) {
+                text.remove_prefix(1);
+            }
+            Version version;
+            version.numbers.fill(BRANCH_NUMBER);
+            version.stage = Version::Stage::DEV;
+            for (size_t i = 0; i < 4 && !text.empty(); ++i) {
+                if (i > 0) {
+                    if (text.front() != '.') {
+                        return std::nullopt;
+                    }
+                    text.remove_prefix(1);
+                }
+                if (!text.empty() && (text.front() == 'x' || text.front() == 'X' || text.front() == '*')) {
+                    text.remove_prefix(1);
+                } else if (text.empty() || !isDigit(text.front()) || !readNumber(text, version.numbers[i])) {
+                    return std::nullopt;
+                }
+            }
+            if (!text.empty()) {
+                return std::nullopt;
+            }
+            return version;
+        }
+
+        /**
+         * Build the bound one step above a version at a position, as
+         * Composer's manipulateVersionString does: "1.2.3" at 2 is 1.3.0.0-dev.
+         * @param position The 1-based number to increment; 0 leaves them all
+         */
+        Version stepVersion(const std::array<uint64_t, 4>& numbers, const size_t position, const uint64_t increment) {
+            Version version;
+            for (size_t i = 0; i < 4; ++i) {
+                if (i + 1 < position) {
+                    version.numbers[i] = numbers[i];
+                } else if (i + 1 == position) {
+                    version.numbers[i] = numbers[i] + increment;
+                }
+            }
+            version.stage = Version::Stage::DEV;
+            return version;
+        }
+
+        bool isOperator(const std::string_view word) {
+            return word == ">=" || word == "<=" || word == ">" || word == "<" || word == "=" || word == "=="
+                || word == "!=" || word == "<>" || word == "~" || word == "^";
+        }
+
+        /**
+         * Split an alternative of a constraint into the constraints that must
+         * all hold: they are separated by commas or spaces, except around an
+         * operator, the dash of a range and "as" of an alias.
+         */
+        std::vector<std::string> splitConjunction(const std::string_view alternative) {
+            std::vector<std::string_view> words;
+            for (size_t start = 0; start < alternative.size();) {
+                const size_t end = std::min(alternative.find_first_of(" \t,", start), alternative.size());
+                if (end > start) {
+                    words.push_back(alternative.substr(start, end - start));
+                }
+                start = end + 1;
+            }
+
+            std::vector<std::string> parts;
+            for (size_t i = 0; i < words.size(); ++i) {
+                if ((words[i] == "-" || words[i] == "as") && !parts.empty() && i + 1 < words.size()) {
+                    parts.back().append(1, ' ').append(words[i]).append(1, ' ').append(words[i + 1]);
+                    ++i;
+                } else if (isOperator(words[i]) && i + 1 < words.size()) {
+                    parts.emplace_back(words[i]).append(words[i + 1]);
+                    ++i;
+                } else {
+                    parts.emplace_back(words[i]);
+                }
+            }
+            return parts;
+        }
+
+        std::vector<std::string_view> splitDisjunction(const std::string_view text) {
+            std::vector<std::string_view> alternatives;
+            for (size_t start = 0;;) {
+                const size_t end = text.find('|', start);
+                alternatives.push_back(trim(text.substr(start, end - start)));
+                if (end == std::string_view::npos) {
+                    break;
+                }
+                start = end + 1 < text.size() && text[end + 1] == '|' ? end + 2 : end + 1;
+            }
+            return alternatives;
+        }
+
+        // Drops "@<stability>" from the end of a constraint
+        std::string_view stripStabilityFlag(std::string_view part, std::optional<Stability>* flag = nullptr) {
+            if (const size_t at = part.rfind('@'); at != std::string_view::npos) {
+                if (const auto stability = parseStability(part.substr(at + 1))) {
+                    if (flag) {
+                        *flag = stability;
+                    }
+                    part = part.substr(0, at);
+                }
+            }
+            return part;
+        }
+
+        // Keeps the real version of an alias, "dev-main as 1.0.x-dev"
+        std::string_view stripAlias(const std::string_view part) {
+            const size_t as = part.find(" as ");
+            return as == std::string_view::npos ? part : trim(part.substr(0, as));
+        }
+
+        bool isWildcard(std::string_view text) {
+            if (!text.empty() && (text.front() == 'v' || text.front() == 'V')) {
+                text.remove_prefix(1);
+            }
+            for (size_t i = 0; i < text.size(); ++i) {
+                const char c = text[i];
+                if (i % 2 == 0 ? c != 'x' && c != 'X' && c != '*' : c != '.') {
+                    return false;
+                }
+            }
+            return text.size() % 2 == 1;
+        }
+
+        /**
+         * Read "1.2.*" or "1.x": numbers followed by at least one wildcard
+         * @return The numbers and how many were given
+         */
+        std::optional<std::pair<std::array<uint64_t, 4>, size_t>> scanWildcardRange(std::string_view text) {
+            if (!text.empty() && (text.front() == 'v' || text.front() == 'V')) {
+                text.remove_prefix(1);
+            }
+            std::array<uint64_t, 4> numbers{};
+            size_t count = 0;
+            while (count < 3 && !text.empty() && isDigit(text.front())) {
+                if (!readNumber(text, numbers[count])) {
+                    return std::nullopt;
+                }
+                ++count;
+                if (text.empty() || text.front() != '.') {
+                    return std::nullopt;
+                }
+                text.remove_prefix(1);
+            }
+            if (count == 0 || !isWildcard(text)) {
+                return std::nullopt;
+            }
+            return std::pair{numbers, count};
+        }
+
+        Constraint parseSingle(std::string_view part) {
+            part = trim(stripAlias(stripStabilityFlag(part)));
+            if (part.empty() || isWildcard(part)) {
+                return Constraint::any();
+            }
+
+            if (part.starts_with('~') || part.starts_with('^')) {
+                const bool tilde = part.front() == '~';
+                std::string_view rest = part.substr(1);
+                if (tilde && rest.starts_with('>')) {
+                    rest.remove_prefix(1);
+                }
+                const auto scanned = scanNumbered(trim(rest));
+                if (!scanned) {
+                    throw ConstraintError("Invalid version in " + std::string(part));
+                }
+                const auto& numbers = scanned->numbers;
+                size_t position;
+                if (tilde) {
+                    // ~1.2.3 allows 1.2.3 up to 1.3, ~1.2 and ~1 up to 2.0
+                    position = std::max<size_t>(1, scanned->count - 1);
+                } else if (numbers[0] != 0 || scanned->count < 2) {
+                    position = 1;
+                } else if (numbers[1] != 0 || scanned->count < 3) {
+                    position = 2;
+                } else {
+                    position = 3;
+                }
+
+                Version lower = toVersion(*scanned);
+                if (!scanned->hasModifier && !scanned->dev) {
+                    lower.stage = Version::Stage::DEV;
+                }
+                return Constraint::between(Constraint::Bound{std::move(lower), true}, Constraint::Bound{stepVersion(numbers, position, 1), false});
+            }
+
+            if (const auto range = scanWildcardRange(part)) {
+                const auto& [numbers, count] = *range;
+                Version lower = stepVersion(numbers, count, 0);
+                Version upper = stepVersion(numbers, count, 1);
+                if (lower.numbers == std::array<uint64_t, 4>{}) {
+                    return Constraint::between(std::nullopt, Constraint::Bound{std::move(upper), false});
+                }
+                return Constraint::between(Constraint::Bound{std::move(lower), true}, Constraint::Bound{std::move(upper), false});
+            }
+
+            if (const size_t dash = part.find(" - "); dash != std::string_view::npos) {
+                const auto from = scanNumbered(trim(part.substr(0, dash)));
+                const auto to = scanNumbered(trim(part.substr(dash + 3)));
+                if (!from || !to) {
+                    throw ConstraintError("Invalid range " + std::string(part));
+                }
+                Version lower = toVersion(*from);
+                if (!from->hasModifier && !from->dev) {
+                    lower.stage = Version::Stage::DEV;
+                }
+                // A partial upper version includes everything it starts: "1 - 2.1" allows 2.1.9
+                if (to->count >= 3 || to->hasModifier || to->dev) {
+                    return Constraint::between(Constraint::Bound{std::move(lower), true}, Constraint::Bound{toVersion(*to), true});
+                }
+                return Constraint::between(Constraint::Bound{std::move(lower), true}, Constraint::Bound{stepVersion(to->numbers, to->count, 1), false});
+            }
+
+            std::string_view op = "=";
+            for (const std::string_view candidate : {"<>", "!=", ">=", "<=", "==", ">", "<", "="}) {
+                if (part.starts_with(candidate)) {
+                    op = candidate;
+                    part = trim(part.substr(candidate.size()));
+                    break;
+                }
+            }
+            auto version = parseVersion(part);
+            if (!version) {
+                throw ConstraintError("Invalid version constraint " + std::string(part));
+            }
+
+            if (version->isBranch()) {
+                if (op == "=" || op == "==") {
+                    return Constraint::branch(std::move(version->branch));
+                }
+                // Branches cannot be ordered, so other operators match nothing, or anything for "!="
+                return op == "!=" || op == "<>" ? Constraint::any() : Constraint{};
+            }
+
+            // "<2.0" and ">=2.0" without a stage exclude or include 2.0's pre-releases too
+            if ((op == "<" || op == ">=") && version->stage == Version::Stage::STABLE && version->stageNumber == 0) {
+                if (const auto scanned = scanNumbered(part); scanned && !scanned->hasModifier && !scanned->dev) {
+                    version->stage = Version::Stage::DEV;
+                }
+            }
+
+            if (op == "=" || op == "==") {
+                return Constraint::between(Constraint::Bound{*version, true}, Constraint::Bound{*version, true});
+            }
+            if (op == "!=" || op == "<>") {
+                return Constraint::between(std::nullopt, Constraint::Bound{*version, false})
+                    .unite(Constraint::between(Constraint::Bound{*version, false}, std::nullopt));
+            }
+            if (op.starts_with('>')) {
+                return Constraint::between(Constraint::Bound{std::move(*version), op == ">="}, std::nullopt);
+            }
+            return Constraint::between(std::nullopt, Constraint::Bound{std::move(*version), op == "<="});
+        }
+
+        /**
+         * Order lower bounds; an unbounded one comes first, and at the same
+         * version an inclusive one, which admits more
+         */
+        bool lowerBefore(const std::optional<Constraint::Bound>& a, const std::optional<Constraint::Bound>& b) {
+            if (!a || !b) {
+                return !a && b;
+            }
+            if (const auto order = a->version <=> b->version; order != 0) {
+                return order < 0;
+            }
+            return a->inclusive && !b->inclusive;
+        }
+
+        // Order upper bounds; an unbounded one comes last, and at the same version an exclusive one first
+        bool upperBefore(const std::optional<Constraint::Bound>& a, const std::optional<Constraint::Bound>& b) {
+            if (!a || !b) {
+                return a && !b;
+            }
+            if (const auto order = a->version <=> b->version; order != 0) {
+                return order < 0;
+            }
+            return !a->inclusive && b->inclusive;
+        }
+
+        bool isEmpty(const Constraint::Interval& interval) {
+            if (!interval.lower || !interval.upper) {
+                return false;
+            }
+            const auto order = interval.lower->version <=> interval.upper->version;
+            return order > 0 || (order == 0 && !(interval.lower->inclusive && interval.upper->inclusive));
+        }
+
+        /**
+         * Check whether an interval starting at lower joins one ending at upper, without a gap
+         */
+        bool touches(const std::optional<Constraint::Bound>& upper, const std::optional<Constraint::Bound>& lower) {
+            if (!upper || !lower) {
+                return true;
+            }
+            const auto order = lower->version <=> upper->version;
+            return order < 0 || (order == 0 && (lower->inclusive || upper->inclusive));
+        }
+    }
+
+    std::optional<Stability> parseStability(const std::string_view name) {
+        if (startsWithIgnoringCase(name, "stable") && name.size() == 6) {
+            return Stability::STABLE;
+        }
+        if (startsWithIgnoringCase(name, "rc") && name.size() == 2) {
+            return Stability::RC;
+        }
+        if (startsWithIgnoringCase(name, "beta") && name.size() == 4) {
+            return Stability::BETA;
+        }
+        if (startsWithIgnoringCase(name, "alpha") && name.size() == 5) {
+            return Stability::ALPHA;
+        }
+        if (startsWithIgnoringCase(name, "dev") && name.size() == 3) {
+            return Stability::DEV;
+        }
+        return std::nullopt;
+    }
+
+    std::string_view toString(const Stability stability) {
+        switch (stability) {
+            case Stability::STABLE:
+                return "stable";
+            case Stability::RC:
+                return "RC";
+            case Stability::BETA:
+                return "beta";
+            case Stability::ALPHA:
+                return "alpha";
+            case Stability::DEV:
+                return "dev";
+        }
+        return "stable";
+    }
+
+    Stability Version::getStability() const {
+        if (isBranch()) {
+            return Stability::DEV;
+        }
+        switch (stage) {
+            case Stage::DEV:
+                return Stability::DEV;
+            case Stage::ALPHA:
+                return Stability::ALPHA;
+            case Stage::BETA:
+                return Stability::BETA;
+            case Stage::RC:
+                return Stability::RC;
+            case Stage::STABLE:
+            case Stage::PATCH:
+                return Stability::STABLE;
+        }
+        return Stability::STABLE;
+    }
+
+    std::string Version::toString() const {
+        if (isBranch()) {
+            return "dev-" + branch;
+        }
+        std::string text;
+        for (const uint64_t number : numbers) {
+            if (!text.empty()) {
+                text += '.';
+            }
+            text += std::to_string(number);
+        }
+        static constexpr std::string_view SUFFIXES[] = {"-dev", "-alpha", "-beta", "-RC", "", "-patch"};
+        text += SUFFIXES[static_cast<size_t>(stage)];
+        if (stage != Stage::DEV && stage != Stage::STABLE && stageNumber != 0) {
+            text += std::to_string(stageNumber);
+        }
+        return text;
+    }
+
+    std::strong_ordering Version::operator<=>(const Version& other) const {
+        if (isBranch() || other.isBranch()) {
+            if (isBranch() != other.isBranch()) {
+                return isBranch() ? std::strong_ordering::less : std::strong_ordering::greater;
+            }
+            return branch <=> other.branch;
+        }
+        if (const auto order = numbers <=> other.numbers; order != 0) {
+            return order;
+        }
+        if (const auto order = stage <=> other.stage; order != 0) {
+            return order;
+        }
+        return stageNumber <=> other.stageNumber;
+    }
+
+    std::optional<Version> parseVersion(std::string_view text) {
+        text = stripStabilityFlag(stripAlias(trim(text)));
+        if (text.empty()) {
+            return std::nullopt;
+        }
+
+        if (text == "master" || text == "trunk" || text == "default") {
+            Version version;
+            version.branch = text;
+            return version;
+        }
+        if (startsWithIgnoringCase(text, "dev-")) {
+            if (text.size() == 4) {
+                return std::nullopt;
+            }
+            Version version;
+            version.branch = text.substr(4);
+            return version;
+        }
+
+        // Build metadata, "1.0.0+20240101", does not take part in comparisons
+        if (const size_t plus = text.find('+'); plus != std::string_view::npos) {
+            text = text.substr(0, plus);
+        }
+        if (const auto scanned = scanNumbered(text)) {
+            return toVersion(*scanned);
+        }
+
+        // A numbered branch, "1.x-dev"
+        if (text.size() > 3 && startsWithIgnoringCase(text.substr(text.size() - 3), "dev")) {
+            std::string_view name = text.substr(0, text.size() - 3);
+            if (name.ends_with('-') || name.ends_with('.')) {
+                name.remove_suffix(1);
+            }
+            return scanBranch(name);
+        }
+        return std::nullopt;
+    }
+
+    bool Constraint::Interval::contains(const Version& version) const {
+        if (lower) {
+            const auto order = version <=> lower->version;
+            if (order < 0 || (order == 0 && !lower->inclusive)) {
+                return false;
+            }
+        }
+        if (upper) {
+            const auto order = version <=> upper->version;
+            if (order > 0 || (order == 0 && !upper->inclusive)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Constraint Constraint::parse(const std::string_view text) {
+        if (trim(text).empty()) {
+            throw ConstraintError("Empty version constraint");
+        }
+        Constraint result;
+        for (const auto alternative : splitDisjunction(text)) {
+            Constraint conjunction = any();
+            for (const auto& part : splitConjunction(alternative)) {
+                conjunction = conjunction.intersect(parseSingle(part));
+            }
+            result = result.unite(conjunction);
+        }
+        return result;
+    }
+
+    Constraint Constraint::any() {
+        Constraint constraint;
+        constraint.intervals.emplace_back();
+        constraint.anyBranch = true;
+        return constraint;
+    }
+
+    Constraint Constraint::between(std::optional<Bound> lower, std::optional<Bound> upper) {
+        Constraint constraint;
+        Interval interval{std::move(lower), std::move(upper)};
+        if (!isEmpty(interval)) {
+            constraint.intervals.push_back(std::move(interval));
+        }
+        return constraint;
+    }
+
+    Constraint Constraint::branch(std::string name) {
+        Constraint constraint;
+        constraint.branches.push_back(std::move(name));
+        return constraint;
+    }
+
+    bool Constraint::matches(const Version& version) const {
+        if (version.isBranch()) {
+            return anyBranch || std::ranges::binary_search(branches, version.branch);
+        }
+        return std::ranges::any_of(intervals, [&version](const Interval& interval) {
+            return interval.contains(version);
+        });
+    }
+
+    bool Constraint::intersects(const Constraint& other) const {
+        const Constraint both = intersect(other);
+        return !both.intervals.empty() || !both.branches.empty() || both.anyBranch;
+    }
+
+    Constraint Constraint::intersect(const Constraint& other) const {
+        Constraint result;
+        for (const auto& a : intervals) {
+            for (const auto& b : other.intervals) {
+                Interval interval{
+                    lowerBefore(a.lower, b.lower) ? b.lower : a.lower,
+                    upperBefore(a.upper, b.upper) ? a.upper : b.upper,
+                };
+                if (!isEmpty(interval)) {
+                    result.intervals.push_back(std::move(interval));
+                }
+            }
+        }
+
+        result.anyBranch = anyBranch && other.anyBranch;
+        if (!result.anyBranch) {
+            if (anyBranch || other.anyBranch) {
+                result.branches = anyBranch ? other.branches : branches;
+            } else {
+                std::ranges::set_intersection(branches, other.branches, std::back_inserter(result.branches));
+            }
+        }
+        result.normalize();
+        return result;
+    }
+
+    Constraint Constraint::unite(const Constraint& other) const {
+        Constraint result;
+        result.intervals = intervals;
+        result.intervals.insert(result.intervals.end(), other.intervals.begin(), other.intervals.end());
+        result.anyBranch = anyBranch || other.anyBranch;
+        if (!result.anyBranch) {
+            std::ranges::set_union(branches, other.branches, std::back_inserter(result.branches));
+        }
+        result.normalize();
+        return result;
+    }
+
+    void Constraint::normalize() {
+        std::ranges::sort(intervals, [](const Interval& a, const Interval& b) {
+            return lowerBefore(a.lower, b.lower);
+        });
+        std::vector<Interval> merged;
+        for (auto& interval : intervals) {
+            if (!merged.empty() && touches(merged.back().upper, interval.lower)) {
+                if (upperBefore(merged.back().upper, interval.upper)) {
+                    merged.back().upper = std::move(interval.upper);
+                }
+            } else {
+                merged.push_back(std::move(interval));
+            }
+        }
+        intervals = std::move(merged);
+
+        std::ranges::sort(branches);
+        const auto [first, last] = std::ranges::unique(branches);
+        branches.erase(first, last);
+    }
+
+    std::optional<Stability> getStabilityFlag(const std::string_view constraint) {
+        std::vector<std::string> parts;
+        for (const auto alternative : splitDisjunction(constraint)) {
+            for (auto& part : splitConjunction(alternative)) {
+                parts.push_back(std::move(part));
+            }
+        }
+
+        // An explicit flag wins over what the versions imply
+        std::optional<Stability> flag;
+        for (const auto& part : parts) {
+            std::optional<Stability> explicitFlag;
+            stripStabilityFlag(part, &explicitFlag);
+            if (explicitFlag && (!flag || *explicitFlag > *flag)) {
+                flag = explicitFlag;
+            }
+        }
+        if (flag) {
+            return flag;
+        }
+
+        for (const auto& part : parts) {
+            std::string_view version = stripAlias(part);
+            version.remove_prefix(std::min(version.find_first_not_of("<>=!^~"), version.size()));
+            const auto parsed = parseVersion(version);
+            if (parsed && parsed->getStability() != Stability::STABLE && (!flag || parsed->getStability() > *flag)) {
+                flag = parsed->getStability();
+            }
+        }
+        return flag;
+    }
+
+    std::optional<PackedVersion> pack(const Version& version) {
+        const auto& [major, minor, patch, build] = version.numbers;
+        if (version.isBranch() || major > UINT32_MAX || minor > UINT16_MAX || patch > UINT16_MAX
+            || build > UINT16_MAX || version.stageNumber >> 40 != 0) {
+            return std::nullopt;
+        }
+        return PackedVersion{
+            major << 32 | minor << 16 | patch,
+            build << 48 | uint64_t{static_cast<uint8_t>(version.stage)} << 40 | version.stageNumber
+        };
+    }
+
+    void PackedVersionList::add(const Version* version) {
+        const auto packed = version ? pack(*version) : std::nullopt;
+        if (!packed) {
+            unpacked.emplace_back(static_cast<uint32_t>(high.size()), version);
+        }
+        // What did not pack holds a placeholder, and its bit is set afterwards
+        high.push_back(packed ? packed->high : 0);
+        low.push_back(packed ? packed->low : 0);
+    }
+
+    CompiledConstraint::CompiledConstraint(Constraint constraint)
+        : constraint(std::move(constraint)) {
+        for (const auto& interval : this->constraint.getIntervals()) {
+            Range range{{0, 0}, PackedVersion::max()};
+            if (interval.lower) {
+                const auto packed = pack(interval.lower->version);
+                if (!packed) {
+                    fallback = true;
+                    break;
+                }
+                range.first = *packed;
+                if (!interval.lower->inclusive) {
+                    // The next packed value; past the maximum, nothing is left
+                    if (range.first == PackedVersion::max()) {
+                        continue;
+                    }
+                    range.first.high += ++range.first.low == 0;
+                }
+            }
+            if (interval.upper) {
+                const auto packed = pack(interval.upper->version);
+                if (!packed) {
+                    fallback = true;
+                    break;
+                }
+                range.last = *packed;
+                if (!interval.upper->inclusive) {
+                    if (range.last == PackedVersion{}) {
+                        continue;
+                    }
+                    range.last.high -= range.last.low-- == 0;
+                }
+            }
+            if (range.first <= range.last) {
+                ranges.push_back(range);
+            }
+        }
+    }
+
+    bool CompiledConstraint::matches(const Version& version) const {
+        const auto packed = fallback ? std::nullopt : pack(version);
+        if (!packed) {
+            return constraint.matches(version);
+        }
+        return std::ranges::any_of(ranges, [&packed](const Range& range) {
+            return range.first <= *packed && *packed <= range.last;
+        });
+    }
+
+    namespace {
+        Version unpack(const uint64_t high, const uint64_t low) {
+            Version version;
+            version.numbers = {high >> 32, high >> 16 & UINT16_MAX, high & UINT16_MAX, low >> 48};
+            version.stage = static_cast<Version::Stage>(low >> 40 & UINT8_MAX);
+            version.stageNumber = low & ((uint64_t{1} << 40) - 1);
+            return version;
+        }
+    }
+
+    // Baseline x86-64 has no 64-bit compares to vectorize with, so there is an AVX2 clone chosen at load time
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    __attribute__((target_clones("avx2", "default")))
+#endif
+    uint64_t CompiledConstraint::matchBlock(
+        const uint64_t* high,
+        const uint64_t* low,
+        const size_t block,
+        const std::span<const Range> ranges
+    ) {
+        // One lane per version, all ones if it is in some range
+        std::array<uint64_t, 64> in{};
+        for (const Range& range : ranges) {
+            for (size_t i = 0; i < block; ++i) {
+                const uint64_t h = high[i];
+                const uint64_t l = low[i];
+                const uint64_t afterFirst = (h > range.first.high) | ((h == range.first.high) & (l >= range.first.low));
+                const uint64_t beforeLast = (h < range.last.high) | ((h == range.last.high) & (l <= range.last.low));
+                in[i] |= 0 - (afterFirst & beforeLast);
+            }
+        }
+        uint64_t word = 0;
+        for (size_t i = 0; i < block; ++i) {
+            word |= (in[i] & 1) << i;
+        }
+        return word;
+    }
+
+    void CompiledConstraint::match(const PackedVersionList& versions, const std::span<uint64_t> matches) const {
+        const size_t count = versions.size();
+        const uint64_t* high = versions.high.data();
+        const uint64_t* low = versions.low.data();
+
+        if (fallback) {
+            std::ranges::fill(matches.first((count + 63) / 64), 0);
+        } else {
+            for (size_t base = 0; base < count; base += 64) {
+                matches[base / 64] = matchBlock(high + base, low + base, std::min<size_t>(64, count - base), ranges);
+            }
+        }
+
+        // What did not pack, and everything when a bound did not, is matched one at a time
+        const auto set = [&matches](const size_t i, const bool match) {
+            const uint64_t bit = uint64_t{1} << (i % 64);
+            matches[i / 64] = match ? matches[i / 64] | bit : matches[i / 64] & ~bit;
+        };
+        for (const auto& [i, version] : versions.unpacked) {
+            set(i, version && constraint.matches(*version));
+        }
+        if (fallback) {
+            for (size_t i = 0, next = 0; i < count; ++i) {
+                if (next < versions.unpacked.size() && versions.unpacked[next].first == i) {
+                    ++next;
+                    continue;
+                }
+                set(i, constraint.matches(unpack(high[i], low[i])));
+            }
+        }
+    }
+} // namespace dev::packages::composer
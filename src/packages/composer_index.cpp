@@ -0,0 +1,435 @@
+#include "packages/composer_index.h"
+#include "packages/composer_repository.h"
+#include "logger.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace dev::packages::composer {
+    namespace {
+        constexpr std::array<char, 8> MAGIC{'S', 'P', 'A', 'N', 'C', 'I', 'D', 'X'};
+        // Bumped whenever a record changes, so older files are rebuilt rather than misread
+        constexpr uint32_t FORMAT_VERSION = 1;
+        // Strings up to this length are stored once however often they occur
+        constexpr size_t MAX_SHARED_STRING = 256;
+
+        struct StringRef {
+            uint32_t offset;
+            uint32_t length;
+        };
+
+        struct Header {
+            std::array<char, 8> magic;
+            uint32_t formatVersion;
+            uint32_t packageCount;
+            uint32_t versionCount;
+            uint32_t linkCount;
+            uint32_t fieldCount;
+            uint32_t reserved;
+            uint64_t stringsSize;
+        };
+
+        struct PackageRecord {
+            StringRef name;
+            uint32_t firstVersion;
+            uint32_t versionCount;
+            FileStamp tagged;
+            FileStamp dev;
+        };
+
+        struct VersionRecord {
+            StringRef name;
+            StringRef version;
+            StringRef branch;
+            std::array<uint64_t, 4> numbers;
+            uint64_t stageNumber;
+            uint32_t stage;
+            // Links are stored require, conflict, replace, provide
+            uint32_t firstLink;
+            std::array<uint32_t, 4> linkCounts;
+            uint32_t firstField;
+            uint32_t fieldCount;
+        };
+
+        struct LinkRecord {
+            StringRef name;
+            StringRef constraint;
+        };
+
+        struct FieldRecord {
+            StringRef key;
+            StringRef value;
+        };
+
+        // Every section starts 8-byte aligned after the header, so records can be read in place
+        static_assert(sizeof(Header) % 8 == 0 && sizeof(PackageRecord) % 8 == 0 && sizeof(VersionRecord) % 8 == 0);
+        static_assert(sizeof(LinkRecord) % 8 == 0 && sizeof(FieldRecord) % 8 == 0);
+        static_assert(std::is_trivially_copyable_v<PackageRecord> && std::is_trivially_copyable_v<VersionRecord>);
+
+        constexpr std::array LINK_FIELDS{
+            &PackageVersion::require, &PackageVersion::conflict, &PackageVersion::replace, &PackageVersion::provide
+        };
+
+        [[noreturn]] void corrupt(const fs::path& file) {
+            throw std::runtime_error("Corrupt metadata index: " + file.string());
+        }
+
+        /**
+         * Lays out the sections of a new index.
+         */
+        class Writer {
+        public:
+            void add(const std::string_view name, const PackageStamps& stamps, const std::vector<PackageVersion>& versions) {
+                PackageRecord& package = packages.emplace_back();
+                package.name = addString(name);
+                package.firstVersion = static_cast<uint32_t>(this->versions.size());
+                package.versionCount = static_cast<uint32_t>(versions.size());
+                package.tagged = stamps.tagged;
+                package.dev = stamps.dev;
+
+                for (const auto& version : versions) {
+                    VersionRecord& record = this->versions.emplace_back();
+                    record.name = addString(version.name);
+                    record.version = addString(version.version);
+                    record.branch = addString(version.normalized.branch);
+                    record.numbers = version.normalized.numbers;
+                    record.stageNumber = version.normalized.stageNumber;
+                    record.stage = static_cast<uint32_t>(version.normalized.stage);
+                    record.firstLink = static_cast<uint32_t>(links.size());
+                    for (size_t kind = 0; kind < LINK_FIELDS.size(); ++kind) {
+                        const auto& kindLinks = version.*LINK_FIELDS[kind];
+                        record.linkCounts[kind] = static_cast<uint32_t>(kindLinks.size());
+                        for (const auto& link : kindLinks) {
+                            links.push_back({addString(link.name), addString(link.constraint)});
+                        }
+                    }
+                    record.firstField = static_cast<uint32_t>(fields.size());
+                    record.fieldCount = static_cast<uint32_t>(version.fields.size());
+                    for (const auto& [key, value] : version.fields) {
+                        fields.push_back({addString(key), addString(value)});
+                    }
+                }
+            }
+
+            [[nodiscard]] std::string build() const {
+                const Header header{
+                    MAGIC, FORMAT_VERSION,
+                    static_cast<uint32_t>(packages.size()), static_cast<uint32_t>(versions.size()),
+                    static_cast<uint32_t>(links.size()), static_cast<uint32_t>(fields.size()),
+                    0, strings.size()
+                };
+
+                std::string contents;
+                contents.reserve(sizeof(Header) + packages.size() * sizeof(PackageRecord)
+                    + versions.size() * sizeof(VersionRecord) + links.size() * sizeof(LinkRecord)
+                    + fields.size() * sizeof(FieldRecord) + strings.size());
+                const auto append = [&contents](const void* data, const size_t size) {
+                    contents.append(static_cast<const char*>(data), size);
+                };
+                append(&header, sizeof(header));
+                append(packages.data(), packages.size() * sizeof(PackageRecord));
+                append(versions.data(), versions.size() * sizeof(VersionRecord));
+                append(links.data(), links.size() * sizeof(LinkRecord));
+                append(fields.data(), fields.size() * sizeof(FieldRecord));
+                contents += strings;
+                return contents;
+            }
+
+        private:
+            std::vector<PackageRecord> packages;
+            std::vector<VersionRecord> versions;
+            std::vector<LinkRecord> links;
+            std::vector<FieldRecord> fields;
+            std::string strings;
+            std::unordered_map<std::string, StringRef> shared;
+
+            StringRef addString(const std::string_view text) {
+                if (text.size() <= MAX_SHARED_STRING) {
+                    if (const auto found = shared.find(std::string(text)); found != shared.end()) {
+                        return found->second;
+                    }
+                }
+                if (strings.size() + text.size() > UINT32_MAX) {
+                    throw std::length_error("Metadata index strings exceed 4 GiB");
+                }
+                const StringRef ref{static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(text.size())};
+                strings.append(text);
+                if (text.size() <= MAX_SHARED_STRING) {
+                    shared.emplace(text, ref);
+                }
+                return ref;
+            }
+        };
+    }
+
+    FileStamp FileStamp::of(const span::vfs::Status& status) {
+        if (!status.exists()) {
+            return {};
+        }
+        return {
+            std::chrono::duration_cast<std::chrono::nanoseconds>(status.modified.time_since_epoch()).count(),
+            status.size
+        };
+    }
+
+    /**
+     * The contents of an index file, mapped or read, with its sections located.
+     */
+    struct MetadataIndex::Mapping {
+        void* address{nullptr};
+        size_t length{0};
+        // The contents, when the file is not on the real filesystem
+        std::string buffer;
+
+        const Header* header{nullptr};
+        std::span<const PackageRecord> packages;
+        std::span<const VersionRecord> versions;
+        std::span<const LinkRecord> links;
+        std::span<const FieldRecord> fields;
+        std::string_view strings;
+        fs::path file;
+
+        Mapping() = default;
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+
+        ~Mapping() {
+            if (address) {
+                ::munmap(address, length);
+            }
+        }
+
+        /**
+         * Locate the sections
+         * @return False if the contents are not an index of this format
+         */
+        bool locate(const std::string_view contents) {
+            if (contents.size() < sizeof(Header)) {
+                return false;
+            }
+            header = reinterpret_cast<const Header*>(contents.data());
+            if (header->magic != MAGIC || header->formatVersion != FORMAT_VERSION) {
+                return false;
+            }
+            const uint64_t expected = sizeof(Header) + uint64_t{header->packageCount} * sizeof(PackageRecord)
+                + uint64_t{header->versionCount} * sizeof(VersionRecord) + uint64_t{header->linkCount} * sizeof(LinkRecord)
+                + uint64_t{header->fieldCount} * sizeof(FieldRecord) + header->stringsSize;
+            if (expected != contents.size()) {
+                return false;
+            }
+
+            const char* position = contents.data() + sizeof(Header);
+            const auto section = [&position]<typename Record>(std::span<const Record>& records, const uint32_t count) {
+                records = {reinterpret_cast<const Record*>(position), count};
+                position += count * sizeof(Record);
+            };
+            section(packages, header->packageCount);
+            section(versions, header->versionCount);
+            section(links, header->linkCount);
+            section(fields, header->fieldCount);
+            strings = {position, static_cast<size_t>(header->stringsSize)};
+            return true;
+        }
+
+        [[nodiscard]] std::string_view get(const StringRef ref) const {
+            if (uint64_t{ref.offset} + ref.length > strings.size()) {
+                corrupt(file);
+            }
+            return strings.substr(ref.offset, ref.length);
+        }
+
+        [[nodiscard]] const PackageRecord* find(const std::string_view name) const {
+            const auto found = std::ranges::lower_bound(packages, name, std::less{}, [this](const PackageRecord& package) {
+                return get(package.name);
+            });
+            return found != packages.end() && get(found->name) == name ? &*found : nullptr;
+        }
+
+        [[nodiscard]] std::vector<PackageVersion> getVersions(const PackageRecord& package) const {
+            if (uint64_t{package.firstVersion} + package.versionCount > versions.size()) {
+                corrupt(file);
+            }
+
+            std::vector<PackageVersion> result(package.versionCount);
+            for (uint32_t i = 0; i < package.versionCount; ++i) {
+                const VersionRecord& record = versions[package.firstVersion + i];
+                PackageVersion& version = result[i];
+                version.name = get(record.name);
+                version.version = get(record.version);
+                version.normalized.numbers = record.numbers;
+                version.normalized.stage = static_cast<Version::Stage>(record.stage);
+                version.normalized.stageNumber = record.stageNumber;
+                version.normalized.branch = get(record.branch);
+
+                uint64_t link = record.firstLink;
+                for (size_t kind = 0; kind < LINK_FIELDS.size(); ++kind) {
+                    if (link + record.linkCounts[kind] > links.size()) {
+                        corrupt(file);
+                    }
+                    auto& kindLinks = version.*LINK_FIELDS[kind];
+                    kindLinks.reserve(record.linkCounts[kind]);
+                    for (const auto end = link + record.linkCounts[kind]; link < end; ++link) {
+                        kindLinks.push_back({std::string(get(links[link].name)), std::string(get(links[link].constraint))});
+                    }
+                }
+
+                if (uint64_t{record.firstField} + record.fieldCount > fields.size()) {
+                    corrupt(file);
+                }
+                version.fields.reserve(record.fieldCount);
+                for (uint32_t field = record.firstField; field < record.firstField + record.fieldCount; ++field) {
+                    version.fields.emplace_back(get(fields[field].key), get(fields[field].value));
+                }
+            }
+            return result;
+        }
+    };
+
+    MetadataIndex::MetadataIndex(fs::path file, span::vfs::FileSystem& fileSystem)
+        : file(std::move(file)),
+          fileSystem(fileSystem),
+          mapping(map(this->file, fileSystem)) {}
+
+    MetadataIndex::~MetadataIndex() = default;
+
+    std::optional<PackageStamps> MetadataIndex::getStamps(const std::string_view name) const {
+        if (const auto found = pending.find(name); found != pending.end()) {
+            return found->second.stamps;
+        }
+        if (mapping) {
+            if (const PackageRecord* package = mapping->find(name)) {
+                return PackageStamps{package->tagged, package->dev};
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::vector<PackageVersion> MetadataIndex::getVersions(const std::string_view name) const {
+        if (const auto found = pending.find(name); found != pending.end()) {
+            return found->second.versions;
+        }
+        if (mapping) {
+            if (const PackageRecord* package = mapping->find(name)) {
+                return mapping->getVersions(*package);
+            }
+        }
+        return {};
+    }
+
+    std::vector<std::string> MetadataIndex::getNames() const {
+        std::vector<std::string> names;
+        if (mapping) {
+            names.reserve(mapping->packages.size());
+            for (const auto& package : mapping->packages) {
+                if (const auto found = pending.find(mapping->get(package.name)); found == pending.end() || found->second.stamps.exists()) {
+                    names.emplace_back(mapping->get(package.name));
+                }
+            }
+        }
+        for (const auto& [name, entry] : pending) {
+            if (entry.stamps.exists() && !(mapping && mapping->find(name))) {
+                names.push_back(name);
+            }
+        }
+        std::ranges::sort(names);
+        return names;
+    }
+
+    void MetadataIndex::put(std::string name, PackageStamps stamps, std::vector<PackageVersion> versions) {
+        pending.insert_or_assign(std::move(name), Entry{stamps, std::move(versions)});
+    }
+
+    bool MetadataIndex::save() {
+        if (pending.empty()) {
+            return false;
+        }
+
+        // Merge what was put with what the current file holds, both sorted by name
+        Writer writer;
+        auto next = pending.begin();
+        const auto addPending = [&writer](const std::string& name, const Entry& entry) {
+            if (entry.stamps.exists()) {
+                writer.add(name, entry.stamps, entry.versions);
+            }
+        };
+        if (mapping) {
+            for (const auto& package : mapping->packages) {
+                const std::string_view name = mapping->get(package.name);
+                for (; next != pending.end() && next->first < name; ++next) {
+                    addPending(next->first, next->second);
+                }
+                if (next != pending.end() && next->first == name) {
+                    addPending(next->first, next->second);
+                    ++next;
+                } else {
+                    writer.add(name, {package.tagged, package.dev}, mapping->getVersions(package));
+                }
+            }
+        }
+        for (; next != pending.end(); ++next) {
+            addPending(next->first, next->second);
+        }
+        const std::string contents = writer.build();
+
+        // Written under a name of its own, so a half-written index is never mapped
+        fs::path partialPath = file;
+        partialPath += ".partial-" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        fileSystem.writeFile(partialPath, contents);
+        fileSystem.rename(partialPath, file);
+
+        mapping = map(file, fileSystem);
+        pending.clear();
+        return true;
+    }
+
+    std::unique_ptr<MetadataIndex::Mapping> MetadataIndex::map(const fs::path& file, const span::vfs::FileSystem& fileSystem) {
+        auto mapping = std::make_unique<MetadataIndex::Mapping>();
+        mapping->file = file;
+
+        if (dynamic_cast<const span::vfs::PosixFileSystem*>(&fileSystem)) {
+            const int descriptor = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+            if (descriptor < 0) {
+                return nullptr;
+            }
+            struct stat status{};
+            if (::fstat(descriptor, &status) == 0 && status.st_size > 0) {
+                void* address = ::mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+                if (address != MAP_FAILED) {
+                    mapping->address = address;
+                    mapping->length = static_cast<size_t>(status.st_size);
+                }
+            }
+            ::close(descriptor);
+            if (!mapping->address) {
+                return nullptr;
+            }
+        } else {
+            if (!fileSystem.exists(file)) {
+                return nullptr;
+            }
+            mapping->buffer = fileSystem.readFile(file);
+        }
+
+        const std::string_view contents = mapping->address
+            ? std::string_view(static_cast<const char*>(mapping->address), mapping->length)
+            : std::string_view(mapping->buffer);
+        if (!mapping->locate(contents)) {
+            SPAN_LOG_DEBUG("Ignoring metadata index from another format: ", file.string());
+            return nullptr;
+        }
+        return mapping;
+    }
+} // namespace dev::packages::composer
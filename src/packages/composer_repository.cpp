@@ -0,0 +1,235 @@
+#include "packages/composer_repository.h"
+#include "logger.h"
+#include "trace.h"
+#include <algorithm>
+#include <cctype>
+#include <simdjson.h>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace dev::packages::composer {
+    namespace {
+        // Marks a field the entry before had and this one does not, in the minified format
+        constexpr std::string_view UNSET = "__unset";
+
+        std::string toLower(std::string_view text) {
+            std::string lower(text);
+            std::ranges::transform(lower, lower.begin(), [](const unsigned char c) {
+                return static_cast<char>(std::tolower(c));
+            });
+            return lower;
+        }
+
+        void readLinks(const simdjson::dom::element value, std::vector<Link>& links) {
+            // An empty list is written as [] by PHP, so anything but an object has no links
+            simdjson::dom::object object;
+            if (value.get_object().get(object) != simdjson::SUCCESS) {
+                return;
+            }
+            for (const auto field : object) {
+                std::string_view constraint;
+                if (field.value.get_string().get(constraint) == simdjson::SUCCESS) {
+                    links.push_back({toLower(field.key), std::string(constraint)});
+                }
+            }
+        }
+
+        /**
+         * Check that a package name is "<vendor>/<name>" and safe to use as a path
+         */
+        bool isRepositoryName(const std::string_view name) {
+            const size_t slash = name.find('/');
+            return slash != std::string_view::npos && slash > 0 && slash + 1 < name.size()
+                && name.find('/', slash + 1) == std::string_view::npos
+                && name.find("..") == std::string_view::npos
+                && !name.starts_with('.') && name[slash + 1] != '.';
+        }
+    }
+
+    Repository::Repository(fs::path directory, span::vfs::FileSystem& fileSystem)
+        : directory(std::move(directory)),
+          fileSystem(fileSystem),
+          index(this->directory / MetadataIndex::FILE_NAME, fileSystem) {}
+
+    const std::vector<PackageVersion>& Repository::getVersions(const std::string& name) {
+        if (const auto found = packages.find(name); found != packages.end()) {
+            return found->second;
+        }
+
+        std::vector<PackageVersion> versions;
+        if (isRepositoryName(name)) {
+            refresh(name);
+            versions = index.getVersions(name);
+        }
+        return packages.emplace(name, std::move(versions)).first->second;
+    }
+
+    size_t Repository::update() {
+        span::trace::Span indexing("index", "composer", directory.string());
+
+        // Every package with a file in p2/<vendor>/, and every one indexed before
+        std::vector<std::string> names = index.getNames();
+        const fs::path metadata = directory / "p2";
+        for (const auto& vendor : fileSystem.list(metadata)) {
+            if (vendor.type != span::vfs::FileType::DIRECTORY) {
+                continue;
+            }
+            for (const auto& entry : fileSystem.list(metadata / vendor.name)) {
+                std::string_view file = entry.name;
+                if (!file.ends_with(".json")) {
+                    continue;
+                }
+                file.remove_suffix(5);
+                if (file.ends_with("~dev")) {
+                    file.remove_suffix(4);
+                }
+                names.push_back(vendor.name + "/" + std::string(file));
+            }
+        }
+        std::ranges::sort(names);
+        names.erase(std::ranges::unique(names).begin(), names.end());
+
+        size_t refreshedCount = 0;
+        for (const auto& name : names) {
+            if (!isRepositoryName(name)) {
+                continue;
+            }
+            if (refresh(name)) {
+                ++refreshedCount;
+                if (const auto found = packages.find(name); found != packages.end()) {
+                    found->second = index.getVersions(name);
+                }
+            }
+        }
+        save();
+        return refreshedCount;
+    }
+
+    void Repository::save() {
+        try {
+            if (index.save()) {
+                SPAN_LOG_DEBUG("Saved metadata index ", index.getFile().string());
+            }
+        } catch (const std::exception& e) {
+            SPAN_LOG_WARNING("Could not save metadata index ", index.getFile().string(), ": ", e.what());
+        }
+    }
+
+    bool Repository::refresh(const std::string& name) {
+        const fs::path base = directory / "p2" / name;
+        const fs::path tagged = fs::path(base).concat(".json");
+        const fs::path dev = fs::path(base).concat("~dev.json");
+        const PackageStamps stamps{
+            FileStamp::of(fileSystem.status(tagged)),
+            FileStamp::of(fileSystem.status(dev))
+        };
+
+        bool indexed = false;
+        try {
+            const auto indexedStamps = index.getStamps(name);
+            if (indexedStamps == stamps) {
+                return false;
+            }
+            indexed = indexedStamps.has_value();
+        } catch (const std::runtime_error& e) {
+            SPAN_LOG_WARNING(e.what(), "; reading ", name, " from its metadata");
+        }
+        // Neither in the repository nor the index, so there is nothing to drop
+        if (!stamps.exists() && !indexed) {
+            return false;
+        }
+
+        std::vector<PackageVersion> versions;
+        if (stamps.exists()) {
+            span::trace::Span read("metadata", "composer", name);
+            load(tagged, name, versions);
+            load(dev, name, versions);
+        }
+        index.put(name, stamps, std::move(versions));
+        return true;
+    }
+
+    void Repository::load(const fs::path& file, const std::string& name, std::vector<PackageVersion>& versions) const {
+        if (!fileSystem.exists(file)) {
+            return;
+        }
+
+        try {
+            const std::string json = fileSystem.readFile(file, simdjson::SIMDJSON_PADDING);
+            simdjson::dom::parser parser;
+            const simdjson::dom::element document = parser.parse(json.data(), json.size(), false);
+
+            std::string_view format;
+            const bool minified = document["minified"].get_string().get(format) == simdjson::SUCCESS
+                && format == "composer/2.0";
+
+            simdjson::dom::object packageList = document["packages"];
+            simdjson::dom::array entries;
+            for (const auto package : packageList) {
+                if (toLower(package.key) == name) {
+                    entries = package.value.get_array();
+                    break;
+                }
+            }
+
+            // The fields in effect for the current entry, in the order they first appeared
+            std::vector<std::pair<std::string_view, simdjson::dom::element>> current;
+            for (const auto entry : entries) {
+                if (!minified) {
+                    current.clear();
+                }
+                for (const auto field : entry.get_object()) {
+                    const auto existing = std::ranges::find(current, field.key, &decltype(current)::value_type::first);
+                    std::string_view text;
+                    if (field.value.get_string().get(text) == simdjson::SUCCESS && text == UNSET) {
+                        if (existing != current.end()) {
+                            current.erase(existing);
+                        }
+                    } else if (existing != current.end()) {
+                        existing->second = field.value;
+                    } else {
+                        current.emplace_back(field.key, field.value);
+                    }
+                }
+
+                PackageVersion version;
+                std::string_view normalized;
+                for (const auto& [key, value] : current) {
+                    if (key == "name") {
+                        version.name = toLower(std::string_view(value.get_string()));
+                    } else if (key == "version") {
+                        version.version = std::string_view(value.get_string());
+                    } else if (key == "version_normalized") {
+                        normalized = value.get_string();
+                    } else if (key == "require") {
+                        readLinks(value, version.require);
+                    } else if (key == "conflict") {
+                        readLinks(value, version.conflict);
+                    } else if (key == "replace") {
+                        readLinks(value, version.replace);
+                    } else if (key == "provide") {
+                        readLinks(value, version.provide);
+                    }
+                    version.fields.emplace_back(key, simdjson::minify(value));
+                }
+                if (version.name.empty()) {
+                    version.name = name;
+                }
+
+                auto parsed = parseVersion(version.version);
+                if (!parsed && !normalized.empty()) {
+                    parsed = parseVersion(normalized);
+                }
+                if (!parsed) {
+                    SPAN_LOG_DEBUG("Skipping ", name, " ", version.version, ": not a version Composer accepts");
+                    continue;
+                }
+                version.normalized = std::move(*parsed);
+                versions.push_back(std::move(version));
+            }
+        } catch (const simdjson::simdjson_error& e) {
+            throw std::runtime_error("Failed to parse " + file.string() + ": " + e.what());
+        }
+    }
+} // namespace dev::packages::composer
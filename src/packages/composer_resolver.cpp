@@ -0,0 +1,907 @@
+#include "packages/composer_resolver.h"
+#include "logger.h"
+#include "trace.h"
+#include <algorithm>
+#include <bit>
+#include <deque>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace dev::packages::composer {
+    namespace {
+        // The root package is always the first, with a single candidate
+        constexpr uint32_t ROOT = 0;
+
+        using Bits = std::vector<uint64_t>;
+
+        /**
+         * A statement about one package: it is selected at one of a set of
+         * candidate versions, or, if absent is set, possibly not at all. So
+         * "not one of S" is the complement of S with absent set.
+         */
+        struct Term {
+            uint32_t package{0};
+            Bits versions;
+            bool absent{false};
+        };
+
+        /**
+         * A set of terms that must not all be true at once.
+         */
+        struct Incompatibility {
+            std::vector<Term> terms;
+            // For one learned from a conflict, the two it was derived from
+            int32_t left{-1};
+            int32_t right{-1};
+            // For one that is not derived, what it says
+            std::string reason;
+        };
+
+        struct Assignment {
+            Term term;
+            // The term intersected with every earlier assignment to the package
+            Term cumulative;
+            // The earlier assignment to the same package, or -1
+            int32_t previous{-1};
+            int32_t level{0};
+            // The incompatibility it was derived from; -1 for a decision
+            int32_t cause{-1};
+        };
+
+        struct Candidate {
+            explicit Candidate(const PackageVersion* version, const bool provided = false, const bool replaced = false)
+                : version(version),
+                  provided(provided),
+                  replaced(replaced) {}
+
+            const PackageVersion* version{nullptr};
+            // The version is of another package, which replaces or provides this one
+            bool provided{false};
+            bool replaced{false};
+            // What the other package replaces or provides, which requirements are matched against
+            Constraint providedAs;
+        };
+
+        struct Package {
+            std::string name;
+            // In order of preference
+            std::vector<Candidate> candidates;
+            // The candidates' versions, for matching constraints against all of them at once; stand-ins match nothing
+            PackedVersionList versions;
+            std::vector<uint32_t> incompatibilities;
+            // The incompatibilities for what each candidate depends on, once it has been considered
+            std::vector<std::optional<std::vector<uint32_t>>> dependencies;
+            int32_t lastAssignment{-1};
+            int32_t decision{-1};
+        };
+
+        /**
+         * A package that replaces or provides a name.
+         */
+        struct Provider {
+            const PackageVersion* version;
+            const Link* link;
+            bool replaces;
+        };
+
+        enum class LinkKind : char {
+            REQUIRE = 'r',
+            CONFLICT = 'c',
+            REPLACE = 'x',
+        };
+
+        enum class Relation {
+            SATISFIED,
+            CONTRADICTED,
+            ALMOST_SATISFIED,
+            INCONCLUSIVE,
+        };
+
+        class Solver {
+        public:
+            Solver(Repository& repository, const RootPackage& root)
+                : repository(repository),
+                  root(root) {
+                rootVersion.name = root.name;
+                rootVersion.version = "dev-main";
+                rootVersion.normalized.branch = "main";
+                rootVersion.require = root.require;
+                rootVersion.require.insert(rootVersion.require.end(), root.requireDev.begin(), root.requireDev.end());
+                rootVersion.conflict = root.conflict;
+                rootVersion.replace = root.replace;
+                rootVersion.provide = root.provide;
+
+                for (const auto& link : rootVersion.require) {
+                    try {
+                        constraints.emplace(link.constraint, CompiledConstraint(Constraint::parse(link.constraint)));
+                    } catch (const ConstraintError& e) {
+                        throw ResolutionError("Invalid constraint \"" + link.constraint + "\" for " + link.name + ": " + e.what());
+                    }
+                    const auto flag = getStabilityFlag(link.constraint);
+                    if (flag && *flag > root.minimumStability) {
+                        const auto [existing, added] = stabilityFlags.emplace(link.name, *flag);
+                        existing->second = std::max(existing->second, *flag);
+                    }
+                }
+
+                // Platform packages pinned by config.platform are packages with a single version
+                platformVersions.reserve(root.platform.size());
+                for (const auto& [name, version] : root.platform) {
+                    if (auto parsed = parseVersion(version)) {
+                        PackageVersion& platform = platformVersions.emplace_back();
+                        platform.name = name;
+                        platform.version = version;
+                        platform.normalized = std::move(*parsed);
+                    } else {
+                        SPAN_LOG_WARNING("Ignoring config.platform version ", version, " of ", name);
+                    }
+                }
+            }
+
+            Resolution solve() {
+                loadPool();
+
+                Package& rootPackage = packages.emplace_back();
+                rootPackage.name = root.name;
+                rootPackage.candidates.emplace_back(&rootVersion);
+                packageIds.emplace(root.name, ROOT);
+
+                addIncompatibility({Term{ROOT, none(ROOT), true}}, "the root package is installed");
+                for (int32_t next = ROOT; next >= 0; next = choose()) {
+                    propagate(static_cast<uint32_t>(next));
+                }
+
+                SPAN_LOG_DEBUG("Resolved ", root.name, " with ", decisions, " decisions and ", conflicts, " conflicts");
+                return getResolution();
+            }
+
+        private:
+            Repository& repository;
+            const RootPackage& root;
+            PackageVersion rootVersion;
+            std::vector<PackageVersion> platformVersions;
+            std::unordered_map<std::string, Stability> stabilityFlags;
+            std::unordered_map<std::string, std::vector<Provider>> providers;
+            std::unordered_map<std::string, CompiledConstraint> constraints;
+
+            std::vector<Package> packages;
+            std::unordered_map<std::string, uint32_t> packageIds;
+            std::vector<Incompatibility> incompatibilities;
+            std::vector<Assignment> assignments;
+            // Links already turned into incompatibilities, by "<package><kind><name> <constraint>"
+            std::unordered_map<std::string, uint32_t> links;
+            static constexpr uint32_t NO_INCOMPATIBILITY = UINT32_MAX;
+            // The decision level: the number of decisions made, less one
+            int32_t level{-1};
+            size_t decisions{0};
+            size_t conflicts{0};
+
+            [[nodiscard]] Stability getAllowedStability(const std::string& name) const {
+                const auto flag = stabilityFlags.find(name);
+                return flag != stabilityFlags.end() ? flag->second : root.minimumStability;
+            }
+
+            [[nodiscard]] bool isAllowed(const PackageVersion& version) const {
+                return version.normalized.getStability() <= getAllowedStability(version.name);
+            }
+
+            const CompiledConstraint& getConstraint(const std::string& text) {
+                if (const auto found = constraints.find(text); found != constraints.end()) {
+                    return found->second;
+                }
+                Constraint constraint;
+                try {
+                    constraint = Constraint::parse(text);
+                } catch (const ConstraintError& e) {
+                    // Composer skips such versions too; the constraint matches nothing
+                    SPAN_LOG_DEBUG("Ignoring constraint ", text, ": ", e.what());
+                }
+                return constraints.emplace(text, CompiledConstraint(std::move(constraint))).first->second;
+            }
+
+            const PackageVersion* findPlatformVersion(const std::string& name) const {
+                const auto version = std::ranges::find(platformVersions, name, &PackageVersion::name);
+                return version != platformVersions.end() ? &*version : nullptr;
+            }
+
+            // Platform packages not in config.platform are assumed to be there, so requirements on them are dropped
+            [[nodiscard]] bool isIgnored(const std::string& name) const {
+                return isPlatformPackage(name) && !findPlatformVersion(name);
+            }
+
+            /**
+             * Load every package the root can reach through requirements, and
+             * index who replaces or provides what among them.
+             */
+            void loadPool() {
+                span::trace::Span load("pool", "composer", root.name);
+                std::deque<const std::string*> queue;
+                std::unordered_set<std::string_view> seen;
+                const auto visit = [&](const PackageVersion& version) {
+                    for (const auto& link : version.require) {
+                        if (!isPlatformPackage(link.name) && seen.insert(link.name).second) {
+                            queue.push_back(&link.name);
+                        }
+                    }
+                    for (const auto& link : version.replace) {
+                        providers[link.name].push_back({&version, &link, true});
+                    }
+                    for (const auto& link : version.provide) {
+                        providers[link.name].push_back({&version, &link, false});
+                    }
+                };
+
+                visit(rootVersion);
+                while (!queue.empty()) {
+                    const std::string& name = *queue.front();
+                    queue.pop_front();
+                    for (const auto& version : repository.getVersions(name)) {
+                        if (isAllowed(version)) {
+                            visit(version);
+                        }
+                    }
+                }
+            }
+
+            uint32_t getPackageId(const std::string& name) {
+                if (const auto found = packageIds.find(name); found != packageIds.end()) {
+                    return found->second;
+                }
+
+                Package package;
+                package.name = name;
+                if (const PackageVersion* platform = findPlatformVersion(name)) {
+                    package.candidates.emplace_back(platform);
+                } else if (!isPlatformPackage(name)) {
+                    for (const auto& version : repository.getVersions(name)) {
+                        if (isAllowed(version)) {
+                            package.candidates.emplace_back(&version);
+                        }
+                    }
+                    // Highest first, or the most stable first with prefer-stable
+                    std::ranges::stable_sort(package.candidates, [this](const Candidate& a, const Candidate& b) {
+                        const Version& first = a.version->normalized;
+                        const Version& second = b.version->normalized;
+                        if (root.preferStable && first.getStability() != second.getStability()) {
+                            return first.getStability() < second.getStability();
+                        }
+                        return first > second;
+                    });
+
+                    // Replacements in the root package always win; other packages only stand in if the real one will not do
+                    if (const auto found = providers.find(name); found != providers.end()) {
+                        for (const bool fromRoot : {true, false}) {
+                            for (const auto& provider : found->second) {
+                                if ((provider.version == &rootVersion) != fromRoot) {
+                                    continue;
+                                }
+                                Candidate candidate(provider.version, true, provider.replaces);
+                                if (provider.link->constraint == "self.version") {
+                                    candidate.providedAs = Constraint::between(
+                                        Constraint::Bound{provider.version->normalized, true},
+                                        Constraint::Bound{provider.version->normalized, true}
+                                    );
+                                    if (provider.version->normalized.isBranch()) {
+                                        candidate.providedAs = Constraint::branch(provider.version->normalized.branch);
+                                    }
+                                } else {
+                                    candidate.providedAs = getConstraint(provider.link->constraint).getConstraint();
+                                }
+                                if (fromRoot) {
+                                    package.candidates.insert(package.candidates.begin(), std::move(candidate));
+                                } else {
+                                    package.candidates.push_back(std::move(candidate));
+                                }
+                            }
+                        }
+                    }
+                }
+
+                for (const auto& candidate : package.candidates) {
+                    package.versions.add(candidate.provided ? nullptr : &candidate.version->normalized);
+                }
+
+                const auto id = static_cast<uint32_t>(packages.size());
+                packages.push_back(std::move(package));
+                packageIds.emplace(name, id);
+                return id;
+            }
+
+            // Bitsets over a package's candidates
+
+            [[nodiscard]] size_t getWords(const uint32_t package) const {
+                return (packages[package].candidates.size() + 63) / 64;
+            }
+
+            [[nodiscard]] Bits none(const uint32_t package) const {
+                return Bits(getWords(package), 0);
+            }
+
+            [[nodiscard]] Bits all(const uint32_t package) const {
+                Bits bits(getWords(package), ~uint64_t{0});
+                if (const size_t rest = packages[package].candidates.size() % 64; rest != 0) {
+                    bits.back() = (uint64_t{1} << rest) - 1;
+                }
+                return bits;
+            }
+
+            [[nodiscard]] Bits only(const uint32_t package, const size_t candidate) const {
+                Bits bits = none(package);
+                bits[candidate / 64] |= uint64_t{1} << (candidate % 64);
+                return bits;
+            }
+
+            [[nodiscard]] static bool has(const Bits& bits, const size_t candidate) {
+                return bits[candidate / 64] >> (candidate % 64) & 1;
+            }
+
+            [[nodiscard]] static size_t count(const Bits& bits) {
+                size_t total = 0;
+                for (const uint64_t word : bits) {
+                    total += std::popcount(word);
+                }
+                return total;
+            }
+
+            [[nodiscard]] static std::optional<size_t> first(const Bits& bits) {
+                for (size_t word = 0; word < bits.size(); ++word) {
+                    if (bits[word]) {
+                        return word * 64 + std::countr_zero(bits[word]);
+                    }
+                }
+                return std::nullopt;
+            }
+
+            [[nodiscard]] Term negate(const Term& term) const {
+                Term negated{term.package, all(term.package), !term.absent};
+                for (size_t word = 0; word < negated.versions.size(); ++word) {
+                    negated.versions[word] &= ~term.versions[word];
+                }
+                return negated;
+            }
+
+            [[nodiscard]] static Term intersect(const Term& a, const Term& b) {
+                Term both{a.package, a.versions, a.absent && b.absent};
+                for (size_t word = 0; word < both.versions.size(); ++word) {
+                    both.versions[word] &= b.versions[word];
+                }
+                return both;
+            }
+
+            // Whether every state a allows, b allows too
+            [[nodiscard]] static bool isSubset(const Term& a, const Term& b) {
+                for (size_t word = 0; word < a.versions.size(); ++word) {
+                    if (a.versions[word] & ~b.versions[word]) {
+                        return false;
+                    }
+                }
+                return !a.absent || b.absent;
+            }
+
+            [[nodiscard]] static bool isDisjoint(const Term& a, const Term& b) {
+                for (size_t word = 0; word < a.versions.size(); ++word) {
+                    if (a.versions[word] & b.versions[word]) {
+                        return false;
+                    }
+                }
+                return !(a.absent && b.absent);
+            }
+
+            [[nodiscard]] bool isAny(const Term& term) const {
+                if (!term.absent) {
+                    return false;
+                }
+                const size_t candidates = packages[term.package].candidates.size();
+                for (size_t word = 0; word < term.versions.size(); ++word) {
+                    const size_t bits = std::min<size_t>(64, candidates - word * 64);
+                    if (std::popcount(term.versions[word]) != static_cast<int>(bits)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            // The partial solution
+
+            [[nodiscard]] const Term* getCurrent(const uint32_t package) const {
+                const int32_t last = packages[package].lastAssignment;
+                return last >= 0 ? &assignments[last].cumulative : nullptr;
+            }
+
+            [[nodiscard]] bool satisfies(const Term& term) const {
+                const Term* current = getCurrent(term.package);
+                return current ? isSubset(*current, term) : isAny(term);
+            }
+
+            /**
+             * Relate an incompatibility to the partial solution
+             * @return The relation, and for ALMOST_SATISFIED the term not yet satisfied
+             */
+            [[nodiscard]] std::pair<Relation, size_t> relate(const Incompatibility& incompatibility) const {
+                std::optional<size_t> unsatisfied;
+                for (size_t i = 0; i < incompatibility.terms.size(); ++i) {
+                    const Term& term = incompatibility.terms[i];
+                    const Term* current = getCurrent(term.package);
+                    if (current ? isSubset(*current, term) : isAny(term)) {
+                        continue;
+                    }
+                    if (current && isDisjoint(*current, term)) {
+                        return {Relation::CONTRADICTED, 0};
+                    }
+                    if (unsatisfied) {
+                        return {Relation::INCONCLUSIVE, 0};
+                    }
+                    unsatisfied = i;
+                }
+                return unsatisfied ? std::pair{Relation::ALMOST_SATISFIED, *unsatisfied} : std::pair{Relation::SATISFIED, size_t{0}};
+            }
+
+            void assign(Term term, const int32_t cause) {
+                Package& package = packages[term.package];
+                Assignment assignment;
+                assignment.previous = package.lastAssignment;
+                assignment.cumulative = assignment.previous >= 0 ? intersect(assignments[assignment.previous].cumulative, term) : term;
+                assignment.term = std::move(term);
+                assignment.level = level;
+                assignment.cause = cause;
+                package.lastAssignment = static_cast<int32_t>(assignments.size());
+                assignments.push_back(std::move(assignment));
+            }
+
+            void decide(const uint32_t package, const size_t candidate) {
+                ++level;
+                ++decisions;
+                assign(Term{package, only(package, candidate), false}, -1);
+                packages[package].decision = static_cast<int32_t>(candidate);
+            }
+
+            void backtrack(const int32_t target) {
+                while (!assignments.empty() && assignments.back().level > target) {
+                    const Assignment& assignment = assignments.back();
+                    Package& package = packages[assignment.term.package];
+                    package.lastAssignment = assignment.previous;
+                    if (assignment.cause < 0) {
+                        package.decision = -1;
+                    }
+                    assignments.pop_back();
+                }
+                level = target;
+            }
+
+            /**
+             * Find the earliest assignment after which the partial solution satisfies a term
+             * @return -1 if no assignment is needed
+             */
+            [[nodiscard]] int32_t findSatisfier(const Term& term) const {
+                // Cumulative terms only narrow, so the assignments that satisfy it are the latest ones
+                int32_t satisfier = -1;
+                for (int32_t i = packages[term.package].lastAssignment; i >= 0 && isSubset(assignments[i].cumulative, term); i = assignments[i].previous) {
+                    satisfier = i;
+                }
+                return satisfier;
+            }
+
+            // Incompatibilities
+
+            uint32_t createIncompatibility(std::vector<Term> terms, const int32_t left, const int32_t right, std::string reason) {
+                // One term per package, leaving out those that always hold
+                std::vector<Term> merged;
+                for (auto& term : terms) {
+                    const auto existing = std::ranges::find(merged, term.package, &Term::package);
+                    if (existing != merged.end()) {
+                        *existing = intersect(*existing, term);
+                    } else {
+                        merged.push_back(std::move(term));
+                    }
+                }
+                std::erase_if(merged, [this](const Term& term) {
+                    return isAny(term);
+                });
+                // The root package is always selected, so saying so adds nothing to a learned incompatibility
+                if (left >= 0 && merged.size() > 1) {
+                    std::erase_if(merged, [](const Term& term) {
+                        return term.package == ROOT && !term.absent;
+                    });
+                }
+
+                const auto id = static_cast<uint32_t>(incompatibilities.size());
+                incompatibilities.push_back({std::move(merged), left, right, std::move(reason)});
+                return id;
+            }
+
+            void index(const uint32_t id) {
+                for (const auto& term : incompatibilities[id].terms) {
+                    packages[term.package].incompatibilities.push_back(id);
+                }
+            }
+
+            uint32_t addIncompatibility(std::vector<Term> terms, std::string reason) {
+                const uint32_t id = createIncompatibility(std::move(terms), -1, -1, std::move(reason));
+                index(id);
+                return id;
+            }
+
+            [[nodiscard]] bool isTerminal(const Incompatibility& incompatibility) const {
+                return incompatibility.terms.empty()
+                    || (incompatibility.terms.size() == 1 && incompatibility.terms[0].package == ROOT && !incompatibility.terms[0].absent);
+            }
+
+            void propagate(const uint32_t start) {
+                std::vector<uint32_t> changed{start};
+                while (!changed.empty()) {
+                    const uint32_t package = changed.back();
+                    changed.pop_back();
+
+                    // Newest first, as those learned from conflicts are the most useful
+                    for (size_t i = packages[package].incompatibilities.size(); i-- > 0;) {
+                        const uint32_t id = packages[package].incompatibilities[i];
+                        const auto [relation, unsatisfied] = relate(incompatibilities[id]);
+                        if (relation == Relation::SATISFIED) {
+                            const uint32_t cause = resolveConflict(id);
+                            const auto [rootRelation, term] = relate(incompatibilities[cause]);
+                            Term derived = negate(incompatibilities[cause].terms[term]);
+                            changed.assign(1, derived.package);
+                            assign(std::move(derived), static_cast<int32_t>(cause));
+                            break;
+                        }
+                        if (relation == Relation::ALMOST_SATISFIED) {
+                            Term derived = negate(incompatibilities[id].terms[unsatisfied]);
+                            if (std::ranges::find(changed, derived.package) == changed.end()) {
+                                changed.push_back(derived.package);
+                            }
+                            assign(std::move(derived), static_cast<int32_t>(id));
+                        }
+                    }
+                }
+            }
+
+            /**
+             * Learn from an incompatibility the partial solution satisfies:
+             * derive the one at its root, and backjump to where it is almost
+             * satisfied.
+             * @return The incompatibility to propagate
+             * @throws ResolutionError if the root package itself is incompatible
+             */
+            uint32_t resolveConflict(uint32_t id) {
+                ++conflicts;
+                const uint32_t original = id;
+                while (!isTerminal(incompatibilities[id])) {
+                    const auto terms = incompatibilities[id].terms;
+
+                    int32_t satisfier = -1;
+                    size_t satisfierTerm = 0;
+                    int32_t previousLevel = 0;
+                    for (size_t i = 0; i < terms.size(); ++i) {
+                        const int32_t found = findSatisfier(terms[i]);
+                        if (found > satisfier) {
+                            if (satisfier >= 0) {
+                                previousLevel = std::max(previousLevel, assignments[satisfier].level);
+                            }
+                            satisfier = found;
+                            satisfierTerm = i;
+                        } else if (found >= 0) {
+                            previousLevel = std::max(previousLevel, assignments[found].level);
+                        }
+                    }
+
+                    const Assignment& assignment = assignments[satisfier];
+                    const Term& term = terms[satisfierTerm];
+                    // If the satisfier alone does not satisfy the term, an earlier assignment is needed with it
+                    const Term difference = intersect(assignment.term, negate(term));
+                    const bool partial = count(difference.versions) > 0 || difference.absent;
+                    if (partial) {
+                        if (const int32_t found = findSatisfier(negate(difference)); found >= 0) {
+                            previousLevel = std::max(previousLevel, assignments[found].level);
+                        }
+                    }
+
+                    if (assignment.cause < 0 || previousLevel < assignment.level) {
+                        if (id != original) {
+                            index(id);
+                        }
+                        backtrack(previousLevel);
+                        return id;
+                    }
+
+                    // Replace the satisfier's package in the incompatibility with the reasons it was derived
+                    std::vector<Term> prior;
+                    for (size_t i = 0; i < terms.size(); ++i) {
+                        if (i != satisfierTerm) {
+                            prior.push_back(terms[i]);
+                        }
+                    }
+                    const uint32_t cause = static_cast<uint32_t>(assignment.cause);
+                    for (const auto& causeTerm : incompatibilities[cause].terms) {
+                        if (causeTerm.package != assignment.term.package) {
+                            prior.push_back(causeTerm);
+                        }
+                    }
+                    if (partial) {
+                        prior.push_back(negate(difference));
+                    }
+                    id = createIncompatibility(std::move(prior), static_cast<int32_t>(id), static_cast<int32_t>(cause), {});
+                }
+                throw ResolutionError(explain(id));
+            }
+
+            // Decisions
+
+            /**
+             * Pick the undecided package with the fewest versions left and decide
+             * on its most preferred one, after adding its dependencies.
+             * @return The package, for propagation, or -1 if every package is decided
+             */
+            int32_t choose() {
+                int32_t chosen = -1;
+                size_t fewest = 0;
+                for (uint32_t package = 0; package < packages.size(); ++package) {
+                    const Term* current = getCurrent(package);
+                    if (!current || current->absent || packages[package].decision >= 0) {
+                        continue;
+                    }
+                    const size_t versions = count(current->versions);
+                    if (chosen < 0 || versions < fewest) {
+                        chosen = static_cast<int32_t>(package);
+                        fewest = versions;
+                    }
+                }
+                if (chosen < 0) {
+                    return -1;
+                }
+
+                const auto package = static_cast<uint32_t>(chosen);
+                const auto candidate = first(getCurrent(package)->versions);
+                if (!candidate) {
+                    addIncompatibility({Term{package, none(package), false}}, "no version of " + packages[package].name + " is left to choose");
+                    return chosen;
+                }
+
+                // A version whose dependencies already conflict is left to propagation to rule out
+                bool conflict = false;
+                for (const uint32_t id : getDependencies(package, *candidate)) {
+                    conflict = conflict || std::ranges::all_of(incompatibilities[id].terms, [&](const Term& term) {
+                        return term.package == package || satisfies(term);
+                    });
+                }
+                if (!conflict) {
+                    decide(package, *candidate);
+                }
+                return chosen;
+            }
+
+            /**
+             * Get the incompatibilities for what a candidate requires, conflicts
+             * with and replaces, adding them the first time. Each covers every
+             * candidate of the package with the same link, so what is learned
+             * from it applies to them all.
+             */
+            const std::vector<uint32_t>& getDependencies(const uint32_t package, const size_t candidate) {
+                auto& known = packages[package].dependencies;
+                known.resize(packages[package].candidates.size());
+                if (!known[candidate]) {
+                    auto added = addDependencies(package, candidate);
+                    packages[package].dependencies[candidate] = std::move(added);
+                }
+                return *packages[package].dependencies[candidate];
+            }
+
+            std::vector<uint32_t> addDependencies(const uint32_t package, const size_t candidate) {
+                std::vector<uint32_t> added;
+                const Candidate& chosen = packages[package].candidates[candidate];
+                const PackageVersion* version = chosen.version;
+
+                if (chosen.provided) {
+                    if (version == &rootVersion) {
+                        return added;
+                    }
+                    const bool replaced = chosen.replaced;
+                    const uint32_t provider = getPackageId(version->name);
+                    const auto& candidates = packages[provider].candidates;
+                    const auto real = std::ranges::find_if(candidates, [version](const Candidate& c) {
+                        return c.version == version && !c.provided;
+                    });
+                    const std::string reason = packages[package].name + " is " + (replaced ? "replaced" : "provided")
+                        + " by " + version->name + " " + version->version;
+                    std::vector<Term> terms{Term{package, only(package, candidate), false}};
+                    if (real != candidates.end()) {
+                        terms.push_back(negate(Term{provider, only(provider, real - candidates.begin()), false}));
+                    }
+                    added.push_back(addIncompatibility(std::move(terms), reason));
+                    return added;
+                }
+
+                const auto addLinks = [&](const std::vector<Link> PackageVersion::* field, const LinkKind kind) {
+                    for (const auto& link : version->*field) {
+                        if (link.name == packages[package].name || isIgnored(link.name)) {
+                            continue;
+                        }
+                        std::string key = std::to_string(package);
+                        key.append(1, static_cast<char>(kind)).append(link.name).append(1, ' ').append(link.constraint);
+                        if (const auto found = links.find(key); found != links.end()) {
+                            if (found->second != NO_INCOMPATIBILITY) {
+                                added.push_back(found->second);
+                            }
+                            continue;
+                        }
+
+                        // Every version of the package with the same link
+                        Bits versions = none(package);
+                        const auto& candidates = packages[package].candidates;
+                        for (size_t i = 0; i < candidates.size(); ++i) {
+                            if (!candidates[i].provided && std::ranges::any_of(candidates[i].version->*field, [&link](const Link& other) {
+                                return other.name == link.name && other.constraint == link.constraint;
+                            })) {
+                                versions[i / 64] |= uint64_t{1} << (i % 64);
+                            }
+                        }
+                        const std::string subject = describe(package, versions);
+
+                        const uint32_t target = getPackageId(link.name);
+                        const CompiledConstraint& constraint = kind == LinkKind::REPLACE ? anyConstraint : getConstraint(link.constraint);
+                        Bits matching = none(target);
+                        constraint.match(packages[target].versions, matching);
+                        // Stand-ins only satisfy requirements, when what they replace or provide meets them
+                        const auto& targetCandidates = packages[target].candidates;
+                        for (size_t i = 0; i < targetCandidates.size(); ++i) {
+                            if (targetCandidates[i].provided && kind == LinkKind::REQUIRE
+                                && constraint.getConstraint().intersects(targetCandidates[i].providedAs)) {
+                                matching[i / 64] |= uint64_t{1} << (i % 64);
+                            }
+                        }
+
+                        if (kind == LinkKind::REQUIRE) {
+                            std::string reason = subject + " requires " + link.name + " " + link.constraint;
+                            if (targetCandidates.empty()) {
+                                reason += ", which the repository does not have";
+                            } else if (count(matching) == 0) {
+                                reason += ", which no available version satisfies";
+                            }
+                            added.push_back(addIncompatibility(
+                                {Term{package, std::move(versions), false}, negate(Term{target, std::move(matching), false})},
+                                std::move(reason)
+                            ));
+                            links.emplace(std::move(key), added.back());
+                        } else if (count(matching) > 0) {
+                            std::string reason = kind == LinkKind::CONFLICT
+                                ? subject + " conflicts with " + link.name + " " + link.constraint
+                                : subject + " replaces " + link.name + ", so both cannot be installed";
+                            added.push_back(addIncompatibility(
+                                {Term{package, std::move(versions), false}, Term{target, std::move(matching), false}},
+                                std::move(reason)
+                            ));
+                            links.emplace(std::move(key), added.back());
+                        } else {
+                            // Conflicts with and replacements of versions that do not exist rule nothing out
+                            links.emplace(std::move(key), NO_INCOMPATIBILITY);
+                        }
+                    }
+                };
+                addLinks(&PackageVersion::require, LinkKind::REQUIRE);
+                addLinks(&PackageVersion::conflict, LinkKind::CONFLICT);
+                addLinks(&PackageVersion::replace, LinkKind::REPLACE);
+                return added;
+            }
+
+            const CompiledConstraint anyConstraint{Constraint::any()};
+
+            // Reporting
+
+            [[nodiscard]] std::string describe(const uint32_t package, const Bits& versions) const {
+                if (package == ROOT) {
+                    return "composer.json";
+                }
+                const Package& described = packages[package];
+                std::vector<std::string_view> names;
+                for (size_t i = 0; i < described.candidates.size(); ++i) {
+                    if (has(versions, i)) {
+                        names.push_back(described.candidates[i].version->version);
+                    }
+                }
+
+                std::string text = described.name;
+                for (size_t i = 0; i < names.size() && i < 3; ++i) {
+                    text.append(i == 0 ? " " : ", ").append(names[i]);
+                }
+                if (names.size() > 3) {
+                    text.append(" and ").append(std::to_string(names.size() - 3)).append(" more");
+                }
+                return text;
+            }
+
+            /**
+             * Explain why resolution failed: the facts about packages that the
+             * final incompatibility was derived from.
+             */
+            [[nodiscard]] std::string explain(const uint32_t id) const {
+                std::string message = "Your requirements could not be resolved:";
+                std::vector<bool> visited(incompatibilities.size());
+                std::vector<uint32_t> stack{id};
+                std::vector<uint32_t> reasons;
+                while (!stack.empty()) {
+                    const uint32_t next = stack.back();
+                    stack.pop_back();
+                    if (visited[next]) {
+                        continue;
+                    }
+                    visited[next] = true;
+                    const Incompatibility& incompatibility = incompatibilities[next];
+                    if (incompatibility.left < 0) {
+                        reasons.push_back(next);
+                        continue;
+                    }
+                    stack.push_back(static_cast<uint32_t>(incompatibility.right));
+                    stack.push_back(static_cast<uint32_t>(incompatibility.left));
+                }
+                // In the order they were learned, which follows the requirements down from the root
+                std::ranges::sort(reasons);
+                for (const uint32_t reason : reasons) {
+                    if (reason != 0) {
+                        message.append("\n  - ").append(incompatibilities[reason].reason);
+                    }
+                }
+                return message;
+            }
+
+            // The result
+
+            [[nodiscard]] const Candidate* getDecision(const std::string& name) const {
+                const auto found = packageIds.find(name);
+                if (found == packageIds.end() || packages[found->second].decision < 0) {
+                    return nullptr;
+                }
+                const Package& package = packages[found->second];
+                return &package.candidates[package.decision];
+            }
+
+            Resolution getResolution() const {
+                // What "require" reaches is for production; the rest is only for development
+                std::unordered_set<const PackageVersion*> production;
+                std::vector<const std::vector<Link>*> pending{&root.require};
+                while (!pending.empty()) {
+                    const auto* links = pending.back();
+                    pending.pop_back();
+                    for (const auto& link : *links) {
+                        const Candidate* candidate = getDecision(link.name);
+                        if (candidate && candidate->version != &rootVersion && production.insert(candidate->version).second) {
+                            pending.push_back(&candidate->version->require);
+                        }
+                    }
+                }
+
+                Resolution resolution;
+                for (uint32_t id = ROOT + 1; id < packages.size(); ++id) {
+                    const Package& package = packages[id];
+                    if (package.decision < 0 || isPlatformPackage(package.name)) {
+                        continue;
+                    }
+                    const Candidate& candidate = package.candidates[package.decision];
+                    if (candidate.provided) {
+                        continue;
+                    }
+                    (production.contains(candidate.version) ? resolution.packages : resolution.devPackages).push_back(candidate.version);
+                }
+                const auto byName = [](const PackageVersion* a, const PackageVersion* b) {
+                    return a->name < b->name;
+                };
+                std::ranges::sort(resolution.packages, byName);
+                std::ranges::sort(resolution.devPackages, byName);
+
+                resolution.stabilityFlags.assign(stabilityFlags.begin(), stabilityFlags.end());
+                std::ranges::sort(resolution.stabilityFlags);
+                return resolution;
+            }
+        };
+    }
+
+    bool isPlatformPackage(const std::string_view name) {
+        return name == "php" || name.starts_with("php-") || name == "hhvm" || name.starts_with("ext-")
+            || name.starts_with("lib-") || name == "composer" || name == "composer-plugin-api"
+            || name == "composer-runtime-api";
+    }
+
+    Resolution resolve(Repository& repository, const RootPackage& root) {
+        span::trace::Span resolve("resolve", "composer", root.name);
+        return Solver(repository, root).solve();
+    }
+} // namespace dev::packages::composer
@@ -0,0 +1,634 @@
+#include "packages/go.h"
+#include "cache.h"
+#include "hash.h"
+#include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace dev::packages {
+    namespace {
+        struct Requirement {
+            std::string path;
+            std::string version;
+        };
+
+        struct Replacement {
+            std::string oldPath;
+            // Empty to replace every version
+            std::string oldVersion;
+            std::string newPath;
+            // Empty for a directory
+            std::string newVersion;
+        };
+
+        struct ModFile {
+            std::string goVersion;
+            std::vector<Requirement> requirements;
+            std::vector<Replacement> replacements;
+        };
+
+        /**
+         * Split a go.mod line into its tokens, unquoting "..." and `...` strings.
+         * Stops at a comment.
+         */
+        std::vector<std::string> tokenize(const std::string_view line) {
+            std::vector<std::string> tokens;
+            size_t position = 0;
+            while (position < line.size()) {
+                const char c = line[position];
+                if (std::isspace(static_cast<unsigned char>(c))) {
+                    ++position;
+                } else if (line.substr(position).starts_with("//")) {
+                    break;
+                } else if (c == '"' || c == '`') {
+                    std::string& token = tokens.emplace_back();
+                    for (++position; position < line.size() && line[position] != c; ++position) {
+                        if (c == '"' && line[position] == '\\' && position + 1 < line.size()) {
+                            ++position;
+                        }
+                        token += line[position];
+                    }
+                    ++position;
+                } else {
+                    const size_t end = std::min(line.find_first_of(" \t\r", position), line.size());
+                    tokens.emplace_back(line.substr(position, end - position));
+                    position = end;
+                }
+            }
+            return tokens;
+        }
+
+        void addDirective(ModFile& modFile, const std::string_view verb, const std::vector<std::string>& arguments, const size_t lineNumber) {
+            if (verb == "go" && arguments.size() == 1) {
+                modFile.goVersion = arguments[0];
+            } else if (verb == "require") {
+                if (arguments.size() != 2) {
+                    throw PackageManagerError("Malformed require on line " + std::to_string(lineNumber));
+                }
+                modFile.requirements.push_back({arguments[0], arguments[1]});
+            } else if (verb == "replace") {
+                const auto arrow = std::ranges::find(arguments, "=>");
+                const size_t before = arrow - arguments.begin();
+                const size_t after = arguments.end() - arrow - 1;
+                if (arrow == arguments.end() || before < 1 || before > 2 || after < 1 || after > 2) {
+                    throw PackageManagerError("Malformed replace on line " + std::to_string(lineNumber));
+                }
+                modFile.replacements.push_back({
+                    arguments[0], before == 2 ? arguments[1] : "", *(arrow + 1), after == 2 ? *(arrow + 2) : ""
+                });
+            }
+        }
+
+        /**
+         * Parse the directives of a go.mod that decide what gets vendored:
+         * go, require and replace, on their own or in ( ) blocks.
+         */
+        ModFile parseModFile(const std::string_view contents) {
+            ModFile modFile;
+            std::string block;
+            size_t lineNumber = 0;
+            for (size_t start = 0; start < contents.size();) {
+                const size_t end = std::min(contents.find('\n', start), contents.size());
+                const std::string_view line = contents.substr(start, end - start);
+                start = end + 1;
+                ++lineNumber;
+
+                auto tokens = tokenize(line);
+                if (tokens.empty()) {
+                    continue;
+                }
+                if (!block.empty()) {
+                    if (tokens[0] == ")") {
+                        block.clear();
+                    } else {
+                        addDirective(modFile, block, tokens, lineNumber);
+                    }
+                    continue;
+                }
+                if (tokens.size() == 2 && tokens[1] == "(") {
+                    block = tokens[0];
+                    continue;
+                }
+                const std::string verb = std::move(tokens[0]);
+                tokens.erase(tokens.begin());
+                addDirective(modFile, verb, tokens, lineNumber);
+            }
+            return modFile;
+        }
+
+        /**
+         * Find the replacement that applies to a module version; one for that
+         * exact version takes precedence over one for every version.
+         */
+        const Replacement* findReplacement(const ModFile& modFile, const std::string_view path, const std::string_view version) {
+            const Replacement* found = nullptr;
+            for (const auto& replacement : modFile.replacements) {
+                if (replacement.oldPath != path) {
+                    continue;
+                }
+                if (replacement.oldVersion == version) {
+                    return &replacement;
+                }
+                if (replacement.oldVersion.empty()) {
+                    found = &replacement;
+                }
+            }
+            return found;
+        }
+
+        /**
+         * Check whether a go version, "1.21" or "1.21.6", is at least major.minor.
+         */
+        bool isAtLeast(const std::string_view goVersion, const int major, const int minor) {
+            int versionMajor = 0;
+            int versionMinor = 0;
+            const char* end = goVersion.data() + goVersion.size();
+            auto [next, error] = std::from_chars(goVersion.data(), end, versionMajor);
+            if (error != std::errc()) {
+                return false;
+            }
+            if (next != end && *next == '.') {
+                std::from_chars(next + 1, end, versionMinor);
+            }
+            return versionMajor != major ? versionMajor > major : versionMinor >= minor;
+        }
+
+        /**
+         * Escape a module path or version as a GOPROXY does: every upper case
+         * letter becomes '!' and its lower case, for case-insensitive filesystems.
+         */
+        std::string escapeCase(const std::string_view text) {
+            std::string escaped;
+            escaped.reserve(text.size());
+            for (const char c : text) {
+                if (c >= 'A' && c <= 'Z') {
+                    escaped += '!';
+                    escaped += static_cast<char>(c - 'A' + 'a');
+                } else {
+                    escaped += c;
+                }
+            }
+            return escaped;
+        }
+
+        /**
+         * List the import path of every package in a vendored module, skipping
+         * what the go command skips: testdata, directories starting with '.' or
+         * '_', and nested modules, which are vendored on their own.
+         */
+        void collectPackages(
+            const span::vfs::FileSystem& fileSystem,
+            const fs::path& directory,
+            const std::string& importPath,
+            std::vector<std::string>& packages
+        ) {
+            bool hasSources = false;
+            for (const auto& entry : fileSystem.list(directory)) {
+                if (entry.type == span::vfs::FileType::DIRECTORY) {
+                    if (entry.name == "testdata" || entry.name.starts_with('.') || entry.name.starts_with('_')
+                        || fileSystem.exists(directory / entry.name / Go::DEPS_FILE_NAME)) {
+                        continue;
+                    }
+                    collectPackages(fileSystem, directory / entry.name, importPath + "/" + entry.name, packages);
+                } else if (entry.name.ends_with(".go") && !entry.name.ends_with("_test.go")) {
+                    hasSources = true;
+                }
+            }
+            if (hasSources) {
+                packages.push_back(importPath);
+            }
+        }
+
+        /**
+         * Remove a vendored module's files, keeping the modules vendored inside it.
+         */
+        void removeModuleFiles(span::vfs::FileSystem& fileSystem, const fs::path& directory) {
+            for (const auto& entry : fileSystem.list(directory)) {
+                const fs::path path = directory / entry.name;
+                if (entry.type == span::vfs::FileType::SYMLINK) {
+                    // A module replaced by a directory; module zips hold no symlinks
+                    continue;
+                }
+                if (entry.type != span::vfs::FileType::DIRECTORY) {
+                    fileSystem.removeAll(path);
+                } else if (!fileSystem.exists(path / Go::DEPS_FILE_NAME)) {
+                    removeModuleFiles(fileSystem, path);
+                }
+            }
+            if (fileSystem.isEmptyDirectory(directory)) {
+                fileSystem.removeAll(directory);
+            }
+        }
+
+        /**
+         * Read the versions of the modules in a vendor/modules.txt, whose lines are
+         * "# <path> [<version>] [=> <path> [<version>]]". Modules replaced by a
+         * directory are left out, as they are linked rather than vendored.
+         */
+        std::unordered_map<std::string, std::string> parseModulesFile(const std::string_view contents) {
+            std::unordered_map<std::string, std::string> versions;
+            for (size_t start = 0; start < contents.size();) {
+                const size_t end = std::min(contents.find('\n', start), contents.size());
+                const std::string_view line = contents.substr(start, end - start);
+                start = end + 1;
+                if (!line.starts_with("# ")) {
+                    continue;
+                }
+
+                const auto tokens = tokenize(line);
+                const auto arrow = std::ranges::find(tokens, "=>");
+                if (arrow == tokens.end()) {
+                    if (tokens.size() == 3) {
+                        versions.emplace(tokens[1], tokens[2]);
+                    }
+                } else if (tokens.end() - arrow == 3) {
+                    // A replacement of every version follows the line of the version required, if any
+                    versions.emplace(tokens[1], *(arrow + 1) + "@" + *(arrow + 2));
+                }
+            }
+            return versions;
+        }
+
+        void appendModuleLine(std::string& modules, const std::string_view path, const std::string_view version, const Replacement* replacement) {
+            modules.append("# ").append(path);
+            if (!version.empty()) {
+                modules.append(1, ' ').append(version);
+            }
+            if (replacement) {
+                modules.append(" => ").append(replacement->newPath);
+                if (!replacement->newVersion.empty()) {
+                    modules.append(1, ' ').append(replacement->newVersion);
+                }
+            }
+            modules += '\n';
+        }
+    }
+
+    Go::Go(std::shared_ptr<Cache> cache)
+        : Manager(std::move(cache)),
+          lockFileCache(LockFileCache::DEFAULT_MAX_BYTES, LockFileCache::DEFAULT_SHARD_COUNT, this->cache->getFileSystem()) {}
+
+    bool Go::isProjectType(const std::string& directory) {
+        return getFileSystem().exists(fs::path(directory) / LOCK_FILE_NAME);
+    }
+
+    std::shared_ptr<const PackageTable> Go::getInstalledVersions(
+        const std::string& directory
+    ) {
+        const auto& fileSystem = getFileSystem();
+        const fs::path lockFile = fs::path(directory) / LOCK_FILE_NAME;
+        if (!fileSystem.exists(lockFile)) {
+            return PackageTable::emptyTable();
+        }
+
+        // go.mod picks the versions, so a go.sum is parsed again whenever its go.mod changes
+        const auto modFile = fileSystem.status(fs::path(directory) / DEPS_FILE_NAME);
+        {
+            std::lock_guard lock(modFilesMutex);
+            auto& parsedWith = modFiles[lockFile.string()];
+            if (parsedWith != std::pair(modFile.modified, modFile.size)) {
+                lockFileCache.invalidate(lockFile);
+                parsedWith = {modFile.modified, modFile.size};
+            }
+        }
+
+        return lockFileCache.get(lockFile, [&fileSystem](const fs::path& path) {
+            return parseLockFile(path, fileSystem);
+        });
+    }
+
+    std::shared_ptr<const PackageTable> Go::parseLockFile(
+        const fs::path& lockFile,
+        const span::vfs::FileSystem& fileSystem
+    ) {
+        const std::string lockFileName = lockFile.string();
+        span::trace::Span parse("parse", "lock", lockFileName);
+        static auto& parseLatency = span::metrics::Registry::getInstance().histogram(
+            "span_lock_parse_seconds", "Time to parse a lock file"
+        );
+        span::metrics::ScopedTimer timer(parseLatency);
+
+        try {
+            const fs::path modFilePath = lockFile.parent_path() / DEPS_FILE_NAME;
+            ModFile modFile;
+            try {
+                modFile = parseModFile(fileSystem.readFile(modFilePath));
+            } catch (const PackageManagerError& e) {
+                throw PackageManagerError("Failed to parse " + modFilePath.string() + ": " + e.what());
+            }
+            if (!isAtLeast(modFile.goVersion, 1, 17)) {
+                SPAN_LOG_WARNING(
+                    modFilePath.string(), " is before go 1.17, so it may not list every module the build needs; ",
+                    "run go mod tidy -go=1.17 to list them"
+                );
+            }
+
+            // "<module> <version> h1:<hash>" for module zips, "<module> <version>/go.mod h1:<hash>" for go.mod files
+            const std::string sums = fileSystem.readFile(lockFile);
+            std::unordered_map<std::string, std::string_view> zipHashes;
+            std::string moduleVersion;
+            for (size_t start = 0; start < sums.size();) {
+                const size_t end = std::min(sums.find('\n', start), sums.size());
+                const std::string_view line = std::string_view(sums).substr(start, end - start);
+                start = end + 1;
+
+                const size_t pathEnd = line.find(' ');
+                const size_t versionEnd = line.find(' ', pathEnd + 1);
+                if (pathEnd == std::string_view::npos || versionEnd == std::string_view::npos) {
+                    continue;
+                }
+                const std::string_view version = line.substr(pathEnd + 1, versionEnd - pathEnd - 1);
+                if (version.ends_with("/go.mod")) {
+                    continue;
+                }
+                moduleVersion.assign(line.substr(0, pathEnd)).append(1, '@').append(version);
+                zipHashes.emplace(moduleVersion, line.substr(versionEnd + 1));
+            }
+
+            PackageTable::Builder versions;
+            versions.reserve(modFile.requirements.size(), modFile.requirements.size() * 96);
+            std::string link;
+            std::string replacedVersion;
+            for (const auto& [path, version] : modFile.requirements) {
+                const Replacement* replacement = findReplacement(modFile, path, version);
+
+                if (replacement && replacement->newVersion.empty()) {
+                    // A directory is relative to the project, the link is relative to vendor/<module>'s parent
+                    fs::path target;
+                    if (fs::path(replacement->newPath).is_relative()) {
+                        for (auto levels = std::ranges::count(path, '/') + 1; levels > 0; --levels) {
+                            target /= "..";
+                        }
+                    }
+                    target /= replacement->newPath;
+                    link.assign(Manager::LINK_PREFIX).append(target.lexically_normal().generic_string());
+                    versions.add(path, link);
+                    continue;
+                }
+
+                moduleVersion = replacement
+                    ? replacement->newPath + "@" + replacement->newVersion
+                    : path + "@" + version;
+                const auto hash = zipHashes.find(moduleVersion);
+                if (hash == zipHashes.end()) {
+                    // Only its go.mod takes part in the build, so go mod vendor lists it without vendoring it
+                    continue;
+                }
+                // A replaced module is cached by its replacement, which is what gets vendored
+                if (replacement) {
+                    versions.add(path, moduleVersion, moduleVersion, hash->second);
+                } else {
+                    versions.add(path, version, moduleVersion, hash->second);
+                }
+            }
+
+            return versions.build();
+        } catch (const PackageManagerError&) {
+            throw;
+        } catch (const std::exception& e) {
+            throw PackageManagerError("Error reading lock file: " + std::string(e.what()));
+        }
+    }
+
+    fs::path Go::getModuleStore(const Cache& cache) {
+        if (const char* store = std::getenv("SPAN_GOPROXY_DIR")) {
+            return store;
+        }
+        return fs::path(cache.getCacheDir()) / "goproxy";
+    }
+
+    std::string Go::hashModule(
+        const span::vfs::FileSystem& fileSystem,
+        const fs::path& directory,
+        const std::string_view prefix
+    ) {
+        std::vector<std::string> files;
+        fileSystem.walk(directory, [&](const fs::path& path, const span::vfs::Status& status, size_t) {
+            if (status.isFile()) {
+                files.push_back(std::string(prefix) + "/" + path.lexically_relative(directory).generic_string());
+            }
+        });
+        std::ranges::sort(files);
+
+        std::string summary;
+        for (const auto& file : files) {
+            const auto digest = span::hash::sha256(fileSystem.readFile(directory / file.substr(prefix.size() + 1)));
+            summary.append(span::hash::toHex(digest)).append("  ").append(file).append(1, '\n');
+        }
+        return "h1:" + span::hash::toBase64(span::hash::sha256(summary));
+    }
+
+    bool Go::fillCache(
+        const std::string& directory,
+        const std::string_view package,
+        const std::string_view version
+    ) {
+        const auto versions = getInstalledVersions(directory);
+        const PackageTable::Entry* entry = versions->find(package);
+        const PackageTable::Source* source = entry ? versions->getSource(*entry) : nullptr;
+        if (!source) {
+            SPAN_LOG_ERROR("No entry for ", package, " in ", LOCK_FILE_NAME);
+            return false;
+        }
+
+        auto& fileSystem = getFileSystem();
+        const std::string moduleVersion(source->resolved);
+        const size_t at = moduleVersion.rfind('@');
+        const fs::path zip = getModuleStore(*cache) / escapeCase(moduleVersion.substr(0, at)) / "@v"
+            / (escapeCase(moduleVersion.substr(at + 1)) + ".zip");
+        if (!fileSystem.exists(zip)) {
+            SPAN_LOG_ERROR("Module ", moduleVersion, " not found: ", zip.string());
+            return false;
+        }
+
+        return cache->addToCache(getManagerName(), package, version, [&](const fs::path& cacheDir) {
+            // Every file in a module zip is below "<module>@<version>/"
+            const fs::path extracted = fs::path(cacheDir).concat(".unzip");
+            fileSystem.removeAll(extracted);
+            try {
+                cache->extractArchive(zip, extracted, package);
+
+                const fs::path root = extracted / moduleVersion;
+                if (!fileSystem.status(root).isDirectory()) {
+                    throw PackageManagerError(zip.string() + " does not hold " + moduleVersion);
+                }
+                {
+                    span::trace::Span verify("verify", "install", package);
+                    if (hashModule(fileSystem, root, moduleVersion) != source->integrity) {
+                        throw PackageManagerError("Checksum mismatch for " + moduleVersion + ": " + zip.string());
+                    }
+                }
+                fileSystem.rename(root, cacheDir);
+                fileSystem.removeAll(extracted);
+            } catch (...) {
+                cache->discard(extracted);
+                throw;
+            }
+
+            // Marks the module root, which modules vendored inside it lack; the go command
+            // writes the same for modules without one
+            if (!fileSystem.exists(cacheDir / DEPS_FILE_NAME)) {
+                fileSystem.writeFile(cacheDir / DEPS_FILE_NAME, "module " + moduleVersion.substr(0, at) + "\n");
+            }
+        });
+    }
+
+    bool Go::isInstalled(
+        const std::string_view package,
+        const std::string_view version,
+        const fs::path& installPath
+    ) const {
+        // Vendoring a module inside this one creates the directory without it
+        if (!getFileSystem().exists(installPath / DEPS_FILE_NAME)) {
+            return false;
+        }
+        if (!isCacheable(version)) {
+            return true;
+        }
+
+        // modules.txt is only written once every module is, so it lists the versions of the last complete install
+        fs::path vendor = installPath;
+        for (auto levels = std::ranges::count(package, '/') + 1; levels > 0; --levels) {
+            vendor = vendor.parent_path();
+        }
+        const auto vendored = getVendoredModules(vendor);
+        const auto found = vendored->versions.find(std::string(package));
+        return found != vendored->versions.end() && found->second == version;
+    }
+
+    std::shared_ptr<const Go::VendoredModules> Go::getVendoredModules(const fs::path& vendor) const {
+        const auto& fileSystem = getFileSystem();
+        const fs::path modulesFile = vendor / MODULES_FILE_NAME;
+        const auto status = fileSystem.status(modulesFile);
+
+        std::lock_guard lock(vendoredMutex);
+        auto& modules = vendoredModules[modulesFile.string()];
+        if (!modules || modules->modified != status.modified || modules->size != status.size) {
+            auto parsed = std::make_shared<VendoredModules>();
+            parsed->modified = status.modified;
+            parsed->size = status.size;
+            if (status.isFile()) {
+                try {
+                    parsed->versions = parseModulesFile(fileSystem.readFile(modulesFile));
+                } catch (const fs::filesystem_error& e) {
+                    SPAN_LOG_WARNING("Cannot read ", modulesFile.string(), ": ", e.code().message());
+                }
+            }
+            modules = std::move(parsed);
+        }
+        return modules;
+    }
+
+    bool Go::linkFromCache(
+        const std::string_view package,
+        const std::string_view version,
+        const std::string& installPath
+    ) const {
+        // Hard links rather than a symlink, so modules vendored inside this one stay in the project
+        return cache->materializeFromCache(getManagerName(), package, version, installPath);
+    }
+
+    bool Go::linkToCache(
+        const std::string_view,
+        const std::string_view,
+        const std::string&
+    ) const {
+        // go mod vendor leaves out the packages a project does not import, so
+        // the cache is only ever filled from verified module zips
+        return true;
+    }
+
+    void Go::removeInstalled(const fs::path& installPath) {
+        auto& fileSystem = getFileSystem();
+        if (!fileSystem.symlinkStatus(installPath).isDirectory()) {
+            fileSystem.removeAll(installPath);
+            return;
+        }
+        removeModuleFiles(fileSystem, installPath);
+    }
+
+    bool Go::completeInstall(const std::string& directory, const PackageTable& versions) {
+        auto& fileSystem = getFileSystem();
+        const fs::path vendor = fs::path(directory) / getInstallDirectory();
+        try {
+            const ModFile modFile = parseModFile(fileSystem.readFile(fs::path(directory) / DEPS_FILE_NAME));
+            // Since go 1.17 the language version of every vendored module is recorded too
+            const bool withGoVersions = isAtLeast(modFile.goVersion, 1, 17);
+
+            auto requirements = modFile.requirements;
+            std::ranges::sort(requirements, {}, &Requirement::path);
+
+            // In the format of go mod vendor, which go build checks against go.mod
+            std::string modules;
+            std::unordered_set<const Replacement*> written;
+            std::vector<std::string> packages;
+            for (const auto& [path, version] : requirements) {
+                const Replacement* replacement = findReplacement(modFile, path, version);
+                appendModuleLine(modules, path, version, replacement);
+                if (replacement && !replacement->oldVersion.empty()) {
+                    written.insert(replacement);
+                }
+
+                modules += "## explicit";
+                if (!versions.find(path)) {
+                    modules += '\n';
+                    continue;
+                }
+                const fs::path root = vendor / path;
+                if (withGoVersions) {
+                    const auto goVersion = parseModFile(fileSystem.readFile(root / DEPS_FILE_NAME)).goVersion;
+                    if (!goVersion.empty()) {
+                        modules.append("; go ").append(goVersion);
+                    }
+                }
+                modules += '\n';
+
+                packages.clear();
+                collectPackages(fileSystem, root, path, packages);
+                std::ranges::sort(packages);
+                for (const auto& importPath : packages) {
+                    modules.append(importPath).append(1, '\n');
+                }
+            }
+
+            // Replacements of every version, and of versions not required, go last, as go mod vendor writes them
+            for (const auto& replacement : modFile.replacements) {
+                if (!written.contains(&replacement)) {
+                    appendModuleLine(modules, replacement.oldPath, replacement.oldVersion, &replacement);
+                }
+            }
+
+            fileSystem.createDirectories(vendor);
+            fileSystem.writeFile(vendor / MODULES_FILE_NAME, modules);
+            return true;
+        } catch (const std::exception& e) {
+            SPAN_LOG_ERROR("Failed to write ", (vendor / MODULES_FILE_NAME).string(), ": ", e.what());
+            return false;
+        }
+    }
+
+    std::string Go::getManagerName() const {
+        return "go";
+    }
+
+    std::string Go::getInstallDirectory() const {
+        return "vendor";
+    }
+
+    std::string Go::getDependencyFileName() const {
+        return DEPS_FILE_NAME;
+    }
+
+    std::vector<std::string> Go::getDependencyFiles() const {
+        return {DEPS_FILE_NAME, LOCK_FILE_NAME};
+    }
+} // namespace dev::packages
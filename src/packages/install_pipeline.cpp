@@ -0,0 +1,250 @@
+#include "packages/install_pipeline.h"
+#include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace dev::packages {
+    namespace {
+        auto& packageLatency = span::metrics::Registry::getInstance().histogram(
+            "span_install_package_seconds", "Time to make one package available"
+        );
+
+        size_t getHardwareConcurrency() {
+            return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+
+        // Links are short and mostly wait on the filesystem, so they get more workers than fetches
+        size_t getLinkConcurrency(const size_t configured) {
+            return configured ? configured : std::max<size_t>(4, 2 * getHardwareConcurrency());
+        }
+    }
+
+    InstallPipeline::InstallPipeline(const Options options)
+        : followStage(
+              "follow", getLinkConcurrency(options.linkConcurrency), options.capacity,
+              [this](Package& package) { follow(package); }
+          ),
+          fetchStage(
+              "fetch", options.fetchConcurrency ? options.fetchConcurrency : getHardwareConcurrency(),
+              options.capacity, [this](Package& package) { fetch(package); }
+          ),
+          linkStage(
+              "link", getLinkConcurrency(options.linkConcurrency), options.capacity,
+              [this](Package& package) { link(package); }
+          ),
+          parseStage(
+              "parse", options.parseConcurrency ? options.parseConcurrency : getHardwareConcurrency(),
+              options.capacity, [this](Project*& project) { parse(*project); }
+          ) {}
+
+    InstallPipeline::~InstallPipeline() {
+        shutdown();
+    }
+
+    size_t InstallPipeline::addProject(std::shared_ptr<Manager> manager, std::string directory) {
+        Project* project;
+        size_t index;
+        {
+            std::lock_guard lock(projectsMutex);
+            index = projects.size();
+            project = &projects.emplace_back();
+        }
+        project->manager = std::move(manager);
+        project->directory = std::move(directory);
+
+        parseStage.push(project);
+        return index;
+    }
+
+    InstallPipeline::Report InstallPipeline::finish() {
+        shutdown();
+
+        // Every package of a project is in place once the stages are joined
+        for (Project& project : projects) {
+            if (!project.versions || project.versions->empty() || project.failures > 0) {
+                continue;
+            }
+            try {
+                if (!project.manager->completeInstall(project.directory, *project.versions)) {
+                    ++project.failures;
+                }
+            } catch (const std::exception& e) {
+                SPAN_LOG_ERROR("Failed to complete the install of ", project.directory, ": ", e.what());
+                project.error = e.what();
+            }
+        }
+
+        Report report;
+        report.uniquePackages = fills.size() + unversioned;
+        report.projects.reserve(projects.size());
+        for (const Project& project : projects) {
+            ProjectReport& projectReport = report.projects.emplace_back();
+            projectReport.directory = project.directory;
+            projectReport.packages = project.versions ? project.versions->size() : 0;
+            projectReport.failures = project.failures;
+            projectReport.error = project.error;
+
+            report.packages += projectReport.packages;
+            report.success &= projectReport.error.empty() && projectReport.failures == 0;
+        }
+
+        SPAN_LOG_INFO(
+            "Installed ", report.packages, " packages across ", report.projects.size(), " projects (",
+            report.uniquePackages, " distinct)"
+        );
+        return report;
+    }
+
+    void InstallPipeline::shutdown() {
+        if (finished) {
+            return;
+        }
+        finished = true;
+
+        // Each stage only feeds later ones, so once a stage has drained nothing can reach it again
+        parseStage.close();
+        parseStage.join();
+        linkStage.close();
+        linkStage.join();
+        fetchStage.close();
+        fetchStage.join();
+        followStage.close();
+        followStage.join();
+    }
+
+    void InstallPipeline::parse(Project& project) {
+        span::trace::Span parseSpan("parse", "pipeline", project.directory);
+        Manager& manager = *project.manager;
+        try {
+            manager.resolveLockFile(project.directory);
+            project.versions = manager.getInstalledVersions(project.directory);
+            if (project.versions->empty()
+                && !manager.getFileSystem().exists(fs::path(project.directory) / manager.getDependencyFileName())) {
+                throw PackageManagerError("No dependency file found in " + project.directory);
+            }
+        } catch (const std::exception& e) {
+            SPAN_LOG_ERROR("Failed to read dependencies of ", project.directory, ": ", e.what());
+            project.error = e.what();
+            project.versions.reset();
+            return;
+        }
+
+        const std::string managerName = manager.getManagerName();
+        for (const auto& entry : project.versions->entries()) {
+            Package package{&project, &entry, nullptr, std::chrono::steady_clock::now()};
+
+            // Without a version or for a link there is nothing to share, so the project installs it itself
+            if (!Manager::isCacheable(entry.version)) {
+                ++unversioned;
+                linkStage.push(package);
+                continue;
+            }
+
+            // Keyed by cache entry, since one package may be installed at several paths of a project
+            const std::string_view name = manager.getCacheName(entry.name);
+            std::string key;
+            key.reserve(managerName.size() + name.size() + entry.version.size() + 2);
+            key.append(managerName).append(1, '\0').append(name).append(1, '\0').append(entry.version);
+
+            bool leader;
+            bool filled = false;
+            {
+                std::lock_guard lock(fillsMutex);
+                auto [fill, inserted] = fills.try_emplace(std::move(key));
+                leader = inserted;
+                if (leader) {
+                    package.fill = &fill->second;
+                } else if (fill->second.done) {
+                    filled = true;
+                } else {
+                    fill->second.followers.push_back(package);
+                }
+            }
+
+            if (leader) {
+                linkStage.push(package);
+            } else if (filled) {
+                followStage.push(package);
+            }
+        }
+    }
+
+    void InstallPipeline::link(Package& package) {
+        const Project& project = *package.project;
+        bool linked;
+        try {
+            linked = project.manager->linkExisting(project.directory, package.entry->name, package.entry->version);
+        } catch (const std::exception& e) {
+            SPAN_LOG_ERROR("Package installation failed: ", e.what());
+            complete(package, false);
+            return;
+        }
+
+        if (linked) {
+            complete(package, true);
+        } else {
+            fetchStage.push(package);
+        }
+    }
+
+    void InstallPipeline::fetch(Package& package) {
+        const Project& project = *package.project;
+        bool fetched;
+        try {
+            fetched = project.manager->fetchPackage(project.directory, package.entry->name, package.entry->version);
+        } catch (const std::exception& e) {
+            SPAN_LOG_ERROR("Package installation failed: ", e.what());
+            fetched = false;
+        }
+        complete(package, fetched);
+    }
+
+    void InstallPipeline::follow(Package& package) {
+        const Project& project = *package.project;
+        Manager& manager = *project.manager;
+        const auto name = package.entry->name;
+        const auto version = package.entry->version;
+
+        // Normally a pure link; the fetch only runs if the fill failed
+        bool installed;
+        try {
+            installed = manager.linkExisting(project.directory, name, version)
+                || manager.fetchPackage(project.directory, name, version);
+        } catch (const std::exception& e) {
+            SPAN_LOG_ERROR("Package installation failed: ", e.what());
+            installed = false;
+        }
+        complete(package, installed);
+    }
+
+    void InstallPipeline::complete(const Package& package, const bool success) {
+        if (!success) {
+            ++package.project->failures;
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+        packageLatency.record(end - package.queuedAt);
+        if (span::trace::Tracer::isEnabled()) {
+            span::trace::Tracer::record("package", "install", package.entry->name, package.queuedAt, end);
+        }
+
+        if (!package.fill) {
+            return;
+        }
+
+        std::vector<Package> followers;
+        {
+            std::lock_guard lock(fillsMutex);
+            package.fill->done = true;
+            followers.swap(package.fill->followers);
+        }
+        for (const Package& follower : followers) {
+            followStage.push(follower);
+        }
+    }
+} // namespace dev::packages
@@ -0,0 +1,53 @@
+#include "packages/install_plan.h"
+#include "trace.h"
+#include <algorithm>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace dev::packages {
+    void InstallPlan::addProject(const std::shared_ptr<Manager>& manager, const std::string& directory) {
+        span::trace::Span projectSpan("add_project", "plan", directory);
+        auto versions = manager->getInstalledVersions(directory);
+        if (versions->empty()) {
+            if (!manager->getFileSystem().exists(fs::path(directory) / manager->getDependencyFileName())) {
+                throw PackageManagerError("No dependency file found in " + directory);
+            }
+            return;
+        }
+
+        if (std::ranges::find(managers, manager) == managers.end()) {
+            managers.push_back(manager);
+        }
+        // A project detected by several managers is still one project
+        const auto known = std::ranges::find(directories, directory);
+        const std::string* projectDirectory = known != directories.end()
+            ? &*known
+            : &directories.emplace_back(directory);
+        const std::string managerName = manager->getManagerName();
+
+        for (const auto& entry : *versions) {
+            const size_t index = items.size();
+            items.push_back({manager.get(), projectDirectory, entry});
+
+            // Without a version or for a link there is nothing to share, so the project installs it itself
+            if (!Manager::isCacheable(entry.version)) {
+                leaders.push_back(index);
+                continue;
+            }
+
+            // Keyed by cache entry, since one package may be installed at several paths of a project
+            const std::string_view name = manager->getCacheName(entry.name);
+            std::string key;
+            key.reserve(managerName.size() + name.size() + entry.version.size() + 2);
+            key.append(managerName).append(1, '\0').append(name).append(1, '\0').append(entry.version);
+
+            if (fillKeys.insert(std::move(key)).second) {
+                leaders.push_back(index);
+            }
+        }
+
+        tables.push_back(std::move(versions));
+    }
+
+} // namespace dev::packages
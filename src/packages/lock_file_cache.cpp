@@ -0,0 +1,163 @@
+#include "packages/lock_file_cache.h"
+#include "metrics.h"
+#include <algorithm>
+
+namespace fs = std::filesystem;
+
+namespace dev::packages {
+    namespace {
+        auto& hits = span::metrics::Registry::getInstance().counter(
+            "span_lock_cache_hits_total", "Lock file reads served from a parsed table"
+        );
+        auto& misses = span::metrics::Registry::getInstance().counter(
+            "span_lock_cache_misses_total", "Lock file reads that had to parse the file"
+        );
+    }
+
+    LockFileCache::LockFileCache(
+        const size_t maxBytes,
+        const size_t shardCount,
+        std::shared_ptr<span::vfs::FileSystem> fileSystem
+    ) : maxBytesPerShard(std::max<size_t>(maxBytes / std::max<size_t>(shardCount, 1), 1)),
+        shardCount(std::max<size_t>(shardCount, 1)),
+        shards(std::make_unique<Shard[]>(this->shardCount)),
+        fileSystem(fileSystem ? std::move(fileSystem) : span::vfs::getDefault()) {}
+
+    LockFileCache::Shard& LockFileCache::getShard(const std::string& key) const {
+        return shards[std::hash<std::string>{}(key) % shardCount];
+    }
+
+    std::shared_ptr<const PackageTable> LockFileCache::get(
+        const fs::path& lockFile,
+        const Loader& loader
+    ) {
+        const auto status = fileSystem->status(lockFile);
+        const auto fileTimestamp = status.modified;
+        const auto fileSize = status.size;
+        if (!status.isFile()) {
+            // Nothing to validate against, so don't cache; let the loader report it
+            return loader(lockFile);
+        }
+
+        const std::string key = lockFile.string();
+        Shard& shard = getShard(key);
+
+        std::promise<std::shared_ptr<const PackageTable>> promise;
+        uint64_t generation;
+        {
+            std::unique_lock lock(shard.mutex);
+
+            if (auto it = shard.entries.find(key); it != shard.entries.end()) {
+                Entry& entry = it->second;
+                if (entry.fileTimestamp == fileTimestamp && entry.fileSize == fileSize) {
+                    shard.lru.splice(shard.lru.begin(), shard.lru, entry.lruPosition);
+                    hits.add();
+                    auto table = entry.table;
+                    lock.unlock();
+                    // Waits here if another thread is still parsing
+                    return table.get();
+                }
+                erase(shard, it);
+            }
+
+            misses.add();
+            generation = ++shard.nextGeneration;
+            shard.lru.push_front(key);
+
+            Entry entry;
+            entry.table = promise.get_future().share();
+            entry.fileTimestamp = fileTimestamp;
+            entry.fileSize = fileSize;
+            entry.generation = generation;
+            entry.lruPosition = shard.lru.begin();
+            shard.entries.emplace(key, std::move(entry));
+        }
+
+        std::shared_ptr<const PackageTable> table;
+        try {
+            table = loader(lockFile);
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+
+            std::lock_guard lock(shard.mutex);
+            if (const auto it = shard.entries.find(key);
+                it != shard.entries.end() && it->second.generation == generation) {
+                erase(shard, it);
+            }
+            throw;
+        }
+
+        promise.set_value(table);
+
+        std::lock_guard lock(shard.mutex);
+        if (const auto it = shard.entries.find(key);
+            it != shard.entries.end() && it->second.generation == generation) {
+            it->second.ready = true;
+            it->second.bytes = table->getMemoryUsage();
+            shard.bytes += it->second.bytes;
+            evict(shard, key);
+        }
+
+        return table;
+    }
+
+    void LockFileCache::erase(Shard& shard, const std::unordered_map<std::string, Entry>::iterator it) {
+        shard.bytes -= it->second.bytes;
+        shard.lru.erase(it->second.lruPosition);
+        shard.entries.erase(it);
+    }
+
+    void LockFileCache::evict(Shard& shard, const std::string& keep) const {
+        // Walk from the least recently used end; entries still loading have no
+        // size yet and are skipped, as is the entry that was just inserted
+        auto position = shard.lru.end();
+        while (shard.bytes > maxBytesPerShard && position != shard.lru.begin()) {
+            --position;
+            const auto it = shard.entries.find(*position);
+            if (*position == keep || !it->second.ready) {
+                continue;
+            }
+
+            const auto next = std::next(position);
+            erase(shard, it);
+            position = next;
+        }
+    }
+
+    void LockFileCache::invalidate(const fs::path& lockFile) {
+        const std::string key = lockFile.string();
+        Shard& shard = getShard(key);
+
+        std::lock_guard lock(shard.mutex);
+        if (const auto it = shard.entries.find(key); it != shard.entries.end()) {
+            erase(shard, it);
+        }
+    }
+
+    void LockFileCache::clear() {
+        for (size_t i = 0; i < shardCount; ++i) {
+            std::lock_guard lock(shards[i].mutex);
+            shards[i].entries.clear();
+            shards[i].lru.clear();
+            shards[i].bytes = 0;
+        }
+    }
+
+    size_t LockFileCache::size() const {
+        size_t total = 0;
+        for (size_t i = 0; i < shardCount; ++i) {
+            std::lock_guard lock(shards[i].mutex);
+            total += shards[i].entries.size();
+        }
+        return total;
+    }
+
+    size_t LockFileCache::getMemoryUsage() const {
+        size_t total = 0;
+        for (size_t i = 0; i < shardCount; ++i) {
+            std::lock_guard lock(shards[i].mutex);
+            total += shards[i].bytes;
+        }
+        return total;
+    }
+} // namespace dev::packages
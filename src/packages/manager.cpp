@@ -1,6 +1,8 @@
 #include "packages/manager.h"
 #include "logger.h"
+#include "metrics.h"
 #include "thread_pool.h"
+#include "trace.h"
 #include <future>
 #include <vector>
 #include <atomic>
@@ -9,27 +11,126 @@
 namespace fs = std::filesystem;
 
 namespace dev::packages {
+    namespace {
+        auto& registry = span::metrics::Registry::getInstance();
+        auto& packageLatency = registry.histogram("span_install_package_seconds", "Time to make one package available");
+        auto& probeLatency = registry.histogram("span_install_phase_seconds", "Time spent per install phase", "phase=\"probe\"");
+        auto& linkLatency = registry.histogram("span_install_phase_seconds", "Time spent per install phase", "phase=\"link\"");
+        auto& fetchLatency = registry.histogram("span_install_phase_seconds", "Time spent per install phase", "phase=\"fetch\"");
+        auto& activeInstalls = registry.gauge("span_install_active", "Packages being installed concurrently");
+        auto& fromVendor = registry.counter("span_packages_total", "Packages by where they came from", "source=\"vendor\"");
+        auto& fromCache = registry.counter("span_packages_total", "Packages by where they came from", "source=\"cache\"");
+        auto& fromFetch = registry.counter("span_packages_total", "Packages by where they came from", "source=\"fetch\"");
+        auto& fromLink = registry.counter("span_packages_total", "Packages by where they came from", "source=\"link\"");
+        auto& failures = registry.counter("span_install_failures_total", "Packages that failed to install");
+
+        // Times a phase for both the trace timeline and the latency metrics
+        class Phase {
+        public:
+            Phase(const char* name, span::metrics::Histogram& latency, const std::string_view package)
+                : traceSpan(name, "install", package), timer(latency) {}
+
+        private:
+            span::trace::Span traceSpan;
+            span::metrics::ScopedTimer timer;
+        };
+
+        class ActiveInstall {
+        public:
+            ActiveInstall() { activeInstalls.increment(); }
+            ~ActiveInstall() { activeInstalls.decrement(); }
+        };
+    }
+
     Manager::Manager(std::shared_ptr<Cache> cache) : cache(std::move(cache)) {}
 
     bool Manager::installDependencies(const std::string& directory) {
         // Step 1: Check for lock file, fallback to dependency file, throw if neither exists
-        auto versions = getInstalledVersions(directory);
-        if (versions.empty()) {
+        resolveLockFile(directory);
+        const auto versions = getInstalledVersions(directory);
+        if (versions->empty()) {
             // Check if dependency file exists to give better error message
             const fs::path depsFile = fs::path(directory) / getDependencyFileName();
-            if (!fs::exists(depsFile)) {
+            if (!getFileSystem().exists(depsFile)) {
                 throw PackageManagerError("No dependency file found in " + directory);
             }
             return true; // No dependencies to install
         }
 
-        span::threads::ThreadPool pool(maxConcurrentInstalls);
+        return installPackages(directory, versions->entries()) && completeInstall(directory, *versions);
+    }
+
+    std::shared_ptr<const PackageTable> Manager::syncDependencies(
+        const std::string& directory,
+        const std::shared_ptr<const PackageTable>& previous,
+        bool& success
+    ) {
+        const auto versions = getInstalledVersions(directory);
+        const auto changes = PackageTable::diff(*previous, *versions);
+        success = true;
+
+        if (changes.empty()) {
+            return versions;
+        }
+
+        SPAN_LOG_INFO(
+            "Applying ", changes.added.size(), " added, ", changes.changed.size(), " changed and ",
+            changes.removed.size(), " removed ", getManagerName(), " packages in ", directory
+        );
+
+        const fs::path installPath = fs::path(directory) / getInstallDirectory();
+
+        for (const auto& [package, version] : changes.removed) {
+            try {
+                removeInstalled(installPath / package);
+            } catch (const fs::filesystem_error& e) {
+                SPAN_LOG_ERROR("Failed to remove package ", package, ": ", e.code().message());
+                success = false;
+            }
+        }
+
+        // Changed packages still point at the old version and would be taken as installed
+        for (const auto& [package, version] : changes.changed) {
+            try {
+                removeInstalled(installPath / package);
+            } catch (const fs::filesystem_error& e) {
+                // Whatever is left may still pass for installed, so the old version could stay
+                SPAN_LOG_ERROR("Failed to remove outdated package ", package, ": ", e.code().message());
+                success = false;
+            }
+        }
+
+        std::vector<PackageTable::Entry> pending;
+        pending.reserve(changes.added.size() + changes.changed.size());
+        pending.insert(pending.end(), changes.added.begin(), changes.added.end());
+        pending.insert(pending.end(), changes.changed.begin(), changes.changed.end());
+
+        success &= installPackages(directory, pending);
+        if (success) {
+            success = completeInstall(directory, *versions);
+        }
+        return versions;
+    }
+
+    bool Manager::installPackages(
+        const std::string& directory,
+        const std::span<const PackageTable::Entry> packages
+    ) {
+        if (packages.empty()) {
+            return true;
+        }
+
+        // Reuse the shared pool when one is set, otherwise size one to this install
+        const auto pool = threadPool
+            ? threadPool
+            : std::make_shared<span::threads::ThreadPool>(maxConcurrentInstalls);
         std::vector<std::future<bool>> results;
         std::atomic<float> progress = 0.0f;
-        const float progressStep = 1.0f / static_cast<float>(versions.size());
+        const float progressStep = 1.0f / static_cast<float>(packages.size());
 
-        for (const auto& [package, version] : versions) {
-            results.emplace_back(pool.enqueue([this, &directory, &package, &version, &progress, progressStep] {
+        // Entries are views owned by the caller, which outlive every result collected here
+        for (const auto& [package, version] : packages) {
+            results.emplace_back(pool->enqueue([this, &directory, &package, &version, &progress, progressStep] {
                 const bool result = this->installSingleDependency(directory, package, version);
                 if (this->progressCallback) {
                     progress += progressStep;
@@ -46,7 +147,7 @@ namespace dev::packages {
                     success = false;
                 }
             } catch (const std::exception& e) {
-                Logger::error("Package installation failed: ", e.what());
+                SPAN_LOG_ERROR("Package installation failed: ", e.what());
                 success = false;
             }
         }
@@ -56,47 +157,169 @@ namespace dev::packages {
 
     bool Manager::installSingleDependency(
         const std::string& directory,
-        const std::string& package,
-        const std::string& version
+        const std::string_view package,
+        const std::string_view version
+    ) {
+        Phase packagePhase("package", packageLatency, package);
+        return linkExisting(directory, package, version) || fetchPackage(directory, package, version);
+    }
+
+    bool Manager::linkExisting(
+        const std::string& directory,
+        const std::string_view package,
+        const std::string_view version
     ) {
+        ActiveInstall active;
         const auto vendorPath = fs::path(directory) / getInstallDirectory() / package;
 
+        // A link has nothing to fetch, so linkPackage throws rather than returning false
+        if (version.starts_with(LINK_PREFIX)) {
+            return linkPackage(vendorPath, package, version);
+        }
+
         // Step 2: Check if package is already installed in vendor directory
-        if (fs::exists(vendorPath)) {
-            Logger::info("Package ", package, " already installed in vendor directory");
+        bool installed;
+        {
+            Phase probe("probe", probeLatency, package);
+            installed = isInstalled(package, version, vendorPath);
+        }
+
+        if (installed) {
+            SPAN_EVENT_INFO(
+                "Package already installed",
+                field("package", package),
+                field("version", version)
+            );
+            fromVendor.add();
 
             // Step 3: Make sure it's linked to global cache
-            if (!cache->linkToCache(getManagerName(), package, version, vendorPath.string())) {
-                Logger::error("Failed to link existing package to cache: ", package);
+            Phase link("link", linkLatency, package);
+            if (!linkToCache(package, version, vendorPath.string())) {
+                SPAN_EVENT_ERROR(
+                    "Failed to link existing package to cache",
+                    field("package", package),
+                    field("version", version)
+                );
             }
             return true;
         }
 
-        // Step 4: Check if version is in global cache
-        if (cache->isCached(getManagerName(), package, version)) {
-            Logger::info("Package ", package, " found in cache, linking to project");
+        // Whatever is there is another version, or left half-installed; linking over it would mix the two
+        if (isCacheable(version) && getFileSystem().symlinkStatus(vendorPath).exists()) {
+            try {
+                removeInstalled(vendorPath);
+            } catch (const fs::filesystem_error& e) {
+                failures.add();
+                throw PackageManagerError(
+                    "Failed to remove outdated " + std::string(package) + " from " + vendorPath.string() + ": " + e.code().message()
+                );
+            }
+        }
+
+        // Step 4: Check if version is in global cache; without a version there is no entry to find
+        bool cached = false;
+        if (isCacheable(version)) {
+            Phase probe("probe", probeLatency, package);
+            cached = cache->isCached(getManagerName(), getCacheName(package), version);
+        }
+
+        if (cached) {
+            SPAN_EVENT_INFO(
+                "Linking package from cache",
+                field("package", package),
+                field("version", version)
+            );
 
             // Step 5: Link from cache to project
-            if (cache->linkFromCache(getManagerName(), package, version, vendorPath.string())) {
+            Phase link("link", linkLatency, package);
+            if (linkFromCache(package, version, vendorPath.string())) {
+                fromCache.add();
                 return true;
+            }
+            SPAN_EVENT_ERROR(
+                "Failed to link package from cache",
+                field("package", package),
+                field("version", version)
+            );
+        }
+
+        return false;
+    }
+
+    bool Manager::linkPackage(
+        const fs::path& installPath,
+        const std::string_view package,
+        const std::string_view version
+    ) {
+        auto& fileSystem = getFileSystem();
+        const fs::path target(version.substr(LINK_PREFIX.size()));
+
+        Phase probe("probe", probeLatency, package);
+        if (fileSystem.readSymlink(installPath) == target) {
+            fromVendor.add();
+            return true;
+        }
+
+        Phase link("link", linkLatency, package);
+        try {
+            if (fileSystem.symlinkStatus(installPath).exists()) {
+                fileSystem.removeAll(installPath);
             } else {
-                Logger::error("Failed to link package from cache: ", package);
-                // Fall through to installation
+                fileSystem.createDirectories(installPath.parent_path());
             }
+            fileSystem.createSymlink(target, installPath);
+        } catch (const fs::filesystem_error& e) {
+            failures.add();
+            throw PackageManagerError(
+                "Failed to link " + std::string(package) + " to " + target.string() + ": " + e.code().message()
+            );
         }
+        fromLink.add();
+        return true;
+    }
+
+    bool Manager::fetchPackage(
+        const std::string& directory,
+        const std::string_view package,
+        const std::string_view version
+    ) {
+        ActiveInstall active;
+        const auto vendorPath = fs::path(directory) / getInstallDirectory() / package;
 
         // Step 6: Package not in cache, install it then link to cache
-        Logger::info("Installing package ", package, " version ", version);
+        SPAN_EVENT_INFO("Installing package", field("package", package), field("version", version));
 
-        if (!installDependency(directory, package, version)) {
-            Logger::error("Failed to install package: ", package);
-            return false;
+        {
+            Phase fetch("fetch", fetchLatency, package);
+            const auto start = std::chrono::steady_clock::now();
+            if (!installDependency(directory, package, version)) {
+                SPAN_EVENT_ERROR(
+                    "Failed to install package",
+                    field("package", package),
+                    field("version", version)
+                );
+                failures.add();
+                return false;
+            }
+            SPAN_EVENT_DEBUG(
+                "Installed package",
+                field("package", package),
+                field("version", version),
+                field("phase", "fetch"),
+                field("duration", std::chrono::steady_clock::now() - start)
+            );
         }
+        fromFetch.add();
 
         // After installation, link the installed package to cache
-        if (fs::exists(vendorPath)) {
-            if (!cache->linkToCache(getManagerName(), package, version, vendorPath.string())) {
-                Logger::error("Package installed but failed to link to cache: ", package);
+        Phase link("link", linkLatency, package);
+        if (isInstalled(package, version, vendorPath)) {
+            if (!linkToCache(package, version, vendorPath.string())) {
+                SPAN_EVENT_ERROR(
+                    "Package installed but failed to link to cache",
+                    field("package", package),
+                    field("version", version)
+                );
             }
         }
 
@@ -104,21 +327,99 @@ namespace dev::packages {
     }
 
     bool Manager::linkDependencies(const std::string& directory) {
-        auto versions = getInstalledVersions(directory);
-        if (versions.empty()) {
+        const auto versions = getInstalledVersions(directory);
+        if (versions->empty()) {
             return true;
         }
 
         bool success = true;
-        for (const auto& [package, version] : versions) {
+        for (const auto& [package, version] : *versions) {
             const auto vendorPath = fs::path(directory) / getInstallDirectory() / package;
-            if (!cache->linkFromCache(getManagerName(), package, version, vendorPath.string())) {
-                Logger::error("Failed to link package: ", package);
+            if (version.starts_with(LINK_PREFIX)) {
+                try {
+                    linkPackage(vendorPath, package, version);
+                } catch (const PackageManagerError& e) {
+                    SPAN_LOG_ERROR(e.what());
+                    success = false;
+                }
+                continue;
+            }
+            if (!linkFromCache(package, version, vendorPath.string())) {
+                SPAN_LOG_ERROR("Failed to link package: ", package);
                 success = false;
             }
         }
 
-        return success;
+        return success && completeInstall(directory, *versions);
+    }
+
+    bool Manager::isCacheable(const std::string_view version) {
+        return !version.empty() && !version.starts_with(LINK_PREFIX);
+    }
+
+    std::string Manager::quoteArgument(const std::string_view argument) {
+        std::string quoted = "'";
+        for (const char c : argument) {
+            if (c == '\'') {
+                quoted += "'\\''";
+            } else {
+                quoted += c;
+            }
+        }
+        quoted += '\'';
+        return quoted;
+    }
+
+    bool Manager::installDependency(
+        const std::string& directory,
+        const std::string_view package,
+        const std::string_view version
+    ) {
+        return fillCache(directory, package, version)
+            && linkFromCache(package, version, (fs::path(directory) / getInstallDirectory() / package).string());
+    }
+
+    std::string_view Manager::getCacheName(const std::string_view package) const {
+        return package;
+    }
+
+    bool Manager::isInstalled(std::string_view, std::string_view, const fs::path& installPath) const {
+        return getFileSystem().exists(installPath);
+    }
+
+    bool Manager::linkFromCache(
+        const std::string_view package,
+        const std::string_view version,
+        const std::string& installPath
+    ) const {
+        return cache->linkFromCache(getManagerName(), getCacheName(package), version, installPath);
+    }
+
+    bool Manager::linkToCache(
+        const std::string_view package,
+        const std::string_view version,
+        const std::string& installPath
+    ) const {
+        return cache->linkToCache(getManagerName(), getCacheName(package), version, installPath);
+    }
+
+    void Manager::removeInstalled(const fs::path& installPath) {
+        // removeAll does not follow symlinks, so cached packages are left untouched
+        getFileSystem().removeAll(installPath);
+    }
+
+    bool Manager::completeInstall(const std::string&, const PackageTable&) {
+        return true;
+    }
+
+    span::vfs::FileSystem& Manager::getFileSystem() const {
+        return *cache->getFileSystem();
+    }
+
+    void Manager::resolveLockFile(const std::string&) {}
+
+    std::vector<std::string> Manager::getDependencyFiles() const {
+        return {getDependencyFileName()};
     }
 
     void Manager::setProgressCallback(ProgressCallback callback) {
@@ -135,4 +436,8 @@ namespace dev::packages {
         }
         maxConcurrentInstalls = max;
     }
+
+    void Manager::setThreadPool(std::shared_ptr<span::threads::ThreadPool> pool) {
+        threadPool = std::move(pool);
+    }
 }
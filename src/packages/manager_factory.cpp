@@ -1,12 +1,24 @@
 #include "packages/manager_factory.h"
+#include <algorithm>
 
 namespace dev::packages {
     ManagerFactory& ManagerFactory::getInstance() {
-        static ManagerFactory instance;
+        static ManagerFactory instance = [] {
+            ManagerFactory factory;
+            registerBuiltinManagers(factory);
+            return factory;
+        }();
         return instance;
     }
 
-    void ManagerFactory::registerManager(const std::string& name, ManagerCreator creator) {
+    void ManagerFactory::registerManager(
+        const std::string& name,
+        std::vector<std::string> markerFiles,
+        ManagerCreator creator
+    ) {
+        for (auto& markerFile : markerFiles) {
+            markers_[std::move(markerFile)].push_back(names_.size());
+        }
         names_.push_back(name);
         creators_.push_back(std::move(creator));
     }
@@ -19,8 +31,67 @@ namespace dev::packages {
         return managers;
     }
 
+    std::shared_ptr<Manager> ManagerFactory::createManager(const size_t index, std::shared_ptr<Cache> cache) const {
+        return creators_.at(index)(std::move(cache));
+    }
+
+    std::vector<size_t> ManagerFactory::detect(const std::vector<span::vfs::DirectoryEntry>& entries) const {
+        std::vector<size_t> detected;
+        for (const auto& entry : entries) {
+            if (const auto it = markers_.find(entry.name); it != markers_.end()) {
+                detected.insert(detected.end(), it->second.begin(), it->second.end());
+            }
+        }
+
+        std::ranges::sort(detected);
+        const auto [first, last] = std::ranges::unique(detected);
+        detected.erase(first, last);
+        return detected;
+    }
+
     std::vector<std::string> ManagerFactory::getRegisteredManagerNames() const {
         return names_;
     }
-}
 
+    ManagerSet::ManagerSet(std::shared_ptr<Cache> cache)
+        : cache(std::move(cache)),
+          managers(ManagerFactory::getInstance().getRegisteredManagerNames().size()) {}
+
+    std::vector<std::shared_ptr<Manager>> ManagerSet::detect(const std::string& directory) {
+        const auto& factory = ManagerFactory::getInstance();
+        const auto detected = factory.detect(cache->getFileSystem()->list(directory));
+
+        std::vector<std::shared_ptr<Manager>> result;
+        result.reserve(detected.size());
+
+        std::lock_guard lock(mutex);
+        for (const size_t index : detected) {
+            auto& manager = managers[index];
+            if (!manager) {
+                manager = factory.createManager(index, cache);
+                if (threadPool) {
+                    manager->setThreadPool(threadPool);
+                }
+            }
+            result.push_back(manager);
+        }
+        return result;
+    }
+
+    void ManagerSet::setThreadPool(std::shared_ptr<span::threads::ThreadPool> pool) {
+        std::lock_guard lock(mutex);
+        threadPool = std::move(pool);
+        for (const auto& manager : managers) {
+            if (manager) {
+                manager->setThreadPool(threadPool);
+            }
+        }
+    }
+
+    size_t ManagerSet::size() const {
+        std::lock_guard lock(mutex);
+        return static_cast<size_t>(std::ranges::count_if(managers, [](const auto& manager) {
+            return manager != nullptr;
+        }));
+    }
+}
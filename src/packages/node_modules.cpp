@@ -0,0 +1,109 @@
+#include "packages/node_modules.h"
+#include "hash.h"
+#include "logger.h"
+#include "trace.h"
+#include <cstdlib>
+
+namespace dev::packages::node_modules {
+    bool matchesPlatform(const std::span<const std::string_view> values, const std::string_view current) {
+        bool listsAllowed = false;
+        bool allowed = false;
+        for (const std::string_view name : values) {
+            if (name.starts_with('!')) {
+                if (name.substr(1) == current) {
+                    return false;
+                }
+            } else {
+                listsAllowed = true;
+                allowed |= name == current;
+            }
+        }
+        return !listsAllowed || allowed;
+    }
+
+    std::string_view getPackageName(const std::string_view installPath) {
+        const size_t nested = installPath.rfind(NESTED_PREFIX);
+        return nested == std::string_view::npos ? installPath : installPath.substr(nested + NESTED_PREFIX.size());
+    }
+
+    fs::path getTarballStore(const Cache& cache) {
+        if (const char* store = std::getenv("SPAN_NPM_TARBALLS")) {
+            return store;
+        }
+        return fs::path(cache.getCacheDir()) / "npm-tarballs";
+    }
+
+    fs::path getRegistryTarball(const fs::path& store, const std::string_view name, const std::string_view version) {
+        const size_t scope = name.find('/');
+        const std::string_view baseName = scope == std::string_view::npos ? name : name.substr(scope + 1);
+
+        std::string file;
+        file.reserve(baseName.size() + version.size() + 5);
+        file.append(baseName).append(1, '-').append(version).append(".tgz");
+        return store / name / "-" / file;
+    }
+
+    std::optional<fs::path> locateTarball(
+        const fs::path& store,
+        const std::string& directory,
+        const std::string_view resolved
+    ) {
+        if (resolved.starts_with("file:")) {
+            return fs::path(directory) / resolved.substr(5);
+        }
+        if (!resolved.starts_with("https://") && !resolved.starts_with("http://")) {
+            return std::nullopt;
+        }
+
+        // Registry tarballs are <registry>/<name>/-/<file>, where a scoped name has two segments
+        const size_t separator = resolved.rfind("/-/");
+        if (separator == std::string_view::npos) {
+            return std::nullopt;
+        }
+        const std::string_view file = resolved.substr(separator + 3);
+
+        size_t nameStart = resolved.rfind('/', separator - 1);
+        if (nameStart == std::string_view::npos) {
+            return std::nullopt;
+        }
+        if (nameStart > 0) {
+            const size_t scopeStart = resolved.rfind('/', nameStart - 1);
+            if (scopeStart != std::string_view::npos && resolved[scopeStart + 1] == '@') {
+                nameStart = scopeStart;
+            }
+        }
+        const std::string_view name = resolved.substr(nameStart + 1, separator - nameStart - 1);
+
+        return store / name / "-" / file;
+    }
+
+    bool unpackToCache(
+        Cache& cache,
+        const std::string_view language,
+        const std::string_view name,
+        const std::string_view version,
+        const fs::path& tarball,
+        const std::string_view integrity
+    ) {
+        auto& fileSystem = *cache.getFileSystem();
+        if (!fileSystem.exists(tarball)) {
+            SPAN_LOG_ERROR("Tarball for ", name, " not found: ", tarball.string());
+            return false;
+        }
+
+        if (integrity.empty()) {
+            SPAN_LOG_WARNING("No integrity hash for ", name, "; installing it unverified");
+        } else {
+            span::trace::Span verify("verify", "install", name);
+            if (!span::hash::matchesIntegrity(integrity, fileSystem.readFile(tarball))) {
+                SPAN_LOG_ERROR("Integrity check failed for ", name, ": ", tarball.string());
+                return false;
+            }
+        }
+
+        // Every file in an npm tarball is below "package/"
+        return cache.addToCache(language, name, version, [&](const fs::path& cacheDir) {
+            cache.extractArchive(tarball, cacheDir, name, 1);
+        });
+    }
+} // namespace dev::packages::node_modules
@@ -0,0 +1,251 @@
+#include "packages/npm.h"
+#include "packages/node_modules.h"
+#include "cache.h"
+#include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+#include <filesystem>
+#include <simdjson.h>
+
+namespace fs = std::filesystem;
+
+namespace dev::packages {
+    namespace {
+        constexpr std::string_view INSTALL_PREFIX = "node_modules/";
+
+        /**
+         * Check an "os" or "cpu" array of a lock file entry.
+         */
+        bool matchesPlatform(simdjson::ondemand::array array, const std::string_view current) {
+            std::vector<std::string_view> values;
+            for (auto value : array) {
+                values.push_back(value.get_string());
+            }
+            return node_modules::matchesPlatform(values, current);
+        }
+    }
+
+    Npm::Npm(std::shared_ptr<Cache> cache)
+        : Manager(std::move(cache)),
+          lockFileCache(LockFileCache::DEFAULT_MAX_BYTES, LockFileCache::DEFAULT_SHARD_COUNT, this->cache->getFileSystem()) {}
+
+    bool Npm::isProjectType(const std::string& directory) {
+        return getFileSystem().exists(fs::path(directory) / LOCK_FILE_NAME);
+    }
+
+    std::shared_ptr<const PackageTable> Npm::getInstalledVersions(
+        const std::string& directory
+    ) {
+        const auto& fileSystem = getFileSystem();
+        const fs::path lockFile = fs::path(directory) / LOCK_FILE_NAME;
+        if (!fileSystem.exists(lockFile)) {
+            return PackageTable::emptyTable();
+        }
+
+        return lockFileCache.get(lockFile, [&fileSystem](const fs::path& path) {
+            return parseLockFile(path, fileSystem);
+        });
+    }
+
+    std::shared_ptr<const PackageTable> Npm::parseLockFile(
+        const fs::path& lockFile,
+        const span::vfs::FileSystem& fileSystem
+    ) {
+        const std::string lockFileName = lockFile.string();
+        span::trace::Span parse("parse", "lock", lockFileName);
+        static auto& parseLatency = span::metrics::Registry::getInstance().histogram(
+            "span_lock_parse_seconds", "Time to parse a lock file"
+        );
+        span::metrics::ScopedTimer timer(parseLatency);
+
+        try {
+            simdjson::ondemand::parser parser;
+            const std::string json = fileSystem.readFile(lockFile, simdjson::SIMDJSON_PADDING);
+            simdjson::ondemand::document doc = parser.iterate(simdjson::padded_string_view(json));
+
+            auto packages = doc["packages"];
+            if (packages.error() == simdjson::NO_SUCH_FIELD) {
+                throw PackageManagerError(
+                    lockFileName + " is lockfileVersion 1, which has no \"packages\" map; "
+                    "update it by running npm install with npm 7 or later"
+                );
+            }
+
+            // Paths, versions, URLs and integrity hashes make up most of an npm lock file
+            PackageTable::Builder versions;
+            versions.reserve(0, json.size() / 2);
+            std::string link;
+
+            for (auto field : packages.get_object()) {
+                try {
+                    // Skips the root project ("") and the sources of workspace packages
+                    const std::string_view path = field.unescaped_key();
+                    if (!path.starts_with(INSTALL_PREFIX)) {
+                        continue;
+                    }
+
+                    std::string_view version;
+                    std::string_view resolved;
+                    std::string_view integrity;
+                    bool isLink = false;
+                    bool bundled = false;
+                    bool compatible = true;
+
+                    for (auto property : field.value().get_object()) {
+                        const std::string_view key = property.unescaped_key();
+                        if (key == "version") {
+                            version = property.value().get_string();
+                        } else if (key == "resolved") {
+                            resolved = property.value().get_string();
+                        } else if (key == "integrity") {
+                            integrity = property.value().get_string();
+                        } else if (key == "link") {
+                            isLink = property.value().get_bool();
+                        } else if (key == "inBundle") {
+                            bundled = property.value().get_bool();
+                        } else if (key == "os") {
+                            compatible &= matchesPlatform(property.value().get_array(), node_modules::CURRENT_OS);
+                        } else if (key == "cpu") {
+                            compatible &= matchesPlatform(property.value().get_array(), node_modules::CURRENT_CPU);
+                        }
+                    }
+
+                    // Bundled packages come inside another package's tarball. npm leaves out
+                    // packages built for other platforms, such as native binaries of esbuild.
+                    if (bundled || !compatible) {
+                        continue;
+                    }
+
+                    const std::string_view installPath = path.substr(INSTALL_PREFIX.size());
+                    if (isLink) {
+                        // Workspace packages are symlinked to their directory, which resolved gives from the root
+                        const fs::path target = fs::path(resolved).lexically_relative(fs::path(path).parent_path());
+                        link.assign(LINK_PREFIX).append(target.generic_string());
+                        versions.add(installPath, link);
+                    } else {
+                        versions.add(installPath, version, resolved, integrity);
+                    }
+                } catch (const simdjson::simdjson_error& e) {
+                    SPAN_LOG_ERROR("Error parsing package: ", e.what());
+                }
+            }
+
+            return versions.build();
+        } catch (const simdjson::simdjson_error& e) {
+            throw PackageManagerError("Failed to parse lock file: " + std::string(e.what()));
+        } catch (const PackageManagerError&) {
+            throw;
+        } catch (const std::exception& e) {
+            throw PackageManagerError("Error reading lock file: " + std::string(e.what()));
+        }
+    }
+
+    bool Npm::fillCache(
+        const std::string& directory,
+        const std::string_view package,
+        const std::string_view version
+    ) {
+        const auto versions = getInstalledVersions(directory);
+        const PackageTable::Entry* entry = versions->find(package);
+        const PackageTable::Source* source = entry ? versions->getSource(*entry) : nullptr;
+        if (!source || source->resolved.empty()) {
+            SPAN_LOG_ERROR("No resolved tarball for ", package, " in ", LOCK_FILE_NAME);
+            return false;
+        }
+
+        const auto tarball = node_modules::locateTarball(node_modules::getTarballStore(*cache), directory, source->resolved);
+        if (!tarball) {
+            SPAN_LOG_ERROR("Unsupported source for ", package, ": ", source->resolved);
+            return false;
+        }
+
+        return node_modules::unpackToCache(*cache, getManagerName(), getCacheName(package), version, *tarball, source->integrity);
+    }
+
+    std::string_view Npm::getCacheName(const std::string_view package) const {
+        return node_modules::getPackageName(package);
+    }
+
+    bool Npm::isInstalled(
+        const std::string_view,
+        const std::string_view version,
+        const fs::path& installPath
+    ) const {
+        // Installing a nested package creates the directories of the packages above it
+        const fs::path packageFile = installPath / DEPS_FILE_NAME;
+        const auto& fileSystem = getFileSystem();
+        if (!fileSystem.exists(packageFile)) {
+            return false;
+        }
+        // A link has no version; anything else is only installed at the version the lock file asks for
+        if (!isCacheable(version)) {
+            return true;
+        }
+        try {
+            simdjson::ondemand::parser parser;
+            const std::string json = fileSystem.readFile(packageFile, simdjson::SIMDJSON_PADDING);
+            simdjson::ondemand::document document = parser.iterate(simdjson::padded_string_view(json));
+            std::string_view installed;
+            return document["version"].get_string().get(installed) == simdjson::SUCCESS && installed == version;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    bool Npm::linkFromCache(
+        const std::string_view package,
+        const std::string_view version,
+        const std::string& installPath
+    ) const {
+        return cache->materializeFromCache(getManagerName(), getCacheName(package), version, installPath);
+    }
+
+    bool Npm::linkToCache(
+        const std::string_view package,
+        const std::string_view version,
+        const std::string& installPath
+    ) const {
+        if (!isCacheable(version)) {
+            return true;
+        }
+        // A tree left from another version would be cached under this one
+        if (!isInstalled(package, version, installPath)) {
+            return false;
+        }
+        // Nested dependencies are cached as packages of their own
+        return cache->materializeToCache(getManagerName(), getCacheName(package), version, installPath, "node_modules");
+    }
+
+    void Npm::removeInstalled(const fs::path& installPath) {
+        auto& fileSystem = getFileSystem();
+        if (!fileSystem.symlinkStatus(installPath).isDirectory()) {
+            fileSystem.removeAll(installPath);
+            return;
+        }
+        // Packages nested below are entries of their own, which stay unless they changed too
+        for (const auto& entry : fileSystem.list(installPath)) {
+            if (entry.name != node_modules::DIRECTORY) {
+                fileSystem.removeAll(installPath / entry.name);
+            }
+        }
+        if (fileSystem.isEmptyDirectory(installPath)) {
+            fileSystem.removeAll(installPath);
+        }
+    }
+
+    std::string Npm::getManagerName() const {
+        return "npm";
+    }
+
+    std::string Npm::getInstallDirectory() const {
+        return std::string(node_modules::DIRECTORY);
+    }
+
+    std::string Npm::getDependencyFileName() const {
+        return DEPS_FILE_NAME;
+    }
+
+    std::vector<std::string> Npm::getDependencyFiles() const {
+        return {DEPS_FILE_NAME, LOCK_FILE_NAME};
+    }
+} // namespace dev::packages
@@ -0,0 +1,138 @@
+#include "packages/package_table.h"
+#include <algorithm>
+
+namespace dev::packages {
+    void PackageTable::Builder::reserve(const size_t packages, const size_t bytes) {
+        pending.reserve(packages);
+        buffer.reserve(bytes);
+    }
+
+    void PackageTable::Builder::add(const std::string_view name, const std::string_view version) {
+        const size_t nameOffset = buffer.size();
+        buffer.append(name);
+        const size_t versionOffset = buffer.size();
+        buffer.append(version);
+
+        pending.push_back({
+            nameOffset,
+            name.size(),
+            versionOffset,
+            version.size()
+        });
+    }
+
+    void PackageTable::Builder::add(
+        const std::string_view name,
+        const std::string_view version,
+        const std::string_view resolved,
+        const std::string_view integrity
+    ) {
+        add(name, version);
+
+        PendingEntry& entry = pending.back();
+        entry.resolvedOffset = buffer.size();
+        entry.resolvedLength = resolved.size();
+        buffer.append(resolved);
+        entry.integrityOffset = buffer.size();
+        entry.integrityLength = integrity.size();
+        buffer.append(integrity);
+        hasSources = true;
+    }
+
+    std::shared_ptr<const PackageTable> PackageTable::Builder::build() {
+        const auto nameOf = [this](const PendingEntry& entry) {
+            return std::string_view(buffer).substr(entry.nameOffset, entry.nameLength);
+        };
+
+        // Stable sort so that the first occurrence of a duplicate name is kept
+        std::ranges::stable_sort(pending, [&nameOf](const PendingEntry& a, const PendingEntry& b) {
+            return nameOf(a) < nameOf(b);
+        });
+        const auto duplicates = std::ranges::unique(pending, [&nameOf](const PendingEntry& a, const PendingEntry& b) {
+            return nameOf(a) == nameOf(b);
+        });
+        pending.erase(duplicates.begin(), duplicates.end());
+
+        // Move the buffer first; views must point into the table's own storage
+        std::shared_ptr<PackageTable> table(new PackageTable());
+        table->buffer = std::move(buffer);
+        table->records.reserve(pending.size());
+
+        const std::string_view storage = table->buffer;
+        for (const auto& entry : pending) {
+            table->records.push_back({
+                storage.substr(entry.nameOffset, entry.nameLength),
+                storage.substr(entry.versionOffset, entry.versionLength)
+            });
+        }
+
+        if (hasSources) {
+            table->sources.reserve(pending.size());
+            for (const auto& entry : pending) {
+                table->sources.push_back({
+                    storage.substr(entry.resolvedOffset, entry.resolvedLength),
+                    storage.substr(entry.integrityOffset, entry.integrityLength)
+                });
+            }
+        }
+
+        buffer.clear();
+        pending.clear();
+        hasSources = false;
+        return table;
+    }
+
+    const PackageTable::Entry* PackageTable::find(const std::string_view name) const {
+        const auto it = std::ranges::lower_bound(records, name, {}, &Entry::name);
+        if (it == records.end() || it->name != name) {
+            return nullptr;
+        }
+        return &*it;
+    }
+
+    const PackageTable::Source* PackageTable::getSource(const Entry& entry) const {
+        if (sources.empty()) {
+            return nullptr;
+        }
+        return &sources[static_cast<size_t>(&entry - records.data())];
+    }
+
+    std::optional<std::string_view> PackageTable::getVersion(const std::string_view name) const {
+        if (const Entry* entry = find(name)) {
+            return entry->version;
+        }
+        return std::nullopt;
+    }
+
+    PackageTable::Changes PackageTable::diff(const PackageTable& previous, const PackageTable& current) {
+        Changes changes;
+
+        auto before = previous.records.begin();
+        auto after = current.records.begin();
+        while (before != previous.records.end() || after != current.records.end()) {
+            if (after == current.records.end() || (before != previous.records.end() && before->name < after->name)) {
+                changes.removed.push_back(*before++);
+            } else if (before == previous.records.end() || after->name < before->name) {
+                changes.added.push_back(*after++);
+            } else {
+                if (before->version != after->version) {
+                    changes.changed.push_back(*after);
+                }
+                ++before;
+                ++after;
+            }
+        }
+
+        return changes;
+    }
+
+    size_t PackageTable::getMemoryUsage() const {
+        return sizeof(PackageTable) + buffer.capacity() + records.capacity() * sizeof(Entry)
+            + sources.capacity() * sizeof(Source);
+    }
+
+    std::shared_ptr<const PackageTable> PackageTable::emptyTable() {
+        static const std::shared_ptr<const PackageTable> empty(new PackageTable());
+        return empty;
+    }
+} // namespace dev::packages
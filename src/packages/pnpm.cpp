@@ -0,0 +1,401 @@
+#include "packages/pnpm.h"
+#include "packages/node_modules.h"
+#include "cache.h"
+#include "hash.h"
+#include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+#include "yaml.h"
+#include <charconv>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace dev::packages {
+    namespace {
+        constexpr std::string_view STORE_PREFIX = ".pnpm/";
+        // pnpm shortens longer directory names with a hash, to stay within filename limits
+        constexpr size_t MAX_STORE_DIRECTORY = 120;
+        constexpr size_t STORE_HASH_LENGTH = 26;
+
+        // lockfileVersion 6 prefixes package keys and aliases with a slash
+        std::string_view stripSlash(const std::string_view depPath) {
+            return depPath.starts_with('/') ? depPath.substr(1) : depPath;
+        }
+
+        /**
+         * Split "name@version(peers)" into its name and the rest, for scoped names too.
+         */
+        std::pair<std::string_view, std::string_view> splitDepPath(const std::string_view depPath) {
+            const size_t at = depPath.find('@', 1);
+            if (at == std::string_view::npos) {
+                return {depPath, {}};
+            }
+            return {depPath.substr(0, at), depPath.substr(at + 1)};
+        }
+
+        // The package a snapshot is for, without its peer dependencies
+        std::string_view withoutPeers(const std::string_view depPath) {
+            return depPath.substr(0, depPath.find('('));
+        }
+
+        /**
+         * Turn a dependency reference into the key of the package it refers to, as pnpm's
+         * refToRelative does: "1.0.0" for name becomes "name@1.0.0", while an alias
+         * such as "other@1.0.0" already is a key.
+         */
+        void toDepPath(const std::string_view name, const std::string_view reference, std::string& depPath) {
+            if (reference.starts_with('/')) {
+                depPath.assign(reference.substr(1));
+                return;
+            }
+            const size_t at = reference.find('@');
+            const size_t colon = reference.find(':');
+            const size_t paren = reference.find('(');
+            if (reference.starts_with('@') || (at != std::string_view::npos && at < colon && at < paren)) {
+                depPath.assign(reference);
+                return;
+            }
+            depPath.assign(name).append(1, '@').append(reference);
+        }
+
+        // From a link in a node_modules directory back up to that directory, past a scope
+        std::string_view upFromLink(const std::string_view name) {
+            return name.find('/') == std::string_view::npos ? "../" : "../../";
+        }
+
+        bool isCompatible(const span::yaml::Node& package) {
+            std::vector<std::string_view> values;
+            for (const auto& [field, current] : {
+                std::pair{"os", node_modules::CURRENT_OS},
+                std::pair{"cpu", node_modules::CURRENT_CPU}
+            }) {
+                const auto list = package[field];
+                if (!list.isSequence()) {
+                    continue;
+                }
+                values.clear();
+                for (const auto value : list) {
+                    values.push_back(value.getString());
+                }
+                if (!node_modules::matchesPlatform(values, current)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    Pnpm::Pnpm(std::shared_ptr<Cache> cache)
+        : Manager(std::move(cache)),
+          lockFileCache(LockFileCache::DEFAULT_MAX_BYTES, LockFileCache::DEFAULT_SHARD_COUNT, this->cache->getFileSystem()) {}
+
+    bool Pnpm::isProjectType(const std::string& directory) {
+        return getFileSystem().exists(fs::path(directory) / LOCK_FILE_NAME);
+    }
+
+    std::shared_ptr<const PackageTable> Pnpm::getInstalledVersions(
+        const std::string& directory
+    ) {
+        const auto& fileSystem = getFileSystem();
+        const fs::path lockFile = fs::path(directory) / LOCK_FILE_NAME;
+        if (!fileSystem.exists(lockFile)) {
+            return PackageTable::emptyTable();
+        }
+
+        return lockFileCache.get(lockFile, [&fileSystem](const fs::path& path) {
+            return parseLockFile(path, fileSystem);
+        });
+    }
+
+    std::shared_ptr<const PackageTable> Pnpm::parseLockFile(
+        const fs::path& lockFile,
+        const span::vfs::FileSystem& fileSystem
+    ) {
+        const std::string lockFileName = lockFile.string();
+        span::trace::Span parse("parse", "lock", lockFileName);
+        static auto& parseLatency = span::metrics::Registry::getInstance().histogram(
+            "span_lock_parse_seconds", "Time to parse a lock file"
+        );
+        span::metrics::ScopedTimer timer(parseLatency);
+
+        try {
+            const auto document = span::yaml::Document::parse(fileSystem.readFile(lockFile));
+            if (document.getDocumentCount() == 0) {
+                return PackageTable::emptyTable();
+            }
+            // pnpm 10 may write its own dependencies as a document before the project's
+            const auto root = document.getRoot(document.getDocumentCount() - 1);
+
+            const std::string_view lockfileVersion = root["lockfileVersion"].getString();
+            int major = 0;
+            std::from_chars(lockfileVersion.data(), lockfileVersion.data() + lockfileVersion.size(), major);
+            if (major < 6) {
+                throw PackageManagerError(
+                    lockFileName + " is lockfileVersion " + std::string(lockfileVersion)
+                    + ", which span cannot read; update it by running pnpm install with pnpm 8 or later"
+                );
+            }
+
+            // Since lockfileVersion 9, packages holds what a package is and snapshots
+            // each of its installations, per set of peer dependencies
+            const auto packages = root["packages"];
+            const bool hasSnapshots = major >= 9;
+            const auto snapshots = hasSnapshots ? root["snapshots"] : packages;
+            const auto getPackageKey = [hasSnapshots](const std::string_view depPath) {
+                return hasSnapshots ? withoutPeers(depPath) : depPath;
+            };
+
+            std::unordered_map<std::string_view, span::yaml::Node> metadata;
+            std::unordered_set<std::string_view> skipped;
+            metadata.reserve(packages.size());
+            for (const auto package : packages) {
+                const std::string_view key = stripSlash(package.getKey());
+                metadata.emplace(key, package);
+                // Like pnpm, leave out packages built for other platforms, such as native binaries of esbuild
+                if (!isCompatible(package)) {
+                    skipped.insert(key);
+                }
+            }
+
+            PackageTable::Builder versions;
+            versions.reserve(snapshots.size() * 4, snapshots.size() * 512);
+            std::unordered_set<std::string_view> hoisted;
+            std::string storePath;
+            std::string linkName;
+            std::string link;
+            std::string depPath;
+            std::string resolved;
+            std::string target;
+
+            const auto addLink = [&](const std::string_view name, const std::string_view target) {
+                link.assign(Manager::LINK_PREFIX).append(target);
+                versions.add(name, link);
+            };
+
+            for (const auto snapshot : snapshots) {
+                const std::string_view key = stripSlash(snapshot.getKey());
+                if (skipped.contains(getPackageKey(key))) {
+                    continue;
+                }
+                const auto found = metadata.find(getPackageKey(key));
+                if (found == metadata.end()) {
+                    SPAN_LOG_ERROR("No package entry for ", key, " in ", lockFileName);
+                    continue;
+                }
+                const span::yaml::Node& package = found->second;
+                const auto [name, reference] = splitDepPath(key);
+                const std::string directory = getStoreDirectory(key);
+
+                // The package itself, in its own directory of the virtual store
+                storePath.assign(STORE_PREFIX).append(directory).append(1, '/').append(node_modules::DIRECTORY).append(1, '/');
+                linkName.assign(storePath).append(name);
+                const auto resolution = package["resolution"];
+                if (const std::string_view local = resolution["directory"].getString(); !local.empty()) {
+                    // Injected workspace packages: up through node_modules/.pnpm/<directory>/node_modules
+                    target.assign(upFromLink(name)).append("../../../").append(local);
+                    addLink(linkName, target);
+                } else {
+                    if (resolution["type"].getString() == "git") {
+                        resolved.assign("git+").append(resolution["repo"].getString()).append(1, '#')
+                            .append(resolution["commit"].getString());
+                    } else {
+                        resolved.assign(resolution["tarball"].getString());
+                    }
+                    // Packages from outside the registry are listed by URL or path, with their version alongside
+                    std::string_view version = package["version"].getString();
+                    if (version.empty()) {
+                        version = withoutPeers(reference);
+                    }
+                    versions.add(linkName, version, resolved, resolution["integrity"].getString());
+                }
+
+                // pnpm's default hoisting: any package can find every other from .pnpm/node_modules
+                if (hoisted.insert(name).second) {
+                    linkName.assign(STORE_PREFIX).append(node_modules::DIRECTORY).append(1, '/').append(name);
+                    target.assign(upFromLink(name)).append(directory).append(node_modules::NESTED_PREFIX).append(name);
+                    addLink(linkName, target);
+                }
+
+                // Its dependencies, as symlinks next to it
+                for (const char* field : {"dependencies", "optionalDependencies"}) {
+                    for (const auto dependency : snapshot[field]) {
+                        const std::string_view dependencyName = dependency.getKey();
+                        const std::string_view dependencyReference = dependency.getString();
+                        linkName.assign(storePath).append(dependencyName);
+
+                        if (dependencyReference.starts_with(Manager::LINK_PREFIX)) {
+                            target.assign(upFromLink(dependencyName)).append("../../../")
+                                .append(dependencyReference.substr(Manager::LINK_PREFIX.size()));
+                            addLink(linkName, target);
+                            continue;
+                        }
+
+                        toDepPath(dependencyName, dependencyReference, depPath);
+                        if (skipped.contains(getPackageKey(depPath))) {
+                            continue;
+                        }
+                        target.assign(upFromLink(dependencyName)).append("../").append(getStoreDirectory(depPath))
+                            .append(node_modules::NESTED_PREFIX).append(splitDepPath(depPath).first);
+                        addLink(linkName, target);
+                    }
+                }
+            }
+
+            // The direct dependencies of each workspace project, as symlinks into the store
+            const auto addImporter = [&](const std::string_view path, const span::yaml::Node& importer) {
+                const fs::path projectPath = path == "." ? fs::path() : fs::path(path);
+                const fs::path installPath = projectPath / node_modules::DIRECTORY;
+
+                for (const char* field : {"dependencies", "devDependencies", "optionalDependencies"}) {
+                    for (const auto dependency : importer[field]) {
+                        const std::string_view dependencyName = dependency.getKey();
+                        const std::string_view reference = dependency.isMapping()
+                            ? dependency["version"].getString()
+                            : dependency.getString();
+
+                        fs::path target;
+                        if (reference.starts_with(Manager::LINK_PREFIX)) {
+                            target = projectPath / reference.substr(Manager::LINK_PREFIX.size());
+                        } else {
+                            toDepPath(dependencyName, reference, depPath);
+                            if (skipped.contains(getPackageKey(depPath))) {
+                                continue;
+                            }
+                            target = fs::path(node_modules::DIRECTORY) / STORE_PREFIX / getStoreDirectory(depPath)
+                                / node_modules::DIRECTORY / splitDepPath(depPath).first;
+                        }
+
+                        // Keyed relative to the root's node_modules, where other projects are one level up
+                        const fs::path link = installPath / dependencyName;
+                        linkName = path == "." ? std::string(dependencyName) : (fs::path("..") / link).generic_string();
+                        addLink(linkName, target.lexically_normal().lexically_relative(link.parent_path()).generic_string());
+                    }
+                }
+            };
+
+            // lockfileVersion 6 lists the dependencies of a project without workspaces at the top level
+            if (const auto importers = root["importers"]; importers.isMapping()) {
+                for (const auto importer : importers) {
+                    addImporter(importer.getKey(), importer);
+                }
+            } else {
+                addImporter(".", root);
+            }
+
+            return versions.build();
+        } catch (const span::yaml::ParseError& e) {
+            throw PackageManagerError("Failed to parse lock file: " + std::string(e.what()));
+        } catch (const PackageManagerError&) {
+            throw;
+        } catch (const std::exception& e) {
+            throw PackageManagerError("Error reading lock file: " + std::string(e.what()));
+        }
+    }
+
+    std::string Pnpm::getStoreDirectory(const std::string_view depPath) {
+        std::string directory;
+        directory.reserve(depPath.size());
+        for (size_t i = 0; i < depPath.size(); ++i) {
+            const char c = depPath[i];
+            switch (c) {
+                case '/': case '\\': case ':': case '*': case '?': case '"': case '<': case '>': case '|':
+                    directory += '+';
+                    break;
+                case '(':
+                    directory += '_';
+                    break;
+                case ')':
+                    // "a@1(b@2)(c@3)" becomes "a@1_b@2_c@3"
+                    if (i + 1 < depPath.size()) {
+                        directory += '_';
+                        if (depPath[i + 1] == '(') {
+                            ++i;
+                        }
+                    }
+                    break;
+                default:
+                    directory += c;
+            }
+        }
+
+        if (directory.size() > MAX_STORE_DIRECTORY) {
+            const auto digest = span::hash::sha1(directory);
+            directory.resize(MAX_STORE_DIRECTORY - STORE_HASH_LENGTH - 1);
+            directory += '_';
+            directory += span::hash::toHex(std::span(digest).first<STORE_HASH_LENGTH / 2>());
+        }
+        return directory;
+    }
+
+    bool Pnpm::fillCache(
+        const std::string& directory,
+        const std::string_view package,
+        const std::string_view version
+    ) {
+        const auto versions = getInstalledVersions(directory);
+        const PackageTable::Entry* entry = versions->find(package);
+        const PackageTable::Source* source = entry ? versions->getSource(*entry) : nullptr;
+        if (!source) {
+            SPAN_LOG_ERROR("No resolution for ", package, " in ", LOCK_FILE_NAME);
+            return false;
+        }
+
+        const std::string_view name = getCacheName(package);
+        const fs::path store = node_modules::getTarballStore(*cache);
+        const auto tarball = source->resolved.empty()
+            ? std::optional(node_modules::getRegistryTarball(store, name, version))
+            : node_modules::locateTarball(store, directory, source->resolved);
+        if (!tarball) {
+            SPAN_LOG_ERROR("Unsupported source for ", package, ": ", source->resolved);
+            return false;
+        }
+
+        return node_modules::unpackToCache(*cache, getManagerName(), name, version, *tarball, source->integrity);
+    }
+
+    std::string_view Pnpm::getCacheName(const std::string_view package) const {
+        return node_modules::getPackageName(package);
+    }
+
+    bool Pnpm::isInstalled(std::string_view, std::string_view, const fs::path& installPath) const {
+        return getFileSystem().exists(installPath / DEPS_FILE_NAME);
+    }
+
+    bool Pnpm::linkFromCache(
+        const std::string_view package,
+        const std::string_view version,
+        const std::string& installPath
+    ) const {
+        return cache->materializeFromCache(getManagerName(), getCacheName(package), version, installPath);
+    }
+
+    bool Pnpm::linkToCache(
+        const std::string_view package,
+        const std::string_view version,
+        const std::string& installPath
+    ) const {
+        if (!isCacheable(version)) {
+            return true;
+        }
+        return cache->materializeToCache(getManagerName(), getCacheName(package), version, installPath);
+    }
+
+    std::string Pnpm::getManagerName() const {
+        return "pnpm";
+    }
+
+    std::string Pnpm::getInstallDirectory() const {
+        return std::string(node_modules::DIRECTORY);
+    }
+
+    std::string Pnpm::getDependencyFileName() const {
+        return DEPS_FILE_NAME;
+    }
+
+    std::vector<std::string> Pnpm::getDependencyFiles() const {
+        return {DEPS_FILE_NAME, LOCK_FILE_NAME};
+    }
+} // namespace dev::packages
@@ -0,0 +1,150 @@
+#include "packages/prefetcher.h"
+#include "logger.h"
+#include "metrics.h"
+#include "throttle.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace dev::packages {
+    namespace {
+        auto& registry = span::metrics::Registry::getInstance();
+        auto& cachedPackages = registry.counter("span_prefetch_packages_total", "Packages prefetched by outcome", "result=\"cached\"");
+        auto& filledPackages = registry.counter("span_prefetch_packages_total", "Packages prefetched by outcome", "result=\"filled\"");
+        auto& failedPackages = registry.counter("span_prefetch_packages_total", "Packages prefetched by outcome", "result=\"failed\"");
+        auto& fillLatency = registry.histogram("span_prefetch_fill_seconds", "Time to fill the cache with one package");
+        auto& throttleLatency = registry.histogram("span_prefetch_throttle_seconds", "Time a prefetch waited for its budget before a fill");
+    }
+
+    Prefetcher::Prefetcher(const Options options) : options(options) {}
+
+    void Prefetcher::addProject(const std::shared_ptr<Manager>& manager, const std::string& directory) {
+        span::trace::Span projectSpan("add_project", "prefetch", directory);
+        auto versions = manager->getInstalledVersions(directory);
+        if (versions->empty()
+            && !manager->getFileSystem().exists(fs::path(directory) / manager->getDependencyFileName())) {
+            throw PackageManagerError("No dependency file found in " + directory);
+        }
+        // Nothing is locked, e.g. in a composer project whose lock only an install would write
+        if (std::ranges::none_of(*versions, [](const auto& entry) { return Manager::isCacheable(entry.version); })) {
+            SPAN_LOG_INFO("Skipping ", directory, " for ", manager->getManagerName(), ": no locked versions");
+            return;
+        }
+
+        if (std::ranges::find(managers, manager) == managers.end()) {
+            managers.push_back(manager);
+        }
+        const auto known = std::ranges::find(directories, directory);
+        const std::string* projectDirectory = known != directories.end()
+            ? &*known
+            : &directories.emplace_back(directory);
+        const std::string managerName = manager->getManagerName();
+
+        for (const auto& entry : *versions) {
+            // Without a version or for a link there is no cache entry to fill
+            if (!Manager::isCacheable(entry.version)) {
+                continue;
+            }
+
+            const std::string_view name = manager->getCacheName(entry.name);
+            std::string key;
+            key.reserve(managerName.size() + name.size() + entry.version.size() + 2);
+            key.append(managerName).append(1, '\0').append(name).append(1, '\0').append(entry.version);
+
+            if (fillKeys.insert(std::move(key)).second) {
+                items.push_back({manager.get(), projectDirectory, entry});
+            }
+        }
+
+        tables.push_back(std::move(versions));
+    }
+
+    Prefetcher::Report Prefetcher::run() {
+        const size_t concurrency = std::clamp<size_t>(options.concurrency, 1, std::max<size_t>(items.size(), 1));
+        // A package per worker may start at once, and a second's worth of filling may run before pacing sets in
+        span::throttle::TokenBucket packageBudget(options.packagesPerSecond, static_cast<double>(concurrency));
+        span::throttle::TokenBucket busyBudget(options.busyShare, options.busyShare);
+
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> cached{0};
+        std::atomic<size_t> filled{0};
+        std::atomic<size_t> failures{0};
+        std::atomic<std::chrono::steady_clock::rep> throttled{0};
+
+        auto work = [&] {
+            if (options.lowPriority && !span::throttle::lowerPriority()) {
+                SPAN_LOG_DEBUG("Could not lower the priority of prefetch workers");
+            }
+
+            for (size_t index = next++; index < items.size(); index = next++) {
+                const auto& [manager, directory, entry] = items[index];
+                if (manager->cache->isCached(manager->getManagerName(), manager->getCacheName(entry.name), entry.version)) {
+                    ++cached;
+                    cachedPackages.add();
+                    continue;
+                }
+
+                // Waits for a package slot, then until earlier fills are paid for
+                const auto waited = packageBudget.take(1) + busyBudget.take(0);
+                throttleLatency.record(waited);
+                throttled += waited.count();
+
+                bool success;
+                std::string error;
+                const auto start = std::chrono::steady_clock::now();
+                {
+                    span::trace::Span fill("fill", "prefetch", entry.name);
+                    try {
+                        success = manager->fillCache(*directory, entry.name, entry.version);
+                    } catch (const std::exception& e) {
+                        error = e.what();
+                        success = false;
+                    }
+                }
+                const auto elapsed = std::chrono::steady_clock::now() - start;
+                fillLatency.record(elapsed);
+                busyBudget.charge(std::chrono::duration<double>(elapsed).count());
+
+                if (success) {
+                    ++filled;
+                    filledPackages.add();
+                    SPAN_LOG_DEBUG("Prefetched ", entry.name, " ", entry.version);
+                } else {
+                    ++failures;
+                    failedPackages.add();
+                    SPAN_LOG_ERROR(
+                        "Failed to prefetch ", entry.name, " ", entry.version, " for ", *directory,
+                        error.empty() ? "" : ": ", error
+                    );
+                }
+            }
+        };
+
+        // Threads of their own, since lowering the priority of a shared pool's would slow installs
+        std::vector<std::thread> workers;
+        workers.reserve(concurrency);
+        for (size_t i = 0; i < concurrency; ++i) {
+            workers.emplace_back([&work, i] {
+                if (span::trace::Tracer::isEnabled()) {
+                    span::trace::Tracer::setThreadName("prefetch-" + std::to_string(i));
+                }
+                work();
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        return {
+            items.size(),
+            cached.load(),
+            filled.load(),
+            failures.load(),
+            std::chrono::steady_clock::duration(throttled.load())
+        };
+    }
+} // namespace dev::packages
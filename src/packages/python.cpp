@@ -0,0 +1,582 @@
+#include "packages/python.h"
+#include "packages/wheel.h"
+#include "cache.h"
+#include "logger.h"
+#include "metrics.h"
+#include "toml.h"
+#include "trace.h"
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace dev::packages {
+    namespace {
+        constexpr std::string_view DIST_INFO_SUFFIX = ".dist-info";
+
+        /**
+         * Collects packages keyed by their metadata directory, with the wheels
+         * that suit the interpreter as their source.
+         */
+        class TableWriter {
+        public:
+            TableWriter(const wheel::Interpreter& interpreter, const std::string& lockFileName)
+                : interpreter(interpreter), lockFileName(lockFileName), sitePackages(wheel::getSitePackages(interpreter)) {}
+
+            void addWheel(std::string_view url, const std::string_view hash) {
+                // Wheels are listed by URL or file name, with '+' of local versions percent-encoded
+                url = url.substr(url.rfind('/') + 1);
+                fileName.clear();
+                for (size_t i = 0; i < url.size(); ++i) {
+                    if (url[i] == '%' && i + 2 < url.size()) {
+                        fileName += static_cast<char>(std::stoi(std::string(url.substr(i + 1, 2)), nullptr, 16));
+                        i += 2;
+                    } else {
+                        fileName += url[i];
+                    }
+                }
+
+                const auto parsed = wheel::parseFileName(fileName);
+                if (!parsed || wheel::getCompatibility(*parsed, interpreter) == 0) {
+                    return;
+                }
+                if (!resolved.empty()) {
+                    resolved += ' ';
+                }
+                resolved += fileName;
+                if (!hash.empty() && !wheel::appendIntegrity(integrity, hash)) {
+                    SPAN_LOG_WARNING("Ignoring malformed hash ", hash, " of ", fileName, " in ", lockFileName);
+                }
+            }
+
+            void addHash(const std::string_view hash) {
+                if (!wheel::appendIntegrity(integrity, hash)) {
+                    SPAN_LOG_WARNING("Ignoring malformed hash ", hash, " in ", lockFileName);
+                }
+            }
+
+            /**
+             * Add a package with the wheels and hashes given since the last one.
+             * @param listsFiles Whether the lock file lists the package's files, so that none matching is a problem
+             */
+            void addPackage(const std::string_view name, const std::string_view version, const bool listsFiles = false) {
+                if (name.empty() || version.empty()) {
+                    SPAN_LOG_ERROR("Skipping a package without name or version in ", lockFileName);
+                } else if (!added.insert(wheel::normalizeName(name)).second) {
+                    SPAN_LOG_WARNING("Installing only the first version of ", name, " listed in ", lockFileName);
+                } else {
+                    if (listsFiles && resolved.empty()) {
+                        SPAN_LOG_WARNING(
+                            lockFileName, " lists no wheel of ", name, " ", version,
+                            " for this platform; looking for one in the wheelhouse"
+                        );
+                    }
+                    key.assign(sitePackages).append(1, '/').append(wheel::getDistInfoName(name, version));
+                    versions.add(key, version, resolved, integrity);
+                }
+                resolved.clear();
+                integrity.clear();
+            }
+
+            [[nodiscard]] bool applies(const std::string_view marker) const {
+                return marker.empty() || wheel::evaluateMarker(marker, interpreter);
+            }
+
+            std::shared_ptr<const PackageTable> build() {
+                return versions.build();
+            }
+
+        private:
+            const wheel::Interpreter& interpreter;
+            const std::string& lockFileName;
+            std::string sitePackages;
+            PackageTable::Builder versions;
+            std::unordered_set<std::string> added;
+            std::string key;
+            std::string fileName;
+            std::string resolved;
+            std::string integrity;
+        };
+
+        /**
+         * Read a pip requirements file, where every requirement has to be pinned,
+         * as pip-compile and uv pip compile write them.
+         */
+        void parseRequirements(const std::string_view text, TableWriter& writer, const std::string& lockFileName) {
+            std::string line;
+            size_t start = 0;
+            while (start < text.size()) {
+                // A backslash at the end of a line continues it
+                line.clear();
+                while (start < text.size()) {
+                    const size_t end = std::min(text.find('\n', start), text.size());
+                    std::string_view part = text.substr(start, end - start);
+                    start = end + 1;
+                    if (part.ends_with('\r')) {
+                        part.remove_suffix(1);
+                    }
+                    if (!part.ends_with('\\')) {
+                        line.append(part);
+                        break;
+                    }
+                    line.append(part.substr(0, part.size() - 1));
+                }
+
+                std::string_view requirement = line;
+                for (size_t hash = requirement.find('#'); hash != std::string_view::npos; hash = requirement.find('#', hash + 1)) {
+                    if (hash == 0 || requirement[hash - 1] == ' ' || requirement[hash - 1] == '\t') {
+                        requirement = requirement.substr(0, hash);
+                        break;
+                    }
+                }
+                requirement.remove_prefix(std::min(requirement.find_first_not_of(" \t"), requirement.size()));
+                requirement = requirement.substr(0, requirement.find_last_not_of(" \t") + 1);
+                if (requirement.empty()) {
+                    continue;
+                }
+
+                if (requirement.starts_with('-')) {
+                    for (const std::string_view option : {"-r", "--requirement", "-c", "--constraint", "-e", "--editable"}) {
+                        if (requirement.starts_with(option)) {
+                            SPAN_LOG_WARNING("Ignoring ", requirement, " in ", lockFileName);
+                            break;
+                        }
+                    }
+                    // Other options, such as --index-url, only tell pip where to download from
+                    continue;
+                }
+
+                // Options such as --hash follow the requirement, and markers follow a semicolon
+                std::string_view options;
+                if (const size_t option = requirement.find(" --"); option != std::string_view::npos) {
+                    options = requirement.substr(option + 1);
+                    requirement = requirement.substr(0, option);
+                }
+                std::string_view marker;
+                if (const size_t semicolon = requirement.find(';'); semicolon != std::string_view::npos) {
+                    marker = requirement.substr(semicolon + 1);
+                    requirement = requirement.substr(0, semicolon);
+                }
+
+                const size_t nameEnd = std::min(requirement.find_first_of(" \t[=<>!~@"), requirement.size());
+                const std::string_view name = requirement.substr(0, nameEnd);
+                std::string_view specifier = requirement.substr(nameEnd);
+                if (specifier.starts_with('[')) {
+                    specifier.remove_prefix(std::min(specifier.find(']') + 1, specifier.size()));
+                }
+                specifier.remove_prefix(std::min(specifier.find_first_not_of(" \t"), specifier.size()));
+                specifier = specifier.substr(0, specifier.find_last_not_of(" \t") + 1);
+
+                std::string_view version;
+                if (specifier.starts_with('@')) {
+                    // A direct reference, which has to be a wheel to know its version
+                    const std::string_view url = specifier.substr(specifier.find_first_not_of(" \t", 1));
+                    const auto parsed = wheel::parseFileName(url.substr(url.rfind('/') + 1));
+                    if (!parsed) {
+                        throw PackageManagerError(lockFileName + ": " + std::string(name) + " is not installed from a wheel");
+                    }
+                    version = parsed->version;
+                    writer.addWheel(url, {});
+                } else if (specifier.starts_with("==")) {
+                    version = specifier.substr(specifier.starts_with("===") ? 3 : 2);
+                    version.remove_prefix(std::min(version.find_first_not_of(" \t"), version.size()));
+                }
+                if (version.empty() || version.find_first_of("*,<>!~ ") != std::string_view::npos) {
+                    throw PackageManagerError(
+                        lockFileName + ": " + std::string(name) + " is not pinned to a version; "
+                        "compile the requirements with pip-compile or uv pip compile"
+                    );
+                }
+
+                if (!writer.applies(marker)) {
+                    continue;
+                }
+                for (size_t pos = options.find("--hash="); pos != std::string_view::npos; pos = options.find("--hash=", pos)) {
+                    pos += 7;
+                    const size_t end = std::min(options.find_first_of(" \t", pos), options.size());
+                    writer.addHash(options.substr(pos, end - pos));
+                }
+                writer.addPackage(name, version);
+            }
+        }
+
+        /**
+         * Read a uv.lock. It lists the packages of every platform and Python
+         * version, so the ones installed are found by following dependencies
+         * from the project whose markers apply, as uv sync does with its
+         * default of the dev group and no extras.
+         */
+        void parseUvLock(const span::toml::Node& root, TableWriter& writer, const std::string& lockFileName) {
+            std::vector<span::toml::Node> packages(root["package"].begin(), root["package"].end());
+            std::unordered_map<std::string, std::vector<size_t>> byName;
+            std::vector<size_t> projects;
+            for (size_t i = 0; i < packages.size(); ++i) {
+                byName[wheel::normalizeName(packages[i]["name"].getString())].push_back(i);
+                const auto source = packages[i]["source"];
+                if (source["virtual"].getString() == "." || source["editable"].getString() == ".") {
+                    projects.push_back(i);
+                }
+            }
+
+            std::vector<bool> reached(packages.size(), projects.empty());
+            std::unordered_set<std::string> reachedExtras;
+            std::vector<span::toml::Node> pending;
+            for (const size_t project : projects) {
+                reached[project] = true;
+                pending.push_back(packages[project]["dependencies"]);
+                pending.push_back(packages[project]["dev-dependencies"]["dev"]);
+            }
+
+            while (!pending.empty()) {
+                const span::toml::Node dependencies = pending.back();
+                pending.pop_back();
+                for (const auto dependency : dependencies) {
+                    if (!writer.applies(dependency["marker"].getString())) {
+                        continue;
+                    }
+                    const auto found = byName.find(wheel::normalizeName(dependency["name"].getString()));
+                    if (found == byName.end()) {
+                        SPAN_LOG_ERROR("No package entry for ", dependency["name"].getString(), " in ", lockFileName);
+                        continue;
+                    }
+                    // A package listed in several versions, for different platforms, is referred to with its version
+                    size_t index = found->second.front();
+                    if (const std::string_view version = dependency["version"].getString(); !version.empty()) {
+                        for (const size_t candidate : found->second) {
+                            if (packages[candidate]["version"].getString() == version) {
+                                index = candidate;
+                            }
+                        }
+                    }
+
+                    if (!reached[index]) {
+                        reached[index] = true;
+                        pending.push_back(packages[index]["dependencies"]);
+                    }
+                    for (const auto extra : dependency["extra"]) {
+                        if (reachedExtras.insert(std::to_string(index) + "[" + std::string(extra.getString())).second) {
+                            pending.push_back(packages[index]["optional-dependencies"][extra.getString()]);
+                        }
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < packages.size(); ++i) {
+                const auto& package = packages[i];
+                const auto source = package["source"];
+                if (!reached[i] || source["virtual"] || source["editable"].getString() == ".") {
+                    continue;
+                }
+                const std::string_view name = package["name"].getString();
+                if (source["editable"]) {
+                    SPAN_LOG_WARNING("Not installing ", name, ", which ", lockFileName, " lists as editable");
+                    continue;
+                }
+
+                for (const auto file : package["wheels"]) {
+                    writer.addWheel(file["url"] ? file["url"].getString() : file["path"].getString(), file["hash"].getString());
+                }
+                writer.addPackage(name, package["version"].getString(), package["wheels"].size() > 0);
+            }
+        }
+
+        /**
+         * Read a poetry.lock, whose packages carry the markers under which they are installed.
+         */
+        void parsePoetryLock(const span::toml::Node& root, TableWriter& writer, const std::string& lockFileName) {
+            // Lock files before Poetry 1.5 list files separately, by package name
+            const auto files = root["metadata"]["files"];
+
+            for (const auto package : root["package"]) {
+                const std::string_view name = package["name"].getString();
+                if (package["optional"].getString() == "true" || !writer.applies(package["markers"].getString())) {
+                    continue;
+                }
+                if (package["source"]["type"].getString() == "directory") {
+                    SPAN_LOG_WARNING("Not installing ", name, ", which ", lockFileName, " lists as a directory");
+                    continue;
+                }
+
+                const auto packageFiles = package["files"] ? package["files"] : files[name];
+                for (const auto file : packageFiles) {
+                    const std::string_view fileName = file["file"].getString();
+                    if (fileName.ends_with(".whl")) {
+                        writer.addWheel(fileName, file["hash"].getString());
+                    }
+                }
+                writer.addPackage(name, package["version"].getString(), packageFiles.size() > 0);
+            }
+        }
+
+        /**
+         * Remove an installed package: the files its RECORD lists, which are spread
+         * over site-packages next to those of other packages, and its metadata.
+         */
+        void removeRecorded(span::vfs::FileSystem& fileSystem, const fs::path& metadata) {
+            const fs::path sitePackages = metadata.parent_path();
+            const fs::path record = metadata / "RECORD";
+            if (fileSystem.exists(record)) {
+                std::vector<fs::path> directories;
+                for (const auto& entry : wheel::parseRecord(fileSystem.readFile(record))) {
+                    if (!wheel::isInsideSitePackages(entry.path)) {
+                        continue;
+                    }
+                    const fs::path path = sitePackages / entry.path;
+                    fileSystem.removeAll(path);
+                    for (fs::path parent = path.parent_path(); parent != sitePackages && parent.has_relative_path(); parent = parent.parent_path()) {
+                        directories.push_back(parent);
+                    }
+                }
+
+                // Deepest first, so that emptied directories empty their parents; leave what Python compiled since
+                std::ranges::sort(directories, std::greater{});
+                directories.erase(std::unique(directories.begin(), directories.end()), directories.end());
+                for (const auto& directory : directories) {
+                    if (fileSystem.isDirectory(directory / "__pycache__") && fileSystem.list(directory).size() == 1) {
+                        fileSystem.removeAll(directory / "__pycache__");
+                    }
+                    if (fileSystem.isEmptyDirectory(directory)) {
+                        fileSystem.removeAll(directory);
+                    }
+                }
+            }
+            fileSystem.removeAll(metadata);
+        }
+
+        /**
+         * Remove other versions of a project before installing one, as pip does, so
+         * that an upgraded environment does not list the project twice.
+         */
+        void removeOtherVersions(span::vfs::FileSystem& fileSystem, const fs::path& metadata) {
+            const std::string distInfo = metadata.filename().string();
+            const std::string name = wheel::normalizeName(distInfo.substr(0, distInfo.find('-')));
+            for (const auto& entry : fileSystem.list(metadata.parent_path())) {
+                if (entry.name != distInfo && entry.name.ends_with(DIST_INFO_SUFFIX)
+                    && wheel::normalizeName(entry.name.substr(0, entry.name.find('-'))) == name) {
+                    SPAN_LOG_DEBUG("Removing ", entry.name, " before installing ", distInfo);
+                    removeRecorded(fileSystem, metadata.parent_path() / entry.name);
+                }
+            }
+        }
+
+        /**
+         * Get the project name of a package key, from its metadata directory "<name>-<version>.dist-info".
+         */
+        std::string_view getProjectName(const std::string_view package, const std::string_view version) {
+            const std::string_view distInfo = package.substr(package.rfind('/') + 1);
+            return distInfo.substr(0, distInfo.size() - std::min(distInfo.size(), DIST_INFO_SUFFIX.size() + version.size() + 1));
+        }
+    }
+
+    Python::Python(std::shared_ptr<Cache> cache)
+        : Manager(std::move(cache)),
+          lockFileCache(LockFileCache::DEFAULT_MAX_BYTES, LockFileCache::DEFAULT_SHARD_COUNT, this->cache->getFileSystem()) {}
+
+    bool Python::isProjectType(const std::string& directory) {
+        const auto& fileSystem = getFileSystem();
+        return std::ranges::any_of(MARKER_FILES, [&](const char* file) {
+            return fileSystem.exists(fs::path(directory) / file);
+        });
+    }
+
+    std::shared_ptr<const PackageTable> Python::getInstalledVersions(
+        const std::string& directory
+    ) {
+        const auto& fileSystem = getFileSystem();
+        const auto lockFileName = std::ranges::find_if(MARKER_FILES, [&](const char* file) {
+            return fileSystem.exists(fs::path(directory) / file);
+        });
+        if (lockFileName == MARKER_FILES.end()) {
+            return PackageTable::emptyTable();
+        }
+        const fs::path lockFile = fs::path(directory) / *lockFileName;
+
+        const fs::path virtualEnv = fs::path(directory) / wheel::VIRTUAL_ENV;
+        const auto interpreter = wheel::readInterpreter(fileSystem, virtualEnv);
+        if (!interpreter) {
+            throw PackageManagerError(
+                "No virtual environment in " + virtualEnv.string() + "; create one with python3 -m venv .venv or uv venv"
+            );
+        }
+
+        const auto load = [&fileSystem, &interpreter](const fs::path& path) {
+            return parseLockFile(path, *interpreter, fileSystem);
+        };
+        auto versions = lockFileCache.get(lockFile, load);
+
+        // The lock file is cached as parsed for the environment it was first read with
+        const std::string sitePackages = wheel::getSitePackages(*interpreter);
+        if (!versions->empty() && !versions->begin()->name.starts_with(sitePackages)) {
+            lockFileCache.invalidate(lockFile);
+            versions = lockFileCache.get(lockFile, load);
+        }
+        return versions;
+    }
+
+    std::shared_ptr<const PackageTable> Python::parseLockFile(
+        const fs::path& lockFile,
+        const wheel::Interpreter& interpreter,
+        const span::vfs::FileSystem& fileSystem
+    ) {
+        const std::string lockFileName = lockFile.string();
+        span::trace::Span parse("parse", "lock", lockFileName);
+        static auto& parseLatency = span::metrics::Registry::getInstance().histogram(
+            "span_lock_parse_seconds", "Time to parse a lock file"
+        );
+        span::metrics::ScopedTimer timer(parseLatency);
+
+        try {
+            TableWriter writer(interpreter, lockFileName);
+            const std::string fileName = lockFile.filename().string();
+            if (fileName == REQUIREMENTS_FILE_NAME) {
+                parseRequirements(fileSystem.readFile(lockFile), writer, lockFileName);
+            } else {
+                const auto document = span::toml::Document::parse(fileSystem.readFile(lockFile));
+                if (fileName == POETRY_LOCK_FILE_NAME) {
+                    parsePoetryLock(document.getRoot(), writer, lockFileName);
+                } else {
+                    parseUvLock(document.getRoot(), writer, lockFileName);
+                }
+            }
+            return writer.build();
+        } catch (const span::toml::ParseError& e) {
+            throw PackageManagerError("Failed to parse lock file: " + std::string(e.what()));
+        } catch (const PackageManagerError&) {
+            throw;
+        } catch (const std::exception& e) {
+            throw PackageManagerError("Error reading lock file: " + std::string(e.what()));
+        }
+    }
+
+    bool Python::fillCache(
+        const std::string& directory,
+        const std::string_view package,
+        const std::string_view version
+    ) {
+        const auto& fileSystem = getFileSystem();
+        const auto versions = getInstalledVersions(directory);
+        const PackageTable::Entry* entry = versions->find(package);
+        const PackageTable::Source* source = entry ? versions->getSource(*entry) : nullptr;
+        if (!source) {
+            SPAN_LOG_ERROR("No entry for ", package, " in the lock file of ", directory);
+            return false;
+        }
+
+        const auto interpreter = wheel::readInterpreter(fileSystem, fs::path(directory) / wheel::VIRTUAL_ENV);
+        if (!interpreter) {
+            return false;
+        }
+        const fs::path wheelhouse = wheel::getWheelhouse(*cache);
+        const std::string_view name = getProjectName(package, version);
+
+        // Without wheels in the lock file, any wheel of this version in the wheelhouse will do
+        std::vector<std::string> candidates;
+        if (source->resolved.empty()) {
+            const std::string normalized = wheel::normalizeName(name);
+            for (const auto& file : fileSystem.list(wheelhouse)) {
+                const auto parsed = wheel::parseFileName(file.name);
+                if (parsed && parsed->version == version && wheel::normalizeName(parsed->distribution) == normalized) {
+                    candidates.push_back(file.name);
+                }
+            }
+        } else {
+            std::string_view resolved = source->resolved;
+            while (!resolved.empty()) {
+                const size_t space = std::min(resolved.find(' '), resolved.size());
+                candidates.emplace_back(resolved.substr(0, space));
+                resolved.remove_prefix(std::min(space + 1, resolved.size()));
+            }
+        }
+
+        const std::string* best = nullptr;
+        int bestCompatibility = 0;
+        for (const auto& candidate : candidates) {
+            const auto parsed = wheel::parseFileName(candidate);
+            const int compatibility = parsed ? wheel::getCompatibility(*parsed, *interpreter) : 0;
+            if (compatibility > bestCompatibility && fileSystem.exists(wheelhouse / candidate)) {
+                best = &candidate;
+                bestCompatibility = compatibility;
+            }
+        }
+        if (!best) {
+            SPAN_LOG_ERROR("No wheel of ", name, " ", version, " for this platform in ", wheelhouse.string());
+            return false;
+        }
+
+        const fs::path python = fs::path(directory) / wheel::VIRTUAL_ENV / "bin" / "python";
+        return wheel::unpackToCache(
+            *cache, getManagerName(), package, version, wheelhouse / *best, source->integrity,
+            fs::path(package).filename().string(), python
+        );
+    }
+
+    bool Python::isInstalled(std::string_view, std::string_view, const fs::path& installPath) const {
+        // RECORD is written last, by span as by pip
+        return getFileSystem().exists(installPath / "RECORD");
+    }
+
+    bool Python::linkFromCache(
+        const std::string_view package,
+        const std::string_view version,
+        const std::string& installPath
+    ) const {
+        try {
+            removeOtherVersions(getFileSystem(), installPath);
+        } catch (const fs::filesystem_error& e) {
+            SPAN_LOG_ERROR("Failed to remove other versions of ", package, ": ", e.code().message());
+            return false;
+        }
+        // The cached directory holds everything the wheel puts into site-packages
+        return cache->materializeFromCache(getManagerName(), package, version, fs::path(installPath).parent_path().string());
+    }
+
+    bool Python::linkToCache(
+        const std::string_view package,
+        const std::string_view version,
+        const std::string& installPath
+    ) const {
+        auto& fileSystem = getFileSystem();
+        if (!isCacheable(version) || fileSystem.exists(cache->getPackagePath(getManagerName(), package, version))) {
+            return true;
+        }
+
+        // Installed by pip or uv: the files its RECORD lists make up the cache entry
+        const fs::path metadata(installPath);
+        const fs::path sitePackages = metadata.parent_path();
+        return cache->addToCache(getManagerName(), package, version, [&](const fs::path& directory) {
+            for (const auto& entry : wheel::parseRecord(fileSystem.readFile(metadata / "RECORD"))) {
+                if (!wheel::isInsideSitePackages(entry.path)) {
+                    continue;
+                }
+                const fs::path target = directory / entry.path;
+                fileSystem.createDirectories(target.parent_path());
+                fileSystem.createHardLink(sitePackages / entry.path, target);
+            }
+        });
+    }
+
+    void Python::removeInstalled(const fs::path& installPath) {
+        removeRecorded(getFileSystem(), installPath);
+    }
+
+    std::string Python::getManagerName() const {
+        return "python";
+    }
+
+    std::string Python::getInstallDirectory() const {
+        return (fs::path(wheel::VIRTUAL_ENV) / "lib").string();
+    }
+
+    std::string Python::getDependencyFileName() const {
+        return DEPS_FILE_NAME;
+    }
+
+    std::vector<std::string> Python::getDependencyFiles() const {
+        return {
+            DEPS_FILE_NAME, UV_LOCK_FILE_NAME, POETRY_LOCK_FILE_NAME, REQUIREMENTS_FILE_NAME,
+            (fs::path(wheel::VIRTUAL_ENV) / "pyvenv.cfg").string()
+        };
+    }
+} // namespace dev::packages
@@ -0,0 +1,775 @@
+#include "packages/wheel.h"
+#include "packages/manager.h"
+#include "hash.h"
+#include "logger.h"
+#include "trace.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+
+namespace dev::packages::wheel {
+    namespace {
+#if defined(__linux__)
+        constexpr std::string_view SYS_PLATFORM = "linux";
+        constexpr std::string_view PLATFORM_SYSTEM = "Linux";
+#elif defined(__APPLE__)
+        constexpr std::string_view SYS_PLATFORM = "darwin";
+        constexpr std::string_view PLATFORM_SYSTEM = "Darwin";
+#else
+        constexpr std::string_view SYS_PLATFORM = "";
+        constexpr std::string_view PLATFORM_SYSTEM = "";
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+        constexpr std::string_view MACHINE = "x86_64";
+#elif (defined(__aarch64__) || defined(_M_ARM64)) && defined(__APPLE__)
+        constexpr std::string_view MACHINE = "arm64";
+#elif defined(__aarch64__) || defined(_M_ARM64)
+        constexpr std::string_view MACHINE = "aarch64";
+#elif defined(__i386__) || defined(_M_IX86)
+        constexpr std::string_view MACHINE = "i686";
+#else
+        constexpr std::string_view MACHINE = "";
+#endif
+
+        struct Version {
+            unsigned major{0};
+            unsigned minor{0};
+        };
+
+        /**
+         * Read "<major>[.<minor>]" from the start of a string, e.g. "2_17" or "312" with one digit of major.
+         */
+        std::optional<Version> parseTagVersion(const std::string_view digits) {
+            Version version;
+            if (digits.empty() || digits.find_first_not_of("0123456789") != std::string_view::npos) {
+                return std::nullopt;
+            }
+            version.major = digits[0] - '0';
+            if (digits.size() > 1) {
+                std::from_chars(digits.data() + 1, digits.data() + digits.size(), version.minor);
+            }
+            return version;
+        }
+
+        bool isPlatformCompatible(const std::string_view tag) {
+            if (tag == "any") {
+                return true;
+            }
+            if (MACHINE.empty() || !tag.ends_with(MACHINE) || tag.size() <= MACHINE.size()
+                || tag[tag.size() - MACHINE.size() - 1] != '_') {
+                // Universal macOS builds hold both architectures
+                return SYS_PLATFORM == "darwin" && tag.starts_with("macosx_") && tag.ends_with("_universal2");
+            }
+            const std::string_view prefix = tag.substr(0, tag.size() - MACHINE.size() - 1);
+
+            if (SYS_PLATFORM == "darwin") {
+                return prefix.starts_with("macosx_");
+            }
+            if (SYS_PLATFORM != "linux") {
+                return false;
+            }
+            if (prefix == "linux") {
+                return true;
+            }
+#if defined(__GLIBC__)
+            // manylinux wheels name the oldest glibc they run on; span itself needs the one it was built with
+            Version glibc;
+            if (prefix == "manylinux1") {
+                glibc = {2, 5};
+            } else if (prefix == "manylinux2010") {
+                glibc = {2, 12};
+            } else if (prefix == "manylinux2014") {
+                glibc = {2, 17};
+            } else if (prefix.starts_with("manylinux_")) {
+                const std::string_view version = prefix.substr(10);
+                const size_t separator = version.find('_');
+                if (separator == std::string_view::npos) {
+                    return false;
+                }
+                std::from_chars(version.data(), version.data() + separator, glibc.major);
+                std::from_chars(version.data() + separator + 1, version.data() + version.size(), glibc.minor);
+            } else {
+                return false;
+            }
+            return glibc.major < __GLIBC__ || (glibc.major == __GLIBC__ && glibc.minor <= __GLIBC_MINOR__);
+#else
+            return prefix.starts_with("musllinux_");
+#endif
+        }
+
+        /**
+         * Rank a python and ABI tag pair the way pip orders them for CPython.
+         * @return 0 if the interpreter cannot load the wheel
+         */
+        int getAbiScore(const std::string_view python, const std::string_view abi, const Interpreter& interpreter) {
+            const bool isCPython = python.starts_with("cp");
+            if (!isCPython && !python.starts_with("py")) {
+                return 0;
+            }
+            const auto version = parseTagVersion(python.substr(2));
+            if (!version || version->major != interpreter.major) {
+                return 0;
+            }
+            const bool hasMinor = python.size() > 3;
+            const bool exact = hasMinor && version->minor == interpreter.minor;
+
+            if (abi == "none") {
+                // cp312-none, or py3 and py3N for N up to the interpreter's minor version
+                return (isCPython ? exact : !hasMinor || version->minor <= interpreter.minor) ? 1 : 0;
+            }
+            if (!isCPython) {
+                return 0;
+            }
+            if (abi == "abi3") {
+                return hasMinor && version->minor <= interpreter.minor ? 2 : 0;
+            }
+            return exact && abi == python ? 3 : 0;
+        }
+
+        template<typename Visit>
+        void forEachTag(const std::string_view tags, Visit&& visit) {
+            size_t start = 0;
+            while (start <= tags.size()) {
+                const size_t end = std::min(tags.find('.', start), tags.size());
+                visit(tags.substr(start, end - start));
+                start = end + 1;
+            }
+        }
+
+        int compareVersions(std::string_view left, std::string_view right) {
+            while (!left.empty() || !right.empty()) {
+                unsigned leftPart = 0;
+                unsigned rightPart = 0;
+                const auto leftEnd = std::from_chars(left.data(), left.data() + left.size(), leftPart).ptr;
+                const auto rightEnd = std::from_chars(right.data(), right.data() + right.size(), rightPart).ptr;
+                if (leftPart != rightPart) {
+                    return leftPart < rightPart ? -1 : 1;
+                }
+                left.remove_prefix(leftEnd - left.data());
+                right.remove_prefix(rightEnd - right.data());
+                if (left.starts_with('.')) {
+                    left.remove_prefix(1);
+                } else {
+                    left = {};
+                }
+                if (right.starts_with('.')) {
+                    right.remove_prefix(1);
+                } else {
+                    right = {};
+                }
+            }
+            return 0;
+        }
+
+        /**
+         * Recursive descent over a marker expression. Variables this cannot
+         * know, such as platform_release, make their comparison true.
+         */
+        class MarkerParser {
+        public:
+            MarkerParser(const std::string_view text, const Interpreter& interpreter)
+                : text(text),
+                  pythonVersion(std::to_string(interpreter.major) + "." + std::to_string(interpreter.minor)),
+                  pythonFullVersion(pythonVersion + "." + std::to_string(interpreter.patch)) {}
+
+            bool parse() {
+                const bool result = parseOr();
+                skipSpaces();
+                if (pos < text.size()) {
+                    throw std::invalid_argument("unexpected '" + std::string(text.substr(pos)) + "'");
+                }
+                return result;
+            }
+
+        private:
+            struct Value {
+                std::string_view text;
+                bool known{true};
+                bool isVersion{false};
+            };
+
+            std::string_view text;
+            size_t pos{0};
+            std::string pythonVersion;
+            std::string pythonFullVersion;
+
+            void skipSpaces() {
+                while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t')) {
+                    ++pos;
+                }
+            }
+
+            bool consumeWord(const std::string_view word) {
+                skipSpaces();
+                if (text.compare(pos, word.size(), word) != 0) {
+                    return false;
+                }
+                const size_t end = pos + word.size();
+                if (end < text.size() && (std::isalnum(static_cast<unsigned char>(text[end])) || text[end] == '_')) {
+                    return false;
+                }
+                pos = end;
+                return true;
+            }
+
+            bool parseOr() {
+                bool result = parseAnd();
+                while (consumeWord("or")) {
+                    result |= parseAnd();
+                }
+                return result;
+            }
+
+            bool parseAnd() {
+                bool result = parseAtom();
+                while (consumeWord("and")) {
+                    result &= parseAtom();
+                }
+                return result;
+            }
+
+            bool parseAtom() {
+                skipSpaces();
+                if (pos < text.size() && text[pos] == '(') {
+                    ++pos;
+                    const bool result = parseOr();
+                    skipSpaces();
+                    if (pos >= text.size() || text[pos] != ')') {
+                        throw std::invalid_argument("expected ')'");
+                    }
+                    ++pos;
+                    return result;
+                }
+
+                const Value left = parseValue();
+                const std::string_view op = parseOperator();
+                const Value right = parseValue();
+                if (!left.known || !right.known) {
+                    return true;
+                }
+                return compare(left, op, right);
+            }
+
+            std::string_view parseOperator() {
+                skipSpaces();
+                for (const std::string_view op : {"===", "==", "!=", "<=", ">=", "~=", "<", ">"}) {
+                    if (text.compare(pos, op.size(), op) == 0) {
+                        pos += op.size();
+                        return op;
+                    }
+                }
+                if (consumeWord("in")) {
+                    return "in";
+                }
+                if (consumeWord("not") && consumeWord("in")) {
+                    return "not in";
+                }
+                throw std::invalid_argument("expected a comparison");
+            }
+
+            Value parseValue() {
+                skipSpaces();
+                if (pos < text.size() && (text[pos] == '"' || text[pos] == '\'')) {
+                    const char quote = text[pos];
+                    const size_t end = text.find(quote, pos + 1);
+                    if (end == std::string_view::npos) {
+                        throw std::invalid_argument("unterminated string");
+                    }
+                    const std::string_view value = text.substr(pos + 1, end - pos - 1);
+                    pos = end + 1;
+                    return {value};
+                }
+
+                const size_t start = pos;
+                while (pos < text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '_' || text[pos] == '.')) {
+                    ++pos;
+                }
+                const std::string_view name = text.substr(start, pos - start);
+                if (name == "python_version") {
+                    return {pythonVersion, true, true};
+                }
+                if (name == "python_full_version" || name == "implementation_version") {
+                    return {pythonFullVersion, true, true};
+                }
+                if (name == "os_name") {
+                    return {"posix"};
+                }
+                if (name == "sys_platform") {
+                    return {SYS_PLATFORM, !SYS_PLATFORM.empty()};
+                }
+                if (name == "platform_system") {
+                    return {PLATFORM_SYSTEM, !PLATFORM_SYSTEM.empty()};
+                }
+                if (name == "platform_machine") {
+                    return {MACHINE, !MACHINE.empty()};
+                }
+                if (name == "platform_python_implementation") {
+                    return {"CPython"};
+                }
+                if (name == "implementation_name") {
+                    return {"cpython"};
+                }
+                if (name == "extra") {
+                    return {""};
+                }
+                if (name.empty()) {
+                    throw std::invalid_argument("expected a marker variable or string");
+                }
+                return {name, false};
+            }
+
+            static bool compare(const Value& left, const std::string_view op, const Value& right) {
+                if (op == "in") {
+                    return right.text.find(left.text) != std::string_view::npos;
+                }
+                if (op == "not in") {
+                    return right.text.find(left.text) == std::string_view::npos;
+                }
+                if (op == "===" || (!left.isVersion && !right.isVersion)) {
+                    const bool equal = left.text == right.text;
+                    return op == "!=" ? !equal : op == "==" || op == "===" ? equal : false;
+                }
+
+                // "3.*" matches any 3.x
+                if (right.text.ends_with(".*") && (op == "==" || op == "!=")) {
+                    const std::string_view prefix = right.text.substr(0, right.text.size() - 1);
+                    const bool matches = left.text.starts_with(prefix) || left.text == prefix.substr(0, prefix.size() - 1);
+                    return op == "==" ? matches : !matches;
+                }
+
+                const int order = compareVersions(left.text, right.text);
+                if (op == "==") {
+                    return order == 0;
+                }
+                if (op == "!=") {
+                    return order != 0;
+                }
+                if (op == "<") {
+                    return order < 0;
+                }
+                if (op == "<=") {
+                    return order <= 0;
+                }
+                if (op == ">") {
+                    return order > 0;
+                }
+                if (op == ">=") {
+                    return order >= 0;
+                }
+                // "~= 3.8" is ">= 3.8, == 3.*"
+                const size_t last = right.text.rfind('.');
+                return order >= 0 && last != std::string_view::npos
+                    && compareVersions(left.text.substr(0, std::min(left.text.size(), last)), right.text.substr(0, last)) == 0;
+            }
+        };
+
+        fs::path findDistInfo(const span::vfs::FileSystem& fileSystem, const fs::path& directory, const fs::path& wheel) {
+            std::optional<std::string> found;
+            for (const auto& entry : fileSystem.list(directory)) {
+                if (entry.type == span::vfs::FileType::DIRECTORY && entry.name.ends_with(".dist-info")) {
+                    if (found) {
+                        throw PackageManagerError(wheel.string() + " has more than one .dist-info directory");
+                    }
+                    found = entry.name;
+                }
+            }
+            if (!found) {
+                throw PackageManagerError(wheel.string() + " has no .dist-info directory");
+            }
+            return *found;
+        }
+
+        void verifyRecord(
+            const span::vfs::FileSystem& fileSystem,
+            const fs::path& directory,
+            const std::vector<RecordEntry>& entries,
+            const fs::path& wheel
+        ) {
+            std::string integrity;
+            for (const auto& entry : entries) {
+                if (!isInsideSitePackages(entry.path)) {
+                    throw PackageManagerError(wheel.string() + " installs " + entry.path + ", outside site-packages");
+                }
+                // RECORD cannot hash itself, and signatures are added after it is written
+                if (entry.hash.empty()) {
+                    continue;
+                }
+
+                const std::string contents = fileSystem.readFile(directory / entry.path);
+                integrity.assign(entry.hash);
+                if (const size_t separator = integrity.find('='); separator != std::string::npos) {
+                    integrity[separator] = '-';
+                }
+                if ((!entry.size.empty() && entry.size != std::to_string(contents.size()))
+                    || !span::hash::matchesIntegrity(integrity, contents)) {
+                    throw PackageManagerError(wheel.string() + ": " + entry.path + " does not match its RECORD entry");
+                }
+            }
+        }
+
+        void writeRecord(span::vfs::FileSystem& fileSystem, const fs::path& path, const std::vector<RecordEntry>& entries) {
+            std::string record;
+            for (const auto& entry : entries) {
+                if (entry.path.find_first_of(",\"\n") != std::string::npos) {
+                    record += '"';
+                    for (const char c : entry.path) {
+                        record += c;
+                        if (c == '"') {
+                            record += '"';
+                        }
+                    }
+                    record += '"';
+                } else {
+                    record += entry.path;
+                }
+                record.append(1, ',').append(entry.hash).append(1, ',').append(entry.size).append(1, '\n');
+            }
+            fileSystem.writeFile(path, record);
+        }
+
+        /**
+         * Move what a wheel installs into purelib or platlib to the top, as
+         * site-packages is both. Scripts, headers and data files are dropped.
+         */
+        void flattenDataDirectory(
+            span::vfs::FileSystem& fileSystem,
+            const fs::path& directory,
+            const std::string& dataName,
+            std::vector<RecordEntry>& entries,
+            const std::string_view name
+        ) {
+            const fs::path dataDirectory = directory / dataName;
+            if (!fileSystem.isDirectory(dataDirectory)) {
+                return;
+            }
+
+            for (const auto& scheme : fileSystem.list(dataDirectory)) {
+                if (scheme.name != "purelib" && scheme.name != "platlib") {
+                    SPAN_LOG_WARNING("Not installing the ", scheme.name, " files of ", name);
+                    continue;
+                }
+                for (const auto& entry : fileSystem.list(dataDirectory / scheme.name)) {
+                    fileSystem.rename(dataDirectory / scheme.name / entry.name, directory / entry.name);
+                }
+            }
+            fileSystem.removeAll(dataDirectory);
+
+            const std::string prefix = dataName + "/";
+            std::erase_if(entries, [&](RecordEntry& entry) {
+                if (!entry.path.starts_with(prefix)) {
+                    return false;
+                }
+                for (const std::string_view scheme : {"purelib/", "platlib/"}) {
+                    if (std::string_view(entry.path).substr(prefix.size()).starts_with(scheme)) {
+                        entry.path.erase(0, prefix.size() + scheme.size());
+                        return false;
+                    }
+                }
+                return true;
+            });
+        }
+
+        /**
+         * Compile every module to bytecode now, so no project pays for it on
+         * first import. The .pyc files are hard-linked along with the sources;
+         * their timestamps still match, since the links share them.
+         */
+        void precompile(
+            span::vfs::FileSystem& fileSystem,
+            const fs::path& directory,
+            const fs::path& python,
+            std::vector<RecordEntry>& entries,
+            const std::string_view name
+        ) {
+            span::trace::Span compile("compile", "install", name);
+            const std::string command = Manager::quoteArgument(python.string()) + " -m compileall -qq "
+                + Manager::quoteArgument(directory.string());
+            SPAN_LOG_DEBUG("Running command: ", command);
+            // Like pip, keep the wheel when some module does not compile, e.g. templates in .py files
+            if (std::system(command.c_str()) != 0) {
+                SPAN_LOG_DEBUG("Not every module of ", name, " could be compiled");
+            }
+
+            fileSystem.walk(directory, [&](const fs::path& path, const span::vfs::Status& status, size_t) {
+                if (status.isFile() && path.parent_path().filename() == "__pycache__") {
+                    entries.push_back({path.lexically_relative(directory).generic_string(), {}, {}});
+                }
+            });
+        }
+    }
+
+    std::optional<Interpreter> readInterpreter(const span::vfs::FileSystem& fileSystem, const fs::path& virtualEnv) {
+        const fs::path config = virtualEnv / "pyvenv.cfg";
+        if (!fileSystem.exists(config)) {
+            return std::nullopt;
+        }
+
+        std::string contents;
+        try {
+            contents = fileSystem.readFile(config);
+        } catch (const fs::filesystem_error&) {
+            return std::nullopt;
+        }
+
+        // venv writes "version = 3.12.1", uv and virtualenv "version_info = 3.12.1"
+        const std::string_view text = contents;
+        size_t start = 0;
+        while (start < text.size()) {
+            const size_t end = std::min(text.find('\n', start), text.size());
+            const std::string_view line = text.substr(start, end - start);
+            start = end + 1;
+
+            const size_t equals = line.find('=');
+            if (equals == std::string_view::npos) {
+                continue;
+            }
+            std::string_view key = line.substr(0, equals);
+            key = key.substr(0, key.find_last_not_of(" \t") + 1);
+            if (key != "version" && key != "version_info") {
+                continue;
+            }
+
+            std::string_view value = line.substr(equals + 1);
+            value.remove_prefix(std::min(value.find_first_not_of(" \t"), value.size()));
+            Interpreter interpreter;
+            const char* valueEnd = value.data() + value.size();
+            auto result = std::from_chars(value.data(), valueEnd, interpreter.major);
+            if (result.ec != std::errc() || result.ptr == valueEnd || *result.ptr != '.') {
+                continue;
+            }
+            result = std::from_chars(result.ptr + 1, valueEnd, interpreter.minor);
+            if (result.ec != std::errc()) {
+                continue;
+            }
+            if (result.ptr != valueEnd && *result.ptr == '.') {
+                std::from_chars(result.ptr + 1, valueEnd, interpreter.patch);
+            }
+            return interpreter;
+        }
+        return std::nullopt;
+    }
+
+    std::string getSitePackages(const Interpreter& interpreter) {
+        return "python" + std::to_string(interpreter.major) + "." + std::to_string(interpreter.minor) + "/site-packages";
+    }
+
+    std::string normalizeName(const std::string_view name) {
+        std::string normalized;
+        normalized.reserve(name.size());
+        for (const char c : name) {
+            if (c == '-' || c == '_' || c == '.') {
+                if (normalized.empty() || normalized.back() != '-') {
+                    normalized += '-';
+                }
+            } else {
+                normalized += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            }
+        }
+        return normalized;
+    }
+
+    std::string getDistInfoName(const std::string_view name, const std::string_view version) {
+        std::string distInfo = normalizeName(name);
+        std::ranges::replace(distInfo, '-', '_');
+        distInfo.append(1, '-').append(version).append(".dist-info");
+        return distInfo;
+    }
+
+    std::optional<FileName> parseFileName(std::string_view fileName) {
+        if (!fileName.ends_with(".whl")) {
+            return std::nullopt;
+        }
+        fileName.remove_suffix(4);
+
+        std::array<std::string_view, 6> parts;
+        size_t count = 0;
+        size_t start = 0;
+        while (start <= fileName.size()) {
+            if (count == parts.size()) {
+                return std::nullopt;
+            }
+            const size_t end = std::min(fileName.find('-', start), fileName.size());
+            parts[count++] = fileName.substr(start, end - start);
+            start = end + 1;
+        }
+        if (count < 5) {
+            return std::nullopt;
+        }
+        // The optional build tag sits between version and tags
+        return FileName{parts[0], parts[1], parts[count - 3], parts[count - 2], parts[count - 1]};
+    }
+
+    int getCompatibility(const FileName& wheel, const Interpreter& interpreter) {
+        int best = 0;
+        forEachTag(wheel.platformTags, [&](const std::string_view platform) {
+            if (!isPlatformCompatible(platform)) {
+                return;
+            }
+            const int platformScore = platform == "any" ? 0 : 10;
+            forEachTag(wheel.pythonTags, [&](const std::string_view python) {
+                forEachTag(wheel.abiTags, [&](const std::string_view abi) {
+                    if (const int abiScore = getAbiScore(python, abi, interpreter)) {
+                        best = std::max(best, platformScore + abiScore);
+                    }
+                });
+            });
+        });
+        return best;
+    }
+
+    bool evaluateMarker(const std::string_view marker, const Interpreter& interpreter) {
+        try {
+            return MarkerParser(marker, interpreter).parse();
+        } catch (const std::invalid_argument& e) {
+            SPAN_LOG_WARNING("Cannot evaluate marker '", marker, "': ", e.what(), "; assuming it applies");
+            return true;
+        }
+    }
+
+    bool appendIntegrity(std::string& integrity, const std::string_view hash) {
+        const size_t colon = hash.find(':');
+        const auto bytes = colon == std::string_view::npos ? std::nullopt : span::hash::fromHex(hash.substr(colon + 1));
+        if (!bytes) {
+            return false;
+        }
+
+        if (!integrity.empty()) {
+            integrity += ' ';
+        }
+        integrity.append(hash.substr(0, colon)).append(1, '-').append(span::hash::toBase64(*bytes));
+        return true;
+    }
+
+    fs::path getWheelhouse(const Cache& cache) {
+        if (const char* wheelhouse = std::getenv("SPAN_WHEELHOUSE")) {
+            return wheelhouse;
+        }
+        return fs::path(cache.getCacheDir()) / "wheelhouse";
+    }
+
+    std::vector<RecordEntry> parseRecord(const std::string_view record) {
+        std::vector<RecordEntry> entries;
+        size_t pos = 0;
+        while (pos < record.size()) {
+            std::array<std::string, 3> fields;
+            size_t field = 0;
+            while (pos < record.size() && record[pos] != '\n') {
+                if (record[pos] == '"') {
+                    for (++pos; pos < record.size(); ++pos) {
+                        if (record[pos] == '"') {
+                            if (pos + 1 < record.size() && record[pos + 1] == '"') {
+                                ++pos;
+                            } else {
+                                ++pos;
+                                break;
+                            }
+                        }
+                        if (field < fields.size()) {
+                            fields[field] += record[pos];
+                        }
+                    }
+                } else if (record[pos] == ',') {
+                    ++field;
+                    ++pos;
+                } else {
+                    if (record[pos] != '\r' && field < fields.size()) {
+                        fields[field] += record[pos];
+                    }
+                    ++pos;
+                }
+            }
+            ++pos;
+            if (!fields[0].empty()) {
+                entries.push_back({std::move(fields[0]), std::move(fields[1]), std::move(fields[2])});
+            }
+        }
+        return entries;
+    }
+
+    bool isInsideSitePackages(const std::string_view path) {
+        if (path.empty() || path.front() == '/' || path.find('\\') != std::string_view::npos) {
+            return false;
+        }
+        size_t start = 0;
+        while (start <= path.size()) {
+            const size_t end = std::min(path.find('/', start), path.size());
+            if (path.substr(start, end - start) == "..") {
+                return false;
+            }
+            start = end + 1;
+        }
+        return true;
+    }
+
+    bool unpackToCache(
+        Cache& cache,
+        const std::string_view language,
+        const std::string_view name,
+        const std::string_view version,
+        const fs::path& wheel,
+        const std::string_view integrity,
+        const std::string_view distInfoName,
+        const fs::path& python
+    ) {
+        auto& fileSystem = *cache.getFileSystem();
+        if (!fileSystem.exists(wheel)) {
+            SPAN_LOG_ERROR("Wheel for ", name, " not found: ", wheel.string());
+            return false;
+        }
+
+        if (integrity.empty()) {
+            SPAN_LOG_WARNING("No hash for ", wheel.filename().string(), "; installing it unverified");
+        } else {
+            span::trace::Span verify("verify", "install", name);
+            if (!span::hash::matchesIntegrity(integrity, fileSystem.readFile(wheel))) {
+                SPAN_LOG_ERROR("Hash check failed for ", name, ": ", wheel.string());
+                return false;
+            }
+        }
+
+        // The interpreter unpacks the wheel, since a wheel is a zip file and unzip may not be installed
+        return cache.addToCache(language, name, version, [&](const fs::path& directory) {
+            {
+                span::trace::Span extract("extract", "install", name);
+                fileSystem.createDirectories(directory);
+                const std::string command = Manager::quoteArgument(python.string()) + " -m zipfile -e "
+                    + Manager::quoteArgument(wheel.string()) + " " + Manager::quoteArgument(directory.string());
+                SPAN_LOG_DEBUG("Running command: ", command);
+                if (std::system(command.c_str()) != 0) {
+                    throw PackageManagerError("Failed to extract " + wheel.string());
+                }
+            }
+
+            const std::string distInfo = findDistInfo(fileSystem, directory, wheel).string();
+            auto entries = parseRecord(fileSystem.readFile(directory / distInfo / "RECORD"));
+            {
+                span::trace::Span verify("verify", "install", name);
+                verifyRecord(fileSystem, directory, entries, wheel);
+            }
+
+            const std::string dataName = distInfo.substr(0, distInfo.size() - 10) + ".data";
+            flattenDataDirectory(fileSystem, directory, dataName, entries, name);
+
+            // Wheels built before names were normalized have e.g. PyYAML-6.0.1.dist-info
+            if (distInfo != distInfoName) {
+                fileSystem.rename(directory / distInfo, directory / distInfoName);
+                const std::string prefix = distInfo + "/";
+                for (auto& entry : entries) {
+                    if (entry.path.starts_with(prefix)) {
+                        entry.path.replace(0, distInfo.size(), distInfoName);
+                    }
+                }
+            }
+
+            const fs::path metadata = directory / distInfoName;
+            fileSystem.writeFile(metadata / "INSTALLER", "span\n");
+            entries.push_back({std::string(distInfoName) + "/INSTALLER", {}, {}});
+
+            precompile(fileSystem, directory, python, entries, name);
+            writeRecord(fileSystem, metadata / "RECORD", entries);
+        });
+    }
+} // namespace dev::packages::wheel
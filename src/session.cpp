@@ -0,0 +1,231 @@
+#include "span.h"
+#include "discovery.h"
+#include "logger.h"
+#include "metrics.h"
+#include "thread_pool.h"
+#include "packages/install_pipeline.h"
+#include "packages/install_plan.h"
+#include "packages/manager_factory.h"
+#include <filesystem>
+#include <future>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace span {
+    namespace {
+        // Absolute and without duplicates, in the order given
+        std::vector<std::string> normalizeDirectories(const std::vector<std::string>& directories) {
+            std::vector<std::string> unique;
+            std::unordered_set<std::string> seen;
+            for (const auto& directory : directories) {
+                auto absolute = fs::absolute(directory).lexically_normal().string();
+                if (seen.insert(absolute).second) {
+                    unique.push_back(std::move(absolute));
+                }
+            }
+            return unique;
+        }
+    }
+
+    Session::Session(SessionOptions options)
+        : cache(std::make_shared<dev::packages::Cache>(options.cacheDir, std::move(options.fileSystem))),
+          managers(std::make_shared<dev::packages::ManagerSet>(cache)),
+          pool(std::make_shared<threads::ThreadPool>(
+              options.concurrency ? options.concurrency : std::thread::hardware_concurrency()
+          )),
+          concurrency(options.concurrency),
+          baseline(readStats()) {
+        managers->setThreadPool(pool);
+    }
+
+    Session::~Session() = default;
+
+    void Session::addProjects(
+        dev::packages::InstallPlan& plan,
+        const std::vector<std::string>& directories,
+        Result& result
+    ) {
+        for (const auto& directory : normalizeDirectories(directories)) {
+            ProjectResult& project = result.projects.emplace_back();
+            project.directory = directory;
+
+            const auto detected = managers->detect(directory);
+            if (detected.empty()) {
+                project.success = false;
+                project.error = "No known package manager detected in " + directory;
+                continue;
+            }
+
+            const size_t before = plan.size();
+            try {
+                for (const auto& manager : detected) {
+                    plan.addProject(manager, directory);
+                }
+            } catch (const std::exception& e) {
+                project.success = false;
+                project.error = e.what();
+            }
+            project.packages = plan.size() - before;
+        }
+
+        result.packages = plan.size();
+        result.uniquePackages = plan.getUniqueCount();
+        for (const auto& project : result.projects) {
+            result.success &= project.success;
+        }
+    }
+
+    std::vector<std::string> Session::discover(
+        const std::vector<std::string>& roots,
+        const std::vector<std::string>& excludes
+    ) const {
+        return discovery::findProjects(*cache->getFileSystem(), roots, {.excludes = excludes});
+    }
+
+    Result Session::plan(const std::vector<std::string>& directories) {
+        const auto start = std::chrono::steady_clock::now();
+        Result result;
+        dev::packages::InstallPlan plan;
+        addProjects(plan, directories, result);
+        result.elapsed = std::chrono::steady_clock::now() - start;
+        return result;
+    }
+
+    Result Session::install(const std::vector<std::string>& directories) {
+        const auto start = std::chrono::steady_clock::now();
+        Result result;
+        dev::packages::InstallPipeline pipeline({.fetchConcurrency = concurrency});
+
+        // A project detected by several managers is one pipeline project per manager
+        std::vector<size_t> owners;
+        for (const auto& directory : normalizeDirectories(directories)) {
+            ProjectResult& project = result.projects.emplace_back();
+            project.directory = directory;
+
+            const auto detected = managers->detect(directory);
+            if (detected.empty()) {
+                project.success = false;
+                project.error = "No known package manager detected in " + directory;
+                continue;
+            }
+
+            for (const auto& manager : detected) {
+                owners.push_back(result.projects.size() - 1);
+                pipeline.addProject(manager, directory);
+            }
+        }
+
+        const auto report = pipeline.finish();
+        dev::Logger::flush();
+
+        for (size_t i = 0; i < report.projects.size(); ++i) {
+            const auto& installed = report.projects[i];
+            ProjectResult& project = result.projects[owners[i]];
+            project.packages += installed.packages;
+            if (!installed.error.empty()) {
+                project.success = false;
+                project.error = installed.error;
+            } else if (installed.failures) {
+                project.success = false;
+                project.error = std::to_string(installed.failures) + " dependencies could not be installed";
+            }
+        }
+
+        result.packages = report.packages;
+        result.uniquePackages = report.uniquePackages;
+        for (const auto& project : result.projects) {
+            result.success &= project.success;
+        }
+        result.elapsed = std::chrono::steady_clock::now() - start;
+        return result;
+    }
+
+    Result Session::link(const std::vector<std::string>& directories) {
+        const auto start = std::chrono::steady_clock::now();
+        Result result;
+
+        std::vector<std::future<bool>> links;
+        std::vector<size_t> owners;
+        for (const auto& directory : normalizeDirectories(directories)) {
+            ProjectResult& project = result.projects.emplace_back();
+            project.directory = directory;
+
+            const auto detected = managers->detect(directory);
+            if (detected.empty()) {
+                project.success = false;
+                project.error = "No known package manager detected in " + directory;
+                continue;
+            }
+
+            for (const auto& manager : detected) {
+                owners.push_back(result.projects.size() - 1);
+                links.push_back(pool->enqueue([manager, directory] {
+                    return manager->linkDependencies(directory);
+                }));
+            }
+        }
+
+        for (size_t i = 0; i < links.size(); ++i) {
+            ProjectResult& project = result.projects[owners[i]];
+            try {
+                if (!links[i].get()) {
+                    project.success = false;
+                    project.error = "One or more dependencies could not be linked";
+                }
+            } catch (const std::exception& e) {
+                project.success = false;
+                project.error = e.what();
+            }
+        }
+        dev::Logger::flush();
+
+        for (const auto& project : result.projects) {
+            result.success &= project.success;
+        }
+        result.elapsed = std::chrono::steady_clock::now() - start;
+        return result;
+    }
+
+    bool Session::cleanup(const size_t maxSizeBytes) {
+        return cache->cleanup(maxSizeBytes);
+    }
+
+    Stats Session::readStats() {
+        const auto& registry = metrics::Registry::getInstance();
+        return {
+            registry.getCounterValue("span_packages_total", "source=\"vendor\""),
+            registry.getCounterValue("span_packages_total", "source=\"cache\""),
+            registry.getCounterValue("span_packages_total", "source=\"fetch\""),
+            registry.getCounterValue("span_packages_total", "source=\"link\""),
+            registry.getCounterValue("span_install_failures_total"),
+            registry.getCounterValue("span_cache_hits_total"),
+            registry.getCounterValue("span_cache_misses_total"),
+            registry.getCounterValue("span_lock_cache_hits_total"),
+            registry.getCounterValue("span_lock_cache_misses_total")
+        };
+    }
+
+    Stats Session::getStats() const {
+        const Stats current = readStats();
+        return {
+            current.fromVendor - baseline.fromVendor,
+            current.fromCache - baseline.fromCache,
+            current.fetched - baseline.fetched,
+            current.symlinked - baseline.symlinked,
+            current.failures - baseline.failures,
+            current.cacheHits - baseline.cacheHits,
+            current.cacheMisses - baseline.cacheMisses,
+            current.lockFileCacheHits - baseline.lockFileCacheHits,
+            current.lockFileCacheMisses - baseline.lockFileCacheMisses
+        };
+    }
+
+    std::string Session::getMetricsJson() const {
+        return metrics::Registry::getInstance().toJson();
+    }
+
+    dev::packages::Cache& Session::getCache() const {
+        return *cache;
+    }
+} // namespace span
@@ -0,0 +1,66 @@
+#include "throttle.h"
+#include <algorithm>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace span::throttle {
+    namespace {
+#ifdef __linux__
+        // From linux/ioprio.h, which glibc does not wrap
+        constexpr int IOPRIO_WHO_PROCESS = 1;
+        constexpr int IOPRIO_CLASS_IDLE = 3;
+        constexpr int IOPRIO_CLASS_SHIFT = 13;
+#endif
+    }
+
+    TokenBucket::TokenBucket(const double rate, const double burst)
+        : rate(rate),
+          burst(std::max(burst, 0.0)),
+          tokens(this->burst),
+          updated(Clock::now()) {}
+
+    TokenBucket::Clock::duration TokenBucket::take(const double tokens) {
+        const auto delay = reserve(tokens);
+        if (delay > Clock::duration::zero()) {
+            std::this_thread::sleep_for(delay);
+        }
+        return delay;
+    }
+
+    void TokenBucket::charge(const double tokens) {
+        reserve(tokens);
+    }
+
+    TokenBucket::Clock::duration TokenBucket::reserve(const double tokens) {
+        if (!isLimited()) {
+            return Clock::duration::zero();
+        }
+
+        std::lock_guard lock(mutex);
+        const auto now = Clock::now();
+        const double earned = std::chrono::duration<double>(now - updated).count() * rate;
+        this->tokens = std::min(this->tokens + earned, burst) - tokens;
+        updated = now;
+
+        if (this->tokens >= 0) {
+            return Clock::duration::zero();
+        }
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(-this->tokens / rate));
+    }
+
+    bool lowerPriority() {
+#ifdef __linux__
+        // Both apply to the calling thread only, as Linux schedules threads on their own
+        const bool niced = ::setpriority(PRIO_PROCESS, 0, 19) == 0;
+        const bool idle = ::syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) == 0;
+        return niced && idle;
+#else
+        return false;
+#endif
+    }
+} // namespace span::throttle
@@ -0,0 +1,539 @@
+#include "toml.h"
+
+namespace span::toml {
+    namespace {
+        void appendUtf8(std::string& out, const uint32_t codePoint) {
+            if (codePoint < 0x80) {
+                out += static_cast<char>(codePoint);
+            } else if (codePoint < 0x800) {
+                out += static_cast<char>(0xc0 | (codePoint >> 6));
+                out += static_cast<char>(0x80 | (codePoint & 0x3f));
+            } else if (codePoint < 0x10000) {
+                out += static_cast<char>(0xe0 | (codePoint >> 12));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (codePoint & 0x3f));
+            } else {
+                out += static_cast<char>(0xf0 | (codePoint >> 18));
+                out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (codePoint & 0x3f));
+            }
+        }
+
+        bool isBareKeyCharacter(const char c) {
+            return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+        }
+    }
+
+    ParseError::ParseError(const std::string& message, const size_t line)
+        : std::runtime_error("line " + std::to_string(line) + ": " + message), line(line) {}
+
+    /**
+     * A single pass over the input. Table headers and dotted keys reopen
+     * tables defined earlier, so the last child of every node is tracked to
+     * append to any of them in constant time.
+     */
+    class Parser {
+    public:
+        explicit Parser(Document& document) : document(document), text(*document.text) {}
+
+        void parseDocument() {
+            document.nodes.push_back({NodeType::NONE, {}, {}});
+            lastChild.push_back(0);
+            addNode(NodeType::TABLE);
+            if (text.starts_with("\xef\xbb\xbf")) {
+                pos = 3;
+            }
+
+            uint32_t table = ROOT;
+            while (skipToContent()) {
+                if (text[pos] == '[') {
+                    table = parseHeader();
+                } else {
+                    parseKeyValue(table);
+                }
+                expectLineEnd();
+            }
+        }
+
+    private:
+        static constexpr uint32_t ROOT = 1;
+
+        Document& document;
+        std::string_view text;
+        // The last child of each node, only needed while parsing
+        std::vector<uint32_t> lastChild;
+        // Reused for every key, since keys are used up before the value after them is parsed
+        std::vector<std::string_view> keyPath;
+        size_t pos{0};
+        size_t line{1};
+
+        [[nodiscard]] ParseError error(const std::string& message) const {
+            return {message, line};
+        }
+
+        [[nodiscard]] bool isLineEnd(const size_t at) const {
+            return at >= text.size() || text[at] == '\n' || text[at] == '\r';
+        }
+
+        [[nodiscard]] bool startsWith(const std::string_view prefix) const {
+            return text.compare(pos, prefix.size(), prefix) == 0;
+        }
+
+        uint32_t addNode(const NodeType type, const std::string_view value = {}) {
+            if (document.nodes.size() >= UINT32_MAX) {
+                throw error("too many nodes");
+            }
+            document.nodes.push_back({type, {}, value});
+            lastChild.push_back(0);
+            return static_cast<uint32_t>(document.nodes.size() - 1);
+        }
+
+        void append(const uint32_t parent, const uint32_t child, const std::string_view key = {}) {
+            auto& nodes = document.nodes;
+            nodes[child].key = key;
+            if (lastChild[parent]) {
+                nodes[lastChild[parent]].next = child;
+            } else {
+                nodes[parent].first = child;
+            }
+            lastChild[parent] = child;
+            ++nodes[parent].size;
+        }
+
+        [[nodiscard]] uint32_t find(const uint32_t table, const std::string_view key) const {
+            for (uint32_t child = document.nodes[table].first; child; child = document.nodes[child].next) {
+                if (document.nodes[child].key == key) {
+                    return child;
+                }
+            }
+            return 0;
+        }
+
+        /**
+         * Get the table a dotted key or header continues in, creating it if needed.
+         * An array of tables is continued in its last table.
+         */
+        uint32_t descend(const uint32_t table, const std::string_view key) {
+            uint32_t child = find(table, key);
+            if (!child) {
+                child = addNode(NodeType::TABLE);
+                append(table, child, key);
+                return child;
+            }
+            if (document.nodes[child].type == NodeType::ARRAY && lastChild[child]) {
+                child = lastChild[child];
+            }
+            if (document.nodes[child].type != NodeType::TABLE) {
+                throw error("'" + std::string(key) + "' is not a table");
+            }
+            return child;
+        }
+
+        void skipSpaces() {
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t')) {
+                ++pos;
+            }
+        }
+
+        void skipComment() {
+            while (pos < text.size() && text[pos] != '\n') {
+                ++pos;
+            }
+        }
+
+        /**
+         * Move to the next character that is not whitespace, a line break or a comment.
+         * @return False at the end of the input
+         */
+        bool skipToContent() {
+            while (pos < text.size()) {
+                const char c = text[pos];
+                if (c == ' ' || c == '\t' || c == '\r') {
+                    ++pos;
+                } else if (c == '\n') {
+                    ++pos;
+                    ++line;
+                } else if (c == '#') {
+                    skipComment();
+                } else {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void expectLineEnd() {
+            skipSpaces();
+            if (pos < text.size() && text[pos] == '#') {
+                skipComment();
+            }
+            if (!isLineEnd(pos)) {
+                throw error("unexpected content after a value");
+            }
+        }
+
+        /**
+         * Parse "[table]" or "[[array.of.tables]]".
+         * @return The table that the key/value pairs below it go into
+         */
+        uint32_t parseHeader() {
+            const bool arrayOfTables = startsWith("[[");
+            pos += arrayOfTables ? 2 : 1;
+            skipSpaces();
+            parseKeyPath();
+            if (!startsWith(arrayOfTables ? "]]" : "]")) {
+                throw error(arrayOfTables ? "expected ']]' after a table header" : "expected ']' after a table header");
+            }
+            pos += arrayOfTables ? 2 : 1;
+
+            uint32_t table = ROOT;
+            for (size_t i = 0; i + 1 < keyPath.size(); ++i) {
+                table = descend(table, keyPath[i]);
+            }
+            const std::string_view key = keyPath.back();
+            const uint32_t existing = find(table, key);
+
+            if (arrayOfTables) {
+                uint32_t array = existing;
+                if (!array) {
+                    array = addNode(NodeType::ARRAY);
+                    append(table, array, key);
+                } else if (document.nodes[array].type != NodeType::ARRAY) {
+                    throw error("'" + std::string(key) + "' is not an array of tables");
+                }
+                const uint32_t item = addNode(NodeType::TABLE);
+                append(array, item);
+                return item;
+            }
+
+            // A table created by a dotted key or a deeper header may be defined afterwards
+            if (existing) {
+                if (document.nodes[existing].type != NodeType::TABLE) {
+                    throw error("'" + std::string(key) + "' is already defined");
+                }
+                return existing;
+            }
+            const uint32_t item = addNode(NodeType::TABLE);
+            append(table, item, key);
+            return item;
+        }
+
+        /**
+         * Parse "key = value", where the key may be dotted, into a table.
+         */
+        void parseKeyValue(uint32_t table) {
+            parseKeyPath();
+            if (pos >= text.size() || text[pos] != '=') {
+                throw error("expected '=' after a key");
+            }
+            ++pos;
+            skipSpaces();
+
+            for (size_t i = 0; i + 1 < keyPath.size(); ++i) {
+                table = descend(table, keyPath[i]);
+            }
+            const std::string_view key = keyPath.back();
+            if (find(table, key)) {
+                throw error("duplicate key '" + std::string(key) + "'");
+            }
+            append(table, parseValue(), key);
+        }
+
+        /**
+         * Parse a key of one or more parts separated by dots into keyPath,
+         * leaving the position after the spaces that follow it.
+         */
+        void parseKeyPath() {
+            keyPath.clear();
+            while (true) {
+                if (pos >= text.size()) {
+                    throw error("expected a key");
+                }
+                if (text[pos] == '"' || text[pos] == '\'') {
+                    if (startsWith("\"\"\"") || startsWith("'''")) {
+                        throw error("keys cannot be multi-line strings");
+                    }
+                    keyPath.push_back(parseString());
+                } else {
+                    const size_t start = pos;
+                    while (pos < text.size() && isBareKeyCharacter(text[pos])) {
+                        ++pos;
+                    }
+                    if (pos == start) {
+                        throw error("expected a key");
+                    }
+                    keyPath.push_back(text.substr(start, pos - start));
+                }
+
+                skipSpaces();
+                if (pos >= text.size() || text[pos] != '.') {
+                    return;
+                }
+                ++pos;
+                skipSpaces();
+            }
+        }
+
+        uint32_t parseValue() {
+            if (pos >= text.size()) {
+                throw error("expected a value");
+            }
+            switch (text[pos]) {
+                case '"':
+                case '\'':
+                    return addNode(NodeType::VALUE, parseString());
+                case '[':
+                    return parseArray();
+                case '{':
+                    return parseInlineTable();
+                default:
+                    break;
+            }
+
+            // Numbers, booleans and dates
+            const size_t start = pos;
+            while (!isLineEnd(pos) && text[pos] != ' ' && text[pos] != '\t' && text[pos] != ','
+                && text[pos] != ']' && text[pos] != '}' && text[pos] != '#') {
+                ++pos;
+                // A space may separate the date and time of a date-time, e.g. "1979-05-27 07:32:00"
+                if (pos - start == 10 && text[start + 4] == '-' && text[start + 7] == '-'
+                    && pos + 1 < text.size() && text[pos] == ' ' && text[pos + 1] >= '0' && text[pos + 1] <= '9') {
+                    ++pos;
+                }
+            }
+            if (pos == start) {
+                throw error("expected a value");
+            }
+            return addNode(NodeType::VALUE, text.substr(start, pos - start));
+        }
+
+        uint32_t parseArray() {
+            const uint32_t node = addNode(NodeType::ARRAY);
+            ++pos;
+
+            while (true) {
+                if (!skipToContent()) {
+                    throw error("unterminated array");
+                }
+                if (text[pos] == ']') {
+                    ++pos;
+                    return node;
+                }
+
+                append(node, parseValue());
+
+                if (!skipToContent()) {
+                    throw error("unterminated array");
+                }
+                if (text[pos] == ',') {
+                    ++pos;
+                } else if (text[pos] != ']') {
+                    throw error("expected ',' or ']' in an array");
+                }
+            }
+        }
+
+        // Line breaks inside inline tables are accepted, as TOML 1.1 allows
+        uint32_t parseInlineTable() {
+            const uint32_t node = addNode(NodeType::TABLE);
+            ++pos;
+
+            while (true) {
+                if (!skipToContent()) {
+                    throw error("unterminated inline table");
+                }
+                if (text[pos] == '}') {
+                    ++pos;
+                    return node;
+                }
+
+                parseKeyValue(node);
+
+                if (!skipToContent()) {
+                    throw error("unterminated inline table");
+                }
+                if (text[pos] == ',') {
+                    ++pos;
+                } else if (text[pos] != '}') {
+                    throw error("expected ',' or '}' in an inline table");
+                }
+            }
+        }
+
+        /**
+         * Parse a basic, literal or multi-line string.
+         * @return A view into the input, or into the document's copy if it had escapes
+         */
+        std::string_view parseString() {
+            const char quote = text[pos];
+            const bool multiLine = startsWith(quote == '"' ? "\"\"\"" : "'''");
+            pos += multiLine ? 3 : 1;
+
+            // A line break right after the opening delimiter is not part of the string
+            if (multiLine && startsWith("\r\n")) {
+                pos += 2;
+                ++line;
+            } else if (multiLine && startsWith("\n")) {
+                ++pos;
+                ++line;
+            }
+
+            const size_t start = pos;
+            bool escaped = false;
+            while (true) {
+                if (pos >= text.size() || (!multiLine && isLineEnd(pos))) {
+                    throw error("unterminated string");
+                }
+                const char c = text[pos];
+                if (c == quote && (!multiLine || (startsWith(quote == '"' ? "\"\"\"" : "'''")))) {
+                    break;
+                }
+                if (c == '\\' && quote == '"') {
+                    escaped = true;
+                    ++pos;
+                    if (pos < text.size() && text[pos] == '\n') {
+                        ++line;
+                    }
+                } else if (c == '\n') {
+                    ++line;
+                }
+                ++pos;
+            }
+
+            size_t end = pos;
+            if (multiLine) {
+                // Up to two quotes may end the string right before its closing delimiter
+                while (end + 3 < text.size() && text[end + 3] == quote && end - pos < 2) {
+                    ++end;
+                }
+                pos = end + 3;
+            } else {
+                ++pos;
+            }
+
+            const std::string_view raw = text.substr(start, end - start);
+            if (!escaped) {
+                return raw;
+            }
+            return document.unescaped.emplace_back(unescape(raw));
+        }
+
+        [[nodiscard]] std::string unescape(const std::string_view raw) const {
+            std::string value;
+            value.reserve(raw.size());
+            for (size_t i = 0; i < raw.size(); ++i) {
+                if (raw[i] != '\\') {
+                    value += raw[i];
+                    continue;
+                }
+
+                const char escape = raw[++i];
+                size_t digits = 0;
+                switch (escape) {
+                    case 'b': value += '\b'; break;
+                    case 't': value += '\t'; break;
+                    case 'n': value += '\n'; break;
+                    case 'f': value += '\f'; break;
+                    case 'r': value += '\r'; break;
+                    case 'e': value += '\x1b'; break;
+                    case '"': value += '"'; break;
+                    case '\\': value += '\\'; break;
+                    case 'x': digits = 2; break;
+                    case 'u': digits = 4; break;
+                    case 'U': digits = 8; break;
+                    case ' ':
+                    case '\t':
+                    case '\r':
+                    case '\n': {
+                        // A backslash ending a line of a multi-line string trims the whitespace after it
+                        size_t next = i;
+                        while (next < raw.size() && (raw[next] == ' ' || raw[next] == '\t' || raw[next] == '\r')) {
+                            ++next;
+                        }
+                        if (next >= raw.size() || raw[next] != '\n') {
+                            throw error("unknown escape \\" + std::string(1, escape));
+                        }
+                        while (next < raw.size() && (raw[next] == ' ' || raw[next] == '\t' || raw[next] == '\r' || raw[next] == '\n')) {
+                            ++next;
+                        }
+                        i = next - 1;
+                        break;
+                    }
+                    default:
+                        throw error(std::string("unknown escape \\") + escape);
+                }
+                if (digits == 0) {
+                    continue;
+                }
+
+                if (i + digits >= raw.size()) {
+                    throw error("truncated escape");
+                }
+                uint32_t codePoint = 0;
+                for (size_t j = 1; j <= digits; ++j) {
+                    const char digit = raw[i + j];
+                    codePoint <<= 4;
+                    if (digit >= '0' && digit <= '9') {
+                        codePoint |= digit - '0';
+                    } else if (digit >= 'a' && digit <= 'f') {
+                        codePoint |= digit - 'a' + 10;
+                    } else if (digit >= 'A' && digit <= 'F') {
+                        codePoint |= digit - 'A' + 10;
+                    } else {
+                        throw error("invalid hex digit in an escape");
+                    }
+                }
+                i += digits;
+                appendUtf8(value, codePoint);
+            }
+            return value;
+        }
+    };
+
+    Document Document::parse(std::string text) {
+        Document document;
+        document.text = std::make_unique<const std::string>(std::move(text));
+        // Roughly one node per line
+        document.nodes.reserve(document.text->size() / 32 + 2);
+        Parser(document).parseDocument();
+        return document;
+    }
+
+    NodeType Node::getType() const {
+        return document ? document->nodes[index].type : NodeType::NONE;
+    }
+
+    std::string_view Node::getString() const {
+        return isValue() ? document->nodes[index].value : std::string_view();
+    }
+
+    std::string_view Node::getKey() const {
+        return document ? document->nodes[index].key : std::string_view();
+    }
+
+    size_t Node::size() const {
+        return document ? document->nodes[index].size : 0;
+    }
+
+    Node Node::operator[](const std::string_view key) const {
+        if (!isTable()) {
+            return {document, 0};
+        }
+        for (uint32_t child = document->nodes[index].first; child; child = document->nodes[child].next) {
+            if (document->nodes[child].key == key) {
+                return {document, child};
+            }
+        }
+        return {document, 0};
+    }
+
+    Node::Iterator Node::begin() const {
+        return {document, document ? document->nodes[index].first : 0};
+    }
+
+    Node::Iterator& Node::Iterator::operator++() {
+        index = document->nodes[index].next;
+        return *this;
+    }
+} // namespace span::toml
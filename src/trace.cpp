@@ -0,0 +1,165 @@
+#include "trace.h"
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unistd.h>
+
+namespace span::trace {
+    std::atomic<bool> Tracer::enabled{false};
+
+    namespace {
+        struct Event {
+            const char* name;
+            const char* category;
+            int64_t startNs;
+            int64_t durationNs;
+            uint32_t detailOffset;
+            uint32_t detailLength;
+        };
+
+        struct ThreadBuffer {
+            // Only contended while the trace is being written
+            std::mutex mutex;
+            uint32_t tid{0};
+            std::string threadName;
+            std::vector<Event> events;
+            // Details of all events, so recording does not allocate per event
+            std::string details;
+        };
+
+        struct Registry {
+            std::mutex mutex;
+            std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+            std::string outputFile;
+            const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        };
+
+        Registry& getRegistry() {
+            static Registry registry;
+            return registry;
+        }
+
+        ThreadBuffer& getThreadBuffer() {
+            // The registry keeps buffers alive after their thread exits
+            thread_local const std::shared_ptr<ThreadBuffer> buffer = [] {
+                auto created = std::make_shared<ThreadBuffer>();
+                created->events.reserve(1024);
+
+                auto& registry = getRegistry();
+                std::lock_guard lock(registry.mutex);
+                created->tid = static_cast<uint32_t>(registry.buffers.size() + 1);
+                registry.buffers.push_back(created);
+                return created;
+            }();
+            return *buffer;
+        }
+
+        void writeEscaped(std::ostream& out, const std::string_view value) {
+            for (const char c : value) {
+                switch (c) {
+                    case '"': out << "\\\""; break;
+                    case '\\': out << "\\\\"; break;
+                    case '\n': out << "\\n"; break;
+                    case '\t': out << "\\t"; break;
+                    default:
+                        if (static_cast<unsigned char>(c) >= 0x20) {
+                            out << c;
+                        }
+                }
+            }
+        }
+    }
+
+    void Tracer::enable(const std::string& outputFile) {
+        auto& registry = getRegistry();
+        {
+            std::lock_guard lock(registry.mutex);
+            registry.outputFile = outputFile;
+        }
+        enabled.store(true, std::memory_order_relaxed);
+        setThreadName("main");
+    }
+
+    void Tracer::setThreadName(const std::string_view name) {
+        if (!isEnabled()) {
+            return;
+        }
+        auto& buffer = getThreadBuffer();
+        std::lock_guard lock(buffer.mutex);
+        buffer.threadName = name;
+    }
+
+    void Tracer::record(
+        const char* name,
+        const char* category,
+        const std::string_view detail,
+        const std::chrono::steady_clock::time_point start,
+        const std::chrono::steady_clock::time_point end
+    ) {
+        const auto epoch = getRegistry().epoch;
+        auto& buffer = getThreadBuffer();
+
+        std::lock_guard lock(buffer.mutex);
+        buffer.events.push_back({
+            name,
+            category,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch).count(),
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+            static_cast<uint32_t>(buffer.details.size()),
+            static_cast<uint32_t>(detail.size())
+        });
+        buffer.details.append(detail);
+    }
+
+    void Tracer::flush() {
+        if (!isEnabled()) {
+            return;
+        }
+
+        auto& registry = getRegistry();
+        std::lock_guard registryLock(registry.mutex);
+
+        std::ofstream out(registry.outputFile);
+        if (!out) {
+            return;
+        }
+
+        const auto pid = ::getpid();
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+        bool first = true;
+        for (const auto& buffer : registry.buffers) {
+            std::lock_guard lock(buffer->mutex);
+
+            if (!buffer->threadName.empty()) {
+                out << (first ? "\n" : ",\n")
+                    << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+                    << ",\"args\":{\"name\":\"";
+                writeEscaped(out, buffer->threadName);
+                out << "\"}}";
+                first = false;
+            }
+
+            for (const Event& event : buffer->events) {
+                // Chrome trace timestamps are microseconds; keep sub-microsecond precision
+                out << (first ? "\n" : ",\n")
+                    << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+                    << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+                    << ",\"ts\":" << static_cast<double>(event.startNs) / 1000.0
+                    << ",\"dur\":" << static_cast<double>(event.durationNs) / 1000.0;
+                if (event.detailLength > 0) {
+                    out << ",\"args\":{\"detail\":\"";
+                    writeEscaped(out, std::string_view(buffer->details).substr(event.detailOffset, event.detailLength));
+                    out << "\"}";
+                }
+                out << "}";
+                first = false;
+            }
+        }
+
+        out << "\n]}\n";
+    }
+} // namespace span::trace
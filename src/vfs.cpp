@@ -0,0 +1,742 @@
+#include "vfs.h"
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace span::vfs {
+    namespace {
+        void walkDirectory(
+            const FileSystem& fileSystem,
+            const fs::path& directory,
+            const size_t depth,
+            const FileSystem::Visitor& visitor
+        ) {
+            for (const auto& entry : fileSystem.list(directory)) {
+                const fs::path path = directory / entry.name;
+                const Status status = fileSystem.symlinkStatus(path);
+                if (!status.exists()) {
+                    continue;
+                }
+                visitor(path, status, depth);
+                if (status.isDirectory()) {
+                    walkDirectory(fileSystem, path, depth + 1, visitor);
+                }
+            }
+        }
+
+        [[noreturn]] void fail(const char* operation, const fs::path& path, const std::errc error) {
+            throw fs::filesystem_error(operation, path, std::make_error_code(error));
+        }
+
+#ifndef _WIN32
+        fs::file_time_type toFileTime(const timespec& time) {
+            const auto sinceEpoch = std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+            return fs::file_time_type::clock::from_sys(
+                std::chrono::system_clock::time_point(
+                    std::chrono::duration_cast<std::chrono::system_clock::duration>(sinceEpoch)
+                )
+            );
+        }
+
+        Status toStatus(const struct stat& info) {
+            Status status;
+            if (S_ISDIR(info.st_mode)) {
+                status.type = FileType::DIRECTORY;
+            } else if (S_ISLNK(info.st_mode)) {
+                status.type = FileType::SYMLINK;
+            } else {
+                status.type = FileType::FILE;
+            }
+            status.size = static_cast<uintmax_t>(info.st_size);
+            status.modified = toFileTime(info.st_mtim);
+            status.accessed = toFileTime(info.st_atim);
+            return status;
+        }
+#else
+        Status toStatus(const fs::path& path, const fs::file_status& fileStatus) {
+            std::error_code error;
+            Status status;
+            switch (fileStatus.type()) {
+                case fs::file_type::not_found:
+                case fs::file_type::none:
+                    return status;
+                case fs::file_type::directory: status.type = FileType::DIRECTORY; break;
+                case fs::file_type::symlink: status.type = FileType::SYMLINK; break;
+                default: status.type = FileType::FILE; break;
+            }
+            if (status.type == FileType::FILE) {
+                status.size = fs::file_size(path, error);
+            }
+            status.modified = fs::last_write_time(path, error);
+            status.accessed = status.modified;
+            return status;
+        }
+#endif
+
+        // Start of the key range holding a directory's subtree
+        std::string getChildPrefix(const std::string_view key) {
+            return key == "/" ? std::string("/") : std::string(key) + "/";
+        }
+
+        // '0' sorts right after '/', so this bounds every key below a directory
+        std::string getSubtreeEnd(const std::string_view key) {
+            return key == "/" ? std::string("0") : std::string(key) + "0";
+        }
+
+        std::string join(const std::string_view directory, const std::string_view name) {
+            std::string result(directory);
+            if (result != "/") {
+                result += '/';
+            }
+            result.append(name);
+            return result;
+        }
+
+        // Whether a path has no empty, "." or ".." components, which is most of
+        // them; lexically_normal costs more than the map lookup it precedes
+        bool isNormal(const std::string_view path) {
+            size_t start = path.starts_with('/') ? 1 : 0;
+            while (start < path.size()) {
+                size_t end = path.find('/', start);
+                if (end == std::string_view::npos) {
+                    end = path.size();
+                }
+                const std::string_view component = path.substr(start, end - start);
+                if (component.empty() || component == "." || component == "..") {
+                    return false;
+                }
+                start = end + 1;
+            }
+            return true;
+        }
+
+        std::pair<std::string_view, std::string_view> splitParent(const std::string_view key) {
+            const size_t separator = key.rfind('/');
+            return {separator == 0 ? std::string_view("/") : key.substr(0, separator), key.substr(separator + 1)};
+        }
+    }
+
+    void FileSystem::walk(const fs::path& root, const Visitor& visitor) const {
+        walkDirectory(*this, root, 0, visitor);
+    }
+
+    // PosixFileSystem
+
+    Status PosixFileSystem::status(const fs::path& path) const {
+#ifndef _WIN32
+        struct stat info{};
+        if (::stat(path.c_str(), &info) != 0) {
+            return {};
+        }
+        return toStatus(info);
+#else
+        std::error_code error;
+        return toStatus(path, fs::status(path, error));
+#endif
+    }
+
+    Status PosixFileSystem::symlinkStatus(const fs::path& path) const {
+#ifndef _WIN32
+        struct stat info{};
+        if (::lstat(path.c_str(), &info) != 0) {
+            return {};
+        }
+        return toStatus(info);
+#else
+        std::error_code error;
+        return toStatus(path, fs::symlink_status(path, error));
+#endif
+    }
+
+    fs::path PosixFileSystem::readSymlink(const fs::path& path) const {
+        std::error_code error;
+        fs::path target = fs::read_symlink(path, error);
+        return error ? fs::path() : target;
+    }
+
+    bool PosixFileSystem::isEmptyDirectory(const fs::path& path) const {
+        std::error_code error;
+        return fs::is_directory(path, error) && fs::is_empty(path, error) && !error;
+    }
+
+    std::vector<DirectoryEntry> PosixFileSystem::list(const fs::path& directory) const {
+        std::vector<DirectoryEntry> entries;
+        std::error_code error;
+        for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+            // The entry type usually comes from the directory listing, without a stat
+            FileType type = FileType::FILE;
+            if (it->is_symlink(error)) {
+                type = FileType::SYMLINK;
+            } else if (it->is_directory(error)) {
+                type = FileType::DIRECTORY;
+            }
+            entries.push_back({it->path().filename().string(), type});
+        }
+        return entries;
+    }
+
+    void PosixFileSystem::createDirectories(const fs::path& path) {
+        fs::create_directories(path);
+    }
+
+    void PosixFileSystem::createSymlink(const fs::path& target, const fs::path& link) {
+        fs::create_symlink(target, link);
+    }
+
+    void PosixFileSystem::createHardLink(const fs::path& target, const fs::path& link) {
+        fs::create_hard_link(target, link);
+    }
+
+    uintmax_t PosixFileSystem::removeAll(const fs::path& path) {
+        return fs::remove_all(path);
+    }
+
+    void PosixFileSystem::rename(const fs::path& from, const fs::path& to) {
+        fs::rename(from, to);
+    }
+
+    std::string PosixFileSystem::readFile(const fs::path& path, const size_t padding) const {
+#ifndef _WIN32
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw fs::filesystem_error("read_file", path, std::error_code(errno, std::generic_category()));
+        }
+
+        struct stat info{};
+        ::fstat(fd, &info);
+
+        std::string contents;
+        contents.reserve(static_cast<size_t>(info.st_size) + padding);
+        contents.resize(static_cast<size_t>(info.st_size));
+
+        size_t total = 0;
+        while (true) {
+            if (total == contents.size()) {
+                // The file grew since fstat; keep reading
+                contents.resize(contents.size() + 4096);
+            }
+            const ssize_t count = ::read(fd, contents.data() + total, contents.size() - total);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count < 0) {
+                const int error = errno;
+                ::close(fd);
+                throw fs::filesystem_error("read_file", path, std::error_code(error, std::generic_category()));
+            }
+            if (count == 0) {
+                break;
+            }
+            total += static_cast<size_t>(count);
+        }
+        ::close(fd);
+
+        contents.resize(total);
+        if (contents.capacity() < total + padding) {
+            contents.reserve(total + padding);
+        }
+        return contents;
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            fail("read_file", path, std::errc::no_such_file_or_directory);
+        }
+        std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        contents.reserve(contents.size() + padding);
+        return contents;
+#endif
+    }
+
+    void PosixFileSystem::writeFile(const fs::path& path, const std::string_view contents) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out || !out.write(contents.data(), static_cast<std::streamsize>(contents.size()))) {
+            fail("write_file", path, std::errc::io_error);
+        }
+    }
+
+    // MemoryFileSystem
+
+    MemoryFileSystem::MemoryFileSystem() {
+        const auto now = fs::file_time_type::clock::now();
+        nodes.emplace("/", Node{FileType::DIRECTORY, 0, now, now, {}, false});
+    }
+
+    std::string MemoryFileSystem::normalize(const fs::path& path) {
+        std::string key = path.generic_string();
+        if (!isNormal(key)) {
+            key = path.lexically_normal().generic_string();
+        }
+        if (key.empty() || key.front() != '/') {
+            key.insert(0, "/");
+        }
+        while (key.size() > 1 && key.back() == '/') {
+            key.pop_back();
+        }
+        return key;
+    }
+
+    std::optional<std::string> MemoryFileSystem::resolve(const std::string_view key, const bool followLast) const {
+        // Entries are only created below resolved directories, so a key that
+        // exists as is has no symlinks among its parents
+        if (const auto it = nodes.find(key);
+            it != nodes.end() && (it->second.type != FileType::SYMLINK || !followLast)) {
+            return std::string(key);
+        }
+
+        constexpr int maxLinks = 40;
+        int links = 0;
+
+        std::string pending(key);
+        std::string current = "/";
+        size_t position = 1;
+
+        while (position < pending.size()) {
+            size_t end = pending.find('/', position);
+            if (end == std::string::npos) {
+                end = pending.size();
+            }
+            const std::string_view component = std::string_view(pending).substr(position, end - position);
+            const bool last = end >= pending.size();
+            std::string candidate = join(current, component);
+
+            const auto it = nodes.find(candidate);
+            if (it == nodes.end()) {
+                if (!last) {
+                    return std::nullopt;
+                }
+                return candidate;
+            }
+
+            if (it->second.type == FileType::SYMLINK && (!last || followLast)) {
+                if (++links > maxLinks) {
+                    return std::nullopt;
+                }
+                const std::string& target = it->second.data;
+                std::string combined = target.starts_with('/') ? target : join(current, target);
+                if (!last) {
+                    combined.append(pending, end);
+                }
+                pending = normalize(combined);
+                current = "/";
+                position = 1;
+                continue;
+            }
+
+            if (!last && it->second.type != FileType::DIRECTORY) {
+                return std::nullopt;
+            }
+
+            current = std::move(candidate);
+            position = end + 1;
+        }
+
+        return current;
+    }
+
+    std::string MemoryFileSystem::resolveForCreate(const fs::path& path, const char* operation) const {
+        const std::string key = normalize(path);
+        if (key == "/") {
+            fail(operation, path, std::errc::file_exists);
+        }
+
+        const auto [parentKey, name] = splitParent(key);
+        const auto parent = resolve(parentKey, true);
+        if (!parent) {
+            fail(operation, path, std::errc::no_such_file_or_directory);
+        }
+        const auto it = nodes.find(*parent);
+        if (it == nodes.end()) {
+            fail(operation, path, std::errc::no_such_file_or_directory);
+        }
+        if (it->second.type != FileType::DIRECTORY) {
+            fail(operation, path, std::errc::not_a_directory);
+        }
+        return join(*parent, name);
+    }
+
+    Status MemoryFileSystem::toStatus(const Node& node) {
+        Status status;
+        status.type = node.type;
+        status.size = node.size;
+        status.modified = node.modified;
+        status.accessed = node.accessed;
+        return status;
+    }
+
+    MemoryFileSystem::Nodes::const_iterator MemoryFileSystem::findResolved(
+        const fs::path& path,
+        const bool followLast
+    ) const {
+        const auto resolved = resolve(normalize(path), followLast);
+        return resolved ? nodes.find(*resolved) : nodes.end();
+    }
+
+    Status MemoryFileSystem::status(const fs::path& path) const {
+        std::shared_lock lock(mutex);
+        const auto it = findResolved(path, true);
+        return it == nodes.end() ? Status{} : toStatus(it->second);
+    }
+
+    Status MemoryFileSystem::symlinkStatus(const fs::path& path) const {
+        std::shared_lock lock(mutex);
+        const auto it = findResolved(path, false);
+        return it == nodes.end() ? Status{} : toStatus(it->second);
+    }
+
+    fs::path MemoryFileSystem::readSymlink(const fs::path& path) const {
+        std::shared_lock lock(mutex);
+        const auto it = findResolved(path, false);
+        return it == nodes.end() || it->second.type != FileType::SYMLINK ? fs::path() : fs::path(it->second.data);
+    }
+
+    bool MemoryFileSystem::isEmptyDirectory(const fs::path& path) const {
+        std::shared_lock lock(mutex);
+        const auto it = findResolved(path, true);
+        if (it == nodes.end() || it->second.type != FileType::DIRECTORY) {
+            return false;
+        }
+        const std::string prefix = getChildPrefix(it->first);
+        const auto first = it->first == "/" ? nodes.upper_bound("/") : nodes.lower_bound(prefix);
+        return first == nodes.end() || !first->first.starts_with(prefix);
+    }
+
+    std::vector<DirectoryEntry> MemoryFileSystem::list(const fs::path& directory) const {
+        std::shared_lock lock(mutex);
+        std::vector<DirectoryEntry> entries;
+
+        const auto it = findResolved(directory, true);
+        if (it == nodes.end() || it->second.type != FileType::DIRECTORY) {
+            return entries;
+        }
+
+        const std::string prefix = getChildPrefix(it->first);
+        auto child = it->first == "/" ? nodes.upper_bound("/") : nodes.lower_bound(prefix);
+        while (child != nodes.end() && child->first.starts_with(prefix)) {
+            const std::string_view name = std::string_view(child->first).substr(prefix.size());
+            if (const size_t separator = name.find('/'); separator != std::string_view::npos) {
+                // Inside a child's subtree; siblings such as "b-x" sort before "b/",
+                // so the subtree is skipped when reached rather than after its root
+                child = nodes.lower_bound(getSubtreeEnd(prefix + std::string(name.substr(0, separator))));
+                continue;
+            }
+            entries.push_back({std::string(name), child->second.type});
+            ++child;
+        }
+        return entries;
+    }
+
+    void MemoryFileSystem::walk(const fs::path& root, const Visitor& visitor) const {
+        // Collected first, so the visitor may call back into this filesystem
+        std::vector<std::pair<std::string, Status>> entries;
+        {
+            std::shared_lock lock(mutex);
+            const auto it = findResolved(root, true);
+            if (it == nodes.end() || it->second.type != FileType::DIRECTORY) {
+                return;
+            }
+
+            const std::string prefix = getChildPrefix(it->first);
+            const auto end = nodes.lower_bound(getSubtreeEnd(it->first));
+            for (auto child = it->first == "/" ? nodes.upper_bound("/") : nodes.lower_bound(prefix); child != end; ++child) {
+                entries.emplace_back(child->first.substr(prefix.size()), toStatus(child->second));
+            }
+        }
+
+        for (const auto& [relative, status] : entries) {
+            visitor(root / relative, status, static_cast<size_t>(std::ranges::count(relative, '/')));
+        }
+    }
+
+    void MemoryFileSystem::createDirectories(const fs::path& path) {
+        std::unique_lock lock(mutex);
+        const std::string key = normalize(path);
+        const auto now = fs::file_time_type::clock::now();
+
+        std::string current = "/";
+        size_t position = 1;
+        while (position < key.size()) {
+            size_t end = key.find('/', position);
+            if (end == std::string::npos) {
+                end = key.size();
+            }
+
+            const auto resolved = resolve(join(current, std::string_view(key).substr(position, end - position)), true);
+            if (!resolved) {
+                fail("create_directories", path, std::errc::too_many_symbolic_link_levels);
+            }
+
+            const auto it = nodes.find(*resolved);
+            if (it == nodes.end()) {
+                nodes.emplace(*resolved, Node{FileType::DIRECTORY, 0, now, now, {}, false});
+            } else if (it->second.type != FileType::DIRECTORY) {
+                fail("create_directories", path, std::errc::not_a_directory);
+            }
+
+            current = *resolved;
+            position = end + 1;
+        }
+    }
+
+    void MemoryFileSystem::createSymlink(const fs::path& target, const fs::path& link) {
+        std::unique_lock lock(mutex);
+        const std::string key = resolveForCreate(link, "create_symlink");
+        if (nodes.contains(key)) {
+            fail("create_symlink", link, std::errc::file_exists);
+        }
+
+        const auto now = fs::file_time_type::clock::now();
+        std::string data = target.generic_string();
+        const uintmax_t size = data.size();
+        nodes.emplace(key, Node{FileType::SYMLINK, size, now, now, std::move(data), false});
+    }
+
+    void MemoryFileSystem::createHardLink(const fs::path& target, const fs::path& link) {
+        std::unique_lock lock(mutex);
+        const auto source = findResolved(target, true);
+        if (source == nodes.end()) {
+            fail("create_hard_link", target, std::errc::no_such_file_or_directory);
+        }
+        if (source->second.type != FileType::FILE) {
+            fail("create_hard_link", target, std::errc::operation_not_permitted);
+        }
+
+        const std::string key = resolveForCreate(link, "create_hard_link");
+        if (nodes.contains(key)) {
+            fail("create_hard_link", link, std::errc::file_exists);
+        }
+
+        // Nodes hold their own contents, so the link is a copy; files are not written in place
+        Node copy = source->second;
+        nodes.emplace(key, std::move(copy));
+    }
+
+    uintmax_t MemoryFileSystem::removeAll(const fs::path& path) {
+        std::unique_lock lock(mutex);
+        const auto it = findResolved(path, false);
+        if (it == nodes.end()) {
+            return 0;
+        }
+
+        uintmax_t removed = 0;
+        if (it->second.type == FileType::DIRECTORY) {
+            const std::string prefix = getChildPrefix(it->first);
+            const auto first = it->first == "/" ? nodes.upper_bound("/") : nodes.lower_bound(prefix);
+            const auto last = nodes.lower_bound(getSubtreeEnd(it->first));
+            removed = static_cast<uintmax_t>(std::distance(first, last));
+            nodes.erase(first, last);
+        }
+
+        // The root itself always stays
+        if (it->first != "/") {
+            nodes.erase(it);
+            ++removed;
+        }
+        return removed;
+    }
+
+    void MemoryFileSystem::rename(const fs::path& from, const fs::path& to) {
+        std::unique_lock lock(mutex);
+        const auto source = findResolved(from, false);
+        if (source == nodes.end()) {
+            fail("rename", from, std::errc::no_such_file_or_directory);
+        }
+        const std::string sourceKey = source->first;
+        const std::string targetKey = resolveForCreate(to, "rename");
+        if (sourceKey == targetKey) {
+            return;
+        }
+        if (targetKey.starts_with(getChildPrefix(sourceKey))) {
+            fail("rename", to, std::errc::invalid_argument);
+        }
+
+        if (const auto target = nodes.find(targetKey); target != nodes.end()) {
+            if (target->second.type == FileType::DIRECTORY) {
+                if (source->second.type != FileType::DIRECTORY) {
+                    fail("rename", to, std::errc::is_a_directory);
+                }
+                const auto child = nodes.lower_bound(getChildPrefix(targetKey));
+                if (child != nodes.end() && child->first.starts_with(getChildPrefix(targetKey))) {
+                    fail("rename", to, std::errc::directory_not_empty);
+                }
+            }
+            nodes.erase(target);
+        }
+
+        // Re-key the entry and its subtree, reusing the map nodes
+        std::vector<Nodes::node_type> moved;
+        const auto last = source->second.type == FileType::DIRECTORY
+            ? nodes.lower_bound(getSubtreeEnd(sourceKey))
+            : std::next(source);
+        for (auto it = nodes.find(sourceKey); it != last;) {
+            const auto next = std::next(it);
+            if (it->first == sourceKey || it->first.starts_with(getChildPrefix(sourceKey))) {
+                moved.push_back(nodes.extract(it));
+            }
+            it = next;
+        }
+        for (auto& node : moved) {
+            node.key() = targetKey + node.key().substr(sourceKey.size());
+            nodes.insert(std::move(node));
+        }
+    }
+
+    std::string MemoryFileSystem::readFile(const fs::path& path, const size_t padding) const {
+        std::shared_lock lock(mutex);
+        const auto it = findResolved(path, true);
+        if (it == nodes.end()) {
+            fail("read_file", path, std::errc::no_such_file_or_directory);
+        }
+        if (it->second.type != FileType::FILE) {
+            fail("read_file", path, std::errc::is_a_directory);
+        }
+
+        std::string contents;
+        contents.reserve(it->second.size + padding);
+        if (it->second.sparse) {
+            contents.resize(it->second.size);
+        } else {
+            contents = it->second.data;
+        }
+        if (contents.capacity() < contents.size() + padding) {
+            contents.reserve(contents.size() + padding);
+        }
+        return contents;
+    }
+
+    void MemoryFileSystem::writeFile(const fs::path& path, const std::string_view contents) {
+        std::unique_lock lock(mutex);
+        // Writing through a symlink writes its target
+        const auto resolved = resolve(normalize(path), true);
+        const std::string key = resolved ? *resolved : resolveForCreate(path, "write_file");
+        if (resolved) {
+            const auto parent = nodes.find(std::string(splitParent(key).first));
+            if (parent == nodes.end() || parent->second.type != FileType::DIRECTORY) {
+                fail("write_file", path, std::errc::no_such_file_or_directory);
+            }
+        }
+
+        const auto now = fs::file_time_type::clock::now();
+        auto [it, inserted] = nodes.try_emplace(key, Node{FileType::FILE, 0, now, now, {}, false});
+        if (it->second.type != FileType::FILE) {
+            fail("write_file", path, std::errc::is_a_directory);
+        }
+        it->second.data.assign(contents);
+        it->second.size = contents.size();
+        it->second.sparse = false;
+        it->second.modified = now;
+        it->second.accessed = now;
+    }
+
+    void MemoryFileSystem::createFile(const fs::path& path, const uintmax_t size, const fs::file_time_type time) {
+        std::unique_lock lock(mutex);
+        const std::string key = resolveForCreate(path, "create_file");
+
+        auto [it, inserted] = nodes.try_emplace(key, Node{FileType::FILE, size, time, time, {}, true});
+        if (!inserted) {
+            if (it->second.type != FileType::FILE) {
+                fail("create_file", path, std::errc::is_a_directory);
+            }
+            it->second = Node{FileType::FILE, size, time, time, {}, true};
+        }
+    }
+
+    size_t MemoryFileSystem::size() const {
+        std::shared_lock lock(mutex);
+        return nodes.size();
+    }
+
+    // LatencyFileSystem
+
+    LatencyFileSystem::LatencyFileSystem(
+        std::shared_ptr<FileSystem> inner,
+        const std::chrono::microseconds latency,
+        const uintmax_t bytesPerSecond
+    ) : inner(std::move(inner)), latency(latency), bytesPerSecond(bytesPerSecond) {}
+
+    void LatencyFileSystem::delay(const uintmax_t bytes) const {
+        auto total = latency;
+        if (bytesPerSecond > 0) {
+            total += std::chrono::microseconds(bytes * 1000000 / bytesPerSecond);
+        }
+        if (total.count() > 0) {
+            std::this_thread::sleep_for(total);
+        }
+    }
+
+    Status LatencyFileSystem::status(const fs::path& path) const {
+        delay();
+        return inner->status(path);
+    }
+
+    Status LatencyFileSystem::symlinkStatus(const fs::path& path) const {
+        delay();
+        return inner->symlinkStatus(path);
+    }
+
+    fs::path LatencyFileSystem::readSymlink(const fs::path& path) const {
+        delay();
+        return inner->readSymlink(path);
+    }
+
+    bool LatencyFileSystem::isEmptyDirectory(const fs::path& path) const {
+        delay();
+        return inner->isEmptyDirectory(path);
+    }
+
+    std::vector<DirectoryEntry> LatencyFileSystem::list(const fs::path& directory) const {
+        delay();
+        return inner->list(directory);
+    }
+
+    void LatencyFileSystem::createDirectories(const fs::path& path) {
+        delay();
+        inner->createDirectories(path);
+    }
+
+    void LatencyFileSystem::createSymlink(const fs::path& target, const fs::path& link) {
+        delay();
+        inner->createSymlink(target, link);
+    }
+
+    void LatencyFileSystem::createHardLink(const fs::path& target, const fs::path& link) {
+        delay();
+        inner->createHardLink(target, link);
+    }
+
+    uintmax_t LatencyFileSystem::removeAll(const fs::path& path) {
+        delay();
+        return inner->removeAll(path);
+    }
+
+    void LatencyFileSystem::rename(const fs::path& from, const fs::path& to) {
+        delay();
+        inner->rename(from, to);
+    }
+
+    std::string LatencyFileSystem::readFile(const fs::path& path, const size_t padding) const {
+        std::string contents = inner->readFile(path, padding);
+        delay(contents.size());
+        return contents;
+    }
+
+    void LatencyFileSystem::writeFile(const fs::path& path, const std::string_view contents) {
+        delay(contents.size());
+        inner->writeFile(path, contents);
+    }
+
+    std::shared_ptr<FileSystem> getDefault() {
+        static const std::shared_ptr<FileSystem> instance = std::make_shared<PosixFileSystem>();
+        return instance;
+    }
+} // namespace span::vfs
@@ -0,0 +1,136 @@
+#include "watcher.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace span::watch {
+    namespace {
+        std::atomic<bool> signalled{false};
+
+        void onSignal(int) {
+            signalled.store(true, std::memory_order_relaxed);
+        }
+
+        constexpr int IDLE_POLL_MS = 250;
+    }
+
+#ifdef __linux__
+    Watcher::Watcher(const std::chrono::milliseconds debounce) : debounce(debounce) {
+        inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0) {
+            throw std::runtime_error("Failed to initialize inotify: " + std::string(std::strerror(errno)));
+        }
+    }
+
+    Watcher::~Watcher() {
+        if (inotifyFd >= 0) {
+            ::close(inotifyFd);
+        }
+    }
+
+    void Watcher::addProject(const std::string& directory, const std::vector<std::string>& fileNames) {
+        constexpr uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+
+        const int wd = ::inotify_add_watch(inotifyFd, directory.c_str(), mask | IN_ONLYDIR);
+        if (wd < 0) {
+            throw std::runtime_error("Failed to watch " + directory + ": " + std::strerror(errno));
+        }
+
+        // The same directory may be added once per manager; merge the file names
+        auto& project = projects[wd];
+        project.directory = directory;
+        project.fileNames.insert(fileNames.begin(), fileNames.end());
+    }
+
+    void Watcher::readEvents(
+        std::unordered_map<int, std::chrono::steady_clock::time_point>& deadlines
+    ) const {
+        alignas(inotify_event) char buffer[16 * 1024];
+
+        while (true) {
+            const ssize_t length = ::read(inotifyFd, buffer, sizeof(buffer));
+            if (length <= 0) {
+                return;
+            }
+
+            const auto deadline = std::chrono::steady_clock::now() + debounce;
+            for (ssize_t offset = 0; offset < length;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+                const auto project = projects.find(event->wd);
+                if (project == projects.end() || event->len == 0) {
+                    continue;
+                }
+                if (project->second.fileNames.contains(event->name)) {
+                    deadlines[event->wd] = deadline;
+                }
+            }
+        }
+    }
+
+    void Watcher::run(const Callback& onChange) {
+        struct sigaction action{};
+        action.sa_handler = onSignal;
+        sigemptyset(&action.sa_mask);
+        ::sigaction(SIGINT, &action, nullptr);
+        ::sigaction(SIGTERM, &action, nullptr);
+
+        std::unordered_map<int, std::chrono::steady_clock::time_point> deadlines;
+
+        while (!stopping.load(std::memory_order_acquire) && !signalled.load(std::memory_order_relaxed)) {
+            int timeout = IDLE_POLL_MS;
+            if (!deadlines.empty()) {
+                const auto next = std::ranges::min_element(deadlines, {}, [](const auto& pending) {
+                    return pending.second;
+                })->second;
+                const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    next - std::chrono::steady_clock::now()
+                );
+                timeout = static_cast<int>(std::clamp<int64_t>(remaining.count(), 0, IDLE_POLL_MS));
+            }
+
+            pollfd descriptor{inotifyFd, POLLIN, 0};
+            if (::poll(&descriptor, 1, timeout) > 0) {
+                readEvents(deadlines);
+            }
+
+            const auto now = std::chrono::steady_clock::now();
+            for (auto it = deadlines.begin(); it != deadlines.end();) {
+                if (it->second > now) {
+                    ++it;
+                    continue;
+                }
+
+                const std::string directory = projects.at(it->first).directory;
+                it = deadlines.erase(it);
+                onChange(directory);
+            }
+        }
+    }
+#else
+    Watcher::Watcher(const std::chrono::milliseconds debounce) : debounce(debounce) {
+        throw std::runtime_error("Watch mode requires inotify and is only supported on Linux");
+    }
+
+    Watcher::~Watcher() = default;
+
+    void Watcher::addProject(const std::string&, const std::vector<std::string>&) {}
+
+    void Watcher::readEvents(std::unordered_map<int, std::chrono::steady_clock::time_point>&) const {}
+
+    void Watcher::run(const Callback&) {}
+#endif
+
+    void Watcher::stop() {
+        stopping.store(true, std::memory_order_release);
+    }
+} // namespace span::watch
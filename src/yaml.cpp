@@ -0,0 +1,642 @@
+#include "yaml.h"
+
+namespace span::yaml {
+    namespace {
+        void appendUtf8(std::string& out, const uint32_t codePoint) {
+            if (codePoint < 0x80) {
+                out += static_cast<char>(codePoint);
+            } else if (codePoint < 0x800) {
+                out += static_cast<char>(0xc0 | (codePoint >> 6));
+                out += static_cast<char>(0x80 | (codePoint & 0x3f));
+            } else if (codePoint < 0x10000) {
+                out += static_cast<char>(0xe0 | (codePoint >> 12));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (codePoint & 0x3f));
+            } else {
+                out += static_cast<char>(0xf0 | (codePoint >> 18));
+                out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (codePoint & 0x3f));
+            }
+        }
+
+        std::string_view trimRight(std::string_view value) {
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+                value.remove_suffix(1);
+            }
+            return value;
+        }
+    }
+
+    ParseError::ParseError(const std::string& message, const size_t line)
+        : std::runtime_error("line " + std::to_string(line) + ": " + message), line(line) {}
+
+    /**
+     * Recursive descent over the input. Block structure is tracked by the
+     * column of each node's first character, so a mapping that starts after
+     * "- " on a sequence line continues at that column on later lines.
+     */
+    class Parser {
+    public:
+        explicit Parser(Document& document) : document(document), text(*document.text) {}
+
+        void parseStream() {
+            document.nodes.push_back({NodeType::NONE, {}, {}});
+            if (text.starts_with("\xef\xbb\xbf")) {
+                pos = lineStart = 3;
+            }
+
+            int column = skipToContent();
+            while (column >= 0) {
+                uint32_t root = 0;
+                if (isDocumentMarker() && text[pos] == '-') {
+                    pos += 3;
+                    column = skipToContent();
+                }
+                if (column >= 0 && !isDocumentMarker()) {
+                    root = parseBlock();
+                    column = skipToContent();
+                    if (column >= 0 && !isDocumentMarker()) {
+                        throw error("unexpected content after the end of the document");
+                    }
+                }
+                document.roots.push_back(root);
+
+                if (column >= 0 && text[pos] == '.') {
+                    pos += 3;
+                    column = skipToContent();
+                }
+            }
+        }
+
+    private:
+        struct Children {
+            uint32_t parent;
+            uint32_t last{0};
+        };
+
+        Document& document;
+        std::string_view text;
+        size_t pos{0};
+        size_t lineStart{0};
+        size_t line{1};
+
+        [[nodiscard]] ParseError error(const std::string& message) const {
+            return {message, line};
+        }
+
+        [[nodiscard]] int column() const {
+            return static_cast<int>(pos - lineStart);
+        }
+
+        [[nodiscard]] bool isLineEnd(const size_t at) const {
+            return at >= text.size() || text[at] == '\n' || text[at] == '\r';
+        }
+
+        [[nodiscard]] bool isSeparator(const size_t at) const {
+            return isLineEnd(at) || text[at] == ' ' || text[at] == '\t';
+        }
+
+        [[nodiscard]] bool isDocumentMarker() const {
+            return pos == lineStart && pos + 3 <= text.size()
+                && (text.compare(pos, 3, "---") == 0 || text.compare(pos, 3, "...") == 0)
+                && isSeparator(pos + 3);
+        }
+
+        [[nodiscard]] bool isSequenceItem() const {
+            return text[pos] == '-' && isSeparator(pos + 1);
+        }
+
+        uint32_t addNode(const NodeType type, const std::string_view value = {}) {
+            if (document.nodes.size() >= UINT32_MAX) {
+                throw error("too many nodes");
+            }
+            document.nodes.push_back({type, {}, value});
+            return static_cast<uint32_t>(document.nodes.size() - 1);
+        }
+
+        void append(Children& children, const uint32_t child, const std::string_view key = {}) {
+            auto& nodes = document.nodes;
+            nodes[child].key = key;
+            if (children.last) {
+                nodes[children.last].next = child;
+            } else {
+                nodes[children.parent].first = child;
+            }
+            children.last = child;
+            ++nodes[children.parent].size;
+        }
+
+        void skipLine() {
+            while (pos < text.size() && text[pos] != '\n') {
+                ++pos;
+            }
+            if (pos < text.size()) {
+                ++pos;
+                ++line;
+            }
+            lineStart = pos;
+        }
+
+        /**
+         * Move to the next character that is not whitespace or a comment.
+         * @return Its column, or -1 at the end of the input
+         */
+        int skipToContent() {
+            while (pos < text.size()) {
+                const char c = text[pos];
+                if (c == ' ') {
+                    ++pos;
+                } else if (c == '\t') {
+                    if (text.substr(lineStart, pos - lineStart).find_first_not_of(' ') == std::string_view::npos) {
+                        throw error("tabs are not allowed in indentation");
+                    }
+                    ++pos;
+                } else if (c == '\n' || c == '\r' || c == '#') {
+                    skipLine();
+                } else {
+                    return column();
+                }
+            }
+            return -1;
+        }
+
+        void skipSpaces() {
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t')) {
+                ++pos;
+            }
+        }
+
+        // Spaces, line breaks and comments between the tokens of a flow collection
+        void skipFlowSpace() {
+            while (pos < text.size()) {
+                const char c = text[pos];
+                if (c == ' ' || c == '\t' || c == '\r') {
+                    ++pos;
+                } else if (c == '\n') {
+                    ++pos;
+                    ++line;
+                    lineStart = pos;
+                } else if (c == '#') {
+                    while (pos < text.size() && text[pos] != '\n') {
+                        ++pos;
+                    }
+                } else {
+                    return;
+                }
+            }
+            throw error("unterminated flow collection");
+        }
+
+        void expectLineEnd() {
+            skipSpaces();
+            if (pos < text.size() && text[pos] == '#') {
+                while (!isLineEnd(pos)) {
+                    ++pos;
+                }
+            }
+            if (!isLineEnd(pos)) {
+                throw error("unexpected content after a value");
+            }
+        }
+
+        void rejectUnsupported() const {
+            switch (text[pos]) {
+                case '&':
+                case '*':
+                    throw error("anchors and aliases are not supported");
+                case '!':
+                    throw error("tags are not supported");
+                case '|':
+                case '>':
+                    throw error("block scalars are not supported");
+                case '?':
+                    if (isSeparator(pos + 1)) {
+                        throw error("complex keys are not supported");
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        /**
+         * Check whether the current line holds a mapping entry, i.e. a key followed by ": ".
+         */
+        [[nodiscard]] bool isMappingKey() const {
+            size_t at = pos;
+            const char c = text[at];
+            if (c == '"' || c == '\'') {
+                for (++at; !isLineEnd(at); ++at) {
+                    if (text[at] == '\\' && c == '"') {
+                        ++at;
+                    } else if (text[at] == c) {
+                        if (c == '\'' && at + 1 < text.size() && text[at + 1] == '\'') {
+                            ++at;
+                            continue;
+                        }
+                        ++at;
+                        while (at < text.size() && (text[at] == ' ' || text[at] == '\t')) {
+                            ++at;
+                        }
+                        return at < text.size() && text[at] == ':' && isSeparator(at + 1);
+                    }
+                }
+                return false;
+            }
+            if (c == '{' || c == '[') {
+                return false;
+            }
+            for (; !isLineEnd(at); ++at) {
+                if (text[at] == ':' && isSeparator(at + 1)) {
+                    return true;
+                }
+                if (text[at] == '#' && at > pos && (text[at - 1] == ' ' || text[at - 1] == '\t')) {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Parse the block node that starts at the current position.
+         */
+        uint32_t parseBlock() {
+            rejectUnsupported();
+            if (isSequenceItem()) {
+                return parseSequence(column());
+            }
+            if (isMappingKey()) {
+                return parseMapping(column());
+            }
+            const uint32_t node = parseInline();
+            expectLineEnd();
+            return node;
+        }
+
+        uint32_t parseMapping(const int indent) {
+            const uint32_t node = addNode(NodeType::MAPPING);
+            Children children{node};
+
+            while (true) {
+                const std::string_view key = parseKey();
+                append(children, parseValue(indent), key);
+
+                const int next = skipToContent();
+                if (next < indent || isDocumentMarker()) {
+                    break;
+                }
+                if (next > indent) {
+                    throw error("unexpected indentation");
+                }
+                if (isSequenceItem() || !isMappingKey()) {
+                    throw error("expected a mapping key");
+                }
+            }
+            return node;
+        }
+
+        uint32_t parseSequence(const int indent) {
+            const uint32_t node = addNode(NodeType::SEQUENCE);
+            Children children{node};
+
+            while (true) {
+                ++pos;
+                skipSpaces();
+                if (isLineEnd(pos) || text[pos] == '#') {
+                    const int next = skipToContent();
+                    append(children, next > indent && !isDocumentMarker() ? parseBlock() : addNode(NodeType::SCALAR));
+                } else {
+                    // "- key: value" starts a mapping at the column of the key
+                    append(children, parseBlock());
+                }
+
+                // A sequence indented as far as its key ends at the next key
+                const int next = skipToContent();
+                if (next < indent || isDocumentMarker() || (next == indent && !isSequenceItem())) {
+                    break;
+                }
+                if (next > indent) {
+                    throw error("unexpected indentation");
+                }
+            }
+            return node;
+        }
+
+        std::string_view parseKey() {
+            std::string_view key;
+            if (text[pos] == '"' || text[pos] == '\'') {
+                key = parseQuoted();
+                skipSpaces();
+            } else {
+                const size_t start = pos;
+                while (!(text[pos] == ':' && isSeparator(pos + 1))) {
+                    ++pos;
+                }
+                key = trimRight(text.substr(start, pos - start));
+            }
+            if (pos >= text.size() || text[pos] != ':') {
+                throw error("expected ':' after a mapping key");
+            }
+            ++pos;
+            return key;
+        }
+
+        /**
+         * Parse the value after "key:", on the same line or the lines below.
+         */
+        uint32_t parseValue(const int indent) {
+            skipSpaces();
+            if (isLineEnd(pos) || text[pos] == '#') {
+                const int next = skipToContent();
+                if (next > indent && !isDocumentMarker()) {
+                    return parseBlock();
+                }
+                // A sequence may be indented as far as the key it belongs to
+                if (next == indent && isSequenceItem()) {
+                    return parseSequence(indent);
+                }
+                return addNode(NodeType::SCALAR);
+            }
+
+            const uint32_t node = parseInline();
+            expectLineEnd();
+            return node;
+        }
+
+        /**
+         * Parse a flow collection or a scalar that ends on its line.
+         */
+        uint32_t parseInline() {
+            rejectUnsupported();
+            switch (text[pos]) {
+                case '{':
+                    return parseFlowMapping();
+                case '[':
+                    return parseFlowSequence();
+                case '"':
+                case '\'':
+                    return addNode(NodeType::SCALAR, parseQuoted());
+                default:
+                    break;
+            }
+
+            const size_t start = pos;
+            while (!isLineEnd(pos) && !(text[pos] == '#' && (text[pos - 1] == ' ' || text[pos - 1] == '\t'))) {
+                ++pos;
+            }
+            return addNode(NodeType::SCALAR, trimRight(text.substr(start, pos - start)));
+        }
+
+        uint32_t parseFlowNode() {
+            skipFlowSpace();
+            rejectUnsupported();
+            switch (text[pos]) {
+                case '{':
+                    return parseFlowMapping();
+                case '[':
+                    return parseFlowSequence();
+                case '"':
+                case '\'':
+                    return addNode(NodeType::SCALAR, parseQuoted());
+                case ',':
+                case '}':
+                case ']':
+                    return addNode(NodeType::SCALAR);
+                default:
+                    return addNode(NodeType::SCALAR, parseFlowPlain());
+            }
+        }
+
+        // A plain scalar inside a flow collection ends at a flow indicator or ": "
+        std::string_view parseFlowPlain() {
+            const size_t start = pos;
+            while (pos < text.size()) {
+                const char c = text[pos];
+                if (c == ',' || c == '[' || c == ']' || c == '{' || c == '}' || c == '\n' || c == '\r') {
+                    break;
+                }
+                if (c == ':' && (isSeparator(pos + 1) || text[pos + 1] == ',' || text[pos + 1] == '}' || text[pos + 1] == ']')) {
+                    break;
+                }
+                if (c == '#' && pos > start && (text[pos - 1] == ' ' || text[pos - 1] == '\t')) {
+                    break;
+                }
+                ++pos;
+            }
+            return trimRight(text.substr(start, pos - start));
+        }
+
+        uint32_t parseFlowMapping() {
+            const uint32_t node = addNode(NodeType::MAPPING);
+            Children children{node};
+            ++pos;
+
+            while (true) {
+                skipFlowSpace();
+                if (text[pos] == '}') {
+                    ++pos;
+                    return node;
+                }
+
+                const std::string_view key = text[pos] == '"' || text[pos] == '\'' ? parseQuoted() : parseFlowPlain();
+                skipFlowSpace();
+                uint32_t value;
+                if (text[pos] == ':') {
+                    ++pos;
+                    value = parseFlowNode();
+                } else {
+                    value = addNode(NodeType::SCALAR);
+                }
+                append(children, value, key);
+
+                skipFlowSpace();
+                if (text[pos] == ',') {
+                    ++pos;
+                } else if (text[pos] != '}') {
+                    throw error("expected ',' or '}' in a flow mapping");
+                }
+            }
+        }
+
+        uint32_t parseFlowSequence() {
+            const uint32_t node = addNode(NodeType::SEQUENCE);
+            Children children{node};
+            ++pos;
+
+            while (true) {
+                skipFlowSpace();
+                if (text[pos] == ']') {
+                    ++pos;
+                    return node;
+                }
+
+                append(children, parseFlowNode());
+
+                skipFlowSpace();
+                if (text[pos] == ',') {
+                    ++pos;
+                } else if (text[pos] != ']') {
+                    throw error("expected ',' or ']' in a flow sequence");
+                }
+            }
+        }
+
+        /**
+         * Parse a single- or double-quoted scalar on one line.
+         * @return A view into the input, or into the document's copy if it had escapes
+         */
+        std::string_view parseQuoted() {
+            const char quote = text[pos];
+            const size_t start = ++pos;
+            bool escaped = false;
+
+            while (true) {
+                if (isLineEnd(pos)) {
+                    throw error("multi-line and unterminated strings are not supported");
+                }
+                const char c = text[pos];
+                if (c == quote) {
+                    if (quote == '\'' && pos + 1 < text.size() && text[pos + 1] == '\'') {
+                        escaped = true;
+                        pos += 2;
+                        continue;
+                    }
+                    break;
+                }
+                if (c == '\\' && quote == '"') {
+                    escaped = true;
+                    ++pos;
+                }
+                ++pos;
+            }
+
+            const std::string_view raw = text.substr(start, pos - start);
+            ++pos;
+            if (!escaped) {
+                return raw;
+            }
+            return document.unescaped.emplace_back(quote == '\'' ? unescapeSingle(raw) : unescapeDouble(raw));
+        }
+
+        static std::string unescapeSingle(const std::string_view raw) {
+            std::string value;
+            value.reserve(raw.size());
+            for (size_t i = 0; i < raw.size(); ++i) {
+                value += raw[i];
+                if (raw[i] == '\'') {
+                    ++i;
+                }
+            }
+            return value;
+        }
+
+        [[nodiscard]] std::string unescapeDouble(const std::string_view raw) const {
+            std::string value;
+            value.reserve(raw.size());
+            for (size_t i = 0; i < raw.size(); ++i) {
+                if (raw[i] != '\\') {
+                    value += raw[i];
+                    continue;
+                }
+
+                const char escape = raw[++i];
+                size_t digits = 0;
+                switch (escape) {
+                    case '0': value += '\0'; break;
+                    case 'a': value += '\a'; break;
+                    case 'b': value += '\b'; break;
+                    case 't': value += '\t'; break;
+                    case 'n': value += '\n'; break;
+                    case 'v': value += '\v'; break;
+                    case 'f': value += '\f'; break;
+                    case 'r': value += '\r'; break;
+                    case 'e': value += '\x1b'; break;
+                    case ' ': value += ' '; break;
+                    case '"': value += '"'; break;
+                    case '/': value += '/'; break;
+                    case '\\': value += '\\'; break;
+                    case 'x': digits = 2; break;
+                    case 'u': digits = 4; break;
+                    case 'U': digits = 8; break;
+                    default:
+                        throw error(std::string("unknown escape \\") + escape);
+                }
+                if (digits == 0) {
+                    continue;
+                }
+
+                if (i + digits >= raw.size()) {
+                    throw error("truncated escape");
+                }
+                uint32_t codePoint = 0;
+                for (size_t j = 1; j <= digits; ++j) {
+                    const char digit = raw[i + j];
+                    codePoint <<= 4;
+                    if (digit >= '0' && digit <= '9') {
+                        codePoint |= digit - '0';
+                    } else if (digit >= 'a' && digit <= 'f') {
+                        codePoint |= digit - 'a' + 10;
+                    } else if (digit >= 'A' && digit <= 'F') {
+                        codePoint |= digit - 'A' + 10;
+                    } else {
+                        throw error("invalid hex digit in an escape");
+                    }
+                }
+                i += digits;
+                appendUtf8(value, codePoint);
+            }
+            return value;
+        }
+    };
+
+    Document Document::parse(std::string text) {
+        Document document;
+        document.text = std::make_unique<const std::string>(std::move(text));
+        // Roughly one node per line
+        document.nodes.reserve(document.text->size() / 32 + 1);
+        Parser(document).parseStream();
+        return document;
+    }
+
+    Node Document::getRoot(const size_t document) const {
+        return {this, document < roots.size() ? roots[document] : 0};
+    }
+
+    NodeType Node::getType() const {
+        return document ? document->nodes[index].type : NodeType::NONE;
+    }
+
+    std::string_view Node::getString() const {
+        return isScalar() ? document->nodes[index].value : std::string_view();
+    }
+
+    std::string_view Node::getKey() const {
+        return document ? document->nodes[index].key : std::string_view();
+    }
+
+    size_t Node::size() const {
+        return document ? document->nodes[index].size : 0;
+    }
+
+    Node Node::operator[](const std::string_view key) const {
+        if (!isMapping()) {
+            return {document, 0};
+        }
+        for (uint32_t child = document->nodes[index].first; child; child = document->nodes[child].next) {
+            if (document->nodes[child].key == key) {
+                return {document, child};
+            }
+        }
+        return {document, 0};
+    }
+
+    Node::Iterator Node::begin() const {
+        return {document, document ? document->nodes[index].first : 0};
+    }
+
+    Node::Iterator& Node::Iterator::operator++() {
+        index = document->nodes[index].next;
+        return *this;
+    }
+} // namespace span::yaml
@@ -0,0 +1,97 @@
+#include "test.h"
+#include "cache.h"
+#include "vfs.h"
+#include <chrono>
+#include <memory>
+
+namespace fs = std::filesystem;
+using dev::packages::Cache;
+using span::vfs::MemoryFileSystem;
+
+namespace {
+    const auto now = fs::file_time_type::clock::now();
+
+    // A cached file accessed the given number of hours ago
+    void addFile(MemoryFileSystem& fileSystem, const fs::path& path, const uintmax_t size, const int hoursAgo) {
+        fileSystem.createDirectories(path.parent_path());
+        fileSystem.createFile(path, size, now - std::chrono::hours(hoursAgo));
+    }
+}
+
+SPAN_TEST(cache, cleanupEvictsLeastRecentlyUsedVersions) {
+    const auto fileSystem = std::make_shared<MemoryFileSystem>();
+    const Cache cache("/cache", fileSystem);
+    addFile(*fileSystem, "/cache/composer/a/1.0.0/src/A.php", 100, 3);
+    addFile(*fileSystem, "/cache/composer/b/1.0.0/src/B.php", 100, 2);
+    addFile(*fileSystem, "/cache/composer/a/2.0.0/src/A.php", 100, 1);
+
+    SPAN_CHECK(cache.cleanup(200));
+    SPAN_CHECK(!fileSystem->exists("/cache/composer/a/1.0.0"));
+    SPAN_CHECK(fileSystem->exists("/cache/composer/b/1.0.0/src/B.php"));
+    SPAN_CHECK(fileSystem->exists("/cache/composer/a/2.0.0/src/A.php"));
+
+    SPAN_CHECK(cache.cleanup(100));
+    SPAN_CHECK(!fileSystem->exists("/cache/composer/b/1.0.0"));
+    SPAN_CHECK(fileSystem->exists("/cache/composer/a/2.0.0/src/A.php"));
+}
+
+SPAN_TEST(cache, cleanupKeepsEverythingUnderTheLimit) {
+    const auto fileSystem = std::make_shared<MemoryFileSystem>();
+    const Cache cache("/cache", fileSystem);
+    addFile(*fileSystem, "/cache/npm/a/1.0.0/index.js", 100, 2);
+    addFile(*fileSystem, "/cache/npm/b/1.0.0/index.js", 100, 1);
+
+    SPAN_CHECK(cache.cleanup(200));
+    SPAN_CHECK(fileSystem->exists("/cache/npm/a/1.0.0/index.js"));
+    SPAN_CHECK(fileSystem->exists("/cache/npm/b/1.0.0/index.js"));
+}
+
+SPAN_TEST(cache, cleanupCountsFilesDirectlyInTheVersionDirectory) {
+    // Most npm packages have their files at the top of the package
+    const auto fileSystem = std::make_shared<MemoryFileSystem>();
+    const Cache cache("/cache", fileSystem);
+    addFile(*fileSystem, "/cache/npm/a/1.0.0/index.js", 300, 2);
+    addFile(*fileSystem, "/cache/npm/b/1.0.0/index.js", 100, 1);
+
+    SPAN_CHECK(cache.cleanup(100));
+    SPAN_CHECK(!fileSystem->exists("/cache/npm/a/1.0.0"));
+    SPAN_CHECK(fileSystem->exists("/cache/npm/a"));
+    SPAN_CHECK(fileSystem->exists("/cache/npm/b/1.0.0/index.js"));
+}
+
+SPAN_TEST(cache, cleanupEvictsWholeVersionDirectories) {
+    // Files in subdirectories belong to their version, which is evicted as a unit by its newest access
+    const auto fileSystem = std::make_shared<MemoryFileSystem>();
+    const Cache cache("/cache", fileSystem);
+    addFile(*fileSystem, "/cache/composer/a/1.0.0/src/deep/Old.php", 100, 5);
+    addFile(*fileSystem, "/cache/composer/a/1.0.0/README.md", 100, 1);
+    addFile(*fileSystem, "/cache/composer/b/1.0.0/src/B.php", 100, 3);
+
+    SPAN_CHECK(cache.cleanup(200));
+    SPAN_CHECK(!fileSystem->exists("/cache/composer/b/1.0.0"));
+    SPAN_CHECK(fileSystem->exists("/cache/composer/a/1.0.0/src/deep/Old.php"));
+    SPAN_CHECK(fileSystem->exists("/cache/composer/a/1.0.0/README.md"));
+
+    SPAN_CHECK(cache.cleanup(0));
+    SPAN_CHECK(!fileSystem->exists("/cache/composer/a/1.0.0"));
+}
+
+SPAN_TEST(cache, addToCacheOnlyPublishesCompleteFills) {
+    const auto fileSystem = std::make_shared<MemoryFileSystem>();
+    const Cache cache("/cache", fileSystem);
+
+    SPAN_CHECK(!cache.addToCache("npm", "a", "1.0.0", [&](const fs::path& directory) {
+        fileSystem->createDirectories(directory);
+        fileSystem->writeFile(directory / "index.js", "partial");
+        throw std::runtime_error("fill failed");
+    }));
+    SPAN_CHECK(!cache.isCached("npm", "a", "1.0.0"));
+    SPAN_CHECK(fileSystem->isEmptyDirectory("/cache/npm/a"));
+
+    SPAN_CHECK(cache.addToCache("npm", "a", "1.0.0", [&](const fs::path& directory) {
+        fileSystem->createDirectories(directory);
+        fileSystem->writeFile(directory / "index.js", "complete");
+    }));
+    SPAN_CHECK(cache.isCached("npm", "a", "1.0.0"));
+    SPAN_CHECK_EQ(fileSystem->readFile(cache.getPackagePath("npm", "a", "1.0.0") / "index.js"), "complete");
+}
@@ -0,0 +1,122 @@
+#include "test.h"
+#include "packages/composer_constraint.h"
+
+using namespace dev::packages::composer;
+
+namespace {
+    // The normalized form of a version, or "" if Composer would reject it
+    std::string normalize(const std::string_view text) {
+        const auto version = parseVersion(text);
+        return version ? version->toString() : "";
+    }
+
+    bool matches(const std::string_view constraint, const std::string_view version) {
+        return Constraint::parse(constraint).matches(*parseVersion(version));
+    }
+
+    bool isRejected(const std::string_view constraint) {
+        try {
+            static_cast<void>(Constraint::parse(constraint));
+        } catch (const ConstraintError&) {
+            return true;
+        }
+        return false;
+    }
+}
+
+SPAN_TEST(composer_constraint, versionsAreNormalized) {
+    SPAN_CHECK_EQ(normalize("1.2"), "1.2.0.0");
+    SPAN_CHECK_EQ(normalize("v6.4.1"), "6.4.1.0");
+    SPAN_CHECK_EQ(normalize("2.0.0-beta2"), "2.0.0.0-beta2");
+    SPAN_CHECK_EQ(normalize("1.0.0-RC1"), "1.0.0.0-RC1");
+    SPAN_CHECK_EQ(normalize("dev-main"), "dev-main");
+    SPAN_CHECK_EQ(normalize("1.x-dev"), "1.9999999.9999999.9999999-dev");
+    SPAN_CHECK_EQ(normalize("not a version"), "");
+}
+
+SPAN_TEST(composer_constraint, versionsOrderByStage) {
+    SPAN_CHECK(*parseVersion("1.0.0-alpha") < *parseVersion("1.0.0-beta"));
+    SPAN_CHECK(*parseVersion("1.0.0-beta") < *parseVersion("1.0.0-RC1"));
+    SPAN_CHECK(*parseVersion("1.0.0-RC1") < *parseVersion("1.0.0"));
+    SPAN_CHECK(*parseVersion("1.0.0") < *parseVersion("1.0.0-p1"));
+    SPAN_CHECK(*parseVersion("1.0.10") > *parseVersion("1.0.9"));
+    SPAN_CHECK(*parseVersion("dev-main") < *parseVersion("0.0.1"));
+
+    SPAN_CHECK(parseVersion("1.0.0")->getStability() == Stability::STABLE);
+    SPAN_CHECK(parseVersion("1.0.0-beta")->getStability() == Stability::BETA);
+    SPAN_CHECK(parseVersion("dev-main")->getStability() == Stability::DEV);
+}
+
+SPAN_TEST(composer_constraint, caretAndTilde) {
+    SPAN_CHECK(matches("^1.2", "1.2.0"));
+    SPAN_CHECK(matches("^1.2", "1.9.9"));
+    SPAN_CHECK(!matches("^1.2", "1.1.9"));
+    SPAN_CHECK(!matches("^1.2", "2.0.0"));
+    SPAN_CHECK(!matches("^1.2", "2.0.0-beta"));
+    // Below 1.0 the minor version is the breaking one
+    SPAN_CHECK(matches("^0.3", "0.3.5"));
+    SPAN_CHECK(!matches("^0.3", "0.4.0"));
+
+    SPAN_CHECK(matches("~1.2", "1.9.0"));
+    SPAN_CHECK(!matches("~1.2", "2.0.0"));
+    SPAN_CHECK(matches("~1.2.3", "1.2.9"));
+    SPAN_CHECK(!matches("~1.2.3", "1.3.0"));
+}
+
+SPAN_TEST(composer_constraint, rangesWildcardsAndAlternatives) {
+    SPAN_CHECK(matches(">=5.4 <7", "6.0.0"));
+    SPAN_CHECK(!matches(">=5.4 <7", "7.0.0"));
+    SPAN_CHECK(matches(">=5.4, <7", "5.4.0"));
+    // A partial upper bound of a hyphen range covers every version it names
+    SPAN_CHECK(matches("1.0 - 2.0", "2.0.5"));
+    SPAN_CHECK(!matches("1.0 - 2.0", "2.1.0"));
+    SPAN_CHECK(matches("2.*", "2.99.0"));
+    SPAN_CHECK(!matches("2.*", "3.0.0"));
+    SPAN_CHECK(matches("^1.0 || ^3.0", "3.1.0"));
+    SPAN_CHECK(matches("^1.0 | ^3.0", "1.1.0"));
+    SPAN_CHECK(!matches("^1.0 || ^3.0", "2.0.0"));
+    SPAN_CHECK(matches("^1.0@beta", "1.1.0"));
+}
+
+SPAN_TEST(composer_constraint, branchesOnlyMatchWhatNamesThem) {
+    SPAN_CHECK(matches("dev-main", "dev-main"));
+    SPAN_CHECK(!matches("dev-main", "dev-feature"));
+    SPAN_CHECK(!matches(">=1.0", "dev-main"));
+    SPAN_CHECK(!matches("dev-main", "1.0.0"));
+    SPAN_CHECK(matches("*", "dev-main"));
+}
+
+SPAN_TEST(composer_constraint, intersectAndUnite) {
+    const auto first = Constraint::parse("^1.0");
+    const auto second = Constraint::parse(">=1.5 <3");
+
+    const auto both = first.intersect(second);
+    SPAN_CHECK(first.intersects(second));
+    SPAN_CHECK(both.matches(*parseVersion("1.5.0")));
+    SPAN_CHECK(!both.matches(*parseVersion("1.4.0")));
+    SPAN_CHECK(!both.matches(*parseVersion("2.0.0")));
+
+    const auto either = first.unite(second);
+    SPAN_CHECK(either.matches(*parseVersion("1.0.0")));
+    SPAN_CHECK(either.matches(*parseVersion("2.5.0")));
+    SPAN_CHECK(!either.matches(*parseVersion("3.0.0")));
+
+    SPAN_CHECK(!first.intersects(Constraint::parse("^2.0")));
+    SPAN_CHECK(!Constraint().matches(*parseVersion("1.0.0")));
+}
+
+SPAN_TEST(composer_constraint, stabilityFlags) {
+    SPAN_CHECK(getStabilityFlag("^1.0@beta") == Stability::BETA);
+    SPAN_CHECK(getStabilityFlag("dev-main") == Stability::DEV);
+    SPAN_CHECK(getStabilityFlag("2.0.0-RC1") == Stability::RC);
+    SPAN_CHECK(!getStabilityFlag("^1.0"));
+    SPAN_CHECK(parseStability("Beta") == Stability::BETA);
+    SPAN_CHECK(!parseStability("unstable"));
+}
+
+SPAN_TEST(composer_constraint, malformedConstraintsAreRejected) {
+    SPAN_CHECK(isRejected(""));
+    SPAN_CHECK(isRejected(">=1.0 <"));
+    SPAN_CHECK(isRejected("^abc"));
+    SPAN_CHECK(!isRejected("^1.0 || dev-main"));
+}
@@ -0,0 +1,155 @@
+#include "test.h"
+#include "packages/composer_resolver.h"
+#include "vfs.h"
+#include <map>
+
+using namespace dev::packages::composer;
+using span::vfs::MemoryFileSystem;
+
+namespace {
+    using Versions = std::map<std::string, std::string>;
+    using StabilityFlags = std::vector<std::pair<std::string, Stability>>;
+
+    // A package version and what it requires, as {"name": "constraint"} JSON
+    struct Entry {
+        std::string version;
+        std::string require{"{}"};
+    };
+
+    // Write p2/<name>.json, in the format Packagist serves without minification
+    void addPackage(MemoryFileSystem& fileSystem, const std::string& name, const std::vector<Entry>& entries) {
+        std::string json = "{\"packages\":{\"" + name + "\":[";
+        for (const auto& entry : entries) {
+            if (&entry != &entries.front()) {
+                json += ",";
+            }
+            json += "{\"name\":\"" + name + "\",\"version\":\"" + entry.version + "\",\"require\":" + entry.require + "}";
+        }
+        json += "]}}";
+
+        const std::filesystem::path file = "/repo/p2/" + name + ".json";
+        fileSystem.createDirectories(file.parent_path());
+        fileSystem.writeFile(file, json);
+    }
+
+    // A repository where a/a 1.1.0 needs a newer b/b than a/a 1.0.0 does
+    void addPackages(MemoryFileSystem& fileSystem) {
+        addPackage(fileSystem, "a/a", {
+            {"1.0.0", R"({"b/b": "^1.0"})"},
+            {"1.1.0", R"({"b/b": "^2.0", "php": ">=8.1"})"},
+            {"2.0.0"},
+        });
+        addPackage(fileSystem, "b/b", {{"1.0.0"}, {"2.0.0"}, {"2.1.0"}, {"2.2.0-beta1"}});
+        addPackage(fileSystem, "c/c", {{"1.0.0", R"({"a/a": "^1.0"})"}});
+    }
+
+    // The chosen version of each package
+    Versions getVersions(const std::vector<const PackageVersion*>& packages) {
+        Versions versions;
+        for (const auto* package : packages) {
+            versions[package->name] = package->version;
+        }
+        return versions;
+    }
+
+    Versions resolveVersions(MemoryFileSystem& fileSystem, const RootPackage& root) {
+        Repository repository("/repo", fileSystem);
+        return getVersions(resolve(repository, root).packages);
+    }
+
+    bool isUnresolvable(MemoryFileSystem& fileSystem, const RootPackage& root) {
+        try {
+            static_cast<void>(resolveVersions(fileSystem, root));
+        } catch (const ResolutionError&) {
+            return true;
+        }
+        return false;
+    }
+}
+
+SPAN_TEST(composer_resolver, choosesTheNewestStableVersions) {
+    MemoryFileSystem fileSystem;
+    addPackages(fileSystem);
+    RootPackage root;
+    root.require = {{"a/a", "^1.0"}};
+
+    const auto versions = resolveVersions(fileSystem, root);
+    SPAN_CHECK_EQ(versions.size(), 2u);
+    SPAN_CHECK_EQ(versions.at("a/a"), "1.1.0");
+    SPAN_CHECK_EQ(versions.at("b/b"), "2.1.0");
+}
+
+SPAN_TEST(composer_resolver, backtracksOnConflictingRequirements) {
+    MemoryFileSystem fileSystem;
+    addPackages(fileSystem);
+    RootPackage root;
+    root.require = {{"a/a", "^1.0"}, {"b/b", "^1.0"}};
+
+    const auto versions = resolveVersions(fileSystem, root);
+    SPAN_CHECK_EQ(versions.at("a/a"), "1.0.0");
+    SPAN_CHECK_EQ(versions.at("b/b"), "1.0.0");
+}
+
+SPAN_TEST(composer_resolver, platformRequirementsAreCheckedAgainstConfig) {
+    MemoryFileSystem fileSystem;
+    addPackages(fileSystem);
+    RootPackage root;
+    root.require = {{"a/a", "^1.0"}};
+    root.platform = {{"php", "8.0.0"}};
+
+    // a/a 1.1.0 needs a newer PHP
+    const auto versions = resolveVersions(fileSystem, root);
+    SPAN_CHECK_EQ(versions.at("a/a"), "1.0.0");
+    SPAN_CHECK_EQ(versions.at("b/b"), "1.0.0");
+}
+
+SPAN_TEST(composer_resolver, minimumStabilityAndFlags) {
+    MemoryFileSystem fileSystem;
+    addPackages(fileSystem);
+    RootPackage root;
+    root.require = {{"b/b", "^2.0"}};
+    SPAN_CHECK_EQ(resolveVersions(fileSystem, root).at("b/b"), "2.1.0");
+
+    root.minimumStability = Stability::BETA;
+    SPAN_CHECK_EQ(resolveVersions(fileSystem, root).at("b/b"), "2.2.0-beta1");
+
+    root.preferStable = true;
+    SPAN_CHECK_EQ(resolveVersions(fileSystem, root).at("b/b"), "2.1.0");
+
+    root.minimumStability = Stability::STABLE;
+    root.preferStable = false;
+    root.require = {{"b/b", "^2.0@beta"}};
+    Repository repository("/repo", fileSystem);
+    const auto resolution = resolve(repository, root);
+    SPAN_CHECK_EQ(getVersions(resolution.packages).at("b/b"), "2.2.0-beta1");
+    SPAN_CHECK(resolution.stabilityFlags == StabilityFlags({{"b/b", Stability::BETA}}));
+}
+
+SPAN_TEST(composer_resolver, devRequirementsAreListedApart) {
+    MemoryFileSystem fileSystem;
+    addPackages(fileSystem);
+    RootPackage root;
+    root.require = {{"b/b", "^1.0"}};
+    root.requireDev = {{"c/c", "^1.0"}};
+
+    Repository repository("/repo", fileSystem);
+    const auto resolution = resolve(repository, root);
+    SPAN_CHECK(getVersions(resolution.packages) == Versions({{"b/b", "1.0.0"}}));
+    SPAN_CHECK(getVersions(resolution.devPackages) == Versions({{"a/a", "1.0.0"}, {"c/c", "1.0.0"}}));
+}
+
+SPAN_TEST(composer_resolver, unsatisfiableRequirementsThrow) {
+    MemoryFileSystem fileSystem;
+    addPackages(fileSystem);
+    RootPackage root;
+
+    root.require = {{"a/a", "^3.0"}};
+    SPAN_CHECK(isUnresolvable(fileSystem, root));
+
+    root.require = {{"missing/package", "^1.0"}};
+    SPAN_CHECK(isUnresolvable(fileSystem, root));
+
+    root.require = {{"a/a", "^1.0"}, {"b/b", "^1.0"}};
+    root.conflict = {{"a/a", "1.0.0"}};
+    SPAN_CHECK(isUnresolvable(fileSystem, root));
+}
@@ -0,0 +1,93 @@
+#include "test.h"
+#include "hash.h"
+
+using namespace span::hash;
+
+namespace {
+    // Two blocks for every digest but SHA-512, whose padding still spills into a second one
+    constexpr std::string_view TWO_BLOCKS = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+
+    std::vector<uint8_t> toBytes(const std::string_view text) {
+        return {text.begin(), text.end()};
+    }
+}
+
+SPAN_TEST(hash, md5KnownVectors) {
+    SPAN_CHECK_EQ(toHex(md5("")), "d41d8cd98f00b204e9800998ecf8427e");
+    SPAN_CHECK_EQ(toHex(md5("abc")), "900150983cd24fb0d6963f7d28e17f72");
+    SPAN_CHECK_EQ(toHex(md5(TWO_BLOCKS)), "8215ef0796a20bcaaae116d3876c664a");
+}
+
+SPAN_TEST(hash, sha1KnownVectors) {
+    SPAN_CHECK_EQ(toHex(sha1("")), "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+    SPAN_CHECK_EQ(toHex(sha1("abc")), "a9993e364706816aba3e25717850c26c9cd0d89d");
+    SPAN_CHECK_EQ(toHex(sha1(TWO_BLOCKS)), "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+}
+
+SPAN_TEST(hash, sha256KnownVectors) {
+    SPAN_CHECK_EQ(toHex(sha256("")), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    SPAN_CHECK_EQ(toHex(sha256("abc")), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    SPAN_CHECK_EQ(toHex(sha256(TWO_BLOCKS)), "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    SPAN_CHECK_EQ(
+        toHex(sha256(std::string(1000000, 'a'))),
+        "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"
+    );
+}
+
+SPAN_TEST(hash, sha512KnownVectors) {
+    SPAN_CHECK_EQ(
+        toHex(sha512("")),
+        "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
+        "47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e"
+    );
+    SPAN_CHECK_EQ(
+        toHex(sha512("abc")),
+        "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+        "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f"
+    );
+}
+
+SPAN_TEST(hash, base64AndHex) {
+    SPAN_CHECK_EQ(toBase64(toBytes("")), "");
+    SPAN_CHECK_EQ(toBase64(toBytes("f")), "Zg==");
+    SPAN_CHECK_EQ(toBase64(toBytes("fo")), "Zm8=");
+    SPAN_CHECK_EQ(toBase64(toBytes("foobar")), "Zm9vYmFy");
+
+    SPAN_CHECK(fromHex("00ffAb") == std::vector<uint8_t>({0x00, 0xff, 0xab}));
+    SPAN_CHECK(!fromHex("abc"));
+    SPAN_CHECK(!fromHex("zz"));
+}
+
+SPAN_TEST(hash, integrityMatchesListedHashes) {
+    const std::string data = "package contents";
+    const std::string sha512Hash = "sha512-" + toBase64(sha512(data));
+
+    SPAN_CHECK(matchesIntegrity(sha512Hash, data));
+    SPAN_CHECK(matchesIntegrity("sha1-" + toBase64(sha1(data)), data));
+    SPAN_CHECK(matchesIntegrity("sha256-" + toBase64(sha256(data)) + "?options", data));
+    SPAN_CHECK(!matchesIntegrity(sha512Hash, data + "!"));
+    SPAN_CHECK(!matchesIntegrity("", data));
+    SPAN_CHECK(!matchesIntegrity("md5-" + toBase64(md5(data)), data));
+
+    // URL-safe base64, as some registries write it
+    std::string urlSafe = sha512Hash;
+    for (char& c : urlSafe) {
+        c = c == '+' ? '-' : c == '/' ? '_' : c;
+    }
+    SPAN_CHECK(matchesIntegrity(urlSafe, data));
+}
+
+SPAN_TEST(hash, integrityOnlyTrustsTheStrongestAlgorithm) {
+    const std::string data = "package contents";
+    const std::string goodSha1 = "sha1-" + toBase64(sha1(data));
+    const std::string goodSha512 = "sha512-" + toBase64(sha512(data));
+    const std::string badSha512 = "sha512-" + toBase64(sha512("tampered"));
+
+    // A matching sha1 cannot vouch for data the listed sha512 rejects
+    SPAN_CHECK(!matchesIntegrity(goodSha1 + " " + badSha512, data));
+    SPAN_CHECK(matchesIntegrity(goodSha1 + " " + goodSha512, data));
+    // Any hash of the strongest algorithm may match
+    SPAN_CHECK(matchesIntegrity(badSha512 + "\t" + goodSha512, data));
+    // Unsupported algorithms are ignored
+    SPAN_CHECK(matchesIntegrity("md5-AAAA " + goodSha1, data));
+}
@@ -0,0 +1,52 @@
+#include "test.h"
+#include <exception>
+#include <iostream>
+
+namespace span::test {
+    namespace {
+        size_t failures = 0;
+    }
+
+    std::vector<Case>& getCases() {
+        static std::vector<Case> cases;
+        return cases;
+    }
+
+    void fail(const char* file, const int line, const std::string& message) {
+        ++failures;
+        std::cerr << file << ":" << line << ": check failed: " << message << std::endl;
+    }
+} // namespace span::test
+
+// Runs the cases whose name starts with the first argument, or every case without one
+int main(const int argc, char** argv) {
+    const std::string prefix = argc > 1 ? argv[1] : "";
+
+    size_t run = 0;
+    size_t failed = 0;
+    for (const auto& [name, body] : span::test::getCases()) {
+        if (!name.starts_with(prefix)) {
+            continue;
+        }
+
+        ++run;
+        const size_t before = span::test::failures;
+        try {
+            body();
+        } catch (const std::exception& e) {
+            span::test::fail(name.c_str(), 0, std::string("uncaught exception: ") + e.what());
+        }
+        if (span::test::failures != before) {
+            ++failed;
+            std::cerr << "FAILED " << name << std::endl;
+        }
+    }
+
+    // A filter matching nothing is a typo in the test registration, not a pass
+    if (run == 0) {
+        std::cerr << "No test cases match '" << prefix << "'" << std::endl;
+        return 1;
+    }
+    std::cout << run - failed << " of " << run << " test cases passed" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
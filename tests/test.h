@@ -0,0 +1,66 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace span::test {
+    struct Case {
+        std::string name;
+        void (*body)();
+    };
+
+    /**
+     * Get every test case, in the order they were registered.
+     */
+    std::vector<Case>& getCases();
+
+    /**
+     * Record a failed check; the case keeps running so that one run reports every failure.
+     */
+    void fail(const char* file, int line, const std::string& message);
+
+    struct Registrar {
+        Registrar(std::string name, void (*body)()) {
+            getCases().push_back({std::move(name), body});
+        }
+    };
+
+    template<typename Left, typename Right>
+    void checkEqual(
+        const Left& left,
+        const Right& right,
+        const char* leftText,
+        const char* rightText,
+        const char* file,
+        const int line
+    ) {
+        if (left == right) {
+            return;
+        }
+        std::ostringstream message;
+        message << leftText << " == " << rightText;
+        if constexpr (requires(std::ostream& out) { out << left << right; }) {
+            message << " (" << left << " vs " << right << ")";
+        }
+        fail(file, line, message.str());
+    }
+} // namespace span::test
+
+/**
+ * Define a test case named "<suite>.<name>". ctest runs each suite as a test of its own.
+ */
+#define SPAN_TEST(suite, name) \
+    static void suite##_##name(); \
+    static const ::span::test::Registrar suite##_##name##_registrar(#suite "." #name, suite##_##name); \
+    static void suite##_##name()
+
+#define SPAN_CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            ::span::test::fail(__FILE__, __LINE__, #condition); \
+        } \
+    } while (false)
+
+#define SPAN_CHECK_EQ(left, right) \
+    ::span::test::checkEqual((left), (right), #left, #right, __FILE__, __LINE__)
@@ -0,0 +1,110 @@
+#include "test.h"
+#include "toml.h"
+
+using span::toml::Document;
+using span::toml::NodeType;
+using span::toml::ParseError;
+
+namespace {
+    // Whether parsing fails, and on which line
+    size_t getErrorLine(std::string text) {
+        try {
+            static_cast<void>(Document::parse(std::move(text)));
+        } catch (const ParseError& e) {
+            return e.getLine();
+        }
+        return 0;
+    }
+}
+
+SPAN_TEST(toml, arraysOfTablesAsInLockFiles) {
+    const auto document = Document::parse(
+        "version = 1\n"
+        "\n"
+        "[[package]]\n"
+        "name = \"certifi\"\n"
+        "version = \"2024.2.2\"\n"
+        "wheels = [\n"
+        "    { url = \"https://files.invalid/certifi.whl\", hash = \"sha256:abc\" },\n"
+        "]\n"
+        "\n"
+        "[[package]]\n"
+        "name = \"idna\"\n"
+        "version = \"3.7\"\n"
+        "\n"
+        "[package.dependencies]\n"
+        "certifi = \">=2017\"\n"
+    );
+    const auto root = document.getRoot();
+
+    SPAN_CHECK_EQ(root["version"].getString(), "1");
+    const auto packages = root["package"];
+    SPAN_CHECK(packages.isArray());
+    SPAN_CHECK_EQ(packages.size(), 2u);
+
+    std::vector<std::string_view> names;
+    for (const auto& package : packages) {
+        names.push_back(package["name"].getString());
+    }
+    SPAN_CHECK(names == std::vector<std::string_view>({"certifi", "idna"}));
+
+    // A table header below an array of tables extends its last element
+    const auto first = *packages.begin();
+    const auto second = *std::next(packages.begin());
+    SPAN_CHECK_EQ((*first["wheels"].begin())["hash"].getString(), "sha256:abc");
+    SPAN_CHECK(!first["dependencies"]);
+    SPAN_CHECK_EQ(second["dependencies"]["certifi"].getString(), ">=2017");
+}
+
+SPAN_TEST(toml, dottedKeysAndInlineTables) {
+    const auto document = Document::parse(
+        "tool.poetry.name = \"demo\"\n"
+        "source = { type = \"git\", url = \"https://git.invalid/repo\" }\n"
+        "\"quoted.key\" = 1\n"
+    );
+    const auto root = document.getRoot();
+
+    SPAN_CHECK_EQ(root["tool"]["poetry"]["name"].getString(), "demo");
+    SPAN_CHECK(root["source"].isTable());
+    SPAN_CHECK_EQ(root["source"]["url"].getString(), "https://git.invalid/repo");
+    SPAN_CHECK_EQ(root["quoted.key"].getString(), "1");
+}
+
+SPAN_TEST(toml, stringsAreUnescaped) {
+    const auto document = Document::parse(
+        "basic = \"tab\\there \\u00e9\"\n"
+        "literal = 'C:\\path\\n'\n"
+        "multi = \"\"\"\n"
+        "first\n"
+        "second\"\"\"\n"
+        "literalMulti = '''\n"
+        "raw \\n'''\n"
+        "other = true # comment\n"
+        "date = 1979-05-27T07:32:00Z\n"
+    );
+    const auto root = document.getRoot();
+
+    SPAN_CHECK_EQ(root["basic"].getString(), "tab\there \xc3\xa9");
+    SPAN_CHECK_EQ(root["literal"].getString(), "C:\\path\\n");
+    // A newline right after the opening quotes is trimmed
+    SPAN_CHECK_EQ(root["multi"].getString(), "first\nsecond");
+    SPAN_CHECK_EQ(root["literalMulti"].getString(), "raw \\n");
+    SPAN_CHECK_EQ(root["other"].getString(), "true");
+    SPAN_CHECK_EQ(root["date"].getString(), "1979-05-27T07:32:00Z");
+}
+
+SPAN_TEST(toml, missingNodesAreEmpty) {
+    const auto document = Document::parse("[a]\nb = 1\n");
+    const auto missing = document.getRoot()["a"]["x"]["y"];
+
+    SPAN_CHECK(missing.getType() == NodeType::NONE);
+    SPAN_CHECK(!missing);
+    SPAN_CHECK_EQ(missing.size(), 0u);
+}
+
+SPAN_TEST(toml, malformedInputIsRejectedWithItsLine) {
+    SPAN_CHECK_EQ(getErrorLine("a = 1\na = 2\n"), 2u);
+    SPAN_CHECK_EQ(getErrorLine("a = 1\nb = \"unterminated\n"), 2u);
+    SPAN_CHECK_EQ(getErrorLine("a = 1\n\n[table\n"), 3u);
+    SPAN_CHECK_EQ(getErrorLine("key\n"), 1u);
+}
@@ -0,0 +1,97 @@
+#include "test.h"
+#include "vfs.h"
+#include <map>
+
+namespace fs = std::filesystem;
+using span::vfs::FileType;
+using span::vfs::MemoryFileSystem;
+
+SPAN_TEST(vfs, memoryWritesReadsAndRenames) {
+    MemoryFileSystem fileSystem;
+    fileSystem.createDirectories("/project/vendor");
+    fileSystem.writeFile("/project/composer.lock", "{}");
+
+    SPAN_CHECK_EQ(fileSystem.readFile("/project/composer.lock"), "{}");
+    SPAN_CHECK_EQ(fileSystem.status("/project/composer.lock").size, 2u);
+    SPAN_CHECK(fileSystem.isEmptyDirectory("/project/vendor"));
+
+    fileSystem.rename("/project/composer.lock", "/project/vendor/composer.lock");
+    SPAN_CHECK(!fileSystem.exists("/project/composer.lock"));
+    SPAN_CHECK(!fileSystem.isEmptyDirectory("/project/vendor"));
+    SPAN_CHECK_EQ(fileSystem.readFile("/project/vendor/composer.lock"), "{}");
+}
+
+SPAN_TEST(vfs, memoryRenameOntoNonEmptyDirectoryFails) {
+    MemoryFileSystem fileSystem;
+    fileSystem.createDirectories("/cache/a/1.0.0.partial");
+    fileSystem.createDirectories("/cache/a/1.0.0");
+    fileSystem.writeFile("/cache/a/1.0.0/index.js", "");
+
+    bool thrown = false;
+    try {
+        fileSystem.rename("/cache/a/1.0.0.partial", "/cache/a/1.0.0");
+    } catch (const fs::filesystem_error&) {
+        thrown = true;
+    }
+    SPAN_CHECK(thrown);
+    SPAN_CHECK(fileSystem.exists("/cache/a/1.0.0.partial"));
+}
+
+SPAN_TEST(vfs, memoryRemoveAllLeavesSiblingsSharingAPrefix) {
+    // "/a/b-c" and "/a/b.partial" sort between "/a/b" and its children
+    MemoryFileSystem fileSystem;
+    fileSystem.createDirectories("/a/b/c");
+    fileSystem.createDirectories("/a/b-c");
+    fileSystem.createDirectories("/a/b.partial");
+    fileSystem.writeFile("/a/b/c/file", "x");
+
+    SPAN_CHECK_EQ(fileSystem.removeAll("/a/b"), 3u);
+    SPAN_CHECK(!fileSystem.exists("/a/b"));
+    SPAN_CHECK(fileSystem.exists("/a/b-c"));
+    SPAN_CHECK(fileSystem.exists("/a/b.partial"));
+    SPAN_CHECK_EQ(fileSystem.removeAll("/a/missing"), 0u);
+}
+
+SPAN_TEST(vfs, memoryWalkCountsDepthFromTheRootsChildren) {
+    MemoryFileSystem fileSystem;
+    fileSystem.createDirectories("/root/a/b");
+    fileSystem.writeFile("/root/a/b/file", "x");
+    fileSystem.writeFile("/root/top", "x");
+
+    std::map<std::string, size_t> depths;
+    fileSystem.walk("/root", [&](const fs::path& path, const span::vfs::Status&, const size_t depth) {
+        depths[path.string()] = depth;
+    });
+
+    SPAN_CHECK_EQ(depths.size(), 4u);
+    SPAN_CHECK_EQ(depths["/root/a"], 0u);
+    SPAN_CHECK_EQ(depths["/root/top"], 0u);
+    SPAN_CHECK_EQ(depths["/root/a/b"], 1u);
+    SPAN_CHECK_EQ(depths["/root/a/b/file"], 2u);
+}
+
+SPAN_TEST(vfs, memorySymlinksResolveAgainstTheirDirectory) {
+    MemoryFileSystem fileSystem;
+    fileSystem.createDirectories("/cache/a/1.0.0");
+    fileSystem.writeFile("/cache/a/1.0.0/index.js", "module");
+    fileSystem.createDirectories("/project/node_modules");
+    fileSystem.createSymlink("../../cache/a/1.0.0", "/project/node_modules/a");
+
+    SPAN_CHECK(fileSystem.symlinkStatus("/project/node_modules/a").type == FileType::SYMLINK);
+    SPAN_CHECK(fileSystem.status("/project/node_modules/a").isDirectory());
+    SPAN_CHECK_EQ(fileSystem.readSymlink("/project/node_modules/a"), fs::path("../../cache/a/1.0.0"));
+    SPAN_CHECK_EQ(fileSystem.readFile("/project/node_modules/a/index.js"), "module");
+
+    // Removing the link leaves its target
+    fileSystem.removeAll("/project/node_modules/a");
+    SPAN_CHECK(fileSystem.exists("/cache/a/1.0.0/index.js"));
+}
+
+SPAN_TEST(vfs, memorySparseFilesReadBackAsZeros) {
+    MemoryFileSystem fileSystem;
+    fileSystem.createDirectories("/cache");
+    fileSystem.createFile("/cache/blob", 4);
+
+    SPAN_CHECK_EQ(fileSystem.status("/cache/blob").size, 4u);
+    SPAN_CHECK_EQ(fileSystem.readFile("/cache/blob"), std::string(4, '\0'));
+}
@@ -0,0 +1,111 @@
+#include "test.h"
+#include "yaml.h"
+
+using span::yaml::Document;
+using span::yaml::NodeType;
+using span::yaml::ParseError;
+
+namespace {
+    // Whether parsing fails, and on which line
+    size_t getErrorLine(std::string text) {
+        try {
+            static_cast<void>(Document::parse(std::move(text)));
+        } catch (const ParseError& e) {
+            return e.getLine();
+        }
+        return 0;
+    }
+}
+
+SPAN_TEST(yaml, blockMappingsAndSequences) {
+    const auto document = Document::parse(
+        "lockfileVersion: '9.0'\n"
+        "\n"
+        "importers:\n"
+        "  .:\n"
+        "    dependencies:\n"
+        "      is-odd:\n"
+        "        specifier: ^3.0.1\n"
+        "        version: 3.0.1\n"
+        "packages:\n"
+        "  is-odd@3.0.1:\n"
+        "    os: [darwin, linux]\n"
+        "    cpu:\n"
+        "      - x64\n"
+        "      - arm64\n"
+    );
+    const auto root = document.getRoot();
+
+    SPAN_CHECK(root.isMapping());
+    SPAN_CHECK_EQ(root["lockfileVersion"].getString(), "9.0");
+    SPAN_CHECK_EQ(root["importers"]["."]["dependencies"]["is-odd"]["version"].getString(), "3.0.1");
+
+    const auto package = root["packages"]["is-odd@3.0.1"];
+    SPAN_CHECK_EQ(package["os"].size(), 2u);
+    SPAN_CHECK(package["cpu"].isSequence());
+
+    std::vector<std::string_view> cpus;
+    for (const auto& cpu : package["cpu"]) {
+        cpus.push_back(cpu.getString());
+    }
+    SPAN_CHECK(cpus == std::vector<std::string_view>({"x64", "arm64"}));
+}
+
+SPAN_TEST(yaml, entriesKeepTheirOrder) {
+    const auto document = Document::parse("b: 1\na: 2\nc: 3\n");
+    std::string keys;
+    for (const auto& entry : document.getRoot()) {
+        keys += entry.getKey();
+    }
+    SPAN_CHECK_EQ(keys, "bac");
+}
+
+SPAN_TEST(yaml, scalarsAreReturnedAsWritten) {
+    const auto document = Document::parse(
+        "plain: true   # a comment\n"
+        "number: 1.0\n"
+        "null: ~\n"
+        "single: 'it''s'\n"
+        "double: \"tab\\there\"\n"
+        "colon: 'a: b'\n"
+        "flow: {resolution: {integrity: sha512-abc}, dev: false}\n"
+    );
+    const auto root = document.getRoot();
+
+    SPAN_CHECK_EQ(root["plain"].getString(), "true");
+    SPAN_CHECK_EQ(root["number"].getString(), "1.0");
+    SPAN_CHECK_EQ(root["null"].getString(), "~");
+    SPAN_CHECK_EQ(root["single"].getString(), "it's");
+    SPAN_CHECK_EQ(root["double"].getString(), "tab\there");
+    SPAN_CHECK_EQ(root["colon"].getString(), "a: b");
+    SPAN_CHECK_EQ(root["flow"]["resolution"]["integrity"].getString(), "sha512-abc");
+    SPAN_CHECK_EQ(root["flow"]["dev"].getString(), "false");
+}
+
+SPAN_TEST(yaml, missingNodesAreEmpty) {
+    const auto document = Document::parse("a:\n  b: c\n");
+    const auto missing = document.getRoot()["x"]["y"];
+
+    SPAN_CHECK(missing.getType() == NodeType::NONE);
+    SPAN_CHECK(!missing);
+    SPAN_CHECK_EQ(missing.getString(), "");
+    SPAN_CHECK_EQ(missing.size(), 0u);
+}
+
+SPAN_TEST(yaml, documentsAreSeparatedByMarkers) {
+    const auto document = Document::parse("---\nfirst: 1\n---\nsecond: 2\n");
+
+    SPAN_CHECK_EQ(document.getDocumentCount(), 2u);
+    SPAN_CHECK_EQ(document.getRoot(0)["first"].getString(), "1");
+    SPAN_CHECK_EQ(document.getRoot(1)["second"].getString(), "2");
+    SPAN_CHECK(!document.getRoot(2));
+}
+
+SPAN_TEST(yaml, unsupportedSyntaxIsRejectedWithItsLine) {
+    SPAN_CHECK_EQ(getErrorLine("a: 1\nb: &anchor 2\n"), 2u);
+    SPAN_CHECK_EQ(getErrorLine("a: 1\nb: *anchor\n"), 2u);
+    SPAN_CHECK_EQ(getErrorLine("a: |\n  text\n"), 1u);
+    // Flow collections may span lines, so an unclosed one is only noticed at the end
+    SPAN_CHECK_EQ(getErrorLine("a: [1, 2\n"), 2u);
+    SPAN_CHECK_EQ(getErrorLine("a: 'unterminated\n"), 1u);
+}